@@ -0,0 +1,395 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sqlite3.h>
+#include "batch.h"
+#include "db_api/orders.h"
+#include "db_api/import.h"
+#include "db_api/offers.h"
+
+typedef enum {
+    CMD_CREATE,
+    CMD_MODIFY,
+    CMD_DELETE,
+    CMD_REPORT,
+    CMD_IMPORT,
+    CMD_REBUILD,
+    CMD_COMMIT,
+    CMD_COUNT // number of command types, keep last
+} CommandType;
+
+typedef struct {
+    const char *name;
+    long ok;
+    long failed;
+    double seconds;
+} CommandStats;
+
+typedef struct {
+    const char *name;
+    void (*run)(sqlite3 *db);
+} BatchReport;
+
+typedef struct {
+    const char *name;
+    int (*run)(sqlite3 *db);
+} BatchRebuild;
+
+// Derived tables that are normally maintained by triggers and can be recomputed from scratch
+static const BatchRebuild rebuilds[] = {
+    {"best-offers", RebuildBestOffers},
+    {"client-shop-cost", RebuildClientShopCost},
+};
+
+static const BatchReport reports[] = {
+    {"grouped", PrintOrdersGroupedByClient},
+    {"by-count", PrintAllOrdersByClientOrderCount},
+    {"cheapest-offers", PrintCheapestOffersForAllClientOrders},
+    {"cheapest-shop", FindCheapestShopPerClient},
+    {"savings", PrintPotentialSavingsPerClient},
+};
+
+typedef struct {
+    sqlite3 *db;
+    int inTransaction;
+    long transactions; // committed write transactions
+    CommandStats stats[CMD_COUNT];
+} BatchState;
+
+static double NowSeconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int BeginWrites(BatchState *state)
+{
+    if (state->inTransaction)
+    {
+        return SQLITE_OK;
+    }
+    int rs = sqlite3_exec(state->db, "BEGIN;", NULL, NULL, NULL);
+    if (rs != SQLITE_OK)
+    {
+        fprintf(stderr, "Error starting transaction: %s\n", sqlite3_errmsg(state->db));
+        return rs;
+    }
+    state->inTransaction = 1;
+    return SQLITE_OK;
+}
+
+static int CommitWrites(BatchState *state)
+{
+    if (!state->inTransaction)
+    {
+        return SQLITE_OK;
+    }
+    int rs = sqlite3_exec(state->db, "COMMIT;", NULL, NULL, NULL);
+    if (rs != SQLITE_OK)
+    {
+        fprintf(stderr, "Error committing transaction: %s\n", sqlite3_errmsg(state->db));
+        sqlite3_exec(state->db, "ROLLBACK;", NULL, NULL, NULL);
+    }
+    else
+    {
+        state->transactions++;
+    }
+    state->inTransaction = 0;
+    return rs;
+}
+
+static int RunCreate(BatchState *state, const char *line, int lineNo)
+{
+    char cmd[16];
+    Order order = {0};
+    if (sscanf(line, "%15s %d %d %d", cmd, &order.client_id, &order.product_id, &order.amount) != 4)
+    {
+        fprintf(stderr, "line %d: usage: create <client_id> <product_id> <amount>\n", lineNo);
+        return 0;
+    }
+    if (BeginWrites(state) != SQLITE_OK)
+    {
+        return 0;
+    }
+    if (InsertOrder(state->db, &order) != SQLITE_DONE)
+    {
+        fprintf(stderr, "line %d: could not create order\n", lineNo);
+        return 0;
+    }
+    printf("Created order %d\n", order.id);
+    return 1;
+}
+
+static int RunModify(BatchState *state, const char *line, int lineNo)
+{
+    char cmd[16];
+    int orderId, amount, clientId, productId;
+    int fields = sscanf(line, "%15s %d %d %d %d", cmd, &orderId, &amount, &clientId, &productId);
+    if (fields != 3 && fields != 5)
+    {
+        fprintf(stderr, "line %d: usage: modify <order_id> <amount> [<client_id> <product_id>]\n", lineNo);
+        return 0;
+    }
+    if (BeginWrites(state) != SQLITE_OK)
+    {
+        return 0;
+    }
+
+    Order order = {0};
+    if (GetOrderById(state->db, orderId, &order) != SQLITE_ROW)
+    {
+        fprintf(stderr, "line %d: order %d not found\n", lineNo, orderId);
+        return 0;
+    }
+    order.amount = amount;
+    if (fields == 5)
+    {
+        order.client_id = clientId;
+        order.product_id = productId;
+    }
+    if (ModifyOrder(state->db, &order) != SQLITE_DONE)
+    {
+        fprintf(stderr, "line %d: could not modify order %d\n", lineNo, orderId);
+        return 0;
+    }
+    return 1;
+}
+
+static int RunDelete(BatchState *state, const char *line, int lineNo)
+{
+    char cmd[16];
+    int orderId;
+    if (sscanf(line, "%15s %d", cmd, &orderId) != 2)
+    {
+        fprintf(stderr, "line %d: usage: delete <order_id>\n", lineNo);
+        return 0;
+    }
+    if (BeginWrites(state) != SQLITE_OK)
+    {
+        return 0;
+    }
+    if (DeleteOrder(state->db, orderId) != SQLITE_DONE)
+    {
+        fprintf(stderr, "line %d: could not delete order %d\n", lineNo, orderId);
+        return 0;
+    }
+    if (sqlite3_changes(state->db) == 0)
+    {
+        fprintf(stderr, "line %d: order %d not found\n", lineNo, orderId);
+        return 0;
+    }
+    return 1;
+}
+
+static int RunReport(BatchState *state, const char *line, int lineNo)
+{
+    char cmd[16];
+    char name[32];
+    if (sscanf(line, "%15s %31s", cmd, name) != 2)
+    {
+        fprintf(stderr, "line %d: usage: report <name>\n", lineNo);
+        return 0;
+    }
+    // Reports must see the writes that came before them
+    if (CommitWrites(state) != SQLITE_OK)
+    {
+        return 0;
+    }
+    for (size_t i = 0; i < sizeof(reports) / sizeof(reports[0]); i++)
+    {
+        if (strcmp(reports[i].name, name) == 0)
+        {
+            reports[i].run(state->db);
+            return 1;
+        }
+    }
+    fprintf(stderr, "line %d: unknown report '%s'\n", lineNo, name);
+    return 0;
+}
+
+static int RunRebuild(BatchState *state, const char *line, int lineNo)
+{
+    char cmd[16];
+    char name[32];
+    if (sscanf(line, "%15s %31s", cmd, name) != 2)
+    {
+        fprintf(stderr, "line %d: usage: rebuild <name>\n", lineNo);
+        return 0;
+    }
+    // The rebuild runs in its own transaction
+    if (CommitWrites(state) != SQLITE_OK)
+    {
+        return 0;
+    }
+    for (size_t i = 0; i < sizeof(rebuilds) / sizeof(rebuilds[0]); i++)
+    {
+        if (strcmp(rebuilds[i].name, name) == 0)
+        {
+            return rebuilds[i].run(state->db) == SQLITE_OK;
+        }
+    }
+    fprintf(stderr, "line %d: unknown rebuild '%s'\n", lineNo, name);
+    return 0;
+}
+
+static int RunImportCommand(BatchState *state, const char *line, int lineNo)
+{
+    char cmd[16];
+    char path[256];
+    int chunkSize = 0;
+    int fields = sscanf(line, "%15s %255s %d", cmd, path, &chunkSize);
+    if (fields < 2)
+    {
+        fprintf(stderr, "line %d: usage: import <file.csv> [<chunk_size>]\n", lineNo);
+        return 0;
+    }
+    // The import commits in its own chunks, so pending writes go first
+    if (CommitWrites(state) != SQLITE_OK)
+    {
+        return 0;
+    }
+    return RunImport(state->db, path, chunkSize) == SQLITE_OK;
+}
+
+int RunImport(sqlite3 *db, const char *path, int chunkSize)
+{
+    FILE *input = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+    if (input == NULL)
+    {
+        fprintf(stderr, "Could not open import file '%s'\n", path);
+        return -1;
+    }
+    ImportStats stats;
+    int rs = ImportOrdersCsv(db, input, chunkSize, &stats);
+    if (input != stdin)
+    {
+        fclose(input);
+    }
+    PrintImportStats(&stats);
+    return rs;
+}
+
+static void PrintSummary(const BatchState *state, double totalSeconds)
+{
+    long commands = 0;
+    printf("\n=== Batch summary ===\n");
+    printf("%-8s %8s %8s %12s %12s\n", "command", "ok", "failed", "total ms", "avg ms");
+    for (int i = 0; i < CMD_COUNT; i++)
+    {
+        const CommandStats *s = &state->stats[i];
+        long count = s->ok + s->failed;
+        if (count == 0)
+        {
+            continue;
+        }
+        commands += count;
+        printf("%-8s %8ld %8ld %12.3f %12.3f\n", s->name, s->ok, s->failed, s->seconds * 1000.0,
+               s->seconds * 1000.0 / count);
+    }
+    printf("%ld commands in %.3f s (%.0f commands/s), %ld write transaction(s) committed\n", commands, totalSeconds,
+           totalSeconds > 0.0 ? commands / totalSeconds : 0.0, state->transactions);
+}
+
+int RunBatch(sqlite3 *db, FILE *input)
+{
+    BatchState state = {
+        .db = db,
+        .inTransaction = 0,
+        .transactions = 0,
+        .stats = {
+            [CMD_CREATE] = {.name = "create"},
+            [CMD_MODIFY] = {.name = "modify"},
+            [CMD_DELETE] = {.name = "delete"},
+            [CMD_REPORT] = {.name = "report"},
+            [CMD_IMPORT] = {.name = "import"},
+            [CMD_REBUILD] = {.name = "rebuild"},
+            [CMD_COMMIT] = {.name = "commit"},
+        }};
+
+    double batchStart = NowSeconds();
+    char line[512];
+    int lineNo = 0;
+    long failures = 0;
+    while (fgets(line, sizeof(line), input) != NULL)
+    {
+        lineNo++;
+        char cmd[16];
+        if (sscanf(line, "%15s", cmd) != 1 || cmd[0] == '#')
+        {
+            continue; // Blank line or comment
+        }
+
+        CommandType type;
+        if (strcmp(cmd, "create") == 0)
+            type = CMD_CREATE;
+        else if (strcmp(cmd, "modify") == 0)
+            type = CMD_MODIFY;
+        else if (strcmp(cmd, "delete") == 0)
+            type = CMD_DELETE;
+        else if (strcmp(cmd, "report") == 0)
+            type = CMD_REPORT;
+        else if (strcmp(cmd, "import") == 0)
+            type = CMD_IMPORT;
+        else if (strcmp(cmd, "rebuild") == 0)
+            type = CMD_REBUILD;
+        else if (strcmp(cmd, "commit") == 0)
+            type = CMD_COMMIT;
+        else
+        {
+            fprintf(stderr, "line %d: unknown command '%s'\n", lineNo, cmd);
+            failures++;
+            continue;
+        }
+
+        double start = NowSeconds();
+        int ok = 0;
+        switch (type)
+        {
+        case CMD_CREATE:
+            ok = RunCreate(&state, line, lineNo);
+            break;
+        case CMD_MODIFY:
+            ok = RunModify(&state, line, lineNo);
+            break;
+        case CMD_DELETE:
+            ok = RunDelete(&state, line, lineNo);
+            break;
+        case CMD_REPORT:
+            ok = RunReport(&state, line, lineNo);
+            break;
+        case CMD_IMPORT:
+            ok = RunImportCommand(&state, line, lineNo);
+            break;
+        case CMD_REBUILD:
+            ok = RunRebuild(&state, line, lineNo);
+            break;
+        case CMD_COMMIT:
+            ok = CommitWrites(&state) == SQLITE_OK;
+            break;
+        default:
+            break;
+        }
+
+        CommandStats *stats = &state.stats[type];
+        stats->seconds += NowSeconds() - start;
+        if (ok)
+        {
+            stats->ok++;
+        }
+        else
+        {
+            stats->failed++;
+            failures++;
+        }
+    }
+
+    if (CommitWrites(&state) != SQLITE_OK)
+    {
+        failures++;
+    }
+
+    PrintSummary(&state, NowSeconds() - batchStart);
+    return (int)failures;
+}
@@ -0,0 +1,44 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdio.h>
+#include <sqlite3.h>
+
+/**
+ * @brief Runs order commands from a script without prompting the user.
+ *
+ * One command per line, blank lines and lines starting with '#' are ignored:
+ *
+ *  - create <client_id> <product_id> <amount>
+ *
+ *  - modify <order_id> <amount> [<client_id> <product_id>]
+ *
+ *  - delete <order_id>
+ *
+ *  - report <grouped|by-count|cheapest-offers|cheapest-shop|savings>
+ *
+ *  - import <file.csv> [<chunk_size>]
+ *
+ *  - rebuild <best-offers|client-shop-cost>
+ *
+ *  - commit
+ *
+ * Consecutive writes share one transaction, it is committed before a report runs,
+ * on an explicit commit and at the end of the input. A timing summary is printed at the end.
+ *
+ * @param db Pointer to the SQLite database connection.
+ * @param input Stream to read the commands from.
+ * @returns Number of commands that failed.
+ */
+int RunBatch(sqlite3 *db, FILE *input);
+
+/**
+ * @brief Imports orders from a CSV file (client_id,product_id,amount) and prints the import summary.
+ * @param db Pointer to the SQLite database connection.
+ * @param path Path to the CSV file, - for stdin.
+ * @param chunkSize Orders per transaction, default chunk size if <= 0.
+ * @returns SQLITE_OK on success or sqlite3 error code, -1 if the file could not be opened.
+ */
+int RunImport(sqlite3 *db, const char *path, int chunkSize);
+
+#endif // BATCH_H
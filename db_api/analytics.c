@@ -0,0 +1,738 @@
+#include <sqlite3.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+#include "analytics.h"
+#include "connection.h"
+#include "stmt_cache.h"
+#include "price_matrix.h"
+#include "orders.h"
+
+typedef enum {
+    ENGINE_AUTO,
+    ENGINE_SQL,
+    ENGINE_MATRIX,
+} AnalyticsEngine;
+
+typedef struct {
+    int id;
+    char *name;
+} ShopName;
+
+struct ClientCostSet {
+    ClientCostSummary *summaries;
+    size_t count;
+    size_t allocated;
+
+    // Client and shop names one after another, the summaries point into it once the scan is done
+    char *names;
+    size_t namesUsed;
+    size_t namesAllocated;
+    size_t *nameOffsets;       // first name, last name, best and worst shop name offsets per summary while scanning
+};
+
+struct Analytics {
+    sqlite3 *db;
+    AnalyticsEngine engine;
+    int stale;                 // set by changes, the next call recomputes
+    sqlite3_int64 dataVersion;
+
+    PriceMatrix matrix;        // built by the matrix engine, kept while offers and shops do not change
+    int matrixStale;
+    sqlite3_int64 matrixVersion;
+    double *basketCost;        // per-shop scratch for one client, basketStride each
+    double *basketPriced;
+    int basketStride;
+
+    ShopName *shops;           // ascending by id
+    size_t shopCount;
+
+    ClientCostSet summaries;   // all clients, returned by GetClientCostSummaries
+};
+
+// Client id range of one computation, the whole table unless a range was asked for
+typedef struct {
+    int first;
+    int last;
+} ClientRange;
+
+static const ClientRange allClients = {INT_MIN, INT_MAX};
+
+static void *Grow(void *p, size_t *allocated, size_t needed, size_t elementSize)
+{
+    if (needed <= *allocated)
+    {
+        return p;
+    }
+    size_t size = *allocated ? *allocated : 64;
+    while (size < needed)
+    {
+        size *= 2;
+    }
+    void *grown = realloc(p, size * elementSize);
+    if (grown == NULL)
+    {
+        fprintf(stderr, "Memory allocation failed for analytics.\n");
+        exit(EXIT_FAILURE);
+    }
+    *allocated = size;
+    return grown;
+}
+
+static void FreeShops(Analytics *analytics)
+{
+    for (size_t i = 0; i < analytics->shopCount; i++)
+    {
+        free(analytics->shops[i].name);
+    }
+    free(analytics->shops);
+    analytics->shops = NULL;
+    analytics->shopCount = 0;
+}
+
+static sqlite3_int64 QueryDataVersion(sqlite3 *db)
+{
+    sqlite3_stmt *stmt;
+    sqlite3_int64 version = -1;
+    if (PrepareCached(db, "PRAGMA data_version;", &stmt) != SQLITE_OK)
+    {
+        return -1;
+    }
+    if (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        version = sqlite3_column_int64(stmt, 0);
+    }
+    ReleaseStatement(stmt);
+    return version;
+}
+
+static int LoadShops(Analytics *analytics)
+{
+    FreeShops(analytics);
+
+    sqlite3_stmt *stmt;
+    int rs;
+    if ((rs = PrepareCached(analytics->db, "SELECT id, name FROM shops ORDER BY id;", &stmt)) != SQLITE_OK)
+    {
+        fprintf(stderr, "Error preparing statement: %s\n", sqlite3_errmsg(analytics->db));
+        return rs;
+    }
+    size_t allocated = 0;
+    while ((rs = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        const char *name = (const char *)sqlite3_column_text(stmt, 1);
+        char *copy = strdup(name ? name : "");
+        if (copy == NULL)
+        {
+            fprintf(stderr, "Memory allocation failed for analytics.\n");
+            exit(EXIT_FAILURE);
+        }
+        analytics->shops = Grow(analytics->shops, &allocated, analytics->shopCount + 1, sizeof(ShopName));
+        analytics->shops[analytics->shopCount].id = sqlite3_column_int(stmt, 0);
+        analytics->shops[analytics->shopCount].name = copy;
+        analytics->shopCount++;
+    }
+    if (rs != SQLITE_DONE)
+    {
+        fprintf(stderr, "Error executing statement: %s - %s\n", sqlite3_errstr(rs), sqlite3_errmsg(analytics->db));
+        ReleaseStatement(stmt);
+        return rs;
+    }
+    ReleaseStatement(stmt);
+    return SQLITE_OK;
+}
+
+static const ShopName *FindShop(const Analytics *analytics, int id)
+{
+    size_t lo = 0;
+    size_t hi = analytics->shopCount;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (analytics->shops[mid].id < id)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    return lo < analytics->shopCount && analytics->shops[lo].id == id ? &analytics->shops[lo] : NULL;
+}
+
+static size_t AppendName(ClientCostSet *set, const char *name)
+{
+    const char *text = name ? name : "";
+    size_t len = strlen(text) + 1;
+    size_t offset = set->namesUsed;
+    set->names = Grow(set->names, &set->namesAllocated, offset + len, 1);
+    memcpy(set->names + offset, text, len);
+    set->namesUsed += len;
+    return offset;
+}
+
+// Shop names are copied as well, the set outlives the shops loaded for the next computation
+static void AppendSummary(ClientCostSet *set, const ClientCostSummary *summary, const unsigned char *firstName,
+                          const unsigned char *lastName)
+{
+    size_t offsetsAllocated = set->allocated;
+    set->summaries = Grow(set->summaries, &set->allocated, set->count + 1, sizeof(ClientCostSummary));
+    if (set->allocated != offsetsAllocated || set->nameOffsets == NULL)
+    {
+        set->nameOffsets = realloc(set->nameOffsets, set->allocated * 4 * sizeof(size_t));
+        if (set->nameOffsets == NULL)
+        {
+            fprintf(stderr, "Memory allocation failed for analytics.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    size_t *offsets = &set->nameOffsets[set->count * 4];
+    offsets[0] = AppendName(set, (const char *)firstName);
+    offsets[1] = AppendName(set, (const char *)lastName);
+    offsets[2] = AppendName(set, summary->bestShopName);
+    offsets[3] = AppendName(set, summary->worstShopName);
+    set->summaries[set->count++] = *summary;
+}
+
+// Points the summaries into the name buffer, which no longer moves
+static void FinishSet(ClientCostSet *set)
+{
+    for (size_t i = 0; i < set->count; i++)
+    {
+        const size_t *offsets = &set->nameOffsets[i * 4];
+        set->summaries[i].firstName = set->names + offsets[0];
+        set->summaries[i].lastName = set->names + offsets[1];
+        set->summaries[i].bestShopName = set->names + offsets[2];
+        set->summaries[i].worstShopName = set->names + offsets[3];
+    }
+}
+
+static void FreeSet(ClientCostSet *set)
+{
+    free(set->summaries);
+    free(set->nameOffsets);
+    free(set->names);
+}
+
+/**
+ * @brief Rebuilds all summaries in one grouped pass: per-client order counts come out of
+ * idx_orders_client_product, each client's shop costs are a primary key range of client_shop_cost,
+ * and argmin/argmax pick the best and worst shop inside SQLite.
+ *
+ * The scan is driven by the clients rowid range so the groups stream in client order: grouping on
+ * the order counts subquery instead sorts every (client, shop) row through a temp b-tree.
+ */
+static int ComputeSql(Analytics *analytics, ClientRange range, ClientCostSet *set)
+{
+    sqlite3 *db = analytics->db;
+    int rs;
+    if ((rs = EnableClientShopCost(db)) != SQLITE_OK)
+    {
+        return rs;
+    }
+
+    // argmin/argmax break ties by the lowest shop id, whatever order the grouping delivers rows in.
+    // client_shop_cost counts an order once per shop however many offers the shop has for its product,
+    // so a shop pricing as many orders as the client has carries them all.
+    // The client's coverage comes from basket_cost over the cheapest offer of each order's product:
+    // every order is an item, orders of products nobody offers are the missing ones. MATERIALIZED keeps the
+    // JSON parsed once per client rather than once per (client, shop) row of the join.
+    sqlite3_stmt *stmt;
+    if ((rs = PrepareCached(db,
+                            "WITH coverage AS MATERIALIZED ("
+                            "SELECT client_id, json_extract(basket, '$.items') AS orders_count, "
+                            "json_extract(basket, '$.items') - json_extract(basket, '$.missing') AS orders_priced "
+                            "FROM (SELECT o.client_id, basket_cost((SELECT best.price FROM product_best_offer AS best "
+                            "WHERE best.product_id = o.product_id LIMIT 1), o.amount) AS basket "
+                            "FROM orders AS o WHERE o.client_id BETWEEN ?1 AND ?2 GROUP BY o.client_id)) "
+                            "SELECT cl.id, cl.first_name, cl.last_name, "
+                            "argmin(c.total_cost, c.shop_id), MIN(c.total_cost), "
+                            "argmax(c.total_cost, c.shop_id), MAX(c.total_cost), "
+                            "COUNT(*), SUM(c.orders_count >= oc.orders_count), oc.orders_count, oc.orders_priced "
+                            "FROM clients AS cl "
+                            "CROSS JOIN coverage AS oc ON oc.client_id = cl.id "
+                            "CROSS JOIN client_shop_cost AS c ON c.client_id = cl.id "
+                            "CROSS JOIN shops AS sh ON sh.id = c.shop_id "
+                            "WHERE cl.id BETWEEN ?1 AND ?2 "
+                            "GROUP BY cl.id ORDER BY cl.id;",
+                            &stmt)) != SQLITE_OK)
+    {
+        fprintf(stderr, "Error preparing statement: %s\n", sqlite3_errmsg(db));
+        return rs;
+    }
+
+    sqlite3_bind_int(stmt, 1, range.first);
+    sqlite3_bind_int(stmt, 2, range.last);
+    while ((rs = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        const ShopName *best = FindShop(analytics, sqlite3_column_int(stmt, 3));
+        const ShopName *worst = FindShop(analytics, sqlite3_column_int(stmt, 5));
+        ClientCostSummary summary = {
+            .clientId = sqlite3_column_int(stmt, 0),
+            .bestShopId = sqlite3_column_int(stmt, 3),
+            .bestShopName = best ? best->name : "",
+            .bestCost = sqlite3_column_double(stmt, 4),
+            .worstShopId = sqlite3_column_int(stmt, 5),
+            .worstShopName = worst ? worst->name : "",
+            .worstCost = sqlite3_column_double(stmt, 6),
+            .shopsPriced = sqlite3_column_int(stmt, 7),
+            .shopsIncomplete = (int)analytics->shopCount - sqlite3_column_int(stmt, 8),
+            .ordersCount = sqlite3_column_int(stmt, 9),
+            .ordersPriced = sqlite3_column_int(stmt, 10)};
+        AppendSummary(set, &summary, sqlite3_column_text(stmt, 1), sqlite3_column_text(stmt, 2));
+    }
+    ReleaseStatement(stmt);
+    if (rs != SQLITE_DONE)
+    {
+        fprintf(stderr, "Error executing statement: %s - %s\n", sqlite3_errstr(rs), sqlite3_errmsg(db));
+        return rs;
+    }
+    return SQLITE_OK;
+}
+
+/**
+ * @brief Turns one client's per-shop basket into a summary, skips clients that are not in clients
+ * (the cursor over clients advances in step with the client ids) or that no shop prices anything.
+ */
+static int FinishMatrixClient(Analytics *analytics, const PriceMatrix *matrix, ClientCostSet *set,
+                              sqlite3_stmt *clients, int *clientsRs, int clientId, int ordersCount, int ordersPriced)
+{
+    while (*clientsRs == SQLITE_ROW && sqlite3_column_int(clients, 0) < clientId)
+    {
+        *clientsRs = sqlite3_step(clients);
+    }
+    if (*clientsRs == SQLITE_DONE)
+    {
+        return SQLITE_OK;
+    }
+    if (*clientsRs != SQLITE_ROW)
+    {
+        fprintf(stderr, "Error executing statement: %s - %s\n", sqlite3_errstr(*clientsRs),
+                sqlite3_errmsg(analytics->db));
+        return *clientsRs;
+    }
+    if (sqlite3_column_int(clients, 0) != clientId)
+    {
+        return SQLITE_OK;
+    }
+
+    ClientCostSummary summary = {.clientId = clientId, .ordersCount = ordersCount, .ordersPriced = ordersPriced};
+    int complete = 0;
+    for (int s = 0; s < matrix->shopCount; s++)
+    {
+        if (analytics->basketPriced[s] == 0.0)
+        {
+            continue;
+        }
+        // Rounded like the client_shop_cost totals, so equal baskets tie and the lower shop id wins
+        double cost = round(analytics->basketCost[s] * 1e4) / 1e4;
+        if (summary.shopsPriced == 0 || cost < summary.bestCost)
+        {
+            summary.bestCost = cost;
+            summary.bestShopId = matrix->shopIds[s];
+        }
+        if (summary.shopsPriced == 0 || cost > summary.worstCost)
+        {
+            summary.worstCost = cost;
+            summary.worstShopId = matrix->shopIds[s];
+        }
+        summary.shopsPriced++;
+        if (analytics->basketPriced[s] >= ordersCount)
+        {
+            complete++;
+        }
+    }
+    if (summary.shopsPriced == 0)
+    {
+        return SQLITE_OK;
+    }
+
+    const ShopName *best = FindShop(analytics, summary.bestShopId);
+    const ShopName *worst = FindShop(analytics, summary.worstShopId);
+    summary.bestShopName = best ? best->name : "";
+    summary.worstShopName = worst ? worst->name : "";
+    summary.shopsIncomplete = (int)analytics->shopCount - complete;
+    AppendSummary(set, &summary, sqlite3_column_text(clients, 1), sqlite3_column_text(clients, 2));
+    return SQLITE_OK;
+}
+
+// Rebuilds the connection's own matrix if offers or shops changed since it was built
+static int RefreshMatrix(Analytics *analytics)
+{
+    if (!analytics->matrixStale)
+    {
+        return SQLITE_OK;
+    }
+    PriceMatrixFree(&analytics->matrix);
+    int rs;
+    if ((rs = PriceMatrixBuild(analytics->db, ANALYTICS_MATRIX_MAX_BYTES, &analytics->matrix)) != SQLITE_OK)
+    {
+        PriceMatrixFree(&analytics->matrix);
+        return rs;
+    }
+    analytics->matrixStale = 0;
+    analytics->matrixVersion = QueryDataVersion(analytics->db);
+    return SQLITE_OK;
+}
+
+/**
+ * @brief Computes the summaries from an in-memory price matrix: each client's orders are streamed once
+ * and every order is added to the baskets of all shops by the SIMD kernel.
+ * The matrix is shared (see SharedPriceMatrixCreate) or else the connection's own.
+ */
+static int ComputeMatrix(Analytics *analytics, ClientRange range, const PriceMatrix *shared, ClientCostSet *set)
+{
+    sqlite3 *db = analytics->db;
+    int rs;
+    if (shared == NULL && (rs = RefreshMatrix(analytics)) != SQLITE_OK)
+    {
+        return rs;
+    }
+    const PriceMatrix *matrix = shared != NULL ? shared : &analytics->matrix;
+    if (analytics->basketCost == NULL || analytics->basketStride < matrix->stride)
+    {
+        size_t stride = (size_t)matrix->stride;
+        analytics->basketCost = realloc(analytics->basketCost, (stride ? stride : 1) * sizeof(double));
+        analytics->basketPriced = realloc(analytics->basketPriced, (stride ? stride : 1) * sizeof(double));
+        if (analytics->basketCost == NULL || analytics->basketPriced == NULL)
+        {
+            fprintf(stderr, "Memory allocation failed for analytics.\n");
+            exit(EXIT_FAILURE);
+        }
+        analytics->basketStride = matrix->stride;
+    }
+
+    sqlite3_stmt *clients;
+    sqlite3_stmt *orders;
+    if ((rs = PrepareCached(db, "SELECT id, first_name, last_name FROM clients WHERE id BETWEEN ?1 AND ?2 ORDER BY id;",
+                            &clients)) != SQLITE_OK)
+    {
+        fprintf(stderr, "Error preparing statement: %s\n", sqlite3_errmsg(db));
+        return rs;
+    }
+    sqlite3_bind_int(clients, 1, range.first);
+    sqlite3_bind_int(clients, 2, range.last);
+    // One sort of the table beats walking idx_orders_client_product with a rowid lookup per order for amount,
+    // a range of clients is only a small part of the index
+    int whole = range.first == allClients.first && range.last == allClients.last;
+    if ((rs = PrepareCached(db,
+                            whole ? "SELECT client_id, product_id, amount FROM orders NOT INDEXED "
+                                    "WHERE client_id BETWEEN ?1 AND ?2 ORDER BY client_id;"
+                                  : "SELECT client_id, product_id, amount FROM orders "
+                                    "WHERE client_id BETWEEN ?1 AND ?2 ORDER BY client_id;",
+                            &orders)) != SQLITE_OK)
+    {
+        fprintf(stderr, "Error preparing statement: %s\n", sqlite3_errmsg(db));
+        ReleaseStatement(clients);
+        return rs;
+    }
+    sqlite3_bind_int(orders, 1, range.first);
+    sqlite3_bind_int(orders, 2, range.last);
+
+    int clientsRs = sqlite3_step(clients);
+    int haveClient = 0;
+    int clientId = 0;
+    int ordersCount = 0;
+    int ordersPriced = 0;
+    rs = SQLITE_OK;
+    int ordersRs = SQLITE_DONE;
+    while (rs == SQLITE_OK && (ordersRs = sqlite3_step(orders)) == SQLITE_ROW)
+    {
+        int id = sqlite3_column_int(orders, 0);
+        if (!haveClient || id != clientId)
+        {
+            if (haveClient)
+            {
+                rs = FinishMatrixClient(analytics, matrix, set, clients, &clientsRs, clientId, ordersCount,
+                                        ordersPriced);
+            }
+            haveClient = 1;
+            clientId = id;
+            ordersCount = 0;
+            ordersPriced = 0;
+            memset(analytics->basketCost, 0, (size_t)matrix->stride * sizeof(double));
+            memset(analytics->basketPriced, 0, (size_t)matrix->stride * sizeof(double));
+        }
+        ordersCount++;
+        const double *row = PriceMatrixRow(matrix, sqlite3_column_int(orders, 1));
+        if (row != NULL)
+        {
+            ordersPriced++;
+            matrix->accumulate(row, sqlite3_column_double(orders, 2), analytics->basketCost, analytics->basketPriced,
+                               matrix->stride);
+        }
+    }
+    if (rs == SQLITE_OK && ordersRs != SQLITE_DONE)
+    {
+        rs = ordersRs;
+        fprintf(stderr, "Error executing statement: %s - %s\n", sqlite3_errstr(rs), sqlite3_errmsg(db));
+    }
+    else if (rs == SQLITE_OK && haveClient)
+    {
+        rs = FinishMatrixClient(analytics, matrix, set, clients, &clientsRs, clientId, ordersCount,
+                                        ordersPriced);
+    }
+    ReleaseStatement(orders);
+    ReleaseStatement(clients);
+    return rs;
+}
+
+static int Compute(Analytics *analytics, ClientRange range, const PriceMatrix *shared, ClientCostSet *set)
+{
+    set->count = 0;
+    set->namesUsed = 0;
+
+    int rs;
+    if ((rs = LoadShops(analytics)) != SQLITE_OK)
+    {
+        return rs;
+    }
+    rs = analytics->engine == ENGINE_SQL ? SQLITE_TOOBIG : ComputeMatrix(analytics, range, shared, set);
+    if (rs == SQLITE_TOOBIG && analytics->engine != ENGINE_MATRIX)
+    {
+        set->count = 0;
+        set->namesUsed = 0;
+        rs = ComputeSql(analytics, range, set);
+    }
+    else if (rs == SQLITE_TOOBIG)
+    {
+        fprintf(stderr, "Price matrix exceeds %d MiB, use the sql analytics engine.\n",
+                ANALYTICS_MATRIX_MAX_BYTES >> 20);
+    }
+    if (rs != SQLITE_OK)
+    {
+        set->count = 0;
+        return rs;
+    }
+    FinishSet(set);
+    return SQLITE_OK;
+}
+
+static void OnTableUpdate(void *ctx, int op, const char *table, sqlite3_int64 rowid)
+{
+    (void)op;
+    (void)rowid;
+    Analytics *analytics = ctx;
+    if (strcmp(table, "offers") == 0 || strcmp(table, "shops") == 0)
+    {
+        analytics->stale = 1;
+        analytics->matrixStale = 1;
+    }
+    else if (strcmp(table, "orders") == 0 || strcmp(table, "clients") == 0)
+    {
+        analytics->stale = 1;
+    }
+}
+
+static void OnRollback(void *ctx)
+{
+    Analytics *analytics = ctx;
+    // A scan inside the transaction may have seen the rolled back rows
+    analytics->stale = 1;
+    analytics->matrixStale = 1;
+}
+
+Analytics *AnalyticsCreate(sqlite3 *db)
+{
+    Analytics *analytics = calloc(1, sizeof(Analytics));
+    if (analytics == NULL)
+    {
+        fprintf(stderr, "Memory allocation failed for analytics.\n");
+        return NULL;
+    }
+    analytics->db = db;
+    analytics->stale = 1;
+    analytics->matrixStale = 1;
+
+    ChangeListener listener = {
+        .onUpdate = OnTableUpdate,
+        .onRollback = OnRollback,
+        .ctx = analytics};
+    if (AddChangeListener(db, &listener) != SQLITE_OK)
+    {
+        free(analytics);
+        return NULL;
+    }
+    return analytics;
+}
+
+void AnalyticsDestroy(Analytics *analytics)
+{
+    if (analytics == NULL)
+    {
+        return;
+    }
+    RemoveChangeListener(analytics->db, analytics);
+    FreeShops(analytics);
+    PriceMatrixFree(&analytics->matrix);
+    free(analytics->basketCost);
+    free(analytics->basketPriced);
+    FreeSet(&analytics->summaries);
+    free(analytics);
+}
+
+int GetClientCostSummaries(sqlite3 *db, const ClientCostSummary **summaries, size_t *count)
+{
+    DbConnection *conn = GetConnection(db);
+    if (conn == NULL || conn->analytics == NULL)
+    {
+        fprintf(stderr, "Analytics need a connection opened with db_init.\n");
+        return SQLITE_MISUSE;
+    }
+    Analytics *analytics = conn->analytics;
+
+    int rs;
+    if (QueryDataVersion(db) != analytics->dataVersion)
+    {
+        analytics->stale = 1; // Another connection committed, offers may have changed as well
+        analytics->matrixStale = 1;
+    }
+    if (analytics->stale)
+    {
+        // stale stays set if the scan fails
+        if ((rs = Compute(analytics, allClients, NULL, &analytics->summaries)) != SQLITE_OK)
+        {
+            return rs;
+        }
+        analytics->stale = 0;
+        analytics->dataVersion = QueryDataVersion(db);
+    }
+    *summaries = analytics->summaries.summaries;
+    *count = analytics->summaries.count;
+    return SQLITE_OK;
+}
+
+ClientCostSet *ClientCostSetCreate(void)
+{
+    ClientCostSet *set = calloc(1, sizeof(ClientCostSet));
+    if (set == NULL)
+    {
+        fprintf(stderr, "Memory allocation failed for analytics.\n");
+        exit(EXIT_FAILURE);
+    }
+    return set;
+}
+
+void ClientCostSetDestroy(ClientCostSet *set)
+{
+    if (set == NULL)
+    {
+        return;
+    }
+    FreeSet(set);
+    free(set);
+}
+
+const ClientCostSummary *GetClientCostSetSummaries(const ClientCostSet *set, size_t *count)
+{
+    *count = set->count;
+    return set->summaries;
+}
+
+int ComputeClientCostRange(sqlite3 *db, int firstClientId, int lastClientId, const PriceMatrix *matrix,
+                           ClientCostSet *set)
+{
+    DbConnection *conn = GetConnection(db);
+    if (conn == NULL || conn->analytics == NULL)
+    {
+        fprintf(stderr, "Analytics need a connection opened with db_init.\n");
+        return SQLITE_MISUSE;
+    }
+    Analytics *analytics = conn->analytics;
+
+    // Only the price matrix is shared with the cached summaries, which stay as they are
+    if (matrix == NULL && QueryDataVersion(db) != analytics->matrixVersion)
+    {
+        analytics->matrixStale = 1;
+    }
+    ClientRange range = {firstClientId, lastClientId};
+    return Compute(analytics, range, matrix, set);
+}
+
+int SharedPriceMatrixCreate(sqlite3 *db, PriceMatrix **matrix)
+{
+    *matrix = NULL;
+    DbConnection *conn = GetConnection(db);
+    if (conn == NULL || conn->analytics == NULL)
+    {
+        fprintf(stderr, "Analytics need a connection opened with db_init.\n");
+        return SQLITE_MISUSE;
+    }
+    if (conn->analytics->engine == ENGINE_SQL)
+    {
+        return SQLITE_OK;
+    }
+    PriceMatrix *shared = calloc(1, sizeof(PriceMatrix));
+    if (shared == NULL)
+    {
+        fprintf(stderr, "Memory allocation failed for analytics.\n");
+        exit(EXIT_FAILURE);
+    }
+    int rs = PriceMatrixBuild(db, ANALYTICS_MATRIX_MAX_BYTES, shared);
+    if (rs != SQLITE_OK)
+    {
+        SharedPriceMatrixDestroy(shared);
+        // Too big: every connection finds out on its own and falls back to SQL or reports it
+        return rs == SQLITE_TOOBIG ? SQLITE_OK : rs;
+    }
+    *matrix = shared;
+    return SQLITE_OK;
+}
+
+void SharedPriceMatrixDestroy(PriceMatrix *matrix)
+{
+    if (matrix == NULL)
+    {
+        return;
+    }
+    PriceMatrixFree(matrix);
+    free(matrix);
+}
+
+int PrepareClientCostReaders(sqlite3 *db)
+{
+    DbConnection *conn = GetConnection(db);
+    if (conn == NULL || conn->analytics == NULL)
+    {
+        fprintf(stderr, "Analytics need a connection opened with db_init.\n");
+        return SQLITE_MISUSE;
+    }
+    if (conn->analytics->engine == ENGINE_MATRIX)
+    {
+        return SQLITE_OK;
+    }
+    if (conn->analytics->engine == ENGINE_AUTO)
+    {
+        size_t bytes;
+        int rs = PriceMatrixBytes(db, &bytes);
+        if (rs != SQLITE_OK || bytes <= ANALYTICS_MATRIX_MAX_BYTES)
+        {
+            return rs;
+        }
+    }
+    return EnableClientShopCost(db);
+}
+
+int SetAnalyticsEngine(sqlite3 *db, const char *engine)
+{
+    DbConnection *conn = GetConnection(db);
+    if (conn == NULL || conn->analytics == NULL)
+    {
+        return SQLITE_MISUSE;
+    }
+    static const char *const names[] = {[ENGINE_AUTO] = "auto", [ENGINE_SQL] = "sql", [ENGINE_MATRIX] = "matrix"};
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+    {
+        if (strcmp(engine, names[i]) == 0)
+        {
+            conn->analytics->engine = (AnalyticsEngine)i;
+            conn->analytics->stale = 1;
+            return SQLITE_OK;
+        }
+    }
+    fprintf(stderr, "Unknown analytics engine '%s'\n", engine);
+    return SQLITE_ERROR;
+}
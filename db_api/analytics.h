@@ -0,0 +1,144 @@
+#ifndef ANALYTICS_H
+#define ANALYTICS_H
+
+#include <sqlite3.h>
+#include <stddef.h>
+
+typedef struct Analytics Analytics;
+typedef struct ClientCostSet ClientCostSet;
+typedef struct PriceMatrix PriceMatrix;
+
+// Largest price matrix the matrix engine builds, the auto engine falls back to SQL above it
+#define ANALYTICS_MATRIX_MAX_BYTES (256 << 20)
+
+// Basket cost of one client across all shops, names are owned by the analytics state
+typedef struct {
+    int clientId;
+    const char *firstName;
+    const char *lastName;
+
+    int bestShopId;           // shop with the lowest basket cost, the lowest id on ties
+    const char *bestShopName;
+    double bestCost;
+    int worstShopId;          // shop with the highest basket cost, the lowest id on ties
+    const char *worstShopName;
+    double worstCost;
+
+    int shopsPriced;          // shops that price at least one order of the client
+    int shopsIncomplete;      // shops that cannot fulfil the whole basket, including shops pricing nothing
+    int ordersCount;          // orders of the client
+    int ordersPriced;         // orders whose product has at least one offer
+} ClientCostSummary;
+
+/**
+ * @brief Creates the per-connection analytics state and subscribes to changes of the tables it reads.
+ * Nothing is computed until the first GetClientCostSummaries call.
+ * @param db Pointer to a registered SQLite database connection.
+ * @returns Pointer to the state, or NULL on failure.
+ */
+Analytics *AnalyticsCreate(sqlite3 *db);
+
+/**
+ * @brief Unsubscribes from changes and frees the state.
+ * @param analytics Pointer to the state, may be NULL.
+ */
+void AnalyticsDestroy(Analytics *analytics);
+
+/**
+ * @brief Returns the basket cost summary of every client with at least one priced order, ordered by client id.
+ *
+ * Two engines compute the same summaries:
+ *
+ *  - sql: one grouped query over orders and client_shop_cost, best and worst shop are picked with the
+ *    argmin/argmax SQL functions and the priced and missing orders are counted with basket_cost
+ *    (see sql_functions.h), one row per client reaches the application.
+ *    The first run creates the table and its triggers (see EnableClientShopCost), from then on every
+ *    order and offer write maintains it
+ *
+ *  - matrix: the offers are loaded into a dense shop x product price matrix (see price_matrix.h) and each
+ *    client's orders are streamed once, a SIMD kernel adds every order to all shops' baskets at once
+ *
+ * The auto engine (default) uses the matrix unless it would exceed ANALYTICS_MATRIX_MAX_BYTES.
+ * The result is kept until orders, offers, shops or clients change (through this connection or,
+ * detected with PRAGMA data_version, through another one), so reports run back to back share one scan.
+ *
+ * @param db Pointer to a registered SQLite database connection.
+ * @param summaries Pointer where the array is stored, valid until the next call or until the connection is closed.
+ * @param count Pointer where the number of summaries is stored.
+ * @returns SQLITE_OK on success, SQLITE_MISUSE if the connection is not registered or sqlite3 error code.
+ */
+int GetClientCostSummaries(sqlite3 *db, const ClientCostSummary **summaries, size_t *count);
+
+/**
+ * @brief Creates an empty set of summaries for ComputeClientCostRange.
+ * @returns Pointer to the set, free it with ClientCostSetDestroy.
+ */
+ClientCostSet *ClientCostSetCreate(void);
+
+/**
+ * @brief Frees a set of summaries.
+ * @param set Pointer to the set, may be NULL.
+ */
+void ClientCostSetDestroy(ClientCostSet *set);
+
+/**
+ * @brief Returns the summaries stored in a set, ordered by client id.
+ * @param set Pointer to the set.
+ * @param count Pointer where the number of summaries is stored.
+ * @returns The summaries, valid until the set is computed again or destroyed.
+ */
+const ClientCostSummary *GetClientCostSetSummaries(const ClientCostSet *set, size_t *count);
+
+/**
+ * @brief Computes the summaries of the clients with ids in [firstClientId, lastClientId] into a set owned by the
+ * caller, with the engine of the connection. The cached summaries of GetClientCostSummaries are left alone, only
+ * the price matrix is shared with them unless one is passed in.
+ *
+ * The set holds copies of all names and stays valid whatever the connection computes next. Connections in one
+ * snapshot (see PoolBeginSnapshot) may compute ranges concurrently, each connection on one thread.
+ *
+ * @param db Pointer to a registered SQLite database connection.
+ * @param firstClientId First client id of the range.
+ * @param lastClientId Last client id of the range, included.
+ * @param matrix Price matrix built in the same snapshot (see SharedPriceMatrixCreate), only read, or NULL for
+ * the connection's own.
+ * @param set Set to store the summaries in, its previous contents are replaced.
+ * @returns SQLITE_OK on success, SQLITE_MISUSE if the connection is not registered or sqlite3 error code.
+ */
+int ComputeClientCostRange(sqlite3 *db, int firstClientId, int lastClientId, const PriceMatrix *matrix,
+                           ClientCostSet *set);
+
+/**
+ * @brief Builds the price matrix once for ComputeClientCostRange calls on several connections of one snapshot,
+ * which then read it concurrently instead of loading all offers each.
+ * @param db Pointer to a registered SQLite database connection in the snapshot.
+ * @param matrix Pointer where the matrix is stored, NULL if the engine of the connection computes without one
+ * (sql, or a matrix above ANALYTICS_MATRIX_MAX_BYTES). Free with SharedPriceMatrixDestroy.
+ * @returns SQLITE_OK on success, SQLITE_MISUSE if the connection is not registered or sqlite3 error code.
+ */
+int SharedPriceMatrixCreate(sqlite3 *db, PriceMatrix **matrix);
+
+/**
+ * @brief Frees a matrix of SharedPriceMatrixCreate.
+ * @param matrix Pointer to the matrix, may be NULL.
+ */
+void SharedPriceMatrixDestroy(PriceMatrix *matrix);
+
+/**
+ * @brief Creates client_shop_cost through a read/write connection if the engine of the connection would compute
+ * with SQL (sql, or auto with a price matrix above ANALYTICS_MATRIX_MAX_BYTES), so read-only connections with the
+ * same engine can compute the summaries too. Call it before their snapshot starts.
+ * @param db Pointer to a registered read/write SQLite database connection outside a transaction.
+ * @returns SQLITE_OK on success, SQLITE_MISUSE if the connection is not registered or sqlite3 error code.
+ */
+int PrepareClientCostReaders(sqlite3 *db);
+
+/**
+ * @brief Selects how GetClientCostSummaries computes the summaries, the next call recomputes them.
+ * @param db Pointer to a registered SQLite database connection.
+ * @param engine "auto", "sql" or "matrix".
+ * @returns SQLITE_OK on success, SQLITE_MISUSE if the connection is not registered, SQLITE_ERROR for an unknown engine.
+ */
+int SetAnalyticsEngine(sqlite3 *db, const char *engine);
+
+#endif // ANALYTICS_H
@@ -0,0 +1,142 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include "arena.h"
+
+#define ARENA_ALIGN _Alignof(max_align_t)
+
+typedef struct ArenaBlock {
+    struct ArenaBlock *next;
+    size_t size;
+    size_t used;
+    _Alignas(max_align_t) unsigned char data[];
+} ArenaBlock;
+
+struct Arena {
+    ArenaBlock *first;
+    ArenaBlock *current; // blocks after it are free, reused before new ones are allocated
+    void *last;          // most recent allocation, the only one ArenaRealloc can grow in place
+    size_t blockSize;
+};
+
+static size_t AlignUp(size_t n)
+{
+    return (n + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+}
+
+Arena *ArenaCreate(size_t blockSize)
+{
+    Arena *arena = calloc(1, sizeof(Arena));
+    if (arena == NULL)
+    {
+        fprintf(stderr, "Memory allocation failed for arena.\n");
+        return NULL;
+    }
+    arena->blockSize = blockSize ? blockSize : ARENA_BLOCK_SIZE;
+    return arena;
+}
+
+void ArenaDestroy(Arena *arena)
+{
+    if (arena == NULL)
+    {
+        return;
+    }
+    ArenaBlock *block = arena->first;
+    while (block != NULL)
+    {
+        ArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+    free(arena);
+}
+
+// Makes the current block one with at least size free bytes
+static void Advance(Arena *arena, size_t size)
+{
+    ArenaBlock *prev = arena->current;
+    ArenaBlock *next = prev != NULL ? prev->next : arena->first;
+    while (next != NULL && next->size < size)
+    {
+        // Too small for this allocation, used again after the next reset
+        next->used = next->size;
+        prev = next;
+        next = next->next;
+    }
+    if (next == NULL)
+    {
+        size_t blockSize = size > arena->blockSize ? size : arena->blockSize;
+        next = malloc(sizeof(ArenaBlock) + blockSize);
+        if (next == NULL)
+        {
+            fprintf(stderr, "Memory allocation failed for arena.\n");
+            exit(EXIT_FAILURE);
+        }
+        next->next = NULL;
+        next->size = blockSize;
+        if (prev != NULL)
+        {
+            prev->next = next;
+        }
+        else
+        {
+            arena->first = next;
+        }
+    }
+    next->used = 0;
+    arena->current = next;
+}
+
+void *ArenaAlloc(Arena *arena, size_t size)
+{
+    size = AlignUp(size ? size : 1);
+    ArenaBlock *block = arena->current;
+    if (block == NULL || block->size - block->used < size)
+    {
+        Advance(arena, size);
+        block = arena->current;
+    }
+    void *p = block->data + block->used;
+    block->used += size;
+    arena->last = p;
+    return p;
+}
+
+void *ArenaRealloc(Arena *arena, void *p, size_t oldSize, size_t newSize)
+{
+    if (p == NULL)
+    {
+        return ArenaAlloc(arena, newSize);
+    }
+    ArenaBlock *block = arena->current;
+    if (p == arena->last)
+    {
+        size_t offset = (size_t)((unsigned char *)p - block->data);
+        size_t size = AlignUp(newSize ? newSize : 1);
+        if (block->size - offset >= size)
+        {
+            block->used = offset + size;
+            return p;
+        }
+    }
+    if (newSize <= oldSize)
+    {
+        return p;
+    }
+    void *grown = ArenaAlloc(arena, newSize);
+    memcpy(grown, p, oldSize);
+    return grown;
+}
+
+void ArenaReset(Arena *arena)
+{
+    if (arena == NULL || arena->first == NULL)
+    {
+        return;
+    }
+    arena->current = arena->first;
+    arena->current->used = 0;
+    arena->last = NULL;
+}
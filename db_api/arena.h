@@ -0,0 +1,49 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+typedef struct Arena Arena;
+
+// Size of the blocks an arena allocates from, larger allocations get a block of their own
+#define ARENA_BLOCK_SIZE (16 << 10)
+
+/**
+ * @brief Creates an empty bump allocator. No memory is allocated until the first ArenaAlloc.
+ * @param blockSize Size of the blocks, 0 for ARENA_BLOCK_SIZE.
+ * @returns Pointer to the arena, or NULL on allocation failure.
+ */
+Arena *ArenaCreate(size_t blockSize);
+
+/**
+ * @brief Frees the arena and every allocation made from it.
+ * @param arena Pointer to the arena, may be NULL.
+ */
+void ArenaDestroy(Arena *arena);
+
+/**
+ * @brief Allocates memory aligned for any type. Exits the program if memory cannot be allocated.
+ * @param arena Pointer to the arena.
+ * @param size Number of bytes.
+ * @returns Pointer to the memory, valid until the arena is reset or destroyed.
+ */
+void *ArenaAlloc(Arena *arena, size_t size);
+
+/**
+ * @brief Resizes an allocation, in place if it is the last one made from the arena, else by copying it.
+ * The old memory is not reclaimed until the arena is reset.
+ * @param arena Pointer to the arena.
+ * @param p Pointer returned by ArenaAlloc or ArenaRealloc, may be NULL.
+ * @param oldSize Size the allocation was made with.
+ * @param newSize New size in bytes.
+ * @returns Pointer to the resized memory.
+ */
+void *ArenaRealloc(Arena *arena, void *p, size_t oldSize, size_t newSize);
+
+/**
+ * @brief Releases every allocation at once. The blocks are kept and reused by the next allocations.
+ * @param arena Pointer to the arena, may be NULL.
+ */
+void ArenaReset(Arena *arena);
+
+#endif // ARENA_H
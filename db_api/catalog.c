@@ -0,0 +1,933 @@
+#include <sqlite3.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "catalog.h"
+#include "connection.h"
+#include "stmt_cache.h"
+
+#define TABLE_PRODUCTS 0
+#define TABLE_SHOPS 1
+#define TABLE_OFFERS 2
+#define TABLE_COUNT 3
+
+// Rows changed through the connection before reloading is cheaper than re-reading each one
+#define MAX_DIRTY_ROWS 4096
+
+static const char *const tableNames[TABLE_COUNT] = {"products", "shops", "offers"};
+
+typedef struct {
+    int id;
+    int32_t entry; // -1 for an empty slot
+} IdSlot;
+
+// Open addressing on the id, slots are never removed (entries are marked dead instead)
+typedef struct {
+    IdSlot *slots;
+    size_t capacity;
+    size_t used;
+} IdMap;
+
+typedef struct {
+    int id;
+    int live;
+    char *name;   // as stored, NULL for NULL
+    char *folded; // case-folded copy used for searching, NULL for NULL
+} NamedEntry;
+
+// Products or shops
+typedef struct {
+    NamedEntry *entries;
+    size_t count;
+    size_t allocated;
+    size_t live;
+    IdMap ids;
+} NameTable;
+
+typedef struct {
+    int id;
+    int live;
+    int shopId;
+    int productId;
+    double price;
+    unsigned char hasShop;
+    unsigned char hasProduct;
+    unsigned char hasPrice;
+} OfferEntry;
+
+// Offers of one product, entry indexes in OfferBefore order
+typedef struct {
+    uint32_t *offers;
+    size_t count;
+    size_t allocated;
+} OfferList;
+
+typedef struct {
+    sqlite3_int64 *rowids;
+    size_t count;
+    size_t allocated;
+} RowidList;
+
+struct Catalog {
+    sqlite3 *db;
+
+    NameTable products;
+    NameTable shops;
+
+    OfferEntry *offers;
+    size_t offerCount;
+    size_t offerAllocated;
+    size_t offersLive;
+    IdMap offerIds;
+
+    OfferList *lists; // by product id through listIds
+    size_t listCount;
+    size_t listAllocated;
+    IdMap listIds;
+
+    size_t stringBytes;
+
+    RowidList dirty[TABLE_COUNT];   // rows changed through the connection, not yet re-read
+    RowidList applied[TABLE_COUNT]; // rows re-read inside the open transaction, dirty again if it is rolled back
+    int rebuiltInTransaction;
+    int needsRebuild;
+    sqlite3_int64 dataVersion;
+};
+
+static void *Grow(void *p, size_t *allocated, size_t needed, size_t elementSize)
+{
+    if (needed <= *allocated)
+    {
+        return p;
+    }
+    size_t size = *allocated ? *allocated : 16;
+    while (size < needed)
+    {
+        size *= 2;
+    }
+    void *tmp = realloc(p, size * elementSize);
+    if (tmp == NULL)
+    {
+        fprintf(stderr, "Memory allocation failed for catalog.\n");
+        exit(EXIT_FAILURE);
+    }
+    *allocated = size;
+    return tmp;
+}
+
+static size_t HashKey(uint32_t key)
+{
+    key ^= key >> 16;
+    key *= 0x7feb352dU;
+    key ^= key >> 15;
+    key *= 0x846ca68bU;
+    key ^= key >> 16;
+    return key;
+}
+
+static IdSlot *FindSlot(const IdMap *map, int id)
+{
+    size_t mask = map->capacity - 1;
+    for (size_t i = HashKey((uint32_t)id) & mask;; i = (i + 1) & mask)
+    {
+        if (map->slots[i].entry < 0 || map->slots[i].id == id)
+        {
+            return &map->slots[i];
+        }
+    }
+}
+
+static int32_t MapGet(const IdMap *map, int id)
+{
+    return map->capacity == 0 ? -1 : FindSlot(map, id)->entry;
+}
+
+static void MapPut(IdMap *map, int id, int32_t entry)
+{
+    if ((map->used + 1) * 10 >= map->capacity * 7)
+    {
+        IdMap grown = {.capacity = map->capacity ? map->capacity * 2 : 1024, .used = map->used};
+        grown.slots = malloc(grown.capacity * sizeof(IdSlot));
+        if (grown.slots == NULL)
+        {
+            fprintf(stderr, "Memory allocation failed for catalog.\n");
+            exit(EXIT_FAILURE);
+        }
+        for (size_t i = 0; i < grown.capacity; i++)
+        {
+            grown.slots[i].entry = -1;
+        }
+        for (size_t i = 0; i < map->capacity; i++)
+        {
+            if (map->slots[i].entry >= 0)
+            {
+                *FindSlot(&grown, map->slots[i].id) = map->slots[i];
+            }
+        }
+        free(map->slots);
+        *map = grown;
+    }
+
+    IdSlot *slot = FindSlot(map, id);
+    if (slot->entry < 0)
+    {
+        map->used++;
+    }
+    slot->id = id;
+    slot->entry = entry;
+}
+
+static void MapFree(IdMap *map)
+{
+    free(map->slots);
+    map->slots = NULL;
+    map->capacity = map->used = 0;
+}
+
+/**
+ * @brief Lowercases ASCII and the two-byte UTF-8 Latin-1 capitals (À-Þ), plus Š and Ž used in Estonian.
+ * Folding never changes the length, so match positions are the same in both copies.
+ */
+static char *Fold(const char *s)
+{
+    char *folded = strdup(s);
+    if (folded == NULL)
+    {
+        fprintf(stderr, "Memory allocation failed for catalog.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (unsigned char *p = (unsigned char *)folded; *p != '\0'; p++)
+    {
+        if (*p >= 'A' && *p <= 'Z')
+        {
+            *p = (unsigned char)(*p - 'A' + 'a');
+        }
+        else if (*p == 0xC3 && p[1] >= 0x80 && p[1] <= 0x9E && p[1] != 0x97)
+        {
+            p[1] += 0x20;
+            p++;
+        }
+        else if (*p == 0xC5 && (p[1] == 0xA0 || p[1] == 0xBD))
+        {
+            p[1] += 1;
+            p++;
+        }
+    }
+    return folded;
+}
+
+static void SetName(Catalog *catalog, NameTable *table, int id, const unsigned char *name)
+{
+    // Both copies are made before the entry is touched, so they are stored together or not at all
+    char *copy = NULL;
+    char *folded = NULL;
+    if (name != NULL)
+    {
+        if ((copy = strdup((const char *)name)) == NULL)
+        {
+            fprintf(stderr, "Memory allocation failed for catalog.\n");
+            exit(EXIT_FAILURE);
+        }
+        folded = Fold(copy);
+    }
+
+    int32_t e = MapGet(&table->ids, id);
+    if (e < 0)
+    {
+        table->entries = Grow(table->entries, &table->allocated, table->count + 1, sizeof(NamedEntry));
+        e = (int32_t)table->count++;
+        table->entries[e] = (NamedEntry){.id = id};
+        MapPut(&table->ids, id, e);
+    }
+    NamedEntry *entry = &table->entries[e];
+    if (entry->name != NULL)
+    {
+        catalog->stringBytes -= 2 * (strlen(entry->name) + 1);
+        free(entry->name);
+        free(entry->folded);
+    }
+    if (!entry->live)
+    {
+        entry->live = 1;
+        table->live++;
+    }
+    entry->name = copy;
+    entry->folded = folded;
+    if (copy != NULL)
+    {
+        catalog->stringBytes += 2 * (strlen(copy) + 1);
+    }
+}
+
+static void RemoveName(Catalog *catalog, NameTable *table, int id)
+{
+    int32_t e = MapGet(&table->ids, id);
+    if (e < 0 || !table->entries[e].live)
+    {
+        return;
+    }
+    NamedEntry *entry = &table->entries[e];
+    if (entry->name != NULL)
+    {
+        catalog->stringBytes -= 2 * (strlen(entry->name) + 1);
+    }
+    free(entry->name);
+    free(entry->folded);
+    entry->name = entry->folded = NULL;
+    entry->live = 0;
+    table->live--;
+}
+
+static const NamedEntry *GetName(const NameTable *table, int id)
+{
+    int32_t e = MapGet(&table->ids, id);
+    return e >= 0 && table->entries[e].live ? &table->entries[e] : NULL;
+}
+
+static void FreeNames(NameTable *table)
+{
+    for (size_t i = 0; i < table->count; i++)
+    {
+        free(table->entries[i].name);
+        free(table->entries[i].folded);
+    }
+    free(table->entries);
+    MapFree(&table->ids);
+    memset(table, 0, sizeof(NameTable));
+}
+
+/**
+ * @brief Order of the offers of one product: priced before NULL prices, then by price, shop id
+ * (NULL first, like ORDER BY) and offer id.
+ */
+static int OfferBefore(const OfferEntry *a, const OfferEntry *b)
+{
+    if (a->hasPrice != b->hasPrice)
+    {
+        return a->hasPrice;
+    }
+    if (a->hasPrice && a->price != b->price)
+    {
+        return a->price < b->price;
+    }
+    if (a->hasShop != b->hasShop)
+    {
+        return !a->hasShop;
+    }
+    if (a->shopId != b->shopId)
+    {
+        return a->shopId < b->shopId;
+    }
+    return a->id < b->id;
+}
+
+static OfferList *ListForProduct(Catalog *catalog, int productId, int create)
+{
+    int32_t l = MapGet(&catalog->listIds, productId);
+    if (l < 0)
+    {
+        if (!create)
+        {
+            return NULL;
+        }
+        catalog->lists = Grow(catalog->lists, &catalog->listAllocated, catalog->listCount + 1, sizeof(OfferList));
+        l = (int32_t)catalog->listCount++;
+        catalog->lists[l] = (OfferList){0};
+        MapPut(&catalog->listIds, productId, l);
+    }
+    return &catalog->lists[l];
+}
+
+static void LinkOffer(Catalog *catalog, uint32_t e)
+{
+    const OfferEntry *offer = &catalog->offers[e];
+    OfferList *list = ListForProduct(catalog, offer->productId, 1);
+    list->offers = Grow(list->offers, &list->allocated, list->count + 1, sizeof(uint32_t));
+
+    // Offers are loaded in index order, so the common case is an append
+    size_t lo = 0;
+    size_t hi = list->count;
+    if (hi > 0 && OfferBefore(offer, &catalog->offers[list->offers[hi - 1]]))
+    {
+        while (lo < hi)
+        {
+            size_t mid = lo + (hi - lo) / 2;
+            if (OfferBefore(offer, &catalog->offers[list->offers[mid]]))
+            {
+                hi = mid;
+            }
+            else
+            {
+                lo = mid + 1;
+            }
+        }
+    }
+    else
+    {
+        lo = hi;
+    }
+    memmove(list->offers + lo + 1, list->offers + lo, (list->count - lo) * sizeof(uint32_t));
+    list->offers[lo] = e;
+    list->count++;
+}
+
+static void UnlinkOffer(Catalog *catalog, uint32_t e)
+{
+    OfferList *list = ListForProduct(catalog, catalog->offers[e].productId, 0);
+    if (list == NULL)
+    {
+        return;
+    }
+    for (size_t i = 0; i < list->count; i++)
+    {
+        if (list->offers[i] == e)
+        {
+            memmove(list->offers + i, list->offers + i + 1, (list->count - i - 1) * sizeof(uint32_t));
+            list->count--;
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Stores an offer row, shopId/productId/price columns of stmt start at column first.
+ */
+static void SetOffer(Catalog *catalog, int id, sqlite3_stmt *stmt, int first)
+{
+    int32_t e = MapGet(&catalog->offerIds, id);
+    if (e < 0)
+    {
+        catalog->offers = Grow(catalog->offers, &catalog->offerAllocated, catalog->offerCount + 1, sizeof(OfferEntry));
+        e = (int32_t)catalog->offerCount++;
+        catalog->offers[e] = (OfferEntry){.id = id};
+        MapPut(&catalog->offerIds, id, e);
+    }
+    OfferEntry *offer = &catalog->offers[e];
+    if (offer->live && offer->hasProduct)
+    {
+        UnlinkOffer(catalog, (uint32_t)e);
+    }
+    if (!offer->live)
+    {
+        offer->live = 1;
+        catalog->offersLive++;
+    }
+    offer->hasShop = sqlite3_column_type(stmt, first) != SQLITE_NULL;
+    offer->shopId = sqlite3_column_int(stmt, first);
+    offer->hasProduct = sqlite3_column_type(stmt, first + 1) != SQLITE_NULL;
+    offer->productId = sqlite3_column_int(stmt, first + 1);
+    offer->hasPrice = sqlite3_column_type(stmt, first + 2) != SQLITE_NULL;
+    offer->price = sqlite3_column_double(stmt, first + 2);
+    if (offer->hasProduct)
+    {
+        LinkOffer(catalog, (uint32_t)e);
+    }
+}
+
+static void RemoveOffer(Catalog *catalog, int id)
+{
+    int32_t e = MapGet(&catalog->offerIds, id);
+    if (e < 0 || !catalog->offers[e].live)
+    {
+        return;
+    }
+    if (catalog->offers[e].hasProduct)
+    {
+        UnlinkOffer(catalog, (uint32_t)e);
+    }
+    catalog->offers[e].live = 0;
+    catalog->offersLive--;
+}
+
+static void FreeTables(Catalog *catalog)
+{
+    FreeNames(&catalog->products);
+    FreeNames(&catalog->shops);
+    free(catalog->offers);
+    catalog->offers = NULL;
+    catalog->offerCount = catalog->offerAllocated = catalog->offersLive = 0;
+    MapFree(&catalog->offerIds);
+    for (size_t i = 0; i < catalog->listCount; i++)
+    {
+        free(catalog->lists[i].offers);
+    }
+    free(catalog->lists);
+    catalog->lists = NULL;
+    catalog->listCount = catalog->listAllocated = 0;
+    MapFree(&catalog->listIds);
+    catalog->stringBytes = 0;
+}
+
+static sqlite3_int64 QueryDataVersion(sqlite3 *db)
+{
+    sqlite3_stmt *stmt;
+    sqlite3_int64 version = -1;
+    if (PrepareCached(db, "PRAGMA data_version;", &stmt) != SQLITE_OK)
+    {
+        return -1;
+    }
+    if (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        version = sqlite3_column_int64(stmt, 0);
+    }
+    ReleaseStatement(stmt);
+    return version;
+}
+
+static int LoadTable(Catalog *catalog, int table)
+{
+    // Offers in idx_offers_product_price order are appended to their product's list without moving others
+    static const char *const sql[TABLE_COUNT] = {
+        "SELECT id, name FROM products;",
+        "SELECT id, name FROM shops;",
+        "SELECT id, shop_id, product_id, price FROM offers ORDER BY product_id, price, shop_id, id;",
+    };
+    sqlite3_stmt *stmt;
+    int rs;
+    if ((rs = sqlite3_prepare_v2(catalog->db, sql[table], -1, &stmt, NULL)) != SQLITE_OK)
+    {
+        fprintf(stderr, "Error preparing statement: %s\n", sqlite3_errmsg(catalog->db));
+        return rs;
+    }
+    while ((rs = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        int id = sqlite3_column_int(stmt, 0);
+        if (table == TABLE_OFFERS)
+        {
+            SetOffer(catalog, id, stmt, 1);
+        }
+        else
+        {
+            SetName(catalog, table == TABLE_PRODUCTS ? &catalog->products : &catalog->shops, id,
+                    sqlite3_column_text(stmt, 1));
+        }
+    }
+    sqlite3_finalize(stmt);
+    if (rs != SQLITE_DONE)
+    {
+        fprintf(stderr, "Error loading catalog %s: %s\n", tableNames[table], sqlite3_errmsg(catalog->db));
+        return rs;
+    }
+    return SQLITE_OK;
+}
+
+static int Rebuild(Catalog *catalog)
+{
+    FreeTables(catalog);
+    for (int t = 0; t < TABLE_COUNT; t++)
+    {
+        catalog->dirty[t].count = 0;
+        catalog->applied[t].count = 0;
+    }
+    catalog->needsRebuild = 1; // Stays set if loading fails
+
+    int rs;
+    for (int t = 0; t < TABLE_COUNT; t++)
+    {
+        if ((rs = LoadTable(catalog, t)) != SQLITE_OK)
+        {
+            return rs;
+        }
+    }
+
+    catalog->needsRebuild = 0;
+    catalog->rebuiltInTransaction = !sqlite3_get_autocommit(catalog->db);
+    catalog->dataVersion = QueryDataVersion(catalog->db);
+    return SQLITE_OK;
+}
+
+static void AppendRowid(RowidList *list, sqlite3_int64 rowid)
+{
+    list->rowids = Grow(list->rowids, &list->allocated, list->count + 1, sizeof(sqlite3_int64));
+    list->rowids[list->count++] = rowid;
+}
+
+static int RefreshTable(Catalog *catalog, int table)
+{
+    static const char *const sql[TABLE_COUNT] = {
+        "SELECT name FROM products WHERE id = ?1;",
+        "SELECT name FROM shops WHERE id = ?1;",
+        "SELECT shop_id, product_id, price FROM offers WHERE id = ?1;",
+    };
+    RowidList *dirty = &catalog->dirty[table];
+    if (dirty->count == 0)
+    {
+        return SQLITE_OK;
+    }
+
+    sqlite3_stmt *stmt;
+    int rs;
+    if ((rs = PrepareCached(catalog->db, sql[table], &stmt)) != SQLITE_OK)
+    {
+        fprintf(stderr, "Error preparing statement: %s\n", sqlite3_errmsg(catalog->db));
+        return rs;
+    }
+    int inTransaction = !sqlite3_get_autocommit(catalog->db);
+    NameTable *names = table == TABLE_PRODUCTS ? &catalog->products : &catalog->shops;
+    for (size_t i = 0; i < dirty->count; i++)
+    {
+        int id = (int)dirty->rowids[i];
+        sqlite3_bind_int(stmt, 1, id);
+        if ((rs = sqlite3_step(stmt)) == SQLITE_ROW)
+        {
+            if (table == TABLE_OFFERS)
+            {
+                SetOffer(catalog, id, stmt, 0);
+            }
+            else
+            {
+                SetName(catalog, names, id, sqlite3_column_text(stmt, 0));
+            }
+        }
+        else if (rs == SQLITE_DONE)
+        {
+            if (table == TABLE_OFFERS)
+            {
+                RemoveOffer(catalog, id);
+            }
+            else
+            {
+                RemoveName(catalog, names, id);
+            }
+        }
+        else
+        {
+            fprintf(stderr, "Error executing statement: %s - %s\n", sqlite3_errstr(rs), sqlite3_errmsg(catalog->db));
+            ReleaseStatement(stmt);
+            catalog->needsRebuild = 1;
+            return rs;
+        }
+        sqlite3_reset(stmt);
+        if (inTransaction)
+        {
+            AppendRowid(&catalog->applied[table], id);
+        }
+    }
+    ReleaseStatement(stmt);
+    dirty->count = 0;
+    return SQLITE_OK;
+}
+
+/**
+ * @brief Re-reads the rows changed through the connection, reloads everything if another connection committed.
+ */
+static int Refresh(Catalog *catalog)
+{
+    if (catalog->needsRebuild || QueryDataVersion(catalog->db) != catalog->dataVersion)
+    {
+        return Rebuild(catalog);
+    }
+    int rs;
+    for (int t = 0; t < TABLE_COUNT; t++)
+    {
+        if ((rs = RefreshTable(catalog, t)) != SQLITE_OK)
+        {
+            return rs;
+        }
+    }
+    return SQLITE_OK;
+}
+
+static void OnCatalogUpdate(void *ctx, int op, const char *table, sqlite3_int64 rowid)
+{
+    (void)op;
+    Catalog *catalog = ctx;
+    if (catalog->needsRebuild)
+    {
+        return;
+    }
+    for (int t = 0; t < TABLE_COUNT; t++)
+    {
+        if (strcmp(table, tableNames[t]) == 0)
+        {
+            if (catalog->dirty[t].count >= MAX_DIRTY_ROWS)
+            {
+                catalog->needsRebuild = 1;
+                return;
+            }
+            AppendRowid(&catalog->dirty[t], rowid);
+            return;
+        }
+    }
+}
+
+static void OnCommit(void *ctx)
+{
+    Catalog *catalog = ctx;
+    for (int t = 0; t < TABLE_COUNT; t++)
+    {
+        catalog->applied[t].count = 0;
+    }
+    catalog->rebuiltInTransaction = 0;
+}
+
+static void OnRollback(void *ctx)
+{
+    Catalog *catalog = ctx;
+    // Rows re-read inside the transaction are back to their committed state
+    for (int t = 0; t < TABLE_COUNT; t++)
+    {
+        for (size_t i = 0; i < catalog->applied[t].count; i++)
+        {
+            AppendRowid(&catalog->dirty[t], catalog->applied[t].rowids[i]);
+        }
+        catalog->applied[t].count = 0;
+    }
+    if (catalog->rebuiltInTransaction)
+    {
+        catalog->needsRebuild = 1;
+        catalog->rebuiltInTransaction = 0;
+    }
+}
+
+Catalog *CatalogCreate(sqlite3 *db)
+{
+    Catalog *catalog = calloc(1, sizeof(Catalog));
+    if (catalog == NULL)
+    {
+        fprintf(stderr, "Memory allocation failed for catalog.\n");
+        return NULL;
+    }
+    catalog->db = db;
+    if (Rebuild(catalog) != SQLITE_OK)
+    {
+        FreeTables(catalog);
+        free(catalog);
+        return NULL;
+    }
+
+    ChangeListener listener = {
+        .onUpdate = OnCatalogUpdate,
+        .onCommit = OnCommit,
+        .onRollback = OnRollback,
+        .ctx = catalog};
+    if (AddChangeListener(db, &listener) != SQLITE_OK)
+    {
+        FreeTables(catalog);
+        free(catalog);
+        return NULL;
+    }
+    return catalog;
+}
+
+void CatalogDestroy(Catalog *catalog)
+{
+    if (catalog == NULL)
+    {
+        return;
+    }
+    RemoveChangeListener(catalog->db, catalog);
+    FreeTables(catalog);
+    for (int t = 0; t < TABLE_COUNT; t++)
+    {
+        free(catalog->dirty[t].rowids);
+        free(catalog->applied[t].rowids);
+    }
+    free(catalog);
+}
+
+int EnableCatalog(sqlite3 *db)
+{
+    DbConnection *conn = GetConnection(db);
+    if (conn == NULL)
+    {
+        return SQLITE_MISUSE;
+    }
+    if (conn->catalog == NULL && (conn->catalog = CatalogCreate(db)) == NULL)
+    {
+        return SQLITE_ERROR;
+    }
+    return SQLITE_OK;
+}
+
+int CatalogGetProduct(Catalog *catalog, int productId, CatalogProduct *product)
+{
+    int rs;
+    if ((rs = Refresh(catalog)) != SQLITE_OK)
+    {
+        return rs;
+    }
+    const NamedEntry *entry = GetName(&catalog->products, productId);
+    if (entry == NULL)
+    {
+        return SQLITE_DONE;
+    }
+    product->id = entry->id;
+    product->name = entry->name;
+    return SQLITE_ROW;
+}
+
+// Sort key of one search match
+typedef struct {
+    int occurrences;
+    size_t length;
+    int id;
+    const char *name;
+} RankedProduct;
+
+static int CompareRanked(const void *a, const void *b)
+{
+    const RankedProduct *x = a;
+    const RankedProduct *y = b;
+    if (x->occurrences != y->occurrences)
+    {
+        return x->occurrences > y->occurrences ? -1 : 1;
+    }
+    if (x->length != y->length)
+    {
+        return x->length < y->length ? -1 : 1;
+    }
+    return (x->id > y->id) - (x->id < y->id);
+}
+
+static size_t Utf8Length(const char *s)
+{
+    size_t len = 0;
+    for (; *s != '\0'; s++)
+    {
+        len += ((unsigned char)*s & 0xC0) != 0x80;
+    }
+    return len;
+}
+
+static int IsWordByte(unsigned char c)
+{
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c >= 0x80;
+}
+
+/**
+ * @brief Counts the occurrences of term in name, or only those at the start of a word for prefix terms.
+ */
+static int CountOccurrences(const char *name, const char *term, int prefix)
+{
+    int occurrences = 0;
+    for (const char *p = strstr(name, term); p != NULL; p = strstr(p + 1, term))
+    {
+        if (!prefix || p == name || !IsWordByte((unsigned char)p[-1]))
+        {
+            occurrences++;
+        }
+    }
+    return occurrences;
+}
+
+int CatalogSearchProducts(Catalog *catalog, int id, const char *term, int limit, CatalogProduct **matches,
+                          size_t *count)
+{
+    *matches = NULL;
+    *count = 0;
+    int rs;
+    if ((rs = Refresh(catalog)) != SQLITE_OK)
+    {
+        return rs;
+    }
+
+    char *folded = Fold(term != NULL ? term : "");
+    size_t termLen = strlen(folded);
+    int prefix = Utf8Length(folded) < 3;
+    const NameTable *products = &catalog->products;
+    size_t capacity = limit > 0 ? (size_t)limit : 0;
+    CatalogProduct *results = malloc((capacity ? capacity : 1) * sizeof(CatalogProduct));
+    RankedProduct *ranked = NULL;
+    size_t rankedCount = 0;
+    size_t rankedAllocated = 0;
+    if (results == NULL)
+    {
+        fprintf(stderr, "Memory allocation failed for catalog.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    size_t used = 0;
+    const NamedEntry *byId = GetName(products, id);
+    if (byId != NULL && used < capacity)
+    {
+        results[used].id = byId->id;
+        results[used].name = byId->name;
+        used++;
+    }
+    for (size_t e = 0; e < products->count && capacity > 0; e++)
+    {
+        const NamedEntry *entry = &products->entries[e];
+        if (!entry->live || entry->id == id || entry->folded == NULL)
+        {
+            continue;
+        }
+        // An empty term matches every product, in id order like the LIKE query
+        int occurrences = termLen == 0 ? 1 : CountOccurrences(entry->folded, folded, prefix);
+        if (occurrences == 0)
+        {
+            continue;
+        }
+        ranked = Grow(ranked, &rankedAllocated, rankedCount + 1, sizeof(RankedProduct));
+        ranked[rankedCount++] = (RankedProduct){
+            .occurrences = occurrences,
+            .length = termLen == 0 ? 0 : strlen(entry->name),
+            .id = entry->id,
+            .name = entry->name};
+    }
+    qsort(ranked, rankedCount, sizeof(RankedProduct), CompareRanked);
+    for (size_t i = 0; i < rankedCount && used < capacity; i++)
+    {
+        results[used].id = ranked[i].id;
+        results[used].name = ranked[i].name;
+        used++;
+    }
+    free(ranked);
+    free(folded);
+
+    *matches = results;
+    *count = used;
+    return SQLITE_DONE;
+}
+
+int CatalogGetCheapestOffer(Catalog *catalog, int productId, Offer *offer)
+{
+    int rs;
+    if ((rs = Refresh(catalog)) != SQLITE_OK)
+    {
+        return rs;
+    }
+    const OfferList *list = ListForProduct(catalog, productId, 0);
+    if (list == NULL || list->count == 0 || !catalog->offers[list->offers[0]].hasPrice)
+    {
+        return SQLITE_DONE;
+    }
+    const OfferEntry *cheapest = &catalog->offers[list->offers[0]];
+    offer->id = cheapest->id;
+    offer->shop_id = cheapest->shopId;
+    offer->product_id = cheapest->productId;
+    offer->price = cheapest->price;
+    return SQLITE_ROW;
+}
+
+int GetCatalogStats(sqlite3 *db, CatalogStats *stats)
+{
+    DbConnection *conn = GetConnection(db);
+    if (conn == NULL || conn->catalog == NULL)
+    {
+        return SQLITE_MISUSE;
+    }
+    const Catalog *catalog = conn->catalog;
+    stats->products = catalog->products.live;
+    stats->shops = catalog->shops.live;
+    stats->offers = catalog->offersLive;
+
+    size_t bytes = sizeof(Catalog) + catalog->stringBytes;
+    bytes += (catalog->products.allocated + catalog->shops.allocated) * sizeof(NamedEntry);
+    bytes += (catalog->products.ids.capacity + catalog->shops.ids.capacity + catalog->offerIds.capacity +
+              catalog->listIds.capacity) *
+             sizeof(IdSlot);
+    bytes += catalog->offerAllocated * sizeof(OfferEntry);
+    bytes += catalog->listAllocated * sizeof(OfferList);
+    for (size_t i = 0; i < catalog->listCount; i++)
+    {
+        bytes += catalog->lists[i].allocated * sizeof(uint32_t);
+    }
+    for (int t = 0; t < TABLE_COUNT; t++)
+    {
+        bytes += (catalog->dirty[t].allocated + catalog->applied[t].allocated) * sizeof(sqlite3_int64);
+    }
+    stats->bytes = bytes;
+    return SQLITE_OK;
+}
@@ -0,0 +1,95 @@
+#ifndef CATALOG_H
+#define CATALOG_H
+
+#include <sqlite3.h>
+#include <stddef.h>
+#include "offers.h"
+
+typedef struct Catalog Catalog;
+
+typedef struct {
+    int id;
+    const char *name; // owned by the catalog, valid until the next call, NULL for NULL
+} CatalogProduct;
+
+typedef struct {
+    size_t products;
+    size_t shops;
+    size_t offers;
+    size_t bytes; // heap memory held by the mirror, tables, strings and hash maps included
+} CatalogStats;
+
+/**
+ * @brief Loads products, shops and offers into memory and subscribes to changes of the three tables.
+ *
+ * Products and shops are kept in hash maps keyed by id, the offers of each product in an array sorted
+ * by price (then shop id and offer id, NULL prices last), so the cheapest offer is the first one.
+ *
+ * Rows changed through the connection are recorded by the update hook and re-read on the next lookup,
+ * rows re-read inside a transaction that is rolled back are re-read again. Changes committed by other
+ * connections are detected with PRAGMA data_version and reload everything.
+ *
+ * @param db Pointer to a registered SQLite database connection.
+ * @returns Pointer to the catalog, or NULL if the tables could not be loaded.
+ */
+Catalog *CatalogCreate(sqlite3 *db);
+
+/**
+ * @brief Unsubscribes from changes and frees the catalog.
+ * @param catalog Pointer to the catalog, may be NULL.
+ */
+void CatalogDestroy(Catalog *catalog);
+
+/**
+ * @brief Creates the catalog of a registered connection, after which GetProductById, GetProduct,
+ * GetMatchedProducts and GetCheapestOffer are answered from memory. Does nothing if it already exists.
+ * @param db Pointer to a registered SQLite database connection.
+ * @returns SQLITE_OK on success, SQLITE_MISUSE if the connection is not registered or sqlite3 error code.
+ */
+int EnableCatalog(sqlite3 *db);
+
+/**
+ * @brief Looks up a product by id.
+ * @param catalog Pointer to the catalog.
+ * @param productId The ID of the product.
+ * @param product Pointer where the product is stored.
+ * @returns SQLITE_ROW if the product exists, SQLITE_DONE if not, or sqlite3 error code if the catalog could not be refreshed.
+ */
+int CatalogGetProduct(Catalog *catalog, int productId, CatalogProduct *product);
+
+/**
+ * @brief Finds products by name the way GetMatchedProducts does: the product with the searched id first,
+ * then names containing the term (terms shorter than 3 characters match the start of a word).
+ *
+ * Matching folds ASCII and Latin-1 letters. Matches are ranked by the number of occurrences of the term,
+ * then by name length and id, which approximates the bm25 order of the full-text search.
+ *
+ * @param catalog Pointer to the catalog.
+ * @param id Product id that always matches.
+ * @param term Term searched in names, NULL or "" matches every product.
+ * @param limit Maximum number of matches.
+ * @param matches Pointer where the array of matches is stored, caller frees it (names stay owned by the catalog).
+ * @param count Pointer where the number of matches is stored.
+ * @returns SQLITE_DONE on success (like a finished query) or sqlite3 error code if the catalog could not be refreshed.
+ */
+int CatalogSearchProducts(Catalog *catalog, int id, const char *term, int limit, CatalogProduct **matches,
+                          size_t *count);
+
+/**
+ * @brief Returns the cheapest offer of a product, the same offer GetCheapestOffer returns from product_best_offer.
+ * @param catalog Pointer to the catalog.
+ * @param productId The ID of the product.
+ * @param offer Pointer to an Offer structure where the offer is stored.
+ * @returns SQLITE_ROW if the product has a priced offer, SQLITE_DONE if not, or sqlite3 error code.
+ */
+int CatalogGetCheapestOffer(Catalog *catalog, int productId, Offer *offer);
+
+/**
+ * @brief Reports the size of the catalog of a connection.
+ * @param db Pointer to a registered SQLite database connection.
+ * @param stats Pointer to a CatalogStats structure that will be filled.
+ * @returns SQLITE_OK on success, SQLITE_MISUSE if the connection has no catalog.
+ */
+int GetCatalogStats(sqlite3 *db, CatalogStats *stats);
+
+#endif // CATALOG_H
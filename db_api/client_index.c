@@ -0,0 +1,781 @@
+#include <sqlite3.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "client_index.h"
+#include "connection.h"
+#include "stmt_cache.h"
+
+#define FIELD_FIRST 0
+#define FIELD_LAST 1
+#define FIELD_COUNT 2
+
+// Entries marked dead by updates before the index is rebuilt from the database
+#define MAX_DEAD_ENTRIES 4096
+
+typedef struct {
+    int id;
+    int live;
+    char *name[FIELD_COUNT];   // as stored, NULL for NULL
+    char *folded[FIELD_COUNT]; // ASCII lowercase copy used for matching, NULL for NULL
+} ClientEntry;
+
+// Entries whose name contains one trigram, ascending since entries are only appended
+typedef struct {
+    uint32_t key; // field + 1 in the top byte and the three name bytes, 0 for an empty slot
+    uint32_t count;
+    uint32_t allocated;
+    uint32_t *entries;
+} Posting;
+
+typedef struct {
+    int id;
+    int32_t entry; // -1 for an empty slot
+} IdSlot;
+
+typedef struct {
+    sqlite3_int64 *rowids;
+    size_t count;
+    size_t allocated;
+} RowidList;
+
+struct ClientIndex {
+    sqlite3 *db;
+
+    ClientEntry *entries;
+    size_t count;
+    size_t allocated;
+    size_t dead;
+
+    Posting *postings; // open addressing on the trigram key
+    size_t postingCapacity;
+    size_t postingUsed;
+
+    IdSlot *ids; // open addressing on the client id
+    size_t idCapacity;
+    size_t idUsed;
+
+    RowidList dirty;   // clients changed through the connection, not yet re-read
+    RowidList applied; // clients re-read inside the open transaction, dirty again if it is rolled back
+    int rebuiltInTransaction;
+    int needsRebuild;
+    sqlite3_int64 dataVersion;
+
+    // Per-search scratch, one slot per entry
+    uint16_t *hits;
+    int8_t *best;
+    uint32_t *touched;
+    size_t touchedCount;
+    size_t scratchAllocated;
+};
+
+static void *Grow(void *p, size_t *allocated, size_t needed, size_t elementSize)
+{
+    if (needed <= *allocated)
+    {
+        return p;
+    }
+    size_t size = *allocated ? *allocated : 16;
+    while (size < needed)
+    {
+        size *= 2;
+    }
+    void *tmp = realloc(p, size * elementSize);
+    if (tmp == NULL)
+    {
+        fprintf(stderr, "Memory allocation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    *allocated = size;
+    return tmp;
+}
+
+static char *Fold(const char *s)
+{
+    char *folded = strdup(s);
+    if (folded == NULL)
+    {
+        fprintf(stderr, "Memory allocation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (char *p = folded; *p != '\0'; p++)
+    {
+        if (*p >= 'A' && *p <= 'Z')
+        {
+            *p = (char)(*p - 'A' + 'a');
+        }
+    }
+    return folded;
+}
+
+static uint32_t TrigramKey(int field, const char *s)
+{
+    return (uint32_t)(field + 1) << 24 | (uint32_t)(unsigned char)s[0] << 16 | (uint32_t)(unsigned char)s[1] << 8 |
+           (uint32_t)(unsigned char)s[2];
+}
+
+static size_t HashKey(uint32_t key)
+{
+    key ^= key >> 16;
+    key *= 0x7feb352dU;
+    key ^= key >> 15;
+    key *= 0x846ca68bU;
+    key ^= key >> 16;
+    return key;
+}
+
+static Posting *FindPosting(const ClientIndex *index, uint32_t key)
+{
+    size_t mask = index->postingCapacity - 1;
+    for (size_t i = HashKey(key) & mask;; i = (i + 1) & mask)
+    {
+        if (index->postings[i].key == key)
+        {
+            return &index->postings[i];
+        }
+        if (index->postings[i].key == 0)
+        {
+            return NULL;
+        }
+    }
+}
+
+static Posting *AddPosting(ClientIndex *index, uint32_t key)
+{
+    if ((index->postingUsed + 1) * 10 >= index->postingCapacity * 7)
+    {
+        Posting *old = index->postings;
+        size_t oldCapacity = index->postingCapacity;
+        index->postingCapacity = oldCapacity ? oldCapacity * 2 : 1024;
+        index->postings = calloc(index->postingCapacity, sizeof(Posting));
+        if (index->postings == NULL)
+        {
+            fprintf(stderr, "Memory allocation failed.\n");
+            exit(EXIT_FAILURE);
+        }
+        size_t mask = index->postingCapacity - 1;
+        for (size_t i = 0; i < oldCapacity; i++)
+        {
+            if (old[i].key != 0)
+            {
+                size_t j = HashKey(old[i].key) & mask;
+                while (index->postings[j].key != 0)
+                {
+                    j = (j + 1) & mask;
+                }
+                index->postings[j] = old[i];
+            }
+        }
+        free(old);
+    }
+
+    size_t mask = index->postingCapacity - 1;
+    size_t i = HashKey(key) & mask;
+    while (index->postings[i].key != 0 && index->postings[i].key != key)
+    {
+        i = (i + 1) & mask;
+    }
+    if (index->postings[i].key == 0)
+    {
+        index->postings[i].key = key;
+        index->postingUsed++;
+    }
+    return &index->postings[i];
+}
+
+static IdSlot *FindIdSlot(const IdSlot *ids, size_t capacity, int id)
+{
+    size_t mask = capacity - 1;
+    for (size_t i = HashKey((uint32_t)id) & mask;; i = (i + 1) & mask)
+    {
+        if (ids[i].entry < 0 || ids[i].id == id)
+        {
+            return (IdSlot *)&ids[i];
+        }
+    }
+}
+
+static void SetEntryForId(ClientIndex *index, int id, uint32_t entry)
+{
+    if ((index->idUsed + 1) * 10 >= index->idCapacity * 7)
+    {
+        IdSlot *old = index->ids;
+        size_t oldCapacity = index->idCapacity;
+        index->idCapacity = oldCapacity ? oldCapacity * 2 : 1024;
+        index->ids = malloc(index->idCapacity * sizeof(IdSlot));
+        if (index->ids == NULL)
+        {
+            fprintf(stderr, "Memory allocation failed.\n");
+            exit(EXIT_FAILURE);
+        }
+        for (size_t i = 0; i < index->idCapacity; i++)
+        {
+            index->ids[i].entry = -1;
+        }
+        for (size_t i = 0; i < oldCapacity; i++)
+        {
+            if (old[i].entry >= 0)
+            {
+                *FindIdSlot(index->ids, index->idCapacity, old[i].id) = old[i];
+            }
+        }
+        free(old);
+    }
+
+    IdSlot *slot = FindIdSlot(index->ids, index->idCapacity, id);
+    if (slot->entry < 0)
+    {
+        index->idUsed++;
+    }
+    slot->id = id;
+    slot->entry = (int32_t)entry;
+}
+
+static ClientEntry *EntryForId(const ClientIndex *index, int id)
+{
+    if (index->idCapacity == 0)
+    {
+        return NULL;
+    }
+    const IdSlot *slot = FindIdSlot(index->ids, index->idCapacity, id);
+    if (slot->entry < 0 || !index->entries[slot->entry].live)
+    {
+        return NULL;
+    }
+    return &index->entries[slot->entry];
+}
+
+static void AddEntry(ClientIndex *index, int id, const unsigned char *firstName, const unsigned char *lastName)
+{
+    // Copies are made before the entry exists, so every allocation has an owner as soon as it is stored
+    const unsigned char *names[FIELD_COUNT] = {firstName, lastName};
+    ClientEntry added = {.id = id, .live = 1};
+    for (int f = 0; f < FIELD_COUNT; f++)
+    {
+        if (names[f] != NULL)
+        {
+            if ((added.name[f] = strdup((const char *)names[f])) == NULL)
+            {
+                fprintf(stderr, "Memory allocation failed.\n");
+                exit(EXIT_FAILURE);
+            }
+            added.folded[f] = Fold(added.name[f]);
+        }
+    }
+    index->entries = Grow(index->entries, &index->allocated, index->count + 1, sizeof(ClientEntry));
+    uint32_t e = (uint32_t)index->count++;
+    index->entries[e] = added;
+
+    for (int f = 0; f < FIELD_COUNT; f++)
+    {
+        const char *s = added.folded[f];
+        size_t len = s != NULL ? strlen(s) : 0;
+        for (size_t i = 0; i + 3 <= len; i++)
+        {
+            Posting *posting = AddPosting(index, TrigramKey(f, s + i));
+            // A trigram repeated in one name is listed once
+            if (posting->count > 0 && posting->entries[posting->count - 1] == e)
+            {
+                continue;
+            }
+            if (posting->count == posting->allocated)
+            {
+                uint32_t allocated = posting->allocated ? posting->allocated * 2 : 16;
+                uint32_t *entries = realloc(posting->entries, allocated * sizeof(uint32_t));
+                if (entries == NULL)
+                {
+                    fprintf(stderr, "Memory allocation failed.\n");
+                    exit(EXIT_FAILURE);
+                }
+                posting->entries = entries;
+                posting->allocated = allocated;
+            }
+            posting->entries[posting->count++] = e;
+        }
+    }
+    SetEntryForId(index, id, e);
+}
+
+static void FreeEntries(ClientIndex *index)
+{
+    for (size_t i = 0; i < index->count; i++)
+    {
+        for (int f = 0; f < FIELD_COUNT; f++)
+        {
+            free(index->entries[i].name[f]);
+            free(index->entries[i].folded[f]);
+        }
+    }
+    for (size_t i = 0; i < index->postingCapacity; i++)
+    {
+        free(index->postings[i].entries);
+    }
+    free(index->entries);
+    free(index->postings);
+    free(index->ids);
+    index->entries = NULL;
+    index->count = index->allocated = index->dead = 0;
+    index->postings = NULL;
+    index->postingCapacity = index->postingUsed = 0;
+    index->ids = NULL;
+    index->idCapacity = index->idUsed = 0;
+}
+
+static sqlite3_int64 QueryDataVersion(sqlite3 *db)
+{
+    sqlite3_stmt *stmt;
+    sqlite3_int64 version = -1;
+    if (PrepareCached(db, "PRAGMA data_version;", &stmt) != SQLITE_OK)
+    {
+        return -1;
+    }
+    if (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        version = sqlite3_column_int64(stmt, 0);
+    }
+    ReleaseStatement(stmt);
+    return version;
+}
+
+static int Rebuild(ClientIndex *index)
+{
+    FreeEntries(index);
+    index->dirty.count = 0;
+    index->applied.count = 0;
+    index->needsRebuild = 1; // Stays set if loading fails
+
+    sqlite3_stmt *stmt;
+    int rs;
+    if ((rs = sqlite3_prepare_v2(index->db, "SELECT id, first_name, last_name FROM clients;", -1, &stmt, NULL)) != SQLITE_OK)
+    {
+        fprintf(stderr, "Error preparing statement: %s\n", sqlite3_errmsg(index->db));
+        return rs;
+    }
+    while ((rs = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        AddEntry(index, sqlite3_column_int(stmt, 0), sqlite3_column_text(stmt, 1), sqlite3_column_text(stmt, 2));
+    }
+    sqlite3_finalize(stmt);
+    if (rs != SQLITE_DONE)
+    {
+        fprintf(stderr, "Error loading client index: %s\n", sqlite3_errmsg(index->db));
+        return rs;
+    }
+
+    index->needsRebuild = 0;
+    index->rebuiltInTransaction = !sqlite3_get_autocommit(index->db);
+    index->dataVersion = QueryDataVersion(index->db);
+    return SQLITE_OK;
+}
+
+static void AppendRowid(RowidList *list, sqlite3_int64 rowid)
+{
+    list->rowids = Grow(list->rowids, &list->allocated, list->count + 1, sizeof(sqlite3_int64));
+    list->rowids[list->count++] = rowid;
+}
+
+/**
+ * @brief Re-reads the clients changed through the connection, rebuilds everything if another
+ * connection committed or too many entries are dead.
+ */
+static int Refresh(ClientIndex *index)
+{
+    sqlite3_int64 dataVersion = QueryDataVersion(index->db);
+    if (index->needsRebuild || dataVersion != index->dataVersion)
+    {
+        return Rebuild(index);
+    }
+    if (index->dirty.count == 0)
+    {
+        return SQLITE_OK;
+    }
+
+    sqlite3_stmt *stmt;
+    int rs;
+    if ((rs = PrepareCached(index->db, "SELECT first_name, last_name FROM clients WHERE id = ?1;", &stmt)) != SQLITE_OK)
+    {
+        fprintf(stderr, "Error preparing statement: %s\n", sqlite3_errmsg(index->db));
+        return rs;
+    }
+    int inTransaction = !sqlite3_get_autocommit(index->db);
+    for (size_t i = 0; i < index->dirty.count; i++)
+    {
+        int id = (int)index->dirty.rowids[i];
+        ClientEntry *old = EntryForId(index, id);
+        if (old != NULL)
+        {
+            old->live = 0;
+            index->dead++;
+        }
+        sqlite3_bind_int(stmt, 1, id);
+        if ((rs = sqlite3_step(stmt)) == SQLITE_ROW)
+        {
+            AddEntry(index, id, sqlite3_column_text(stmt, 0), sqlite3_column_text(stmt, 1));
+        }
+        else if (rs != SQLITE_DONE)
+        {
+            fprintf(stderr, "Error executing statement: %s - %s\n", sqlite3_errstr(rs), sqlite3_errmsg(index->db));
+            ReleaseStatement(stmt);
+            index->needsRebuild = 1;
+            return rs;
+        }
+        sqlite3_reset(stmt);
+        if (inTransaction)
+        {
+            AppendRowid(&index->applied, id);
+        }
+    }
+    ReleaseStatement(stmt);
+    index->dirty.count = 0;
+
+    // Posting lists still reference dead entries, start over once they add up
+    return index->dead > MAX_DEAD_ENTRIES ? Rebuild(index) : SQLITE_OK;
+}
+
+static int ContainsRowid(const RowidList *list, sqlite3_int64 rowid)
+{
+    for (size_t i = 0; i < list->count; i++)
+    {
+        if (list->rowids[i] == rowid)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void OnClientUpdate(void *ctx, int op, const char *table, sqlite3_int64 rowid)
+{
+    ClientIndex *index = ctx;
+    if (strcmp(table, "clients") != 0 || index->needsRebuild)
+    {
+        return;
+    }
+    if (index->dirty.count >= MAX_DEAD_ENTRIES)
+    {
+        index->needsRebuild = 1; // Cheaper to reload than to re-read each row
+        return;
+    }
+    // An UPDATE that changes clients.id is reported with the new id only, the old entry would stay live.
+    // The new id is unknown to the index or was already changed in this batch, so reload in those cases
+    if (op == SQLITE_UPDATE && (EntryForId(index, (int)rowid) == NULL || ContainsRowid(&index->dirty, rowid)))
+    {
+        index->needsRebuild = 1;
+        return;
+    }
+    AppendRowid(&index->dirty, rowid);
+}
+
+static void OnCommit(void *ctx)
+{
+    ClientIndex *index = ctx;
+    index->applied.count = 0;
+    index->rebuiltInTransaction = 0;
+}
+
+static void OnRollback(void *ctx)
+{
+    ClientIndex *index = ctx;
+    // Rows re-read inside the transaction are back to their committed state
+    for (size_t i = 0; i < index->applied.count; i++)
+    {
+        AppendRowid(&index->dirty, index->applied.rowids[i]);
+    }
+    index->applied.count = 0;
+    if (index->rebuiltInTransaction)
+    {
+        index->needsRebuild = 1;
+        index->rebuiltInTransaction = 0;
+    }
+}
+
+ClientIndex *ClientIndexCreate(sqlite3 *db)
+{
+    ClientIndex *index = calloc(1, sizeof(ClientIndex));
+    if (index == NULL)
+    {
+        fprintf(stderr, "Memory allocation failed for client index.\n");
+        return NULL;
+    }
+    index->db = db;
+    if (Rebuild(index) != SQLITE_OK)
+    {
+        FreeEntries(index);
+        free(index);
+        return NULL;
+    }
+
+    ChangeListener listener = {
+        .onUpdate = OnClientUpdate,
+        .onCommit = OnCommit,
+        .onRollback = OnRollback,
+        .ctx = index};
+    if (AddChangeListener(db, &listener) != SQLITE_OK)
+    {
+        FreeEntries(index);
+        free(index);
+        return NULL;
+    }
+    return index;
+}
+
+void ClientIndexDestroy(ClientIndex *index)
+{
+    if (index == NULL)
+    {
+        return;
+    }
+    RemoveChangeListener(index->db, index);
+    FreeEntries(index);
+    free(index->dirty.rowids);
+    free(index->applied.rowids);
+    free(index->hits);
+    free(index->best);
+    free(index->touched);
+    free(index);
+}
+
+/**
+ * @brief Smallest edit distance between the pattern and any substring of the text (Sellers' algorithm).
+ * @returns The distance, or limit + 1 if it is larger than limit.
+ */
+static int SubstringDistance(const char *pattern, size_t m, const char *text, int limit)
+{
+    int column[CLIENT_INDEX_MAX_TERM + 1];
+    for (size_t i = 0; i <= m; i++)
+    {
+        column[i] = (int)i;
+    }
+    int best = (int)m;
+    for (const char *t = text; *t != '\0' && best > 0; t++)
+    {
+        int diagonal = column[0];
+        column[0] = 0; // A match may start anywhere in the text
+        for (size_t i = 1; i <= m; i++)
+        {
+            int above = column[i];
+            int cost = diagonal + (pattern[i - 1] != *t);
+            int insert = column[i - 1] + 1;
+            int remove = above + 1;
+            column[i] = cost < insert ? (cost < remove ? cost : remove) : (insert < remove ? insert : remove);
+            diagonal = above;
+        }
+        if (column[m] < best)
+        {
+            best = column[m];
+        }
+    }
+    return best <= limit ? best : limit + 1;
+}
+
+static int AllowedTypos(size_t length)
+{
+    // A typo in a 3-4 character term matches too much of any name to be useful
+    if (length > CLIENT_INDEX_MAX_TERM || length < 5)
+    {
+        return 0;
+    }
+    return length < 9 ? 1 : 2;
+}
+
+static void Touch(ClientIndex *index, uint32_t e, int distance)
+{
+    if (index->best[e] == INT8_MAX)
+    {
+        index->touched[index->touchedCount++] = e;
+    }
+    if (distance < index->best[e])
+    {
+        index->best[e] = (int8_t)distance;
+    }
+}
+
+static void SearchField(ClientIndex *index, int field, const char *term)
+{
+    char *folded = Fold(term);
+    size_t m = strlen(folded);
+    int typos = AllowedTypos(m);
+
+    if (m < 3)
+    {
+        // Too short for trigrams, the names are scanned
+        for (size_t e = 0; e < index->count; e++)
+        {
+            const ClientEntry *entry = &index->entries[e];
+            if (entry->live && entry->folded[field] != NULL && strstr(entry->folded[field], folded) != NULL)
+            {
+                Touch(index, (uint32_t)e, 0);
+            }
+        }
+        free(folded);
+        return;
+    }
+
+    // Count shared trigrams per entry, each edit can destroy at most three of them
+    size_t trigrams = 0;
+    uint32_t *candidates = NULL;
+    size_t candidateCount = 0;
+    size_t candidatesAllocated = 0;
+    for (size_t i = 0; i + 3 <= m; i++)
+    {
+        uint32_t key = TrigramKey(field, folded + i);
+        int seen = 0;
+        for (size_t j = 0; j < i && !seen; j++)
+        {
+            seen = TrigramKey(field, folded + j) == key;
+        }
+        if (seen)
+        {
+            continue;
+        }
+        trigrams++;
+        const Posting *posting = FindPosting(index, key);
+        if (posting == NULL)
+        {
+            continue;
+        }
+        for (uint32_t p = 0; p < posting->count; p++)
+        {
+            uint32_t e = posting->entries[p];
+            if (index->hits[e]++ == 0)
+            {
+                candidates = Grow(candidates, &candidatesAllocated, candidateCount + 1, sizeof(uint32_t));
+                candidates[candidateCount++] = e;
+            }
+        }
+    }
+
+    size_t needed = trigrams > (size_t)(3 * typos) ? trigrams - (size_t)(3 * typos) : 1;
+    for (size_t c = 0; c < candidateCount; c++)
+    {
+        uint32_t e = candidates[c];
+        const ClientEntry *entry = &index->entries[e];
+        if (entry->live && index->hits[e] >= needed)
+        {
+            int distance = typos == 0 ? (strstr(entry->folded[field], folded) != NULL ? 0 : 1)
+                                      : SubstringDistance(folded, m, entry->folded[field], typos);
+            if (distance <= typos)
+            {
+                Touch(index, e, distance);
+            }
+        }
+        index->hits[e] = 0;
+    }
+    free(candidates);
+    free(folded);
+}
+
+// Sort key of one match, computed once before sorting
+typedef struct {
+    int distance;
+    size_t lengthDifference; // closest length of a matched name to the term, exact names first
+    int id;
+    uint32_t entry;
+} RankedMatch;
+
+static int CompareRanked(const void *a, const void *b)
+{
+    const RankedMatch *x = a;
+    const RankedMatch *y = b;
+    if (x->distance != y->distance)
+    {
+        return x->distance < y->distance ? -1 : 1;
+    }
+    if (x->lengthDifference != y->lengthDifference)
+    {
+        return x->lengthDifference < y->lengthDifference ? -1 : 1;
+    }
+    return (x->id > y->id) - (x->id < y->id);
+}
+
+static size_t LengthDifference(const ClientEntry *entry, const size_t termLength[FIELD_COUNT])
+{
+    size_t best = SIZE_MAX;
+    for (int f = 0; f < FIELD_COUNT; f++)
+    {
+        if (entry->name[f] != NULL && termLength[f] != SIZE_MAX)
+        {
+            size_t len = strlen(entry->name[f]);
+            size_t diff = len > termLength[f] ? len - termLength[f] : termLength[f] - len;
+            best = diff < best ? diff : best;
+        }
+    }
+    return best;
+}
+
+int ClientIndexSearch(ClientIndex *index, int id, const char *firstName, const char *lastName, ClientMatch **matches,
+                      size_t *count)
+{
+    *matches = NULL;
+    *count = 0;
+    int rs;
+    if ((rs = Refresh(index)) != SQLITE_OK)
+    {
+        return rs;
+    }
+
+    if (index->scratchAllocated < index->count)
+    {
+        size_t allocated = index->scratchAllocated;
+        index->hits = Grow(index->hits, &allocated, index->count, sizeof(uint16_t));
+        allocated = index->scratchAllocated;
+        index->best = Grow(index->best, &allocated, index->count, sizeof(int8_t));
+        allocated = index->scratchAllocated;
+        index->touched = Grow(index->touched, &allocated, index->count, sizeof(uint32_t));
+        memset(index->hits, 0, allocated * sizeof(uint16_t));
+        memset(index->best, INT8_MAX, allocated * sizeof(int8_t));
+        index->scratchAllocated = allocated;
+    }
+    index->touchedCount = 0;
+
+    ClientEntry *byId = EntryForId(index, id);
+    if (byId != NULL)
+    {
+        Touch(index, (uint32_t)(byId - index->entries), -1);
+    }
+    if (firstName != NULL)
+    {
+        SearchField(index, FIELD_FIRST, firstName);
+    }
+    if (lastName != NULL)
+    {
+        SearchField(index, FIELD_LAST, lastName);
+    }
+
+    size_t matchCount = index->touchedCount;
+    RankedMatch *ranked = malloc((matchCount ? matchCount : 1) * sizeof(RankedMatch));
+    ClientMatch *results = malloc((matchCount ? matchCount : 1) * sizeof(ClientMatch));
+    if (ranked == NULL || results == NULL)
+    {
+        fprintf(stderr, "Memory allocation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    size_t termLength[FIELD_COUNT] = {firstName != NULL ? strlen(firstName) : SIZE_MAX,
+                                      lastName != NULL ? strlen(lastName) : SIZE_MAX};
+    for (size_t i = 0; i < matchCount; i++)
+    {
+        uint32_t e = index->touched[i];
+        const ClientEntry *entry = &index->entries[e];
+        ranked[i].distance = index->best[e];
+        ranked[i].lengthDifference = LengthDifference(entry, termLength);
+        ranked[i].id = entry->id;
+        ranked[i].entry = e;
+        index->best[e] = INT8_MAX;
+    }
+    qsort(ranked, matchCount, sizeof(RankedMatch), CompareRanked);
+
+    for (size_t i = 0; i < matchCount; i++)
+    {
+        const ClientEntry *entry = &index->entries[ranked[i].entry];
+        results[i].id = entry->id;
+        results[i].distance = ranked[i].distance;
+        results[i].firstName = entry->name[FIELD_FIRST];
+        results[i].lastName = entry->name[FIELD_LAST];
+    }
+    free(ranked);
+
+    *matches = results;
+    *count = index->touchedCount;
+    return SQLITE_DONE;
+}
@@ -0,0 +1,55 @@
+#ifndef CLIENT_INDEX_H
+#define CLIENT_INDEX_H
+
+#include <sqlite3.h>
+#include <stddef.h>
+
+typedef struct ClientIndex ClientIndex;
+
+// Longest search term matched with typo tolerance, longer terms only match as exact substrings
+#define CLIENT_INDEX_MAX_TERM 128
+
+typedef struct {
+    int id;
+    int distance;          // edits between the term and the closest part of the name, -1 for the searched id
+    const char *firstName; // owned by the index, valid until the next search
+    const char *lastName;
+} ClientMatch;
+
+/**
+ * @brief Loads all client names into an in-memory trigram index and subscribes to changes of clients.
+ *
+ * Changes made through the connection are picked up from the update hook and re-read on the next search
+ * (an UPDATE of clients.id reloads the index, the hook does not report the old id),
+ * changes committed by other connections are detected with PRAGMA data_version and rebuild the index.
+ *
+ * @param db Pointer to a registered SQLite database connection.
+ * @returns Pointer to the index, or NULL if the clients could not be loaded.
+ */
+ClientIndex *ClientIndexCreate(sqlite3 *db);
+
+/**
+ * @brief Unsubscribes from changes and frees the index.
+ * @param index Pointer to the index, may be NULL.
+ */
+void ClientIndexDestroy(ClientIndex *index);
+
+/**
+ * @brief Finds clients whose first name contains firstName or whose last name contains lastName.
+ *
+ * Matching is case-insensitive for ASCII like LIKE. Terms of 5-8 characters also match with one typo,
+ * longer terms with two (edit distance against the closest substring of the name).
+ * Results are ranked: the client with the searched id, then by distance, closeness of the name length and id.
+ *
+ * @param index Pointer to the index.
+ * @param id Client id that always matches.
+ * @param firstName Term searched in first names, NULL to skip.
+ * @param lastName Term searched in last names, NULL to skip.
+ * @param matches Pointer where the array of matches is stored, caller frees it (names stay owned by the index).
+ * @param count Pointer where the number of matches is stored.
+ * @returns SQLITE_DONE on success (like a finished query) or sqlite3 error code if the index could not be refreshed.
+ */
+int ClientIndexSearch(ClientIndex *index, int id, const char *firstName, const char *lastName, ClientMatch **matches,
+                      size_t *count);
+
+#endif // CLIENT_INDEX_H
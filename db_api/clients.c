@@ -5,38 +5,45 @@
 #include <string.h>
 #include "clients.h"
 #include "db.h"
+#include "stmt_cache.h"
+#include "connection.h"
+#include "client_index.h"
+#include "entity_cache.h"
+#include "search_cursor.h"
 #include "../main.h"
 
-void InitClientWrapper(GenericWrapper *wrapper)
+void FreeClient(Client *client)
 {
-    wrapper->data = NULL;
-    wrapper->freeData = FreeClient;
-    wrapper->getElementAt = GetClientAt;
-    wrapper->size = 0;
-    wrapper->used = 0;
-    wrapper->limit = 0;
-}
-
-void FreeClient(void *pClient)
-{
-    Client *client = (Client *)pClient;
     if (client == NULL)
     {
         return; // Nothing to free
     }
-    FreeMemory((void **)&client->first_name);
-    FreeMemory((void **)&client->last_name);
+    ShortStringFree(&client->first_name);
+    ShortStringFree(&client->last_name);
 }
 
-void *GetClientAt(void *pWrapper, size_t index)
+void ReadClientRow(Client *client, sqlite3_stmt *stmt)
 {
-    GenericWrapper *wrapper = (GenericWrapper *)pWrapper;
-    if (index >= wrapper->used)
-    {
-        return NULL; // Index out of bounds
-    }
-    Client *pClient = (Client *)wrapper->data + index;
-    return (void *)pClient;
+    client->id = sqlite3_column_int(stmt, 0);
+    ShortStringSetRef(&client->first_name, ColumnTextRef(stmt, 1));
+    ShortStringSetRef(&client->last_name, ColumnTextRef(stmt, 2));
+}
+
+void RetainClientRow(const ClientRow *row, ClientVector *clients)
+{
+    Client *client = ClientVectorPush(clients);
+    client->id = row->id;
+    ShortStringSetRef(&client->first_name, row->first_name);
+    ShortStringSetRef(&client->last_name, row->last_name);
+}
+
+// Replaces the names of a found client, the previous ones are freed
+static void SetClientNames(Client *client, int id, const unsigned char *firstName, const unsigned char *lastName)
+{
+    FreeClient(client);
+    client->id = id;
+    ShortStringSet(&client->first_name, (const char *)firstName);
+    ShortStringSet(&client->last_name, (const char *)lastName);
 }
 
 int GetClient(sqlite3 *db, Client *client)
@@ -46,55 +53,28 @@ int GetClient(sqlite3 *db, Client *client)
 
     const char *sql = "SELECT id, first_name, last_name FROM clients WHERE id = ?1 OR first_name LIKE '%' || ?2 || '%' OR last_name LIKE '%' || ?3 || '%';";
     int rs;
-    if ((rs = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL)) != SQLITE_OK)
+    if ((rs = PrepareCached(db, sql, &stmt)) != SQLITE_OK)
     {
         // Error preparing statement
         fprintf(stderr, "Error preparing statement: %s\n", sqlite3_errmsg(db));
         return rs;
     }
     sqlite3_bind_int(stmt, 1, client->id);
-    sqlite3_bind_text(stmt, 2, client->first_name, -1, SQLITE_STATIC);
-    sqlite3_bind_text(stmt, 3, client->last_name, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, ShortStringGet(&client->first_name), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 3, ShortStringGet(&client->last_name), -1, SQLITE_STATIC);
 
     if ((rs = sqlite3_step(stmt)) == SQLITE_ROW)
     {
         // Successfully retrieved a row
-        client->id = sqlite3_column_int(stmt, 0);
-        const unsigned char *firstName = sqlite3_column_text(stmt, 1);
-        const unsigned char *lastName = sqlite3_column_text(stmt, 2);
-        if (firstName)
-        {
-            // strncpy(product->name, (const char *)name, sizeof(product->name) - 1);
-            client->first_name = strdup((const char *)firstName);
-            client->first_name[sizeof(client->first_name) - 1] = '\0'; // Ensure null termination
-        }
-        else
-        {
-            client->first_name[0] = '\0'; // Handle NULL case
-        }
-
-        if (lastName)
-        {
-            client->last_name = strdup((const char *)lastName);
-            client->last_name[sizeof(client->last_name) - 1] = '\0'; // Ensure null termination
-        }
-        else
-        {
-            client->last_name[0] = '\0'; // Handle NULL case
-        }
-
-        sqlite3_finalize(stmt);
-    }
-    else if (rs == SQLITE_DONE)
-    {
-        // No rows found
-        sqlite3_finalize(stmt);
+        FreeClient(client);
+        ReadClientRow(client, stmt);
     }
-    else
+    else if (rs != SQLITE_DONE)
     {
         fprintf(stderr, "Error executing statement: %s - %s\n", sqlite3_errstr(rs), sqlite3_errmsg(db));
     }
 
+    ReleaseStatement(stmt);
     return rs;
 }
 
@@ -102,178 +82,144 @@ int GetClientById(sqlite3 *db, int clientId, Client *client)
 {
     if (client == NULL)
     {
-        fprintf(stderr, "Product pointer is NULL.\n");
+        fprintf(stderr, "Client pointer is NULL.\n");
         return SQLITE_MISUSE; // Return an error code for misuse
     }
 
-    client->id = clientId;        // Set the ID to search for
-    client->first_name[0] = '\0'; // Initialize name to an empty string
-    client->last_name[0] = '\0';
-
     int rs;
-    const char *sql = "SELECT id, first_name, last_name clients products WHERE id = ?1;";
-    sqlite3_stmt *stmt;
-    // Prepare the SQL statement to select a client by ID
-    if ((rs = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL)) != SQLITE_OK)
+    const char *names[2];
+    DbConnection *conn = GetConnection(db);
+    EntityCache *cache = conn != NULL ? conn->entityCache : NULL;
+    if (cache != NULL && (rs = EntityCacheGet(cache, ENTITY_CLIENT, clientId, names)) != SQLITE_NOTFOUND)
     {
-        // Error preparing statement
-        fprintf(stderr, "Error preparing statement: %s\n", sqlite3_errmsg(db));
-        return rs;
+        if (rs == SQLITE_ROW)
+        {
+            SetClientNames(client, clientId, (const unsigned char *)names[0], (const unsigned char *)names[1]);
+        }
     }
-    sqlite3_bind_int(stmt, 1, clientId);
-    if ((rs = sqlite3_step(stmt)) & (SQLITE_ROW | SQLITE_DONE))
+    else
     {
-        int id = sqlite3_column_int(stmt, 0);
-        if (id == clientId)
+        const char *sql = "SELECT first_name, last_name FROM clients WHERE id = ?1;";
+        sqlite3_stmt *stmt;
+        // Prepare the SQL statement to select a client by ID
+        if ((rs = PrepareCached(db, sql, &stmt)) != SQLITE_OK)
         {
-            // Successfully retrieved a row
-            client->id = id;
-            const unsigned char *firstName = sqlite3_column_text(stmt, 1);
-            const unsigned char *lastName = sqlite3_column_text(stmt, 2);
-            // Set first name
-            if (firstName)
-            {
-                client->first_name = strdup((const char *)firstName);
-                client->first_name[sizeof(client->first_name) - 1] = '\0'; // Ensure null termination
-            }
-            else
-            {
-                client->first_name[0] = '\0'; // Handle NULL case
-            }
-
-            // Set last name
-            if (lastName)
-            {
-                client->last_name = strdup((const char *)lastName);
-                client->last_name[sizeof(client->last_name) - 1] = '\0'; // Ensure null termination
-            }
-            else
-            {
-                client->last_name[0] = '\0'; // Handle NULL case
-            }
+            // Error preparing statement
+            fprintf(stderr, "Error preparing statement: %s\n", sqlite3_errmsg(db));
+            return rs;
+        }
+        sqlite3_bind_int(stmt, 1, clientId);
+        const unsigned char *firstName = NULL;
+        const unsigned char *lastName = NULL;
+        if ((rs = sqlite3_step(stmt)) == SQLITE_ROW)
+        {
+            firstName = sqlite3_column_text(stmt, 0);
+            lastName = sqlite3_column_text(stmt, 1);
+            SetClientNames(client, clientId, firstName, lastName);
+        }
+        else if (rs != SQLITE_DONE)
+        {
+            fprintf(stderr, "Error executing statement: %s - %s\n", sqlite3_errstr(rs), sqlite3_errmsg(db));
         }
-        else
+        if (cache != NULL && (rs == SQLITE_ROW || rs == SQLITE_DONE))
         {
-            fprintf(stderr, "Client with ID %d not found.\n", clientId);
+            EntityCachePut(cache, ENTITY_CLIENT, clientId, rs == SQLITE_ROW, firstName, lastName);
         }
-        sqlite3_finalize(stmt);
+        ReleaseStatement(stmt);
     }
 
+    if (rs == SQLITE_DONE)
+    {
+        fprintf(stderr, "Client with ID %d not found.\n", clientId);
+    }
     return rs;
 }
 
-int GetMatchedClients(sqlite3 *db, Client *searchClient, GenericWrapper *clientWrapper)
+/**
+ * @brief Visits the matches of the in-memory client index, best matches first.
+ */
+static int VisitMatchedClientsIndexed(ClientIndex *index, const Client *searchClient, ClientRowVisitor visit,
+                                      void *ctx)
 {
+    ClientMatch *matches;
+    size_t count;
+    int rs = ClientIndexSearch(index, searchClient->id, ShortStringGet(&searchClient->first_name),
+                               ShortStringGet(&searchClient->last_name), &matches, &count);
+    if (rs != SQLITE_DONE)
+    {
+        return rs;
+    }
+
+    for (size_t i = 0; i < count && rs == SQLITE_DONE; i++)
+    {
+        ClientRow row = {matches[i].id, MakeTextRef(matches[i].firstName), MakeTextRef(matches[i].lastName)};
+        if (visit(&row, ctx) != 0)
+        {
+            rs = SQLITE_ABORT;
+        }
+    }
+    free(matches);
+    return rs;
+}
+
+int VisitMatchedClients(sqlite3 *db, const Client *searchClient, ClientRowVisitor visit, void *ctx)
+{
+    DbConnection *conn = GetConnection(db);
+    if (conn != NULL && conn->clientIndex != NULL)
+    {
+        return VisitMatchedClientsIndexed(conn->clientIndex, searchClient, visit, ctx);
+    }
+
+    // Connection not opened through db_init, search the table
     sqlite3_stmt *stmt;
 
     const char *sql = "SELECT id, first_name, last_name FROM clients WHERE id = ?1 OR first_name LIKE '%' || ?2 || '%' OR last_name LIKE '%' || ?3 || '%';";
-    // For readability, define indices for the columns, not sure if there is a better way to do this
-    const int idIdx = 0;
-    const int firstNameIdx = 1;
-    const int lastNameIdx = 2;
-
     int rs;
-    if ((rs = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL)) != SQLITE_OK)
+    if ((rs = PrepareCached(db, sql, &stmt)) != SQLITE_OK)
     {
         // Error preparing statement
         fprintf(stderr, "Error preparing statement: %s\n", sqlite3_errmsg(db));
         return rs;
     }
     sqlite3_bind_int(stmt, 1, searchClient->id);
-    sqlite3_bind_text(stmt, 2, searchClient->first_name, -1, SQLITE_STATIC);
-    sqlite3_bind_text(stmt, 3, searchClient->last_name, -1, SQLITE_STATIC);
-
-    int count = 0;
-    int allocated = 4; // Initial allocation size
-    Client *clients = malloc(allocated * sizeof(Client));
-    Client *tempClient = NULL;
-    if (!clients)
-    {
-        fprintf(stderr, "Memory allocation failed.\n");
-        sqlite3_finalize(stmt);
-        exit(EXIT_FAILURE);
-    }
+    sqlite3_bind_text(stmt, 2, ShortStringGet(&searchClient->first_name), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 3, ShortStringGet(&searchClient->last_name), -1, SQLITE_STATIC);
 
     while ((rs = sqlite3_step(stmt)) == SQLITE_ROW)
     {
-        if (count >= allocated)
-        {
-            // Resize the array if needed
-            allocated *= 2;
-            tempClient = realloc(clients, allocated * sizeof(Client));
-            if (!tempClient)
-            {
-                fprintf(stderr, "Memory reallocation failed.\n");
-                // Free all the products in array before exiting
-                for (int i = 0; i < count; i++)
-                {
-                    FreeClient((void **)&clients[i]);
-                }
-                // then free the array itself
-                FreeMemory((void **)&clients);
-                sqlite3_finalize(stmt);
-                exit(EXIT_FAILURE);
-            }
-
-            clients = tempClient;
-        }
-
-        // Successfully retrieved a row
-        (clients + count)->id = sqlite3_column_int(stmt, idIdx);
-        const unsigned char *lastName = sqlite3_column_text(stmt, lastNameIdx);
-        const unsigned char *firstName = sqlite3_column_text(stmt, firstNameIdx);
-        if (firstName)
-        {
-            // strncpy((products + count)->name, (const char *)name, sizeof((products + count)->name) - 1);
-            (clients + count)->first_name = strdup((const char *)firstName);
-            // null termination?
-        }
-        else
+        ClientRow row = {sqlite3_column_int(stmt, 0), ColumnTextRef(stmt, 1), ColumnTextRef(stmt, 2)};
+        if (visit(&row, ctx) != 0)
         {
-            // Handle NULL case
-            (clients + count)->first_name = NULL;
+            rs = SQLITE_ABORT;
+            break;
         }
-
-        if(lastName) 
-        {
-            (clients + count)->last_name = strdup((const char *)lastName);
-        }
-        else
-        {
-            // Handle NULL case
-            (clients + count)->last_name = NULL;
-        }
-
-        count++;
     }
-
-    clientWrapper->data = clients;
-    clientWrapper->used = count;
-    clientWrapper->limit = allocated;
-    clientWrapper->size = sizeof(Client);
-
-    if (rs == SQLITE_DONE)
-    {
-        // No rows found
-        sqlite3_finalize(stmt);
-    }
-    else
+    if (rs != SQLITE_DONE && rs != SQLITE_ABORT)
     {
         fprintf(stderr, "Error executing statement: %s - %s\n", sqlite3_errstr(rs), sqlite3_errmsg(db));
     }
 
+    ReleaseStatement(stmt);
     return rs;
 }
 
+static int RetainClientVisitor(const ClientRow *row, void *ctx)
+{
+    RetainClientRow(row, ctx);
+    return 0;
+}
+
+int GetMatchedClients(sqlite3 *db, Client *searchClient, ClientVector *clients)
+{
+    return VisitMatchedClients(db, searchClient, RetainClientVisitor, clients);
+}
+
 int PromptUserForClient(sqlite3 *db, Client **outClient)
 {
-    GenericWrapper *clientWrapper = malloc(sizeof(GenericWrapper));
-    if(clientWrapper == NULL)
-    {
-        fprintf(stderr, "Memory allocation failed for client wrapper.\n");
-        exit(EXIT_FAILURE);
-    }
-    InitClientWrapper(clientWrapper);
+    ClientVector clients;
+    // Only the selected row is copied out, the page is released with the arena
+    DbConnection *conn = GetConnection(db);
+    ClientVectorInitArena(&clients, conn != NULL ? conn->searchArena : NULL);
     // First get the product name from the user
     char firstName[128];
     char lastName[128];
@@ -309,49 +255,76 @@ int PromptUserForClient(sqlite3 *db, Client **outClient)
 
     Client client = {
         .id = 0,
-        .first_name = NULL,
-        .last_name = NULL
+        .first_name = {.kind = SHORT_STRING_NULL},
+        .last_name = {.kind = SHORT_STRING_NULL}
     };
-    // strncpy(product.name, product_name, sizeof(product.name) - 1);
-    client.first_name = strdup(firstName);
-    client.last_name = strdup(lastName);
-    if (client.first_name == NULL || client.last_name == NULL)
-    {
-        fprintf(stderr, "Memory allocation failed for client names.\n");
-        exit(EXIT_FAILURE);
-    }
+    ShortStringSet(&client.first_name, firstName);
+    ShortStringSet(&client.last_name, lastName);
 
     int rs;
-    // Get matched products in generic wrapper
-    // do not forget to free the wrapper after use
-    if ((rs = GetMatchedClients(db, &client, clientWrapper)) & (SQLITE_ROW | SQLITE_DONE))
+    // Exact matches page by page in name order, the typo tolerant search only if there are none
+    SearchCursor *cursor = NULL;
+    if ((rs = OpenClientCursor(db, &client, CLIENT_PAGE_SIZE, &cursor)) == SQLITE_OK)
+    {
+        rs = CursorNextClientPage(cursor, &clients);
+    }
+    if (rs == SQLITE_DONE)
+    {
+        CloseCursor(cursor);
+        cursor = NULL;
+        rs = GetMatchedClients(db, &client, &clients);
+    }
+    if (rs & (SQLITE_ROW | SQLITE_DONE))
     {
-        // TODO: limit for the number of clients to display and ask the user to narrow down the search if there are too many results
-        for (size_t i = 0; i < clientWrapper->used; i++)
+        size_t shown = 0;
+        int clientId = 0;
+        for (;;)
         {
-            Client *pClient = (Client *)clientWrapper->getElementAt(clientWrapper, i);
-            PrintClient(pClient);
+            for (size_t i = 0; i < clients.count; i++)
+            {
+                PrintClient(ClientVectorAt(&clients, i));
+            }
+            shown += clients.count;
+            if (cursor == NULL || CursorFinished(cursor))
+            {
+                printf("Found %zu clients matching '%s %s':\n", shown, ShortStringGet(&client.first_name),
+                       ShortStringGet(&client.last_name));
+                printf("Type ID of the client you want to select or 0 to cancel: ");
+            }
+            else
+            {
+                printf("Showing %zu clients matching '%s %s' so far.\n", shown, ShortStringGet(&client.first_name),
+                       ShortStringGet(&client.last_name));
+                printf("Type ID of the client you want to select, 0 to cancel or -1 for more: ");
+            }
+            // Read the client ID from user input
+            scanf("%d", &clientId);
+            // Clear the input buffer
+            while (getchar() != '\n' && getchar() != EOF);
+            if (clientId != -1 || cursor == NULL || CursorFinished(cursor))
+            {
+                break;
+            }
+            // Only the current page can be picked from, earlier ones are released
+            if ((rs = CursorNextClientPage(cursor, &clients)) != SQLITE_ROW)
+            {
+                clientId = 0;
+                break;
+            }
         }
-        printf("Found %zu clients matching '%s %s':\n", clientWrapper->used, client.first_name, client.last_name);
-        printf("Type ID of the client you want to select or 0 to cancel: ");
-        int clientId;
-        // Read the product ID from user input
-        scanf("%d", &clientId);
-        // Clear the input buffer
-        while (getchar() != '\n' && getchar() != EOF);
         if (clientId == 0)
         {
             printf("Client selection cancelled.\n");
+            CloseCursor(cursor);
             FreeClient(&client); // Free the client names
-            FreeWrapper(clientWrapper); // Free the wrapper after use
-            FreeMemory((void **)&clientWrapper);
+            ClientVectorFree(&clients); // Free the vector after use
             return 0; // User cancelled the selection
         }
 
         // Check if picked ID is in fetched clients and set it to outClient
-        for (size_t i = 0; i < clientWrapper->used; i++)
+        for (size_t i = 0; i < clients.count; i++)
         {
-            Client *pClient = (Client *)clientWrapper->getElementAt(clientWrapper, i);
+            Client *pClient = ClientVectorAt(&clients, i);
             if (pClient->id == clientId)
             {
                 // Set the output product to the found one
@@ -363,19 +336,14 @@ int PromptUserForClient(sqlite3 *db, Client **outClient)
                 }
                 // Copy the found product data
                 newPClient->id = pClient->id;
-                newPClient->first_name = strdup(pClient->first_name);
-                newPClient->last_name = strdup(pClient->last_name);
-                if (newPClient->first_name == NULL || newPClient->last_name == NULL)
-                {
-                    fprintf(stderr, "Memory allocation failed for client names.\n");
-                    exit(EXIT_FAILURE);
-                }
+                ShortStringCopy(&newPClient->first_name, &pClient->first_name);
+                ShortStringCopy(&newPClient->last_name, &pClient->last_name);
 
                 *outClient = newPClient; // Set the output product to the selected one
                 printf("Selected Client: ");
                 PrintClient(newPClient);
-                FreeWrapper(clientWrapper); // Free the wrapper after use
-                FreeMemory((void **)&clientWrapper); // Free the client names
+                CloseCursor(cursor);
+                ClientVectorFree(&clients); // Free the vector after use
                 FreeClient(&client); // Free the client names
                 return 1; // Successfully selected a product
             }
@@ -412,13 +380,8 @@ int PromptUserForClient(sqlite3 *db, Client **outClient)
                     exit(EXIT_FAILURE);
                 }
                 newPClient->id = client.id;
-                newPClient->first_name = strdup(client.first_name);
-                newPClient->last_name = strdup(client.last_name);
-                if (newPClient->first_name == NULL || newPClient->last_name == NULL)
-                {
-                    fprintf(stderr, "Memory allocation failed for client names.\n");
-                    exit(EXIT_FAILURE);
-                }
+                ShortStringCopy(&newPClient->first_name, &client.first_name);
+                ShortStringCopy(&newPClient->last_name, &client.last_name);
 
                 *outClient = newPClient;
                 printf("Found client: ");
@@ -437,11 +400,12 @@ int PromptUserForClient(sqlite3 *db, Client **outClient)
     }
     else
     {
-        printf("%s - searched for client '%s %s'\n", sqlite3_errstr(rs), client.first_name, client.last_name);
+        printf("%s - searched for client '%s %s'\n", sqlite3_errstr(rs), ShortStringGet(&client.first_name),
+               ShortStringGet(&client.last_name));
     }
 
-    FreeWrapper(clientWrapper); // Free the wrapper after use
-    FreeMemory((void **)&clientWrapper);
+    CloseCursor(cursor);
+    ClientVectorFree(&clients); // Free the vector after use
     FreeClient(&client); // Free the client names
     return rs;
 }
@@ -453,5 +417,6 @@ void PrintClient(Client *client)
         printf("No client data available.\n");
         return;
     }
-    printf("Client ID: %d, Name: %s %s\n", client->id, client->first_name, client->last_name);
+    printf("Client ID: %d, Name: %s %s\n", client->id, ShortStringGet(&client->first_name),
+           ShortStringGet(&client->last_name));
 }
\ No newline at end of file
@@ -3,15 +3,51 @@
 
 #include <sqlite3.h>
 #include "db.h"
+#include "vector.h"
+#include "row_view.h"
+#include "short_string.h"
 #include <inttypes.h>
 #include <stdlib.h>
 
 typedef struct {
-    int id;        
-    char *first_name;
-    char *last_name;
+    int id;
+    ShortString first_name; // read with ShortStringGet
+    ShortString last_name;
 } Client;
 
+/**
+ * @brief Frees memory allocated for a Client structure.
+ * @param client Pointer to the Client structure to be freed.
+ */
+void FreeClient(Client *client);
+
+/**
+ * @brief Fills a client from the current row of a statement selecting id, first_name and last_name, in this order.
+ * @param client Pointer to the Client structure to fill.
+ * @param stmt Statement positioned on a row.
+ */
+void ReadClientRow(Client *client, sqlite3_stmt *stmt);
+
+DEFINE_VECTOR(ClientVector, Client, FreeClient)
+DEFINE_VECTOR_ROWS(ClientVector, Client, ReadClientRow)
+
+// A client row as borrowed by a visitor, the names are valid only during the callback
+typedef struct {
+    int id;
+    TextRef first_name;
+    TextRef last_name;
+} ClientRow;
+
+// Called once per row, a nonzero return stops the visit
+typedef int (*ClientRowVisitor)(const ClientRow *row, void *ctx);
+
+/**
+ * @brief Copies a visited client row into a vector, for callers that keep rows past the callback.
+ * @param row Row passed to the visitor.
+ * @param clients Pointer to an initialized vector.
+ */
+void RetainClientRow(const ClientRow *row, ClientVector *clients);
+
 /**
  * @brief Retrieves a client from the database.
  * @param db Pointer to the SQLite database connection.
@@ -30,22 +66,47 @@ int GetClient(sqlite3 *db, Client *client);
 
 /**
  * @brief Convenience function to retrieve a client by only its ID
+ *
+ * Answered from the connection's entity cache when possible (see entity_cache.h),
+ * which also remembers ids that do not exist.
+ *
  * @param db Pointer to the SQLite database connection.
  * @param clientId The ID of the client to retrieve.
- * @param client Pointer to a Client structure that will be filled with the retrieved data.
+ * @param client Pointer to a Client structure that will be filled with the retrieved data,
+ * its names must be NULL or heap allocated and are replaced (freed) if the client is found.
+ * @returns SQLITE_ROW if the client is found, SQLITE_DONE if not, or sqlite3 error code.
  */
 int GetClientById(sqlite3 *db, int clientId, Client *client);
 /**
  * @brief Retrieves clients that match the search criteria from the database.
+ *
+ * Matches the client with the searched id and clients whose first name contains first_name or whose
+ * last name contains last_name. On connections opened by db_init the in-memory trigram index answers
+ * the search without a query; it also tolerates typos and ranks the results (see client_index.h).
+ *
  * @param db Pointer to the SQLite database connection.
  * @param searchClient Pointer to a Client structure containing search criteria.
- * @param clientWrapper Pointer to a GenericWrapper structure where matched clients will be stored.
+ * @param clients Pointer to an initialized vector the matched clients are appended to, may use an arena (see ClientVectorInitArena).
  * @returns sqlite3 result code or -1 on error.
  */
-int GetMatchedClients(sqlite3 *db, Client *searchClient, GenericWrapper *clientWrapper);
+int GetMatchedClients(sqlite3 *db, Client *searchClient, ClientVector *clients);
+
+/**
+ * @brief Calls a visitor for each client GetMatchedClients would return, in the same order, without copying the names.
+ * @param db Pointer to the SQLite database connection.
+ * @param searchClient Pointer to a Client structure containing search criteria.
+ * @param visit Callback receiving each row, copy with RetainClientRow what must outlive the call.
+ * @param ctx Passed to the visitor.
+ * @returns SQLITE_DONE after the last row, SQLITE_ABORT if the visitor stopped, or sqlite3 error code.
+ */
+int VisitMatchedClients(sqlite3 *db, const Client *searchClient, ClientRowVisitor visit, void *ctx);
 
 /**
  * @brief Prompts the user for client details and retrieves matching products from the database for user to select.
+ *
+ * Substring matches are shown CLIENT_PAGE_SIZE at a time in name order (see OpenClientCursor), the next page
+ * is fetched on request. If nothing matches exactly, the typo tolerant GetMatchedClients results are shown.
+ *
  * @param db Pointer to the SQLite database connection.
  * @param outClient Pointer to a Client structure where the selected product will be stored.
  * 
@@ -53,26 +114,6 @@ int GetMatchedClients(sqlite3 *db, Client *searchClient, GenericWrapper *clientW
  */
 int PromptUserForClient(sqlite3 *db, Client **outClient);
 
-/**
- * @brief Frees memory allocated for a Client structure.
- * @param pClient Pointer to the Client structure to be freed.
- */
-void FreeClient(void *pClient);
-
-/**
- * @brief Gets a client at the specified index from a wrapper.
- * @param pWrapper Pointer to the wrapper containing clients.
- * @param index The index of the client to retrieve.
- * @returns Pointer to the Client at the specified index, or NULL if index is out of bounds.
- */
-void *GetClientAt(void *pWrapper, size_t index);
-
-/**
- * @brief Initializes a GenericWrapper for handling Client structures.
- * @param wrapper Pointer to the GenericWrapper to initialize.
- */
-void InitClientWrapper(GenericWrapper *wrapper);
-
 /**
  * @brief Prints the details of a single client to the console.
  * @param client Pointer to the Client structure to print.
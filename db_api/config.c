@@ -0,0 +1,470 @@
+#include <sqlite3.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <stdint.h>
+#include "config.h"
+#include "db.h"
+
+static const DbConfig profiles[] = {
+    // SQLite defaults: rollback journal, synchronous=FULL, 2 MiB page cache, no mmap
+    {.profile = CONFIG_DEFAULT_PROFILE,
+     .path = DB_PATH,
+     .cacheSize = CONFIG_UNSET,
+     .mmapSize = CONFIG_UNSET,
+     .busyTimeout = CONFIG_UNSET,
+     .foreignKeys = CONFIG_UNSET},
+    // Short write transactions: WAL makes a commit one append and fsync only at checkpoints
+    {.profile = "oltp",
+     .path = DB_PATH,
+     .journalMode = "wal",
+     .synchronous = "normal",
+     .cacheSize = -8192,
+     .mmapSize = 64LL * 1024 * 1024,
+     .busyTimeout = 5000,
+     .foreignKeys = 1},
+    // Long read-only scans: the whole file memory mapped. temp_store=memory and a page cache much larger
+    // than this made the GROUP BY temp b-trees of the shop reports slower, so both stay moderate
+    {.profile = "reporting",
+     .path = DB_PATH,
+     .journalMode = "wal",
+     .synchronous = "normal",
+     .cacheSize = -16384,
+     .mmapSize = 1024LL * 1024 * 1024,
+     .busyTimeout = 5000,
+     .foreignKeys = 1},
+};
+
+static const char *const journalModes[] = {"delete", "truncate", "persist", "memory", "wal", "off", NULL};
+static const char *const synchronousModes[] = {"off", "normal", "full", "extra", NULL};
+static const char *const tempStores[] = {"default", "file", "memory", NULL};
+static const char *const analyticsEngines[] = {"auto", "sql", "matrix", NULL};
+
+typedef struct {
+    const char *key;
+    const char *env;
+} ConfigKey;
+
+static const ConfigKey keys[] = {
+    {"path", "HW3_DB_PATH"},
+    {"journal_mode", "HW3_JOURNAL_MODE"},
+    {"synchronous", "HW3_SYNCHRONOUS"},
+    {"cache_size", "HW3_CACHE_SIZE"},
+    {"mmap_size", "HW3_MMAP_SIZE"},
+    {"temp_store", "HW3_TEMP_STORE"},
+    {"busy_timeout", "HW3_BUSY_TIMEOUT"},
+    {"foreign_keys", "HW3_FOREIGN_KEYS"},
+    {"analytics_engine", "HW3_ANALYTICS_ENGINE"},
+    {"catalog_mirror", "HW3_CATALOG_MIRROR"},
+};
+
+static int SetChoice(char *dest, size_t size, const char *value, const char *const *choices)
+{
+    char lower[16];
+    size_t len = strlen(value);
+    if (len >= sizeof(lower))
+    {
+        return 0;
+    }
+    for (size_t i = 0; i <= len; i++)
+    {
+        lower[i] = (char)tolower((unsigned char)value[i]);
+    }
+    for (size_t i = 0; choices[i] != NULL; i++)
+    {
+        if (strcmp(lower, choices[i]) == 0)
+        {
+            snprintf(dest, size, "%s", choices[i]);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int ParseInt64(const char *value, sqlite3_int64 min, sqlite3_int64 max, sqlite3_int64 *out)
+{
+    char *end;
+    errno = 0;
+    long long v = strtoll(value, &end, 10);
+    if (end == value || *end != '\0' || errno != 0 || v < min || v > max)
+    {
+        return 0;
+    }
+    *out = v;
+    return 1;
+}
+
+static int ParseBool(const char *value, int *out)
+{
+    if (strcmp(value, "1") == 0 || strcmp(value, "on") == 0 || strcmp(value, "true") == 0)
+    {
+        *out = 1;
+        return 1;
+    }
+    if (strcmp(value, "0") == 0 || strcmp(value, "off") == 0 || strcmp(value, "false") == 0)
+    {
+        *out = 0;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Sets one setting from its textual value.
+ * @param source Where the value came from, used in the error message.
+ * @returns SQLITE_OK on success, SQLITE_ERROR if the key or value is invalid.
+ */
+static int SetConfigValue(DbConfig *config, const char *key, const char *value, const char *source)
+{
+    int ok = 0;
+    sqlite3_int64 number;
+    if (strcmp(key, "path") == 0)
+    {
+        ok = value[0] != '\0' && strlen(value) < sizeof(config->path);
+        if (ok)
+        {
+            snprintf(config->path, sizeof(config->path), "%s", value);
+        }
+    }
+    else if (strcmp(key, "journal_mode") == 0)
+    {
+        ok = SetChoice(config->journalMode, sizeof(config->journalMode), value, journalModes);
+    }
+    else if (strcmp(key, "synchronous") == 0)
+    {
+        ok = SetChoice(config->synchronous, sizeof(config->synchronous), value, synchronousModes);
+    }
+    else if (strcmp(key, "temp_store") == 0)
+    {
+        ok = SetChoice(config->tempStore, sizeof(config->tempStore), value, tempStores);
+    }
+    else if (strcmp(key, "analytics_engine") == 0)
+    {
+        ok = SetChoice(config->analyticsEngine, sizeof(config->analyticsEngine), value, analyticsEngines);
+    }
+    else if (strcmp(key, "cache_size") == 0)
+    {
+        if ((ok = ParseInt64(value, -2147483647LL, 2147483647LL, &number)))
+        {
+            config->cacheSize = (int)number;
+        }
+    }
+    else if (strcmp(key, "mmap_size") == 0)
+    {
+        if ((ok = ParseInt64(value, 0, INT64_MAX, &number)))
+        {
+            config->mmapSize = number;
+        }
+    }
+    else if (strcmp(key, "busy_timeout") == 0)
+    {
+        if ((ok = ParseInt64(value, 0, 2147483647LL, &number)))
+        {
+            config->busyTimeout = (int)number;
+        }
+    }
+    else if (strcmp(key, "foreign_keys") == 0)
+    {
+        ok = ParseBool(value, &config->foreignKeys);
+    }
+    else if (strcmp(key, "catalog_mirror") == 0)
+    {
+        ok = ParseBool(value, &config->catalogMirror);
+    }
+    else
+    {
+        fprintf(stderr, "%s: unknown setting '%s'\n", source, key);
+        return SQLITE_ERROR;
+    }
+
+    if (!ok)
+    {
+        fprintf(stderr, "%s: invalid value '%s' for %s\n", source, value, key);
+        return SQLITE_ERROR;
+    }
+    return SQLITE_OK;
+}
+
+static int ProfileFromEnv(void)
+{
+    const char *profile = getenv("HW3_PROFILE");
+    return profile != NULL && profile[0] != '\0';
+}
+
+static char *Trim(char *s)
+{
+    while (isspace((unsigned char)*s))
+    {
+        s++;
+    }
+    char *end = s + strlen(s);
+    while (end > s && isspace((unsigned char)end[-1]))
+    {
+        *--end = '\0';
+    }
+    return s;
+}
+
+/**
+ * @brief Reads the config file line by line.
+ *
+ * With apply == 0 only the top level "profile" setting is looked up (written to config->profile)
+ * and it is checked whether the file has a section for the wanted profile.
+ * With apply != 0 the top level settings and the section of config->profile are applied.
+ *
+ * @returns SQLITE_OK on success, SQLITE_ERROR on a syntax or value error.
+ */
+static int ReadConfigFile(FILE *file, const char *path, DbConfig *config, int apply, int *hasSection)
+{
+    char line[512];
+    char source[300];
+    char section[32] = "";
+    int lineNo = 0;
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        lineNo++;
+        snprintf(source, sizeof(source), "%s:%d", path, lineNo);
+        char *p = Trim(line);
+        if (*p == '\0' || *p == '#' || *p == ';')
+        {
+            continue;
+        }
+        if (*p == '[')
+        {
+            char *close = strchr(p, ']');
+            if (close == NULL || close[1] != '\0' || close - p - 1 >= (long)sizeof(section))
+            {
+                fprintf(stderr, "%s: invalid section header\n", source);
+                return SQLITE_ERROR;
+            }
+            *close = '\0';
+            snprintf(section, sizeof(section), "%s", Trim(p + 1));
+            if (hasSection != NULL && strcmp(section, config->profile) == 0)
+            {
+                *hasSection = 1;
+            }
+            continue;
+        }
+
+        char *eq = strchr(p, '=');
+        if (eq == NULL)
+        {
+            fprintf(stderr, "%s: expected key = value\n", source);
+            return SQLITE_ERROR;
+        }
+        *eq = '\0';
+        char *key = Trim(p);
+        char *value = Trim(eq + 1);
+
+        if (strcmp(key, "profile") == 0)
+        {
+            if (section[0] != '\0')
+            {
+                fprintf(stderr, "%s: profile can only be set outside of a section\n", source);
+                return SQLITE_ERROR;
+            }
+            if (!apply && !ProfileFromEnv())
+            {
+                snprintf(config->profile, sizeof(config->profile), "%s", value);
+            }
+            continue;
+        }
+        if (apply)
+        {
+            // Sections of other profiles are still validated, into a scratch copy
+            DbConfig scratch;
+            int active = section[0] == '\0' || strcmp(section, config->profile) == 0;
+            if (SetConfigValue(active ? config : &scratch, key, value, source) != SQLITE_OK)
+            {
+                return SQLITE_ERROR;
+            }
+        }
+    }
+    return SQLITE_OK;
+}
+
+int LoadDbConfig(DbConfig *config)
+{
+    memset(config, 0, sizeof(DbConfig));
+    snprintf(config->profile, sizeof(config->profile), "%s",
+             ProfileFromEnv() ? getenv("HW3_PROFILE") : CONFIG_DEFAULT_PROFILE);
+
+    // Only an explicitly given config file has to exist
+    const char *path = getenv("HW3_CONFIG");
+    FILE *file = fopen(path != NULL ? path : CONFIG_PATH, "r");
+    if (file == NULL && path != NULL)
+    {
+        fprintf(stderr, "Could not open config file '%s'\n", path);
+        return SQLITE_ERROR;
+    }
+    if (path == NULL)
+    {
+        path = CONFIG_PATH;
+    }
+
+    int hasSection = 0;
+    if (file != NULL && ReadConfigFile(file, path, config, 0, NULL) != SQLITE_OK)
+    {
+        fclose(file);
+        return SQLITE_ERROR;
+    }
+
+    // Start from the built-in profile, a profile only defined in the file builds on the default one
+    char wanted[sizeof(config->profile)];
+    snprintf(wanted, sizeof(wanted), "%s", config->profile);
+    const DbConfig *base = &profiles[0];
+    int builtIn = 0;
+    for (size_t i = 0; i < sizeof(profiles) / sizeof(profiles[0]); i++)
+    {
+        if (strcmp(profiles[i].profile, wanted) == 0)
+        {
+            base = &profiles[i];
+            builtIn = 1;
+            break;
+        }
+    }
+    *config = *base;
+    snprintf(config->profile, sizeof(config->profile), "%s", wanted);
+
+    if (file != NULL)
+    {
+        rewind(file);
+        int rs = ReadConfigFile(file, path, config, 1, &hasSection);
+        fclose(file);
+        if (rs != SQLITE_OK)
+        {
+            return rs;
+        }
+    }
+    if (!builtIn && !hasSection)
+    {
+        fprintf(stderr, "Unknown connection profile '%s'\n", wanted);
+        return SQLITE_ERROR;
+    }
+
+    for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); i++)
+    {
+        const char *value = getenv(keys[i].env);
+        if (value != NULL && SetConfigValue(config, keys[i].key, value, keys[i].env) != SQLITE_OK)
+        {
+            return SQLITE_ERROR;
+        }
+    }
+    return SQLITE_OK;
+}
+
+static int ExecPragma(sqlite3 *db, const char *sql)
+{
+    int rs = sqlite3_exec(db, sql, NULL, NULL, NULL);
+    if (rs != SQLITE_OK)
+    {
+        fprintf(stderr, "Error executing '%s': %s\n", sql, sqlite3_errmsg(db));
+    }
+    return rs;
+}
+
+static sqlite3_int64 QueryPragmaInt(sqlite3 *db, const char *sql)
+{
+    sqlite3_int64 value = 0;
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) == SQLITE_OK)
+    {
+        if (sqlite3_step(stmt) == SQLITE_ROW)
+        {
+            value = sqlite3_column_int64(stmt, 0);
+        }
+        sqlite3_finalize(stmt);
+    }
+    return value;
+}
+
+static void QueryPragmaText(sqlite3 *db, const char *sql, char *buffer, size_t size)
+{
+    buffer[0] = '\0';
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) == SQLITE_OK)
+    {
+        if (sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_text(stmt, 0) != NULL)
+        {
+            snprintf(buffer, size, "%s", (const char *)sqlite3_column_text(stmt, 0));
+        }
+        sqlite3_finalize(stmt);
+    }
+}
+
+int ApplyDbConfig(sqlite3 *db, const DbConfig *config)
+{
+    // Values are validated against fixed choices and integers in LoadDbConfig, so they are safe to format in
+    char sql[128];
+    int rs = SQLITE_OK;
+    if (config->busyTimeout != CONFIG_UNSET && (rs = sqlite3_busy_timeout(db, config->busyTimeout)) != SQLITE_OK)
+    {
+        return rs;
+    }
+    if (config->journalMode[0] != '\0')
+    {
+        snprintf(sql, sizeof(sql), "PRAGMA journal_mode = %s;", config->journalMode);
+        if ((rs = ExecPragma(db, sql)) != SQLITE_OK)
+        {
+            return rs;
+        }
+    }
+    if (config->synchronous[0] != '\0')
+    {
+        snprintf(sql, sizeof(sql), "PRAGMA synchronous = %s;", config->synchronous);
+        if ((rs = ExecPragma(db, sql)) != SQLITE_OK)
+        {
+            return rs;
+        }
+    }
+    if (config->cacheSize != CONFIG_UNSET)
+    {
+        snprintf(sql, sizeof(sql), "PRAGMA cache_size = %d;", config->cacheSize);
+        if ((rs = ExecPragma(db, sql)) != SQLITE_OK)
+        {
+            return rs;
+        }
+    }
+    if (config->mmapSize != CONFIG_UNSET)
+    {
+        snprintf(sql, sizeof(sql), "PRAGMA mmap_size = %lld;", (long long)config->mmapSize);
+        if ((rs = ExecPragma(db, sql)) != SQLITE_OK)
+        {
+            return rs;
+        }
+    }
+    if (config->tempStore[0] != '\0')
+    {
+        snprintf(sql, sizeof(sql), "PRAGMA temp_store = %s;", config->tempStore);
+        if ((rs = ExecPragma(db, sql)) != SQLITE_OK)
+        {
+            return rs;
+        }
+    }
+    if (config->foreignKeys != CONFIG_UNSET)
+    {
+        snprintf(sql, sizeof(sql), "PRAGMA foreign_keys = %s;", config->foreignKeys ? "ON" : "OFF");
+        if ((rs = ExecPragma(db, sql)) != SQLITE_OK)
+        {
+            return rs;
+        }
+    }
+
+    // Log what SQLite actually uses (to stderr, pooled connections open several per process), e.g. journal_mode=wal is refused for in-memory databases
+    char journalMode[16];
+    QueryPragmaText(db, "PRAGMA journal_mode;", journalMode, sizeof(journalMode));
+    sqlite3_int64 synchronous = QueryPragmaInt(db, "PRAGMA synchronous;");
+    sqlite3_int64 tempStore = QueryPragmaInt(db, "PRAGMA temp_store;");
+    fprintf(stderr, "Connection profile '%s': journal_mode=%s synchronous=%s cache_size=%lld mmap_size=%lld "
+           "temp_store=%s busy_timeout=%lld foreign_keys=%s\n",
+           config->profile, journalMode,
+           synchronous >= 0 && synchronous <= 3 ? synchronousModes[synchronous] : "?",
+           (long long)QueryPragmaInt(db, "PRAGMA cache_size;"),
+           (long long)QueryPragmaInt(db, "PRAGMA mmap_size;"),
+           tempStore >= 0 && tempStore <= 2 ? tempStores[tempStore] : "?",
+           (long long)QueryPragmaInt(db, "PRAGMA busy_timeout;"),
+           QueryPragmaInt(db, "PRAGMA foreign_keys;") ? "on" : "off");
+    return SQLITE_OK;
+}
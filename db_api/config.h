@@ -0,0 +1,59 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <sqlite3.h>
+
+// Config file read when HW3_CONFIG is not set, a missing file is not an error
+#define CONFIG_PATH "hw3.conf"
+#define CONFIG_DEFAULT_PROFILE "default"
+
+// Setting left at the SQLite default
+#define CONFIG_UNSET -1
+
+typedef struct {
+    char profile[32];
+    char path[256];
+    char journalMode[16];  // delete, truncate, persist, memory, wal, off or "" for unset
+    char synchronous[16];  // off, normal, full, extra or "" for unset
+    char tempStore[16];    // default, file, memory or "" for unset
+    int cacheSize;         // PRAGMA cache_size, negative values are KiB
+    sqlite3_int64 mmapSize;
+    int busyTimeout;       // milliseconds
+    int foreignKeys;       // 0 or 1
+    char analyticsEngine[16]; // auto, sql, matrix or "" for unset (auto), see SetAnalyticsEngine
+    int catalogMirror;        // 1 to answer product and offer lookups from memory (see catalog.h)
+} DbConfig;
+
+/**
+ * @brief Builds the connection settings.
+ *
+ * Later sources override earlier ones:
+ *
+ *  - the built-in profile (default, oltp or reporting)
+ *
+ *  - key = value lines at the top of the config file (CONFIG_PATH or $HW3_CONFIG)
+ *
+ *  - key = value lines in the [profile] section of the config file
+ *
+ *  - environment variables HW3_DB_PATH, HW3_JOURNAL_MODE, HW3_SYNCHRONOUS, HW3_CACHE_SIZE,
+ *    HW3_MMAP_SIZE, HW3_TEMP_STORE, HW3_BUSY_TIMEOUT, HW3_FOREIGN_KEYS, HW3_ANALYTICS_ENGINE and
+ *    HW3_CATALOG_MIRROR
+ *
+ * The profile is taken from $HW3_PROFILE, then from "profile = name" in the config file.
+ * A config file section may also define a new profile on top of the default one.
+ *
+ * @param config Pointer to a DbConfig structure that will be filled.
+ * @returns SQLITE_OK on success, SQLITE_ERROR if the config file or a value is invalid.
+ */
+int LoadDbConfig(DbConfig *config);
+
+/**
+ * @brief Applies the connection settings with PRAGMA statements and logs the effective values.
+ * Values SQLite ignored or adjusted (e.g. mmap_size above the compile-time limit) are logged as read back.
+ * @param db Pointer to the SQLite database connection.
+ * @param config Pointer to the settings to apply.
+ * @returns SQLITE_OK on success or sqlite3 error code.
+ */
+int ApplyDbConfig(sqlite3 *db, const DbConfig *config);
+
+#endif // CONFIG_H
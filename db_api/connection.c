@@ -0,0 +1,185 @@
+#include <sqlite3.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <pthread.h>
+#include "connection.h"
+#include "stmt_cache.h"
+#include "client_index.h"
+#include "analytics.h"
+#include "catalog.h"
+#include "entity_cache.h"
+#include "arena.h"
+
+// Head of the list of registered connections, there are only a handful of them per process.
+// Pooled connections are looked up from several threads, the lock guards the list (not the state in it).
+static DbConnection *connections = NULL;
+static pthread_rwlock_t connectionsLock = PTHREAD_RWLOCK_INITIALIZER;
+
+DbConnection *RegisterConnection(sqlite3 *db)
+{
+    DbConnection *conn = GetConnection(db);
+    if (conn != NULL)
+    {
+        return conn; // Already registered
+    }
+
+    conn = calloc(1, sizeof(DbConnection));
+    if (conn == NULL)
+    {
+        fprintf(stderr, "Memory allocation failed for connection state.\n");
+        return NULL;
+    }
+    conn->db = db;
+    // NULL falls back to malloc
+    conn->searchArena = ArenaCreate(0);
+
+    conn->stmtCache = StmtCacheCreate(db);
+    if (conn->stmtCache == NULL)
+    {
+        ArenaDestroy(conn->searchArena);
+        free(conn);
+        return NULL;
+    }
+
+    pthread_rwlock_wrlock(&connectionsLock);
+    conn->next = connections;
+    connections = conn;
+    pthread_rwlock_unlock(&connectionsLock);
+
+    // Built after the connection is in the registry, all subscribe to changes.
+    // Read-only connections (pool readers) run reports only and skip the client search index,
+    // client searches there fall back to SQL.
+    int readOnly = sqlite3_db_readonly(db, "main") == 1;
+    conn->clientIndex = readOnly ? NULL : ClientIndexCreate(db);
+    conn->analytics = readOnly || conn->clientIndex != NULL ? AnalyticsCreate(db) : NULL;
+    conn->entityCache = conn->analytics != NULL ? EntityCacheCreate(db) : NULL;
+    if ((!readOnly && conn->clientIndex == NULL) || conn->analytics == NULL || conn->entityCache == NULL)
+    {
+        UnregisterConnection(db);
+        return NULL;
+    }
+    return conn;
+}
+
+DbConnection *GetConnection(sqlite3 *db)
+{
+    pthread_rwlock_rdlock(&connectionsLock);
+    DbConnection *conn = connections;
+    while (conn != NULL && conn->db != db)
+    {
+        conn = conn->next;
+    }
+    pthread_rwlock_unlock(&connectionsLock);
+    return conn;
+}
+
+void UnregisterConnection(sqlite3 *db)
+{
+    DbConnection *conn = GetConnection(db);
+    if (conn == NULL)
+    {
+        return; // Not registered
+    }
+
+    CatalogDestroy(conn->catalog);
+    EntityCacheDestroy(conn->entityCache);
+    AnalyticsDestroy(conn->analytics);
+    ClientIndexDestroy(conn->clientIndex);
+
+    pthread_rwlock_wrlock(&connectionsLock);
+    DbConnection **link = &connections;
+    while (*link != conn)
+    {
+        link = &(*link)->next;
+    }
+    *link = conn->next;
+    pthread_rwlock_unlock(&connectionsLock);
+
+    sqlite3_update_hook(db, NULL, NULL);
+    sqlite3_commit_hook(db, NULL, NULL);
+    sqlite3_rollback_hook(db, NULL, NULL);
+
+    StmtCacheDestroy(conn->stmtCache);
+    ArenaDestroy(conn->searchArena);
+    free(conn);
+}
+
+static void DispatchUpdate(void *pConn, int op, const char *dbName, const char *table, sqlite3_int64 rowid)
+{
+    (void)dbName;
+    DbConnection *conn = pConn;
+    for (int i = 0; i < conn->listenerCount; i++)
+    {
+        if (conn->listeners[i].onUpdate != NULL)
+        {
+            conn->listeners[i].onUpdate(conn->listeners[i].ctx, op, table, rowid);
+        }
+    }
+}
+
+static int DispatchCommit(void *pConn)
+{
+    DbConnection *conn = pConn;
+    for (int i = 0; i < conn->listenerCount; i++)
+    {
+        if (conn->listeners[i].onCommit != NULL)
+        {
+            conn->listeners[i].onCommit(conn->listeners[i].ctx);
+        }
+    }
+    return 0; // Non-zero would turn the commit into a rollback
+}
+
+static void DispatchRollback(void *pConn)
+{
+    DbConnection *conn = pConn;
+    for (int i = 0; i < conn->listenerCount; i++)
+    {
+        if (conn->listeners[i].onRollback != NULL)
+        {
+            conn->listeners[i].onRollback(conn->listeners[i].ctx);
+        }
+    }
+}
+
+int AddChangeListener(sqlite3 *db, const ChangeListener *listener)
+{
+    DbConnection *conn = GetConnection(db);
+    if (conn == NULL)
+    {
+        return SQLITE_MISUSE;
+    }
+    if (conn->listenerCount >= MAX_CHANGE_LISTENERS)
+    {
+        fprintf(stderr, "Too many change listeners on one connection.\n");
+        return SQLITE_FULL;
+    }
+    conn->listeners[conn->listenerCount++] = *listener;
+
+    // The hooks are installed once and fan out to all listeners
+    if (conn->listenerCount == 1)
+    {
+        sqlite3_update_hook(db, DispatchUpdate, conn);
+        sqlite3_commit_hook(db, DispatchCommit, conn);
+        sqlite3_rollback_hook(db, DispatchRollback, conn);
+    }
+    return SQLITE_OK;
+}
+
+void RemoveChangeListener(sqlite3 *db, void *ctx)
+{
+    DbConnection *conn = GetConnection(db);
+    if (conn == NULL)
+    {
+        return;
+    }
+    int kept = 0;
+    for (int i = 0; i < conn->listenerCount; i++)
+    {
+        if (conn->listeners[i].ctx != ctx)
+        {
+            conn->listeners[kept++] = conn->listeners[i];
+        }
+    }
+    conn->listenerCount = kept;
+}
@@ -0,0 +1,79 @@
+#ifndef CONNECTION_H
+#define CONNECTION_H
+
+#include <sqlite3.h>
+
+typedef struct StmtCache StmtCache;
+typedef struct ClientIndex ClientIndex;
+typedef struct Analytics Analytics;
+typedef struct Catalog Catalog;
+typedef struct EntityCache EntityCache;
+typedef struct Arena Arena;
+
+// Upper bound on change listeners per connection, SQLite allows only one hook of each kind
+#define MAX_CHANGE_LISTENERS 8
+
+/**
+ * Callbacks for row changes made through a connection. SQLite hooks must not use the connection,
+ * so listeners only record what changed and catch up on the next read. Any callback may be NULL.
+ */
+typedef struct {
+    void (*onUpdate)(void *ctx, int op, const char *table, sqlite3_int64 rowid); // op: SQLITE_INSERT/UPDATE/DELETE
+    void (*onCommit)(void *ctx);
+    void (*onRollback)(void *ctx);
+    void *ctx;
+} ChangeListener;
+
+// Per-connection state that lives as long as the sqlite3 handle opened by db_init
+typedef struct DbConnection {
+    sqlite3 *db;
+    StmtCache *stmtCache;     // prepared statements keyed by query text
+    ClientIndex *clientIndex; // trigram index over client names, NULL on read-only connections
+    Analytics *analytics;     // per-client basket cost summaries shared by the reports
+    Catalog *catalog;         // in-memory products, shops and offers, NULL unless enabled (see EnableCatalog)
+    EntityCache *entityCache; // products and clients by id, least recently used evicted
+    Arena *searchArena;       // rows of the interactive searches, reset when their vector is freed
+
+    ChangeListener listeners[MAX_CHANGE_LISTENERS];
+    int listenerCount;
+
+    struct DbConnection *next;
+} DbConnection;
+
+/**
+ * @brief Registers a database connection so per-connection state can be attached to it.
+ * @param db Pointer to the SQLite database connection.
+ * @returns Pointer to the registered connection state, or NULL on allocation failure.
+ */
+DbConnection *RegisterConnection(sqlite3 *db);
+
+/**
+ * @brief Looks up the state registered for a database connection.
+ * @param db Pointer to the SQLite database connection.
+ * @returns Pointer to the connection state, or NULL if the connection was never registered.
+ */
+DbConnection *GetConnection(sqlite3 *db);
+
+/**
+ * @brief Tears down all state attached to a connection and removes it from the registry.
+ * Must be called before sqlite3_close, since cached statements keep the connection busy.
+ * @param db Pointer to the SQLite database connection.
+ */
+void UnregisterConnection(sqlite3 *db);
+
+/**
+ * @brief Adds a listener for changes made through a registered connection.
+ * @param db Pointer to the SQLite database connection.
+ * @param listener Callbacks to add, copied.
+ * @returns SQLITE_OK, SQLITE_MISUSE if the connection is not registered, SQLITE_FULL if there are too many listeners.
+ */
+int AddChangeListener(sqlite3 *db, const ChangeListener *listener);
+
+/**
+ * @brief Removes the listeners registered with the given context.
+ * @param db Pointer to the SQLite database connection.
+ * @param ctx Context pointer the listener was added with.
+ */
+void RemoveChangeListener(sqlite3 *db, void *ctx);
+
+#endif // CONNECTION_H
@@ -6,10 +6,43 @@
 #include "orders.h"
 #include "product.h"
 #include "clients.h"
+#include "connection.h"
+#include "migrations.h"
+#include "config.h"
+#include "sql_functions.h"
+#include "analytics.h"
+#include "catalog.h"
 
 void db_init(sqlite3 **pdb)
 {
-    int conn = sqlite3_open_v2("shop2.db", pdb, SQLITE_OPEN_READWRITE, NULL);
+    db_open(pdb, NULL);
+}
+
+void db_open(sqlite3 **pdb, const char *path)
+{
+    db_open_v2(pdb, path, SQLITE_OPEN_READWRITE);
+}
+
+void db_open_v2(sqlite3 **pdb, const char *path, int flags)
+{
+    int readOnly = (flags & SQLITE_OPEN_READONLY) != 0;
+    DbConfig config;
+    if (LoadDbConfig(&config) != SQLITE_OK)
+    {
+        fprintf(stderr, "Invalid database configuration.\n");
+        exit(EXIT_FAILURE);
+    }
+    if (path == NULL)
+    {
+        path = config.path;
+    }
+    if (readOnly)
+    {
+        // The journal mode belongs to the database file, only read/write connections may change it
+        config.journalMode[0] = '\0';
+    }
+
+    int conn = sqlite3_open_v2(path, pdb, flags, NULL);
     if (conn != SQLITE_OK)
     {
         fprintf(stderr, "Error opening database: %s\n", sqlite3_errmsg(*pdb));
@@ -19,13 +52,27 @@ void db_init(sqlite3 **pdb)
 
     // If database could not be opened in read/write mode, it tries to open it in read-only mode
     // we do not want that so check if it is opened in read/write mode
-    if (sqlite3_db_readonly(*pdb, "main") != 0)
+    if (!readOnly && sqlite3_db_readonly(*pdb, "main") != 0)
     {
         fprintf(stderr, "Could not open database in read/write mode: %s\n", sqlite3_errmsg(*pdb));
         sqlite3_close(*pdb);
         exit(EXIT_FAILURE);
     }
 
+    // Journal mode, page cache, mmap etc. from the selected profile
+    if (ApplyDbConfig(*pdb, &config) != SQLITE_OK)
+    {
+        sqlite3_close(*pdb);
+        exit(EXIT_FAILURE);
+    }
+
+    // argmin, argmax and basket_cost aggregates used by the analytics summaries
+    if (RegisterSqlFunctions(*pdb) != SQLITE_OK)
+    {
+        sqlite3_close(*pdb);
+        exit(EXIT_FAILURE);
+    }
+
     // Test db connection
     char buffer[256] = {0};
     sqlite3_stmt *stmt;
@@ -51,8 +98,59 @@ void db_init(sqlite3 **pdb)
         sqlite3_close(*pdb);
         exit(EXIT_FAILURE);
     }
-    printf("Database opened successfully in read/write mode.\n");
-    printf("Database name: '%s'\n", buffer);
+    // Status lines go to stderr, pools open a connection per thread and stdout carries the reports
+    fprintf(stderr, "Database opened successfully in %s mode.\n", readOnly ? "read-only" : "read/write");
+    fprintf(stderr, "Database name: '%s'\n", buffer);
+
+    // Bring the schema (indexes) up to date before anything gets prepared against it,
+    // read-only connections rely on a read/write one having done so
+    if (!readOnly && RunMigrations(*pdb) != SQLITE_OK)
+    {
+        fprintf(stderr, "Database migration failed.\n");
+        sqlite3_close(*pdb);
+        exit(EXIT_FAILURE);
+    }
+
+    // Attach per-connection state (prepared statement cache)
+    if (RegisterConnection(*pdb) == NULL)
+    {
+        sqlite3_close(*pdb);
+        exit(EXIT_FAILURE);
+    }
+    if (config.analyticsEngine[0] != '\0' && SetAnalyticsEngine(*pdb, config.analyticsEngine) != SQLITE_OK)
+    {
+        db_close(*pdb);
+        exit(EXIT_FAILURE);
+    }
+    // The sql engine reads client_shop_cost, which only exists where that engine was asked for
+    if (!readOnly && strcmp(config.analyticsEngine, "sql") == 0 && EnableClientShopCost(*pdb) != SQLITE_OK)
+    {
+        db_close(*pdb);
+        exit(EXIT_FAILURE);
+    }
+    // Read-only connections serve the parallel reports, which never look up the catalog
+    if (!readOnly && config.catalogMirror == 1)
+    {
+        CatalogStats stats;
+        if (EnableCatalog(*pdb) != SQLITE_OK || GetCatalogStats(*pdb, &stats) != SQLITE_OK)
+        {
+            db_close(*pdb);
+            exit(EXIT_FAILURE);
+        }
+        fprintf(stderr, "Catalog mirror: %zu products, %zu shops, %zu offers, %.1f MiB\n", stats.products, stats.shops,
+               stats.offers, stats.bytes / (1024.0 * 1024.0));
+    }
+}
+
+void db_close(sqlite3 *db)
+{
+    // Cached statements must be finalized before the connection can be closed
+    UnregisterConnection(db);
+    int rs = sqlite3_close(db);
+    if (rs != SQLITE_OK)
+    {
+        fprintf(stderr, "Error closing database: %s\n", sqlite3_errstr(rs));
+    }
 }
 
 void CreateOrder(sqlite3 *db)
@@ -60,7 +158,7 @@ void CreateOrder(sqlite3 *db)
     // Initialize product
     Product product = {
         .id = 0, // Assuming 0 means no specific ID
-        .name = NULL};
+        .name = {.kind = SHORT_STRING_NULL}};
     // This is not a great solution, because the product_ptr will be overwritten with allocated memory
     // TODO: fix product prompting to just take pointer to allocated memory, then reallocate instead
     Product *product_ptr = &product;
@@ -84,8 +182,8 @@ void CreateOrder(sqlite3 *db)
     // Initialize client
     Client client = {
         .id = 0, // Assuming 0 means no specific ID
-        .first_name = NULL,
-        .last_name = NULL};
+        .first_name = {.kind = SHORT_STRING_NULL},
+        .last_name = {.kind = SHORT_STRING_NULL}};
     Client *client_ptr = &client;
     // Note: client_ptr will be overwritten with allocated memory
     // TODO: allocate memory here instead, idk why I did it like this initally
@@ -194,38 +292,6 @@ void UpdateOrder(sqlite3 *db)
     // No need to free order, since it stores integers that are not dynamically allocated
 }
 
-void FreeWrapper(GenericWrapper *wrapper)
-{
-    if (wrapper == NULL)
-    {
-        return;
-    }
-    if (wrapper->data != NULL)
-    {
-        if (wrapper->freeData != NULL)
-        {
-            for (size_t i = 0; i < wrapper->used; i++)
-            {
-                // get the data pointer at index i for the unknown type
-                void *pData = wrapper->getElementAt(wrapper, i);
-                // continue if pData is NULL
-                if (pData == NULL)
-                {
-                    continue;
-                }
-
-                // call the struct specific memory deallocation function
-                wrapper->freeData(pData);
-            }
-        }
-        // free the data pointer itself
-        FreeMemory(&wrapper->data);
-    }
-    wrapper->size = 0;
-    wrapper->used = 0;
-    wrapper->limit = 0;
-}
-
 void FreeMemory(void **p)
 {
     if (*p)
@@ -3,34 +3,39 @@
 
 #include <sqlite3.h>
 
-typedef struct {
-    void *data;
+// Database used by the interactive program unless the config sets another path
+#define DB_PATH "shop2.db"
 
-    // These function must be implemented in the respective data types
-    void (*freeData)(void *); // a function provided that frees the data
-    void *(*getElementAt)(void *, size_t); // a function provided that gets the element at index
+/**
+ * @brief Initializes the SQLite database connection with the path and settings from the config (see config.h).
+ * @param pdb Pointer to a pointer that will hold the database connection.
+ */
+void db_init(sqlite3 **pdb);
 
-    size_t size;
-    size_t used;
-    size_t limit;
-} GenericWrapper;
+/**
+ * @brief Opens the database at the given path the same way db_init does (config, migrations, statement cache).
+ * Exits the program if the config is invalid or the database cannot be opened in read/write mode.
+ * @param pdb Pointer to a pointer that will hold the database connection.
+ * @param path Path to the database file, NULL for the configured path.
+ */
+void db_open(sqlite3 **pdb, const char *path);
 
 /**
- * @brief Initializes the SQLite database connection.
+ * @brief Opens the database like db_open with the given sqlite3_open_v2 flags, e.g. SQLITE_OPEN_NOMUTEX for
+ * connections used by one thread at a time. Read-only connections skip the migrations, the client search
+ * index and the catalog mirror. Status lines go to stderr.
+ * Exits the program if the config is invalid or the database cannot be opened as requested.
  * @param pdb Pointer to a pointer that will hold the database connection.
+ * @param path Path to the database file, NULL for the configured path.
+ * @param flags SQLITE_OPEN_READWRITE or SQLITE_OPEN_READONLY, optionally with other SQLITE_OPEN_* flags.
  */
-void db_init(sqlite3 **pdb);
+void db_open_v2(sqlite3 **pdb, const char *path, int flags);
 
 /**
- * @brief Frees resources associated with a wrapper object.
- *
- * This function deallocates memory and releases any resources that were
- * allocated by the wrapper.
- *
- * @param wrapper Pointer to the wrapper object to be freed.
- * @return void
+ * @brief Releases per-connection state (cached statements) and closes the database connection.
+ * @param db Pointer to the SQLite database connection opened by db_init.
  */
-void FreeWrapper(GenericWrapper *wrapper);
+void db_close(sqlite3 *db);
 
 /**
  * @brief Frees memory pointed to by a pointer and sets the pointer to NULL.
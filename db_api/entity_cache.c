@@ -0,0 +1,342 @@
+#include <sqlite3.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "entity_cache.h"
+#include "connection.h"
+#include "stmt_cache.h"
+
+// Hash chains per entry, a power of two
+#define BUCKET_COUNT (2 * ENTITY_CACHE_CAPACITY)
+
+typedef struct {
+    int kind;
+    int id;
+    int found;
+    char *names[2];
+    int32_t hashNext; // next entry in the bucket, or in the free list
+    int32_t prev;     // towards the most recently used entry
+    int32_t next;     // towards the least recently used entry
+} CacheEntry;
+
+// Row changed inside the open transaction
+typedef struct {
+    int kind;
+    int id;
+} ChangedRow;
+
+struct EntityCache {
+    sqlite3 *db;
+    CacheEntry entries[ENTITY_CACHE_CAPACITY];
+    int32_t buckets[BUCKET_COUNT];
+    int32_t freeList;
+    int32_t head; // most recently used
+    int32_t tail; // least recently used, evicted first
+    size_t count;
+
+    ChangedRow *changed;
+    size_t changedCount;
+    size_t changedAllocated;
+
+    sqlite3_int64 dataVersion;
+    EntityCacheStats stats;
+};
+
+static size_t HashKey(int kind, int id)
+{
+    uint32_t key = (uint32_t)id ^ (uint32_t)kind << 31;
+    key ^= key >> 16;
+    key *= 0x7feb352dU;
+    key ^= key >> 15;
+    key *= 0x846ca68bU;
+    key ^= key >> 16;
+    return key & (BUCKET_COUNT - 1);
+}
+
+static int32_t Find(const EntityCache *cache, int kind, int id)
+{
+    for (int32_t e = cache->buckets[HashKey(kind, id)]; e >= 0; e = cache->entries[e].hashNext)
+    {
+        if (cache->entries[e].id == id && cache->entries[e].kind == kind)
+        {
+            return e;
+        }
+    }
+    return -1;
+}
+
+static void UnlinkLru(EntityCache *cache, int32_t e)
+{
+    CacheEntry *entry = &cache->entries[e];
+    if (entry->prev >= 0)
+    {
+        cache->entries[entry->prev].next = entry->next;
+    }
+    else
+    {
+        cache->head = entry->next;
+    }
+    if (entry->next >= 0)
+    {
+        cache->entries[entry->next].prev = entry->prev;
+    }
+    else
+    {
+        cache->tail = entry->prev;
+    }
+}
+
+static void PushFront(EntityCache *cache, int32_t e)
+{
+    CacheEntry *entry = &cache->entries[e];
+    entry->prev = -1;
+    entry->next = cache->head;
+    if (cache->head >= 0)
+    {
+        cache->entries[cache->head].prev = e;
+    }
+    cache->head = e;
+    if (cache->tail < 0)
+    {
+        cache->tail = e;
+    }
+}
+
+static void Remove(EntityCache *cache, int32_t e)
+{
+    CacheEntry *entry = &cache->entries[e];
+    int32_t *link = &cache->buckets[HashKey(entry->kind, entry->id)];
+    while (*link != e)
+    {
+        link = &cache->entries[*link].hashNext;
+    }
+    *link = entry->hashNext;
+    UnlinkLru(cache, e);
+    free(entry->names[0]);
+    free(entry->names[1]);
+    entry->names[0] = entry->names[1] = NULL;
+    entry->hashNext = cache->freeList;
+    cache->freeList = e;
+    cache->count--;
+}
+
+static void Clear(EntityCache *cache)
+{
+    while (cache->head >= 0)
+    {
+        Remove(cache, cache->head);
+    }
+}
+
+static void Invalidate(EntityCache *cache, int kind, int id)
+{
+    int32_t e = Find(cache, kind, id);
+    if (e >= 0)
+    {
+        Remove(cache, e);
+        cache->stats.invalidations++;
+    }
+}
+
+static sqlite3_int64 QueryDataVersion(sqlite3 *db)
+{
+    sqlite3_stmt *stmt;
+    sqlite3_int64 version = -1;
+    if (PrepareCached(db, "PRAGMA data_version;", &stmt) != SQLITE_OK)
+    {
+        return -1;
+    }
+    if (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        version = sqlite3_column_int64(stmt, 0);
+    }
+    ReleaseStatement(stmt);
+    return version;
+}
+
+static void OnEntityUpdate(void *ctx, int op, const char *table, sqlite3_int64 rowid)
+{
+    (void)op;
+    EntityCache *cache = ctx;
+    int kind;
+    if (strcmp(table, "products") == 0)
+    {
+        kind = ENTITY_PRODUCT;
+    }
+    else if (strcmp(table, "clients") == 0)
+    {
+        kind = ENTITY_CLIENT;
+    }
+    else
+    {
+        return;
+    }
+    Invalidate(cache, kind, (int)rowid);
+
+    if (cache->changedCount >= cache->changedAllocated)
+    {
+        size_t allocated = cache->changedAllocated ? cache->changedAllocated * 2 : 64;
+        ChangedRow *grown = realloc(cache->changed, allocated * sizeof(ChangedRow));
+        if (grown == NULL)
+        {
+            fprintf(stderr, "Memory allocation failed for entity cache.\n");
+            exit(EXIT_FAILURE);
+        }
+        cache->changed = grown;
+        cache->changedAllocated = allocated;
+    }
+    cache->changed[cache->changedCount++] = (ChangedRow){.kind = kind, .id = (int)rowid};
+}
+
+static void OnCommit(void *ctx)
+{
+    EntityCache *cache = ctx;
+    cache->changedCount = 0;
+}
+
+static void OnRollback(void *ctx)
+{
+    EntityCache *cache = ctx;
+    // Rows read back after the change hold values that no longer exist
+    for (size_t i = 0; i < cache->changedCount; i++)
+    {
+        Invalidate(cache, cache->changed[i].kind, cache->changed[i].id);
+    }
+    cache->changedCount = 0;
+}
+
+EntityCache *EntityCacheCreate(sqlite3 *db)
+{
+    EntityCache *cache = calloc(1, sizeof(EntityCache));
+    if (cache == NULL)
+    {
+        fprintf(stderr, "Memory allocation failed for entity cache.\n");
+        return NULL;
+    }
+    cache->db = db;
+    for (int i = 0; i < BUCKET_COUNT; i++)
+    {
+        cache->buckets[i] = -1;
+    }
+    for (int i = 0; i < ENTITY_CACHE_CAPACITY; i++)
+    {
+        cache->entries[i].hashNext = i + 1 < ENTITY_CACHE_CAPACITY ? i + 1 : -1;
+    }
+    cache->freeList = 0;
+    cache->head = cache->tail = -1;
+    cache->dataVersion = QueryDataVersion(db);
+
+    ChangeListener listener = {
+        .onUpdate = OnEntityUpdate,
+        .onCommit = OnCommit,
+        .onRollback = OnRollback,
+        .ctx = cache};
+    if (AddChangeListener(db, &listener) != SQLITE_OK)
+    {
+        free(cache);
+        return NULL;
+    }
+    return cache;
+}
+
+void EntityCacheDestroy(EntityCache *cache)
+{
+    if (cache == NULL)
+    {
+        return;
+    }
+    RemoveChangeListener(cache->db, cache);
+    Clear(cache);
+    free(cache->changed);
+    free(cache);
+}
+
+int EntityCacheGet(EntityCache *cache, int kind, int id, const char **names)
+{
+    sqlite3_int64 dataVersion = QueryDataVersion(cache->db);
+    if (dataVersion != cache->dataVersion)
+    {
+        // Another connection committed, any row may have changed
+        Clear(cache);
+        cache->dataVersion = dataVersion;
+    }
+
+    int32_t e = Find(cache, kind, id);
+    if (e < 0)
+    {
+        cache->stats.misses++;
+        return SQLITE_NOTFOUND;
+    }
+    if (e != cache->head)
+    {
+        UnlinkLru(cache, e);
+        PushFront(cache, e);
+    }
+    cache->stats.hits++;
+    const CacheEntry *entry = &cache->entries[e];
+    if (!entry->found)
+    {
+        cache->stats.negativeHits++;
+        return SQLITE_DONE;
+    }
+    names[0] = entry->names[0];
+    names[1] = entry->names[1];
+    return SQLITE_ROW;
+}
+
+static char *CopyName(const unsigned char *name)
+{
+    if (name == NULL)
+    {
+        return NULL;
+    }
+    char *copy = strdup((const char *)name);
+    if (copy == NULL)
+    {
+        fprintf(stderr, "Memory allocation failed for entity cache.\n");
+        exit(EXIT_FAILURE);
+    }
+    return copy;
+}
+
+void EntityCachePut(EntityCache *cache, int kind, int id, int found, const unsigned char *first,
+                    const unsigned char *second)
+{
+    int32_t e = Find(cache, kind, id);
+    if (e >= 0)
+    {
+        Remove(cache, e);
+    }
+    if (cache->freeList < 0)
+    {
+        Remove(cache, cache->tail);
+        cache->stats.evictions++;
+    }
+
+    e = cache->freeList;
+    CacheEntry *entry = &cache->entries[e];
+    cache->freeList = entry->hashNext;
+    entry->kind = kind;
+    entry->id = id;
+    entry->found = found;
+    entry->names[0] = found ? CopyName(first) : NULL;
+    entry->names[1] = found ? CopyName(second) : NULL;
+    size_t bucket = HashKey(kind, id);
+    entry->hashNext = cache->buckets[bucket];
+    cache->buckets[bucket] = e;
+    PushFront(cache, e);
+    cache->count++;
+}
+
+void GetEntityCacheStats(sqlite3 *db, EntityCacheStats *stats)
+{
+    memset(stats, 0, sizeof(EntityCacheStats));
+    DbConnection *conn = GetConnection(db);
+    if (conn == NULL || conn->entityCache == NULL)
+    {
+        return;
+    }
+    *stats = conn->entityCache->stats;
+    stats->entries = conn->entityCache->count;
+}
@@ -0,0 +1,71 @@
+#ifndef ENTITY_CACHE_H
+#define ENTITY_CACHE_H
+
+#include <sqlite3.h>
+#include <stddef.h>
+
+typedef struct EntityCache EntityCache;
+
+// Entries per connection, products and clients share them, the least recently used one is evicted
+#define ENTITY_CACHE_CAPACITY 1024
+
+#define ENTITY_PRODUCT 0 // names[0] is the product name
+#define ENTITY_CLIENT 1  // names[0] and names[1] are the first and last name
+
+typedef struct {
+    unsigned long hits;          // lookups answered from the cache, negative ones included
+    unsigned long negativeHits;  // lookups answered with "no such id"
+    unsigned long misses;        // lookups that went to the database
+    unsigned long evictions;     // entries dropped to make room
+    unsigned long invalidations; // entries dropped because their row changed
+    size_t entries;              // entries currently held
+} EntityCacheStats;
+
+/**
+ * @brief Creates an empty cache of products and clients by id and subscribes to changes of both tables.
+ *
+ * The update hook drops the entry of every changed rowid. Rows changed inside a transaction are dropped
+ * again when it is rolled back, since they may have been cached with the uncommitted values meanwhile.
+ * Commits of other connections are detected with PRAGMA data_version and empty the cache.
+ *
+ * @param db Pointer to a registered SQLite database connection.
+ * @returns Pointer to the cache, or NULL on allocation failure.
+ */
+EntityCache *EntityCacheCreate(sqlite3 *db);
+
+/**
+ * @brief Unsubscribes from changes and frees the cache.
+ * @param cache Pointer to the cache, may be NULL.
+ */
+void EntityCacheDestroy(EntityCache *cache);
+
+/**
+ * @brief Looks up an entity and marks it as recently used.
+ * @param cache Pointer to the cache.
+ * @param kind ENTITY_PRODUCT or ENTITY_CLIENT.
+ * @param id The ID of the entity.
+ * @param names Pointer to two name pointers that are set on a positive hit, owned by the cache until the next call.
+ * @returns SQLITE_ROW if the entity is cached, SQLITE_DONE if it is cached as missing, SQLITE_NOTFOUND on a miss.
+ */
+int EntityCacheGet(EntityCache *cache, int kind, int id, const char **names);
+
+/**
+ * @brief Stores the result of a database lookup, evicting the least recently used entry if the cache is full.
+ * @param cache Pointer to the cache.
+ * @param kind ENTITY_PRODUCT or ENTITY_CLIENT.
+ * @param id The ID of the entity.
+ * @param found 0 to remember that the id does not exist.
+ * @param first First name column (product name or client first name), may be NULL.
+ * @param second Second name column (client last name), may be NULL.
+ */
+void EntityCachePut(EntityCache *cache, int kind, int id, int found, const unsigned char *first,
+                    const unsigned char *second);
+
+/**
+ * @brief Retrieves the counters of the entity cache of a connection, all zero if it has none.
+ * @param db Pointer to the SQLite database connection.
+ * @param stats Pointer to an EntityCacheStats structure that will be filled.
+ */
+void GetEntityCacheStats(sqlite3 *db, EntityCacheStats *stats);
+
+#endif // ENTITY_CACHE_H
@@ -0,0 +1,247 @@
+#include <sqlite3.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include "import.h"
+#include "orders.h"
+
+// Sorted ids of a table, looked up with a binary search
+typedef struct {
+    int *ids;
+    size_t count;
+} IdSet;
+
+static double NowSeconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int LoadIdSet(sqlite3 *db, const char *sql, IdSet *set)
+{
+    set->ids = NULL;
+    set->count = 0;
+
+    sqlite3_stmt *stmt;
+    int rs;
+    if ((rs = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL)) != SQLITE_OK)
+    {
+        fprintf(stderr, "Error preparing statement: %s\n", sqlite3_errmsg(db));
+        return rs;
+    }
+
+    size_t allocated = 0;
+    while ((rs = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        if (set->count >= allocated)
+        {
+            allocated = allocated ? allocated * 2 : 1024;
+            int *tmp = realloc(set->ids, allocated * sizeof(int));
+            if (tmp == NULL)
+            {
+                fprintf(stderr, "Memory allocation failed.\n");
+                free(set->ids);
+                sqlite3_finalize(stmt);
+                exit(EXIT_FAILURE);
+            }
+            set->ids = tmp;
+        }
+        set->ids[set->count++] = sqlite3_column_int(stmt, 0);
+    }
+    if (rs != SQLITE_DONE)
+    {
+        fprintf(stderr, "Error executing statement: %s - %s\n", sqlite3_errstr(rs), sqlite3_errmsg(db));
+    }
+    sqlite3_finalize(stmt);
+    return rs == SQLITE_DONE ? SQLITE_OK : rs;
+}
+
+static int ContainsId(const IdSet *set, int id)
+{
+    size_t lo = 0;
+    size_t hi = set->count;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (set->ids[mid] < id)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    return lo < set->count && set->ids[lo] == id;
+}
+
+/**
+ * @brief Parses one integer field, surrounding spaces allowed.
+ * @returns Pointer past the field separator or end of line, NULL if the field is not an integer.
+ */
+static const char *ParseField(const char *p, int *value, int last)
+{
+    char *end;
+    errno = 0;
+    long v = strtol(p, &end, 10);
+    if (end == p || errno != 0 || v < -2147483647L || v > 2147483647L)
+    {
+        return NULL;
+    }
+    while (*end == ' ' || *end == '\t')
+    {
+        end++;
+    }
+    if (last)
+    {
+        if (*end != '\0' && *end != '\r' && *end != '\n')
+        {
+            return NULL;
+        }
+    }
+    else if (*end++ != ',')
+    {
+        return NULL;
+    }
+    *value = (int)v;
+    return end;
+}
+
+static int ExecSimple(sqlite3 *db, const char *sql)
+{
+    int rs = sqlite3_exec(db, sql, NULL, NULL, NULL);
+    if (rs != SQLITE_OK)
+    {
+        fprintf(stderr, "Error executing '%s': %s\n", sql, sqlite3_errmsg(db));
+    }
+    return rs;
+}
+
+int ImportOrdersCsv(sqlite3 *db, FILE *input, int chunkSize, ImportStats *stats)
+{
+    memset(stats, 0, sizeof(ImportStats));
+    if (chunkSize <= 0)
+    {
+        chunkSize = IMPORT_DEFAULT_CHUNK;
+    }
+
+    double start = NowSeconds();
+
+    // Foreign keys are validated in memory, the sets are loaded once for the whole import
+    IdSet clients;
+    IdSet products;
+    int rs;
+    if ((rs = LoadIdSet(db, "SELECT id FROM clients ORDER BY id;", &clients)) != SQLITE_OK)
+    {
+        return rs;
+    }
+    if ((rs = LoadIdSet(db, "SELECT id FROM products ORDER BY id;", &products)) != SQLITE_OK)
+    {
+        free(clients.ids);
+        return rs;
+    }
+
+    if ((rs = ExecSimple(db, "BEGIN;")) != SQLITE_OK)
+    {
+        free(clients.ids);
+        free(products.ids);
+        return rs;
+    }
+
+    char line[256];
+    int lineNo = 0;
+    int inChunk = 0;
+    while (fgets(line, sizeof(line), input) != NULL)
+    {
+        lineNo++;
+        const char *p = line;
+        while (*p == ' ' || *p == '\t')
+        {
+            p++;
+        }
+        if (*p == '\0' || *p == '\n' || *p == '\r')
+        {
+            continue; // Blank line
+        }
+        if (lineNo == 1 && !(*p == '-' || (*p >= '0' && *p <= '9')))
+        {
+            continue; // Header line
+        }
+
+        stats->lines++;
+        Order order = {0};
+        const char *reason = NULL;
+        if ((p = ParseField(p, &order.client_id, 0)) == NULL ||
+            (p = ParseField(p, &order.product_id, 0)) == NULL ||
+            (p = ParseField(p, &order.amount, 1)) == NULL)
+        {
+            reason = "expected client_id,product_id,amount";
+        }
+        else if (order.amount <= 0)
+        {
+            reason = "amount must be a positive integer";
+        }
+        else if (!ContainsId(&clients, order.client_id) || order.client_id <= 0)
+        {
+            reason = "unknown client_id";
+        }
+        else if (!ContainsId(&products, order.product_id) || order.product_id <= 0)
+        {
+            reason = "unknown product_id";
+        }
+        else if (InsertOrder(db, &order) != SQLITE_DONE)
+        {
+            reason = "insert failed";
+        }
+
+        if (reason != NULL)
+        {
+            line[strcspn(line, "\r\n")] = '\0';
+            fprintf(stderr, "line %d: rejected '%s': %s\n", lineNo, line, reason);
+            stats->rejected++;
+            continue;
+        }
+
+        stats->imported++;
+        if (++inChunk >= chunkSize)
+        {
+            if ((rs = ExecSimple(db, "COMMIT;")) != SQLITE_OK || (rs = ExecSimple(db, "BEGIN;")) != SQLITE_OK)
+            {
+                break;
+            }
+            stats->commits++;
+            inChunk = 0;
+        }
+    }
+
+    if (rs == SQLITE_OK)
+    {
+        if ((rs = ExecSimple(db, "COMMIT;")) == SQLITE_OK)
+        {
+            stats->commits += inChunk > 0;
+        }
+    }
+    if (rs != SQLITE_OK)
+    {
+        // The current chunk is lost, earlier chunks stay committed
+        sqlite3_exec(db, "ROLLBACK;", NULL, NULL, NULL);
+        stats->imported -= inChunk;
+    }
+
+    free(clients.ids);
+    free(products.ids);
+    stats->seconds = NowSeconds() - start;
+    return rs;
+}
+
+void PrintImportStats(const ImportStats *stats)
+{
+    printf("\n=== Import summary ===\n");
+    printf("Lines read: %ld, imported: %ld, rejected: %ld, transactions: %ld\n", stats->lines, stats->imported,
+           stats->rejected, stats->commits);
+    printf("Elapsed: %.3f s (%.0f rows/s)\n", stats->seconds,
+           stats->seconds > 0.0 ? stats->imported / stats->seconds : 0.0);
+}
@@ -0,0 +1,40 @@
+#ifndef IMPORT_H
+#define IMPORT_H
+
+#include <stdio.h>
+#include <sqlite3.h>
+
+// Orders committed per transaction when no chunk size is given
+#define IMPORT_DEFAULT_CHUNK 10000
+
+typedef struct {
+    long lines;    // data lines read, header and blank lines excluded
+    long imported;
+    long rejected;
+    long commits;
+    double seconds;
+} ImportStats;
+
+/**
+ * @brief Imports orders from CSV lines of the form client_id,product_id,amount.
+ *
+ * Client and product ids are checked against id sets loaded once at the start instead of
+ * querying per row. Valid rows go through InsertOrder, which reuses one prepared statement,
+ * and are committed every chunkSize rows. Rejected lines are reported on stderr with the reason.
+ * A header line is skipped if the first line is not numeric.
+ *
+ * @param db Pointer to the SQLite database connection, must not be inside a transaction.
+ * @param input Stream to read the CSV from.
+ * @param chunkSize Number of orders per transaction, IMPORT_DEFAULT_CHUNK if <= 0.
+ * @param stats Pointer to an ImportStats structure that will be filled.
+ * @returns SQLITE_OK if the import ran to the end (even with rejected lines), or a sqlite3 error code.
+ */
+int ImportOrdersCsv(sqlite3 *db, FILE *input, int chunkSize, ImportStats *stats);
+
+/**
+ * @brief Prints the import statistics to the console.
+ * @param stats Pointer to the ImportStats structure to print.
+ */
+void PrintImportStats(const ImportStats *stats);
+
+#endif // IMPORT_H
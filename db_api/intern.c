@@ -0,0 +1,152 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stddef.h>
+#include <pthread.h>
+#include "intern.h"
+
+// Buckets of a new table, doubled whenever there are more strings than buckets
+#define INTERN_INITIAL_BUCKETS 256
+
+typedef struct InternEntry {
+    struct InternEntry *next; // next entry of the bucket
+    uint32_t hash;
+    uint32_t length;
+    size_t refs;
+    char text[]; // NUL terminated, the pointer handed out
+} InternEntry;
+
+static pthread_mutex_t internLock = PTHREAD_MUTEX_INITIALIZER;
+static InternEntry **buckets;
+static size_t bucketCount;
+static InternStats internStats;
+
+static InternEntry *EntryOf(const char *interned)
+{
+    return (InternEntry *)(interned - offsetof(InternEntry, text));
+}
+
+// FNV-1a
+static uint32_t HashText(const char *text, size_t length)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++)
+    {
+        hash = (hash ^ (unsigned char)text[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static void *AllocOrExit(size_t size)
+{
+    void *p = malloc(size);
+    if (p == NULL)
+    {
+        fprintf(stderr, "Memory allocation failed for interned string.\n");
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+// Rehashes the entries into twice as many buckets, or creates the first buckets
+static void GrowBuckets(void)
+{
+    size_t newCount = bucketCount == 0 ? INTERN_INITIAL_BUCKETS : bucketCount * 2;
+    InternEntry **newBuckets = AllocOrExit(newCount * sizeof(InternEntry *));
+    memset(newBuckets, 0, newCount * sizeof(InternEntry *));
+    for (size_t i = 0; i < bucketCount; i++)
+    {
+        InternEntry *entry = buckets[i];
+        while (entry != NULL)
+        {
+            InternEntry *next = entry->next;
+            size_t slot = entry->hash & (newCount - 1);
+            entry->next = newBuckets[slot];
+            newBuckets[slot] = entry;
+            entry = next;
+        }
+    }
+    free(buckets);
+    internStats.bytes += (newCount - bucketCount) * sizeof(InternEntry *);
+    buckets = newBuckets;
+    bucketCount = newCount;
+}
+
+const char *Intern(const char *text, size_t length)
+{
+    uint32_t hash = HashText(text, length);
+    pthread_mutex_lock(&internLock);
+    if (internStats.strings >= bucketCount)
+    {
+        GrowBuckets();
+    }
+    InternEntry **slot = &buckets[hash & (bucketCount - 1)];
+    for (InternEntry *entry = *slot; entry != NULL; entry = entry->next)
+    {
+        if (entry->hash == hash && entry->length == length && memcmp(entry->text, text, length) == 0)
+        {
+            entry->refs++;
+            internStats.references++;
+            internStats.hits++;
+            pthread_mutex_unlock(&internLock);
+            return entry->text;
+        }
+    }
+
+    InternEntry *entry = AllocOrExit(sizeof(InternEntry) + length + 1);
+    entry->hash = hash;
+    entry->length = (uint32_t)length;
+    entry->refs = 1;
+    memcpy(entry->text, text, length);
+    entry->text[length] = '\0';
+    entry->next = *slot;
+    *slot = entry;
+    internStats.strings++;
+    internStats.references++;
+    internStats.inserts++;
+    internStats.bytes += sizeof(InternEntry) + length + 1;
+    pthread_mutex_unlock(&internLock);
+    return entry->text;
+}
+
+const char *InternRetain(const char *interned)
+{
+    pthread_mutex_lock(&internLock);
+    EntryOf(interned)->refs++;
+    internStats.references++;
+    pthread_mutex_unlock(&internLock);
+    return interned;
+}
+
+void InternRelease(const char *interned)
+{
+    if (interned == NULL)
+    {
+        return;
+    }
+    InternEntry *entry = EntryOf(interned);
+    pthread_mutex_lock(&internLock);
+    internStats.references--;
+    if (--entry->refs == 0)
+    {
+        // Unlink from the bucket, the strings of one bucket are few
+        InternEntry **link = &buckets[entry->hash & (bucketCount - 1)];
+        while (*link != entry)
+        {
+            link = &(*link)->next;
+        }
+        *link = entry->next;
+        internStats.strings--;
+        internStats.bytes -= sizeof(InternEntry) + entry->length + 1;
+        free(entry);
+    }
+    pthread_mutex_unlock(&internLock);
+}
+
+void GetInternStats(InternStats *stats)
+{
+    pthread_mutex_lock(&internLock);
+    *stats = internStats;
+    pthread_mutex_unlock(&internLock);
+}
@@ -0,0 +1,46 @@
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <stddef.h>
+
+typedef struct {
+    size_t strings;        // distinct strings currently held
+    size_t references;     // references handed out and not released yet
+    size_t bytes;          // heap memory held by the strings and the buckets
+    unsigned long hits;    // interns answered with an existing string
+    unsigned long inserts; // interns that added a string
+} InternStats;
+
+/**
+ * @brief Returns the process-wide copy of a string, adding it on first use. Safe to call from any thread.
+ *
+ * Each call takes a reference that is given back with InternRelease, the string is freed with its last
+ * reference. Equal strings that are held at the same time share one pointer, so they compare with ==.
+ * Exits the program if memory cannot be allocated.
+ *
+ * @param text Bytes of the string, need not be NUL terminated.
+ * @param length Number of bytes.
+ * @returns NUL terminated interned string, valid until its reference is released.
+ */
+const char *Intern(const char *text, size_t length);
+
+/**
+ * @brief Takes another reference to an interned string, without hashing it again.
+ * @param interned String returned by Intern.
+ * @returns The same pointer.
+ */
+const char *InternRetain(const char *interned);
+
+/**
+ * @brief Gives back a reference taken by Intern or InternRetain.
+ * @param interned String returned by Intern, may be NULL.
+ */
+void InternRelease(const char *interned);
+
+/**
+ * @brief Retrieves the counters of the intern table.
+ * @param stats Pointer to an InternStats structure that will be filled.
+ */
+void GetInternStats(InternStats *stats);
+
+#endif // INTERN_H
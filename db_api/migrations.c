@@ -0,0 +1,455 @@
+#include <sqlite3.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <strings.h>
+#include "migrations.h"
+#include "../main.h"
+
+typedef struct {
+    int version;             // value PRAGMA user_version is set to once the step is applied
+    const char *description;
+    const char *sql;         // executed inside the migration transaction
+    const char *requires;    // compile option the step needs (sqlite3_compileoption_used), NULL if none
+} Migration;
+
+// Steps are applied in order, never edit a step that has shipped, append a new one instead
+static const Migration migrations[] = {
+    {
+        .version = 1,
+        .description = "covering index for cheapest offer lookups",
+        .sql = "CREATE INDEX IF NOT EXISTS idx_offers_product_price ON offers(product_id, price, shop_id);",
+    },
+    {
+        .version = 2,
+        .description = "indexes for order lookups by client and product",
+        .sql = "CREATE INDEX IF NOT EXISTS idx_orders_client ON orders(client_id);"
+               "CREATE INDEX IF NOT EXISTS idx_orders_product ON orders(product_id);",
+    },
+    {
+        .version = 3,
+        .description = "full-text indexes for product search (trigram and word prefix)",
+        // External content tables: the text lives in products only, the triggers keep the indexes in sync
+        .sql = "CREATE VIRTUAL TABLE IF NOT EXISTS products_fts USING fts5("
+               "name, content='products', content_rowid='id', tokenize='trigram');"
+               "CREATE VIRTUAL TABLE IF NOT EXISTS products_prefix USING fts5("
+               "name, content='products', content_rowid='id', prefix='1 2');"
+               "CREATE TRIGGER IF NOT EXISTS products_fts_ai AFTER INSERT ON products BEGIN"
+               "  INSERT INTO products_fts(rowid, name) VALUES (new.id, new.name);"
+               "  INSERT INTO products_prefix(rowid, name) VALUES (new.id, new.name);"
+               " END;"
+               "CREATE TRIGGER IF NOT EXISTS products_fts_ad AFTER DELETE ON products BEGIN"
+               "  INSERT INTO products_fts(products_fts, rowid, name) VALUES ('delete', old.id, old.name);"
+               "  INSERT INTO products_prefix(products_prefix, rowid, name) VALUES ('delete', old.id, old.name);"
+               " END;"
+               "CREATE TRIGGER IF NOT EXISTS products_fts_au AFTER UPDATE OF id, name ON products BEGIN"
+               "  INSERT INTO products_fts(products_fts, rowid, name) VALUES ('delete', old.id, old.name);"
+               "  INSERT INTO products_prefix(products_prefix, rowid, name) VALUES ('delete', old.id, old.name);"
+               "  INSERT INTO products_fts(rowid, name) VALUES (new.id, new.name);"
+               "  INSERT INTO products_prefix(rowid, name) VALUES (new.id, new.name);"
+               " END;"
+               "INSERT INTO products_fts(products_fts) VALUES ('rebuild');"
+               "INSERT INTO products_prefix(products_prefix) VALUES ('rebuild');",
+        .requires = "ENABLE_FTS5",
+    },
+    {
+        .version = 4,
+        .description = "product_best_offer: cheapest offers per product, maintained by triggers on offers",
+        // One row per offer at the minimum price of its product, ties keep all offers
+        .sql = "CREATE TABLE IF NOT EXISTS product_best_offer ("
+               "product_id INTEGER NOT NULL, offer_id INTEGER NOT NULL, shop_id INTEGER, price REAL NOT NULL,"
+               " PRIMARY KEY (product_id, offer_id)) WITHOUT ROWID;"
+               // Recomputing a product is two seeks on idx_offers_product_price, independent of its offer count
+               "CREATE TRIGGER IF NOT EXISTS offers_best_ai AFTER INSERT ON offers BEGIN"
+               "  DELETE FROM product_best_offer WHERE product_id = new.product_id;"
+               "  INSERT INTO product_best_offer SELECT product_id, id, shop_id, price FROM offers"
+               "   WHERE product_id = new.product_id"
+               "   AND price = (SELECT MIN(price) FROM offers WHERE product_id = new.product_id);"
+               " END;"
+               "CREATE TRIGGER IF NOT EXISTS offers_best_ad AFTER DELETE ON offers BEGIN"
+               "  DELETE FROM product_best_offer WHERE product_id = old.product_id;"
+               "  INSERT INTO product_best_offer SELECT product_id, id, shop_id, price FROM offers"
+               "   WHERE product_id = old.product_id"
+               "   AND price = (SELECT MIN(price) FROM offers WHERE product_id = old.product_id);"
+               " END;"
+               "CREATE TRIGGER IF NOT EXISTS offers_best_au AFTER UPDATE OF id, product_id, shop_id, price ON offers BEGIN"
+               "  DELETE FROM product_best_offer WHERE product_id IN (old.product_id, new.product_id);"
+               "  INSERT INTO product_best_offer SELECT product_id, id, shop_id, price FROM offers"
+               "   WHERE product_id IN (old.product_id, new.product_id)"
+               "   AND price = (SELECT MIN(price) FROM offers AS m WHERE m.product_id = offers.product_id);"
+               " END;"
+               "DELETE FROM product_best_offer;"
+               "INSERT INTO product_best_offer SELECT o.product_id, o.id, o.shop_id, o.price FROM offers AS o"
+               " JOIN (SELECT product_id, MIN(price) AS price FROM offers GROUP BY product_id) AS m"
+               " ON m.product_id = o.product_id AND m.price = o.price;",
+    },
+    {
+        .version = 5,
+        .description = "orders(client_id, product_id) index for per-client order scans, replaces idx_orders_client",
+        .sql = "CREATE INDEX IF NOT EXISTS idx_orders_client_product ON orders(client_id, product_id);"
+               "DROP INDEX IF EXISTS idx_orders_client;",
+    },
+    {
+        .version = 6,
+        .description = "name order indexes for paging through client and product searches",
+        .sql = "CREATE INDEX IF NOT EXISTS idx_clients_name ON clients(last_name, first_name);"
+               "CREATE INDEX IF NOT EXISTS idx_products_name ON products(name);",
+    },
+};
+
+typedef struct {
+    char *label;      // comment above the query in the saved queries file
+    char *sql;
+    char *planBefore; // EXPLAIN QUERY PLAN output before migrating
+} SavedQuery;
+
+int GetSchemaVersion(sqlite3 *db)
+{
+    sqlite3_stmt *stmt;
+    int version = -1;
+    if (sqlite3_prepare_v2(db, "PRAGMA user_version;", -1, &stmt, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "Error preparing statement: %s\n", sqlite3_errmsg(db));
+        return -1;
+    }
+    if (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        version = sqlite3_column_int(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    return version;
+}
+
+static int ApplyMigration(sqlite3 *db, const Migration *migration)
+{
+    char *errMsg = NULL;
+    int rs;
+
+    if ((rs = sqlite3_exec(db, "BEGIN IMMEDIATE;", NULL, NULL, &errMsg)) != SQLITE_OK)
+    {
+        fprintf(stderr, "Error starting migration %d: %s\n", migration->version, errMsg);
+        sqlite3_free(errMsg);
+        return rs;
+    }
+
+    // Without the required feature only the version is bumped, callers fall back to plain queries
+    int skipped = migration->requires != NULL && !sqlite3_compileoption_used(migration->requires);
+    if ((rs = sqlite3_exec(db, skipped ? "" : migration->sql, NULL, NULL, &errMsg)) == SQLITE_OK)
+    {
+        // PRAGMA does not take bound parameters, the version is our own integer
+        char pragma[64];
+        snprintf(pragma, sizeof(pragma), "PRAGMA user_version = %d;", migration->version);
+        rs = sqlite3_exec(db, pragma, NULL, NULL, &errMsg);
+    }
+
+    if (rs != SQLITE_OK)
+    {
+        fprintf(stderr, "Error applying migration %d (%s): %s\n", migration->version, migration->description, errMsg);
+        sqlite3_free(errMsg);
+        sqlite3_exec(db, "ROLLBACK;", NULL, NULL, NULL);
+        return rs;
+    }
+
+    if ((rs = sqlite3_exec(db, "COMMIT;", NULL, NULL, &errMsg)) != SQLITE_OK)
+    {
+        fprintf(stderr, "Error committing migration %d: %s\n", migration->version, errMsg);
+        sqlite3_free(errMsg);
+        sqlite3_exec(db, "ROLLBACK;", NULL, NULL, NULL);
+        return rs;
+    }
+
+    if (skipped)
+    {
+        printf("Skipped migration %d: %s (SQLite built without %s)\n", migration->version, migration->description,
+               migration->requires);
+        return SQLITE_OK;
+    }
+    printf("Applied migration %d: %s\n", migration->version, migration->description);
+    return SQLITE_OK;
+}
+
+/**
+ * @brief Returns EXPLAIN QUERY PLAN output as indented text, one plan node per line.
+ * Caller frees the returned string, NULL if the query could not be explained.
+ */
+static char *ExplainQueryPlan(sqlite3 *db, const char *sql)
+{
+    size_t len = strlen("EXPLAIN QUERY PLAN ") + strlen(sql) + 1;
+    char *explainSql = malloc(len);
+    if (explainSql == NULL)
+    {
+        return NULL;
+    }
+    snprintf(explainSql, len, "EXPLAIN QUERY PLAN %s", sql);
+
+    sqlite3_stmt *stmt;
+    int rs = sqlite3_prepare_v2(db, explainSql, -1, &stmt, NULL);
+    free(explainSql);
+    if (rs != SQLITE_OK)
+    {
+        return NULL;
+    }
+
+    char *plan = NULL;
+    size_t planSize = 0;
+    FILE *out = open_memstream(&plan, &planSize);
+    if (out == NULL)
+    {
+        sqlite3_finalize(stmt);
+        return NULL;
+    }
+
+    // Plan rows reference their parent node, keep track of depths for indentation
+    int ids[64];
+    int depths[64];
+    int nodes = 0;
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        int id = sqlite3_column_int(stmt, 0);
+        int parent = sqlite3_column_int(stmt, 1);
+        const char *detail = (const char *)sqlite3_column_text(stmt, 3);
+
+        int depth = 0;
+        for (int i = 0; i < nodes; i++)
+        {
+            if (ids[i] == parent)
+            {
+                depth = depths[i] + 1;
+                break;
+            }
+        }
+        if (nodes < 64)
+        {
+            ids[nodes] = id;
+            depths[nodes] = depth;
+            nodes++;
+        }
+        fprintf(out, "%*s%s\n", depth * 2, "", detail ? detail : "");
+    }
+    sqlite3_finalize(stmt);
+    fclose(out);
+    return plan;
+}
+
+static void FreeSavedQueries(SavedQuery *queries, size_t count)
+{
+    if (queries == NULL)
+    {
+        return;
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        free(queries[i].label);
+        free(queries[i].sql);
+        free(queries[i].planBefore);
+    }
+    free(queries);
+}
+
+/**
+ * @brief Splits the saved queries file into statements, remembering the comment above each one.
+ * CREATE statements are skipped, they have no plan worth comparing.
+ */
+static SavedQuery *LoadSavedQueries(const char *path, size_t *count)
+{
+    *count = 0;
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+    {
+        return NULL;
+    }
+
+    SavedQuery *queries = NULL;
+    size_t loaded = 0;
+    size_t allocated = 0;
+
+    char label[256] = "";
+    char *sql = NULL;
+    size_t sqlSize = 0;
+    FILE *sqlOut = open_memstream(&sql, &sqlSize);
+    if (sqlOut == NULL)
+    {
+        fclose(file);
+        return NULL;
+    }
+
+    char line[1024];
+    int eof = 0;
+    while (!eof)
+    {
+        eof = fgets(line, sizeof(line), file) == NULL;
+        if (!eof)
+        {
+            const char *p = line;
+            while (isspace((unsigned char)*p))
+            {
+                p++;
+            }
+            if (strncmp(p, "--", 2) == 0)
+            {
+                // Remember section headers like "-- CHEAPEST OFFER FOR EACH ORDER"
+                p += 2;
+                while (isspace((unsigned char)*p))
+                {
+                    p++;
+                }
+                if (*p != '\0')
+                {
+                    strncpy(label, p, sizeof(label) - 1);
+                    label[sizeof(label) - 1] = '\0';
+                    label[strcspn(label, "\r\n")] = '\0';
+                }
+                continue;
+            }
+            fputs(line, sqlOut);
+            if (strchr(line, ';') == NULL)
+            {
+                continue;
+            }
+        }
+
+        // A statement ended (or the file did), store it if there is anything in it.
+        // The stream is rewound between statements, so only the first sqlSize bytes are current
+        fflush(sqlOut);
+        char *statement = strndup(sql != NULL ? sql : "", sqlSize);
+        const char *start = statement;
+        while (start != NULL && isspace((unsigned char)*start))
+        {
+            start++;
+        }
+        if (start != NULL && *start != '\0' && strncasecmp(start, "CREATE", 6) != 0)
+        {
+            if (loaded >= allocated)
+            {
+                allocated = allocated ? allocated * 2 : 8;
+                SavedQuery *tmp = realloc(queries, allocated * sizeof(SavedQuery));
+                if (tmp == NULL)
+                {
+                    free(statement);
+                    break;
+                }
+                queries = tmp;
+            }
+            if (label[0] == '\0')
+            {
+                // No header comment, label the query by its first line
+                strncpy(label, start, sizeof(label) - 1);
+                label[sizeof(label) - 1] = '\0';
+                label[strcspn(label, "\r\n")] = '\0';
+            }
+            char *labelCopy = strdup(label);
+            char *sqlCopy = strdup(start);
+            if (labelCopy == NULL || sqlCopy == NULL)
+            {
+                free(labelCopy);
+                free(sqlCopy);
+                free(statement);
+                break;
+            }
+            queries[loaded].label = labelCopy;
+            queries[loaded].sql = sqlCopy;
+            queries[loaded].planBefore = NULL;
+            loaded++;
+        }
+        free(statement);
+        rewind(sqlOut);
+        label[0] = '\0';
+    }
+
+    fclose(sqlOut);
+    free(sql);
+    fclose(file);
+    *count = loaded;
+    return queries;
+}
+
+static void PrintPlanDiff(sqlite3 *db, SavedQuery *queries, size_t count)
+{
+    if (count == 0)
+    {
+        return;
+    }
+    printf("\n=== Query plan changes (%s) ===\n", SAVED_QUERIES_PATH);
+    for (size_t i = 0; i < count; i++)
+    {
+        char *planAfter = ExplainQueryPlan(db, queries[i].sql);
+        if (queries[i].planBefore == NULL || planAfter == NULL)
+        {
+            printf("%s: could not explain query\n", queries[i].label);
+        }
+        else if (strcmp(queries[i].planBefore, planAfter) == 0)
+        {
+            printf("%s: unchanged\n", queries[i].label);
+        }
+        else
+        {
+            printf("%s:\n", queries[i].label);
+            // Print old plan lines prefixed with '-' and new ones with '+'
+            const char *prefixes[2] = {"-", "+"};
+            const char *plans[2] = {queries[i].planBefore, planAfter};
+            for (int k = 0; k < 2; k++)
+            {
+                const char *line = plans[k];
+                while (*line != '\0')
+                {
+                    size_t lineLen = strcspn(line, "\n");
+                    printf("  %s %.*s\n", prefixes[k], (int)lineLen, line);
+                    line += lineLen + (line[lineLen] == '\n');
+                }
+            }
+        }
+        free(planAfter);
+    }
+}
+
+int RunMigrations(sqlite3 *db)
+{
+    int version = GetSchemaVersion(db);
+    if (version < 0)
+    {
+        return SQLITE_ERROR;
+    }
+
+    size_t migrationCount = sizeof(migrations) / sizeof(migrations[0]);
+    int latest = migrations[migrationCount - 1].version;
+    if (version >= latest)
+    {
+        return SQLITE_OK; // Nothing to do
+    }
+
+    // Capture plans before touching the schema so the effect of the migration can be shown
+    size_t queryCount = 0;
+    SavedQuery *queries = LoadSavedQueries(SAVED_QUERIES_PATH, &queryCount);
+    for (size_t i = 0; queries != NULL && i < queryCount; i++)
+    {
+        queries[i].planBefore = ExplainQueryPlan(db, queries[i].sql);
+    }
+
+    printf("Migrating database schema from version %d to %d\n", version, latest);
+    int rs = SQLITE_OK;
+    for (size_t i = 0; i < migrationCount; i++)
+    {
+        if (migrations[i].version <= version)
+        {
+            continue;
+        }
+        if ((rs = ApplyMigration(db, &migrations[i])) != SQLITE_OK)
+        {
+            FreeSavedQueries(queries, queryCount);
+            return rs;
+        }
+    }
+
+    // Refresh planner statistics for the new indexes
+    char *errMsg = NULL;
+    if (sqlite3_exec(db, "ANALYZE; PRAGMA optimize;", NULL, NULL, &errMsg) != SQLITE_OK)
+    {
+        fprintf(stderr, "Error refreshing statistics: %s\n", errMsg);
+        sqlite3_free(errMsg);
+    }
+
+    PrintPlanDiff(db, queries, queryCount);
+    FreeSavedQueries(queries, queryCount);
+    return rs;
+}
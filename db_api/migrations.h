@@ -0,0 +1,29 @@
+#ifndef MIGRATIONS_H
+#define MIGRATIONS_H
+
+#include <sqlite3.h>
+
+// Queries whose plans are compared before and after migrating
+#define SAVED_QUERIES_PATH "saved_queries.sql"
+
+/**
+ * @brief Brings the database schema up to the latest version.
+ *
+ * The current version is read from PRAGMA user_version, every newer step is applied
+ * in its own transaction together with the version bump. If any step was applied,
+ * statistics are refreshed with ANALYZE and PRAGMA optimize and the query plan
+ * differences for the queries in SAVED_QUERIES_PATH are printed.
+ *
+ * @param db Pointer to the SQLite database connection.
+ * @returns SQLITE_OK on success or the sqlite3 error code of the failed step.
+ */
+int RunMigrations(sqlite3 *db);
+
+/**
+ * @brief Gets the schema version the database is currently at.
+ * @param db Pointer to the SQLite database connection.
+ * @returns Value of PRAGMA user_version, or -1 on error.
+ */
+int GetSchemaVersion(sqlite3 *db);
+
+#endif // MIGRATIONS_H
@@ -0,0 +1,66 @@
+#include <sqlite3.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include "offers.h"
+#include "stmt_cache.h"
+#include "connection.h"
+#include "catalog.h"
+
+int GetCheapestOffer(sqlite3 *db, int productId, Offer *offer)
+{
+    if (offer == NULL)
+    {
+        fprintf(stderr, "Offer pointer is NULL.\n");
+        return SQLITE_MISUSE;
+    }
+    DbConnection *conn = GetConnection(db);
+    if (conn != NULL && conn->catalog != NULL)
+    {
+        return CatalogGetCheapestOffer(conn->catalog, productId, offer);
+    }
+
+    sqlite3_stmt *stmt;
+    const char *sql = "SELECT offer_id, shop_id, product_id, price FROM product_best_offer WHERE product_id = ?1 "
+                      "ORDER BY shop_id, offer_id LIMIT 1;";
+    int rs;
+    if ((rs = PrepareCached(db, sql, &stmt)) != SQLITE_OK)
+    {
+        fprintf(stderr, "Error preparing statement: %s\n", sqlite3_errmsg(db));
+        return rs;
+    }
+    sqlite3_bind_int(stmt, 1, productId);
+
+    if ((rs = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        offer->id = sqlite3_column_int(stmt, 0);
+        offer->shop_id = sqlite3_column_int(stmt, 1);
+        offer->product_id = sqlite3_column_int(stmt, 2);
+        offer->price = sqlite3_column_double(stmt, 3);
+    }
+    else if (rs != SQLITE_DONE)
+    {
+        fprintf(stderr, "Error executing statement: %s - %s\n", sqlite3_errstr(rs), sqlite3_errmsg(db));
+    }
+
+    ReleaseStatement(stmt);
+    return rs;
+}
+
+int RebuildBestOffers(sqlite3 *db)
+{
+    const char *sql = "BEGIN IMMEDIATE;"
+                      "DELETE FROM product_best_offer;"
+                      "INSERT INTO product_best_offer SELECT o.product_id, o.id, o.shop_id, o.price FROM offers AS o"
+                      " JOIN (SELECT product_id, MIN(price) AS price FROM offers GROUP BY product_id) AS m"
+                      " ON m.product_id = o.product_id AND m.price = o.price;"
+                      "COMMIT;";
+    char *errMsg = NULL;
+    int rs = sqlite3_exec(db, sql, NULL, NULL, &errMsg);
+    if (rs != SQLITE_OK)
+    {
+        fprintf(stderr, "Error rebuilding product_best_offer: %s\n", errMsg);
+        sqlite3_free(errMsg);
+        sqlite3_exec(db, "ROLLBACK;", NULL, NULL, NULL);
+    }
+    return rs;
+}
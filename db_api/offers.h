@@ -0,0 +1,40 @@
+#ifndef OFFERS_H
+#define OFFERS_H
+
+#include <sqlite3.h>
+
+typedef struct {
+    int id;
+    int shop_id;
+    int product_id;
+    double price;
+} Offer;
+
+/**
+ * @brief Retrieves the cheapest offer of a product from the product_best_offer table.
+ * A lookup on the table's primary key, the cost does not depend on how many offers the product has.
+ * Answered from memory if the connection has the catalog mirror enabled (see catalog.h).
+ * If several shops share the lowest price, the offer of the shop with the lowest ID is returned.
+ * @param db Pointer to the SQLite database connection.
+ * @param productId The ID of the product.
+ * @param offer Pointer to an Offer structure where the retrieved data will be stored.
+ *
+ * @returns sqlite3 result code
+ *
+ *  - SQLITE_ROW if the product has an offer,
+ *
+ *  - SQLITE_DONE if the product has no offers,
+ *
+ *  - or an error code if the query failed.
+ */
+int GetCheapestOffer(sqlite3 *db, int productId, Offer *offer);
+
+/**
+ * @brief Recomputes product_best_offer from the offers table in one transaction.
+ * The triggers on offers keep the table exact, this is for repairing it (e.g. after bulk loads with triggers off).
+ * @param db Pointer to the SQLite database connection, must not be inside a transaction.
+ * @returns SQLITE_OK on success or sqlite3 error code.
+ */
+int RebuildBestOffers(sqlite3 *db);
+
+#endif // OFFERS_H
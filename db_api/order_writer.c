@@ -0,0 +1,310 @@
+#include <sqlite3.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+#include "order_writer.h"
+#include "db.h"
+
+// Synchronized on its own, a handle may be waited for after the writer is closed
+struct OrderWrite {
+    OrderWriteKind kind;
+    Order order;
+    int result;
+    pthread_mutex_t lock;
+    pthread_cond_t finished;
+    int done;
+};
+
+struct OrderWriter {
+    sqlite3 *db; // used by the writer thread only
+    pthread_t thread;
+    int maxBatch;
+    double maxDelayMs;
+
+    pthread_mutex_t lock;    // guards everything below
+    pthread_cond_t notEmpty; // signalled on submit and on close
+    pthread_cond_t notFull;  // signalled when the writer takes writes off the queue
+    OrderWrite *queue[ORDER_WRITER_QUEUE_CAPACITY];
+    int head;
+    int count;
+    int closing;
+    OrderWriterStats stats;
+};
+
+static double NowSeconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static OrderWrite *Dequeue(OrderWriter *writer)
+{
+    OrderWrite *write = writer->queue[writer->head];
+    writer->head = (writer->head + 1) % ORDER_WRITER_QUEUE_CAPACITY;
+    writer->count--;
+    return write;
+}
+
+// Takes the next batch off the queue, returns 0 once the writer is closing and the queue is empty
+static int TakeBatch(OrderWriter *writer, OrderWrite **batch)
+{
+    pthread_mutex_lock(&writer->lock);
+    while (writer->count == 0 && !writer->closing)
+    {
+        pthread_cond_wait(&writer->notEmpty, &writer->lock);
+    }
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    long nanos = deadline.tv_nsec + (long)(writer->maxDelayMs * 1e6);
+    deadline.tv_sec += nanos / 1000000000L;
+    deadline.tv_nsec = nanos % 1000000000L;
+
+    int size = 0;
+    for (;;)
+    {
+        while (writer->count > 0 && size < writer->maxBatch)
+        {
+            batch[size++] = Dequeue(writer);
+        }
+        // Closing flushes what is queued without waiting for more
+        if (size == 0 || size == writer->maxBatch || writer->closing ||
+            pthread_cond_timedwait(&writer->notEmpty, &writer->lock, &deadline) != 0)
+        {
+            break;
+        }
+    }
+    pthread_cond_broadcast(&writer->notFull);
+    pthread_mutex_unlock(&writer->lock);
+    return size;
+}
+
+static int ApplyWrite(sqlite3 *db, OrderWrite *write)
+{
+    switch (write->kind)
+    {
+    case ORDER_WRITE_INSERT:
+        return InsertOrder(db, &write->order);
+    case ORDER_WRITE_MODIFY:
+        return ModifyOrder(db, &write->order);
+    case ORDER_WRITE_DELETE:
+        return DeleteOrder(db, write->order.id);
+    }
+    return SQLITE_MISUSE;
+}
+
+static void WriteBatch(OrderWriter *writer, OrderWrite **batch, int size)
+{
+    sqlite3 *db = writer->db;
+    double commitSeconds = 0.0;
+    int rs = sqlite3_exec(db, "BEGIN IMMEDIATE;", NULL, NULL, NULL);
+    if (rs != SQLITE_OK)
+    {
+        fprintf(stderr, "Error starting write transaction: %s\n", sqlite3_errmsg(db));
+        for (int i = 0; i < size; i++)
+        {
+            batch[i]->result = rs;
+        }
+    }
+    else
+    {
+        // A failed statement is rolled back on its own and the transaction stays open for the others,
+        // unless the error rolled back the whole transaction (SQLITE_FULL, SQLITE_IOERR, SQLITE_NOMEM...).
+        // The rest of the batch is not applied then, it would autocommit write by write.
+        int applied = 0;
+        while (applied < size && rs == SQLITE_OK)
+        {
+            batch[applied]->result = ApplyWrite(db, batch[applied]);
+            applied++;
+            if (sqlite3_get_autocommit(db))
+            {
+                rs = sqlite3_errcode(db) != SQLITE_OK ? sqlite3_errcode(db) : SQLITE_ABORT;
+                fprintf(stderr, "Order writes rolled back: %s\n", sqlite3_errstr(rs));
+            }
+        }
+        if (rs == SQLITE_OK)
+        {
+            double start = NowSeconds();
+            rs = sqlite3_exec(db, "COMMIT;", NULL, NULL, NULL);
+            commitSeconds = NowSeconds() - start;
+            if (rs != SQLITE_OK)
+            {
+                fprintf(stderr, "Error committing order writes: %s\n", sqlite3_errmsg(db));
+                if (sqlite3_get_autocommit(db) == 0)
+                {
+                    sqlite3_exec(db, "ROLLBACK;", NULL, NULL, NULL);
+                }
+            }
+        }
+        // Writes that failed on their own keep their error, the others share the fate of the transaction
+        for (int i = 0; i < size && rs != SQLITE_OK; i++)
+        {
+            if (i >= applied || batch[i]->result == SQLITE_DONE)
+            {
+                batch[i]->result = rs;
+            }
+        }
+    }
+
+    pthread_mutex_lock(&writer->lock);
+    writer->stats.writes += size;
+    writer->stats.batches++;
+    writer->stats.largestBatch = size > writer->stats.largestBatch ? size : writer->stats.largestBatch;
+    writer->stats.commitSeconds += commitSeconds;
+    pthread_mutex_unlock(&writer->lock);
+
+    for (int i = 0; i < size; i++)
+    {
+        OrderWrite *write = batch[i];
+        pthread_mutex_lock(&write->lock);
+        write->done = 1;
+        pthread_cond_signal(&write->finished);
+        pthread_mutex_unlock(&write->lock);
+    }
+}
+
+static void *WriterMain(void *pWriter)
+{
+    OrderWriter *writer = pWriter;
+    OrderWrite **batch = malloc((size_t)writer->maxBatch * sizeof(OrderWrite *));
+    if (batch == NULL)
+    {
+        fprintf(stderr, "Memory allocation failed for order writer.\n");
+        exit(EXIT_FAILURE);
+    }
+    int size;
+    while ((size = TakeBatch(writer, batch)) > 0)
+    {
+        WriteBatch(writer, batch, size);
+    }
+    free(batch);
+    return NULL;
+}
+
+int OrderWriterOpen(const char *path, int maxBatch, double maxDelayMs, OrderWriter **pWriter)
+{
+    *pWriter = NULL;
+    OrderWriter *writer = calloc(1, sizeof(OrderWriter));
+    if (writer == NULL)
+    {
+        fprintf(stderr, "Memory allocation failed for order writer.\n");
+        exit(EXIT_FAILURE);
+    }
+    writer->maxBatch = maxBatch > 0 ? maxBatch : ORDER_WRITER_MAX_BATCH;
+    writer->maxDelayMs = maxDelayMs >= 0 ? maxDelayMs : ORDER_WRITER_MAX_DELAY_MS;
+
+    // Only the writer thread uses the connection
+    db_open_v2(&writer->db, path, SQLITE_OPEN_READWRITE | SQLITE_OPEN_NOMUTEX);
+    // A reported write must survive a power loss whatever the profile trades for speed (synchronous=normal
+    // in WAL mode does not sync on commit), and a batch waits for other writers instead of failing at once
+    if (sqlite3_exec(writer->db, "PRAGMA synchronous = FULL;", NULL, NULL, NULL) != SQLITE_OK ||
+        sqlite3_busy_timeout(writer->db, ORDER_WRITER_BUSY_TIMEOUT_MS) != SQLITE_OK)
+    {
+        fprintf(stderr, "Could not configure the order writer connection: %s\n", sqlite3_errmsg(writer->db));
+        db_close(writer->db);
+        free(writer);
+        return SQLITE_ERROR;
+    }
+
+    pthread_mutex_init(&writer->lock, NULL);
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC); // for the batch deadline
+    pthread_cond_init(&writer->notEmpty, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_cond_init(&writer->notFull, NULL);
+
+    if (pthread_create(&writer->thread, NULL, WriterMain, writer) != 0)
+    {
+        fprintf(stderr, "Could not start the order writer thread.\n");
+        db_close(writer->db);
+        pthread_cond_destroy(&writer->notFull);
+        pthread_cond_destroy(&writer->notEmpty);
+        pthread_mutex_destroy(&writer->lock);
+        free(writer);
+        return SQLITE_ERROR;
+    }
+    *pWriter = writer;
+    return SQLITE_OK;
+}
+
+void OrderWriterClose(OrderWriter *writer)
+{
+    if (writer == NULL)
+    {
+        return;
+    }
+    pthread_mutex_lock(&writer->lock);
+    writer->closing = 1;
+    pthread_cond_signal(&writer->notEmpty);
+    pthread_cond_broadcast(&writer->notFull); // Blocked submitters give up
+    pthread_mutex_unlock(&writer->lock);
+    pthread_join(writer->thread, NULL);
+
+    db_close(writer->db);
+    pthread_cond_destroy(&writer->notFull);
+    pthread_cond_destroy(&writer->notEmpty);
+    pthread_mutex_destroy(&writer->lock);
+    free(writer);
+}
+
+OrderWrite *SubmitOrderWrite(OrderWriter *writer, OrderWriteKind kind, const Order *order)
+{
+    OrderWrite *write = malloc(sizeof(OrderWrite));
+    if (write == NULL)
+    {
+        fprintf(stderr, "Memory allocation failed for order write.\n");
+        exit(EXIT_FAILURE);
+    }
+    *write = (OrderWrite){.kind = kind, .order = *order};
+    pthread_mutex_init(&write->lock, NULL);
+    pthread_cond_init(&write->finished, NULL);
+
+    pthread_mutex_lock(&writer->lock);
+    while (writer->count == ORDER_WRITER_QUEUE_CAPACITY && !writer->closing)
+    {
+        pthread_cond_wait(&writer->notFull, &writer->lock);
+    }
+    if (writer->closing)
+    {
+        pthread_mutex_unlock(&writer->lock);
+        pthread_cond_destroy(&write->finished);
+        pthread_mutex_destroy(&write->lock);
+        free(write);
+        return NULL;
+    }
+    writer->queue[(writer->head + writer->count) % ORDER_WRITER_QUEUE_CAPACITY] = write;
+    writer->count++;
+    pthread_cond_signal(&writer->notEmpty);
+    pthread_mutex_unlock(&writer->lock);
+    return write;
+}
+
+int WaitOrderWrite(OrderWrite *write, Order *order)
+{
+    pthread_mutex_lock(&write->lock);
+    while (!write->done)
+    {
+        pthread_cond_wait(&write->finished, &write->lock);
+    }
+    pthread_mutex_unlock(&write->lock);
+
+    int rs = write->result;
+    if (order != NULL)
+    {
+        *order = write->order;
+    }
+    pthread_cond_destroy(&write->finished);
+    pthread_mutex_destroy(&write->lock);
+    free(write);
+    return rs;
+}
+
+void GetOrderWriterStats(OrderWriter *writer, OrderWriterStats *stats)
+{
+    pthread_mutex_lock(&writer->lock);
+    *stats = writer->stats;
+    pthread_mutex_unlock(&writer->lock);
+}
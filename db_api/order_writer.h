@@ -0,0 +1,87 @@
+#ifndef ORDER_WRITER_H
+#define ORDER_WRITER_H
+
+#include <sqlite3.h>
+#include "orders.h"
+
+typedef struct OrderWriter OrderWriter;
+typedef struct OrderWrite OrderWrite;
+
+// Writes waiting for the writer thread, SubmitOrderWrite blocks while the queue is full
+#define ORDER_WRITER_QUEUE_CAPACITY 1024
+// Defaults for OrderWriterOpen. Without a delay a batch is what queued up while the previous one committed,
+// callers that wait for each write before the next one gain nothing from waiting longer.
+#define ORDER_WRITER_MAX_BATCH 256
+#define ORDER_WRITER_MAX_DELAY_MS 0.0
+// How long a batch waits for the write lock held by another connection before its writes fail with SQLITE_BUSY
+#define ORDER_WRITER_BUSY_TIMEOUT_MS 5000
+
+typedef enum {
+    ORDER_WRITE_INSERT, // InsertOrder, the order id is assigned by the database
+    ORDER_WRITE_MODIFY, // ModifyOrder
+    ORDER_WRITE_DELETE  // DeleteOrder, only the order id is used
+} OrderWriteKind;
+
+typedef struct {
+    long writes;       // writes committed or failed
+    long batches;      // transactions committed or rolled back
+    int largestBatch;
+    double commitSeconds; // time spent in COMMIT, where the journal is synced
+} OrderWriterStats;
+
+/**
+ * @brief Opens a connection of its own and starts a writer thread that applies queued order writes
+ * in batches, one transaction per batch, so concurrent callers share the sync of a commit.
+ *
+ * A batch starts with the first queued write and takes more until it holds maxBatch writes or maxDelayMs
+ * passed, whichever comes first. Each write runs as InsertOrder, ModifyOrder or DeleteOrder would;
+ * a write that fails is undone on its own and the rest of the batch still commits. An error that rolls back
+ * the whole transaction (SQLITE_FULL, SQLITE_IOERR, SQLITE_NOMEM...) fails the writes before it, and the
+ * rest of the batch fails without being applied.
+ *
+ * The connection uses synchronous=FULL whatever the profile says, so a committed write survives a power loss,
+ * and waits up to ORDER_WRITER_BUSY_TIMEOUT_MS for other writers.
+ * Exits the program if the connection cannot be opened, like db_open.
+ *
+ * @param path Path to the database file, NULL for the configured path.
+ * @param maxBatch Most writes per transaction, ORDER_WRITER_MAX_BATCH if <= 0.
+ * @param maxDelayMs Longest a write waits for others to join its batch, ORDER_WRITER_MAX_DELAY_MS if < 0.
+ * @param pWriter Pointer where the writer is stored, stop it with OrderWriterClose.
+ * @returns SQLITE_OK or SQLITE_ERROR if the connection could not be configured or the thread not started.
+ */
+int OrderWriterOpen(const char *path, int maxBatch, double maxDelayMs, OrderWriter **pWriter);
+
+/**
+ * @brief Commits the writes still queued, stops the writer thread and closes its connection.
+ * Handles of submitted writes stay valid for WaitOrderWrite.
+ * @param writer Pointer to the writer, may be NULL.
+ */
+void OrderWriterClose(OrderWriter *writer);
+
+/**
+ * @brief Queues an order write, safe to call from any number of threads. Blocks while the queue is full.
+ * @param writer Pointer to the writer.
+ * @param kind Kind of the write.
+ * @param order Order to write, copied.
+ * @returns Handle to wait for with WaitOrderWrite (every handle must be waited for), or NULL if the writer is closing.
+ */
+OrderWrite *SubmitOrderWrite(OrderWriter *writer, OrderWriteKind kind, const Order *order);
+
+/**
+ * @brief Waits until the transaction of a write has committed or failed, then frees the handle.
+ * @param write Handle returned by SubmitOrderWrite.
+ * @param order Pointer where the written order is stored (with the id assigned to an insert), may be NULL.
+ * @returns SQLITE_DONE once the write has committed (durable, see OrderWriterOpen), the error of the write
+ * itself (see InsertOrder), or the error of its transaction if the write succeeded but was not committed
+ * (rolled back, not applied, or the COMMIT failed).
+ */
+int WaitOrderWrite(OrderWrite *write, Order *order);
+
+/**
+ * @brief Reads the counters of a writer.
+ * @param writer Pointer to the writer.
+ * @param stats Pointer where the counters are stored.
+ */
+void GetOrderWriterStats(OrderWriter *writer, OrderWriterStats *stats);
+
+#endif // ORDER_WRITER_H
@@ -6,25 +6,16 @@
 #include <sqlite3.h>
 #include "orders.h"
 #include "db.h"
+#include "stmt_cache.h"
+#include "analytics.h"
 #include "../main.h"
 
-void InitOrdersWrapper(GenericWrapper *wrapper)
+void ReadOrderRow(Order *order, sqlite3_stmt *stmt)
 {
-    wrapper->data = NULL;
-    wrapper->freeData = NULL;
-    wrapper->getElementAt = NULL;
-    wrapper->size = 0;
-    wrapper->used = 0;
-    wrapper->limit = 0;
-}
-
-void *GetOrderAt(GenericWrapper *wrapper, size_t index)
-{
-    if (index >= wrapper->used)
-    {
-        return NULL; // Index out of bounds
-    }
-    return ((Order *)wrapper->data) + index;
+    order->id = sqlite3_column_int(stmt, 0);
+    order->client_id = sqlite3_column_int(stmt, 1);
+    order->product_id = sqlite3_column_int(stmt, 2);
+    order->amount = sqlite3_column_int(stmt, 3);
 }
 
 void PrintOrder(Order *order)
@@ -51,7 +42,7 @@ int InsertOrder(sqlite3 *db, Order *order)
     const char *sql = "INSERT INTO orders (client_id, product_id, amount) VALUES (?1, ?2, ?3);";
     int rs;
 
-    if ((rs = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL)) != SQLITE_OK)
+    if ((rs = PrepareCached(db, sql, &stmt)) != SQLITE_OK)
     {
         fprintf(stderr, "Error preparing statement: %s\n", sqlite3_errmsg(db));
         return rs;
@@ -71,7 +62,7 @@ int InsertOrder(sqlite3 *db, Order *order)
         order->id = (int)sqlite3_last_insert_rowid(db);
     }
 
-    sqlite3_finalize(stmt);
+    ReleaseStatement(stmt);
     return rs;
 }
 
@@ -87,7 +78,7 @@ int DeleteOrder(sqlite3 *db, int orderId)
     const char *sql = "DELETE FROM orders WHERE id = ?1;";
     int rs;
 
-    if ((rs = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL)) != SQLITE_OK)
+    if ((rs = PrepareCached(db, sql, &stmt)) != SQLITE_OK)
     {
         fprintf(stderr, "Error preparing statement: %s\n", sqlite3_errmsg(db));
         return rs;
@@ -101,7 +92,7 @@ int DeleteOrder(sqlite3 *db, int orderId)
         fprintf(stderr, "Error executing statement: %s - %s\n", sqlite3_errstr(rs), sqlite3_errmsg(db));
     }
 
-    sqlite3_finalize(stmt);
+    ReleaseStatement(stmt);
     return rs;
 }
 
@@ -118,7 +109,7 @@ int ModifyOrder(sqlite3 *db, Order *order)
     const char *sql = "UPDATE orders SET client_id = ?, product_id = ?, amount = ? WHERE id = ?;";
     int rs;
 
-    if ((rs = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL)) != SQLITE_OK)
+    if ((rs = PrepareCached(db, sql, &stmt)) != SQLITE_OK)
     {
         fprintf(stderr, "Error preparing statement: %s\n", sqlite3_errmsg(db));
         return rs;
@@ -136,7 +127,7 @@ int ModifyOrder(sqlite3 *db, Order *order)
         fprintf(stderr, "Error executing statement: %s - %s\n", sqlite3_errstr(rs), sqlite3_errmsg(db));
     }
 
-    sqlite3_finalize(stmt);
+    ReleaseStatement(stmt);
     return rs;
 }
 
@@ -152,7 +143,7 @@ int GetOrderById(sqlite3 *db, int orderId, Order *order)
     const char *sql = "SELECT id, client_id, product_id, amount FROM orders WHERE id = ?1;";
     int rs;
 
-    if ((rs = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL)) != SQLITE_OK)
+    if ((rs = PrepareCached(db, sql, &stmt)) != SQLITE_OK)
     {
         fprintf(stderr, "Error preparing statement: %s\n", sqlite3_errmsg(db));
         return rs;
@@ -162,10 +153,7 @@ int GetOrderById(sqlite3 *db, int orderId, Order *order)
 
     if ((rs = sqlite3_step(stmt)) == SQLITE_ROW)
     {
-        order->id = sqlite3_column_int(stmt, 0);
-        order->client_id = sqlite3_column_int(stmt, 1);
-        order->product_id = sqlite3_column_int(stmt, 2);
-        order->amount = sqlite3_column_int(stmt, 3);
+        ReadOrderRow(order, stmt);
     }
     else if (rs == SQLITE_DONE)
     {
@@ -177,7 +165,29 @@ int GetOrderById(sqlite3 *db, int orderId, Order *order)
         fprintf(stderr, "Error executing statement: %s - %s\n", sqlite3_errstr(rs), sqlite3_errmsg(db));
     }
 
-    sqlite3_finalize(stmt);
+    ReleaseStatement(stmt);
+    return rs;
+}
+
+int GetClientOrders(sqlite3 *db, int clientId, OrderVector *orders)
+{
+    sqlite3_stmt *stmt;
+    const char *sql = "SELECT id, client_id, product_id, amount FROM orders WHERE client_id = ?1 ORDER BY id;";
+    int rs;
+
+    if ((rs = PrepareCached(db, sql, &stmt)) != SQLITE_OK)
+    {
+        fprintf(stderr, "Error preparing statement: %s\n", sqlite3_errmsg(db));
+        return rs;
+    }
+    sqlite3_bind_int(stmt, 1, clientId);
+
+    if ((rs = OrderVectorAppendRows(orders, stmt)) != SQLITE_DONE)
+    {
+        fprintf(stderr, "Error executing statement: %s - %s\n", sqlite3_errstr(rs), sqlite3_errmsg(db));
+    }
+
+    ReleaseStatement(stmt);
     return rs;
 }
 
@@ -209,382 +219,600 @@ int PromptUserForOrder(sqlite3 *db, Order *order)
     return rs;
 }
 
-void PrintOrdersGroupedByClient(sqlite3 *db)
+// Report queries, all select the columns of OrderReportRow up to productName in its order, then the extras of the report
+static const char *orderReportSql[] = {
+    [ORDER_REPORT_GROUPED_BY_CLIENT] =
+        "SELECT cl.id, cl.first_name, cl.last_name, o.id, o.product_id, o.amount, prd.name "
+        "FROM orders AS o "
+        "LEFT JOIN clients AS cl ON cl.id = o.client_id "
+        "LEFT JOIN products AS prd ON prd.id = o.product_id "
+        "GROUP BY cl.id, prd.id "
+        "ORDER BY cl.last_name ASC, cl.first_name ASC;",
+    [ORDER_REPORT_BY_ORDER_COUNT] =
+        "SELECT cl.id, cl.first_name, cl.last_name, "
+        "o.id as order_id, o.product_id, o.amount, p.name as product_name, "
+        "(SELECT COUNT(*) FROM orders WHERE client_id = cl.id) as orderCount "
+        "FROM clients AS cl "
+        "INNER JOIN orders o ON cl.id = o.client_id "
+        "LEFT JOIN products p ON o.product_id = p.id "
+        "ORDER BY orderCount DESC, cl.last_name ASC, cl.first_name ASC, o.id ASC;",
+    // product_best_offer holds only the offers at the lowest price, ties are listed by shop
+    [ORDER_REPORT_CHEAPEST_OFFERS] =
+        "SELECT cl.id, cl.first_name, cl.last_name, o.id AS order_id, "
+        "best.product_id AS product_id, o.amount, prd.name, "
+        "best.offer_id AS offer_id, best.price, sh.name "
+        "FROM clients AS cl "
+        "INNER JOIN orders AS o ON o.client_id = cl.id "
+        "LEFT JOIN products AS prd ON prd.id = o.product_id "
+        "INNER JOIN product_best_offer AS best ON best.product_id = prd.id "
+        "LEFT JOIN shops AS sh ON sh.id = best.shop_id "
+        "ORDER BY cl.last_name ASC, cl.first_name ASC, o.id ASC, best.shop_id ASC, best.offer_id ASC;",
+};
+
+// Reports that can be split into ranges of clients in name order, with the same columns and order as their
+// orderReportSql. The clients of a range are a page of idx_clients_name: ?1/?2/?3 = name key of the first client,
+// ?4 = clients in the range. The row value comparison seeks into the index but is NULL if a name of the key is
+// NULL, the NULL aware comparison of the second statement is needed for the first ranges at most (as in
+// search_cursor.c). The subquery delivers the clients in name order, only orders and offers are sorted.
+#define CHEAPEST_OFFERS_RANGE_SQL(clientsFrom)                                                                      \
+    "SELECT cl.id, cl.first_name, cl.last_name, o.id AS order_id, "                                                 \
+    "best.product_id AS product_id, o.amount, prd.name, "                                                           \
+    "best.offer_id AS offer_id, best.price, sh.name "                                                               \
+    "FROM (SELECT id, first_name, last_name FROM clients WHERE " clientsFrom                                        \
+    " ORDER BY last_name, first_name, id LIMIT ?4) AS cl "                                                          \
+    "INNER JOIN orders AS o ON o.client_id = cl.id "                                                                \
+    "LEFT JOIN products AS prd ON prd.id = o.product_id "                                                           \
+    "INNER JOIN product_best_offer AS best ON best.product_id = prd.id "                                            \
+    "LEFT JOIN shops AS sh ON sh.id = best.shop_id "                                                                \
+    "ORDER BY cl.last_name ASC, cl.first_name ASC, o.id ASC, best.shop_id ASC, best.offer_id ASC;"
+
+static const char *orderReportRangeSql[][2] = {
+    [ORDER_REPORT_CHEAPEST_OFFERS] = {
+        CHEAPEST_OFFERS_RANGE_SQL("(last_name, first_name, id) >= (?1, ?2, ?3)"),
+        CHEAPEST_OFFERS_RANGE_SQL(
+            "(last_name > ?1 OR (?1 IS NULL AND last_name IS NOT NULL) OR (last_name IS ?1 AND"
+            " (first_name > ?2 OR (?2 IS NULL AND first_name IS NOT NULL) OR (first_name IS ?2 AND id >= ?3))))"),
+    },
+};
+
+static int VisitReportRows(sqlite3 *db, OrderReport report, sqlite3_stmt *stmt, OrderReportVisitor visit, void *ctx)
 {
-    sqlite3_stmt *stmt;
-    const char *sql = "SELECT cl.id, cl.first_name, cl.last_name, o.id, o.product_id, o.amount, prd.name "
-                      "FROM orders AS o "
-                      "LEFT JOIN clients AS cl ON cl.id = o.client_id "
-                      "LEFT JOIN products AS prd ON prd.id = o.product_id "
-                      "GROUP BY cl.id, prd.id "
-                      "ORDER BY cl.last_name ASC, cl.first_name ASC;";
     int rs;
-    if ((rs = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL)) != SQLITE_OK)
-    {
-        fprintf(stderr, "Error preparing statement: %s\n", sqlite3_errmsg(db));
-        return;
-    }
-
-    printf("\n=== Orders Grouped by Clients ===\n");
-
-    // Since rows are sorted by client names, orders can be grouped under client until a new client is found
-    int currentClientId = -1;
+    OrderReportRow row = {0};
     while ((rs = sqlite3_step(stmt)) == SQLITE_ROW)
     {
-        int clientId = sqlite3_column_int(stmt, 0);
-        const unsigned char *firstName = sqlite3_column_text(stmt, 1);
-        const unsigned char *lastName = sqlite3_column_text(stmt, 2);
-        int orderId = sqlite3_column_int(stmt, 3);
-        int productId = sqlite3_column_int(stmt, 4);
-        int amount = sqlite3_column_int(stmt, 5);
-        const unsigned char *productName = sqlite3_column_text(stmt, 6);
-
-        if (clientId != currentClientId)
+        row.clientId = sqlite3_column_int(stmt, 0);
+        row.firstName = ColumnTextRef(stmt, 1);
+        row.lastName = ColumnTextRef(stmt, 2);
+        row.orderId = sqlite3_column_int(stmt, 3);
+        row.productId = sqlite3_column_int(stmt, 4);
+        row.amount = sqlite3_column_int(stmt, 5);
+        row.productName = ColumnTextRef(stmt, 6);
+        if (report == ORDER_REPORT_BY_ORDER_COUNT)
         {
-            // New client found, print client details
-            if (currentClientId != -1)
-            {
-                printf("\n"); // Print a newline before the next client
-            }
-            printf("Client ID: %d, Name: %s %s\n", clientId, firstName, lastName);
-            printf("────────────────────────────────────────\n");
-            currentClientId = clientId;
+            row.orderCount = sqlite3_column_int(stmt, 7);
         }
-
-        // Print order details
-        printf("    Order ID %-3d: %s (ID %-3d) Amount: %d\n", orderId, productName, productId, amount);
+        else if (report == ORDER_REPORT_CHEAPEST_OFFERS)
+        {
+            row.offerId = sqlite3_column_int(stmt, 7);
+            row.price = sqlite3_column_double(stmt, 8);
+            row.shopName = ColumnTextRef(stmt, 9);
+        }
+        if (visit(&row, ctx) != 0)
+        {
+            rs = SQLITE_ABORT;
+            break;
+        }
+    }
+    if (rs != SQLITE_DONE && rs != SQLITE_ABORT)
+    {
+        fprintf(stderr, "Error executing statement: %s - %s\n", sqlite3_errstr(rs), sqlite3_errmsg(db));
     }
 
-    sqlite3_finalize(stmt);
+    ReleaseStatement(stmt);
+    return rs;
 }
 
-void PrintAllOrdersByClientOrderCount(sqlite3 *db)
+int VisitOrderReport(sqlite3 *db, OrderReport report, OrderReportVisitor visit, void *ctx)
 {
     sqlite3_stmt *stmt;
-    const char *sql = "SELECT cl.id, cl.first_name, cl.last_name, "
-                      "o.id as order_id, o.product_id, o.amount, p.name as product_name, "
-                      "(SELECT COUNT(*) FROM orders WHERE client_id = cl.id) as orderCount "
-                      "FROM clients AS cl "
-                      "INNER JOIN orders o ON cl.id = o.client_id "
-                      "LEFT JOIN products p ON o.product_id = p.id "
-                      "ORDER BY orderCount DESC, cl.last_name ASC, cl.first_name ASC, o.id ASC;";
     int rs;
-
-    if ((rs = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL)) != SQLITE_OK)
+    if ((rs = PrepareCached(db, orderReportSql[report], &stmt)) != SQLITE_OK)
     {
         fprintf(stderr, "Error preparing statement: %s\n", sqlite3_errmsg(db));
-        return;
+        return rs;
     }
+    return VisitReportRows(db, report, stmt, visit, ctx);
+}
 
-    printf("\n=== Clients by order count ===\n");
-
-    int currentClientId = -1;
-    int totalOrders = 0;
-
-    while ((rs = sqlite3_step(stmt)) == SQLITE_ROW)
+static char *CopyName(const unsigned char *name)
+{
+    if (name == NULL)
     {
-        int clientId = sqlite3_column_int(stmt, 0);
-        const char *firstName = (const char *)sqlite3_column_text(stmt, 1);
-        const char *lastName = (const char *)sqlite3_column_text(stmt, 2);
-        int orderId = sqlite3_column_int(stmt, 3);
-        int productId = sqlite3_column_int(stmt, 4);
-        int amount = sqlite3_column_int(stmt, 5);
-        const char *productName = (const char *)sqlite3_column_text(stmt, 6);
-        int orderCount = sqlite3_column_int(stmt, 7);
-
-        // Check if we're on a new client
-        if (clientId != currentClientId)
-        {
-            if (currentClientId != -1)
-            {
-                printf("\n"); // Add spacing between clients
-            }
-
-            currentClientId = clientId;
-
-            // Handle NULL names
-            const char *fName = firstName ? firstName : "N/A";
-            const char *lName = lastName ? lastName : "N/A";
-
-            printf("Client ID %d: %s %s (%d orders)\n",
-                   clientId, fName, lName, orderCount);
-            printf("────────────────────────────────────────\n");
-        }
-
-        // Handle NULL product name
-        const char *pName = productName ? productName : "Unknown Product";
+        return NULL;
+    }
+    char *copy = strdup((const char *)name);
+    if (copy == NULL)
+    {
+        fprintf(stderr, "Memory allocation failed for client ranges.\n");
+        exit(EXIT_FAILURE);
+    }
+    return copy;
+}
 
-        printf("  Order ID %-3d: %s (ID: %-3d) Amount: %d\n",
-               orderId, pName, productId, amount);
+static int SameName(const char *a, const unsigned char *b)
+{
+    return a == NULL ? b == NULL : b != NULL && strcmp(a, (const char *)b) == 0;
+}
 
-        totalOrders++;
+int SplitClientsByName(sqlite3 *db, int maxChunks, ClientNameRange **ranges, int *count)
+{
+    sqlite3_stmt *stmt;
+    int rs;
+    if ((rs = PrepareCached(db, "SELECT COUNT(*) FROM clients;", &stmt)) != SQLITE_OK)
+    {
+        fprintf(stderr, "Error preparing statement: %s\n", sqlite3_errmsg(db));
+        return rs;
     }
-
-    if (currentClientId == -1)
+    int clients = 0;
+    if ((rs = sqlite3_step(stmt)) == SQLITE_ROW)
     {
-        printf("No orders found in the database.\n");
+        clients = sqlite3_column_int(stmt, 0);
+        rs = SQLITE_OK;
     }
     else
     {
-        printf("\n════════════════════════════════════════\n");
-        printf("Total orders displayed: %d\n", totalOrders);
+        fprintf(stderr, "Error executing statement: %s - %s\n", sqlite3_errstr(rs), sqlite3_errmsg(db));
+    }
+    ReleaseStatement(stmt);
+    if (rs != SQLITE_OK)
+    {
+        return rs;
     }
 
+    if ((rs = PrepareCached(db, "SELECT id, first_name, last_name FROM clients ORDER BY last_name, first_name, id;",
+                            &stmt)) != SQLITE_OK)
+    {
+        fprintf(stderr, "Error preparing statement: %s\n", sqlite3_errmsg(db));
+        return rs;
+    }
+    int chunks = maxChunks > 1 ? maxChunks : 1;
+    int target = clients / chunks + (clients % chunks != 0);
+    ClientNameRange *split = calloc((size_t)chunks, sizeof(ClientNameRange));
+    if (split == NULL)
+    {
+        fprintf(stderr, "Memory allocation failed for client ranges.\n");
+        exit(EXIT_FAILURE);
+    }
+    // Name of the previous client, a range may only start where the name changes
+    char *lastName = NULL;
+    char *firstName = NULL;
+    int used = 0;
+    while ((rs = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        const unsigned char *first = sqlite3_column_text(stmt, 1);
+        const unsigned char *last = sqlite3_column_text(stmt, 2);
+        int sameName = used > 0 && SameName(lastName, last) && SameName(firstName, first);
+        if (used == 0 || (used < chunks && split[used - 1].clientCount >= target && !sameName))
+        {
+            ClientNameRange range = {.lastName = CopyName(last), .firstName = CopyName(first),
+                                     .id = sqlite3_column_int(stmt, 0)};
+            split[used++] = range;
+        }
+        split[used - 1].clientCount++;
+        if (!sameName)
+        {
+            free(lastName);
+            free(firstName);
+            lastName = CopyName(last);
+            firstName = CopyName(first);
+        }
+    }
+    free(lastName);
+    free(firstName);
+    ReleaseStatement(stmt);
     if (rs != SQLITE_DONE)
     {
         fprintf(stderr, "Error executing statement: %s - %s\n", sqlite3_errstr(rs), sqlite3_errmsg(db));
+        FreeClientNameRanges(split, used);
+        return rs;
     }
+    // No clients: one empty range
+    *ranges = split;
+    *count = used > 0 ? used : 1;
+    return SQLITE_OK;
+}
 
-    sqlite3_finalize(stmt);
+void FreeClientNameRanges(ClientNameRange *ranges, int count)
+{
+    if (ranges == NULL)
+    {
+        return;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        free(ranges[i].lastName);
+        free(ranges[i].firstName);
+    }
+    free(ranges);
 }
 
-void PrintCheapestOffersForAllClientOrders(sqlite3 *db)
+int VisitOrderReportRange(sqlite3 *db, OrderReport report, const ClientNameRange *range, OrderReportVisitor visit,
+                          void *ctx)
 {
+    if ((size_t)report >= sizeof(orderReportRangeSql) / sizeof(orderReportRangeSql[0]) ||
+        orderReportRangeSql[report][0] == NULL)
+    {
+        fprintf(stderr, "Report %d cannot be split by client.\n", (int)report);
+        return SQLITE_MISUSE;
+    }
     sqlite3_stmt *stmt;
-    const char *sql = "SELECT cl.id, cl.first_name, cl.last_name, prd.name, "
-                      "off.product_id AS product_id, off.id AS offer_id, "
-                      "off.price, o.id AS order_id, o.amount, sh.name "
-                      "FROM clients AS cl "
-                      "INNER JOIN orders AS o ON o.client_id = cl.id "
-                      "LEFT JOIN products AS prd ON prd.id = o.product_id "
-                      "LEFT JOIN offers AS off ON off.product_id = prd.id "
-                      "LEFT JOIN shops AS sh ON sh.id = off.shop_id "
-                      "WHERE off.price = ("
-                      "    SELECT MIN(price) FROM offers WHERE product_id = prd.id"
-                      ") "
-                      "ORDER BY cl.last_name ASC, cl.first_name ASC, o.id ASC;";
     int rs;
-
-    if ((rs = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL)) != SQLITE_OK)
+    int nullKey = range->lastName == NULL || range->firstName == NULL;
+    if ((rs = PrepareCached(db, orderReportRangeSql[report][nullKey], &stmt)) != SQLITE_OK)
     {
         fprintf(stderr, "Error preparing statement: %s\n", sqlite3_errmsg(db));
-        return;
+        return rs;
     }
+    sqlite3_bind_text(stmt, 1, range->lastName, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, range->firstName, -1, SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 3, range->id);
+    sqlite3_bind_int(stmt, 4, range->clientCount);
+    return VisitReportRows(db, report, stmt, visit, ctx);
+}
 
-    printf("\n=== Cheapest Offers for All Orders ===\n");
+// Ids of the client and order printed last, the rows of a report are grouped under them
+typedef struct {
+    FILE *out;
+    int clientId;
+    int orderId;
+    int rows;
+} ReportGroups;
 
-    // Your implementation here - similar to PrintAllOrdersByClientOrderCount
-    // but showing offer details instead of just products
-    int currentClientId = -1;
-    int currentOrderId = -1;
-    while ((rs = sqlite3_step(stmt)) == SQLITE_ROW)
+static int PrintGroupedByClientRow(const OrderReportRow *row, void *ctx)
+{
+    ReportGroups *groups = ctx;
+    // Since rows are sorted by client names, orders can be grouped under client until a new client is found
+    if (row->clientId != groups->clientId)
     {
-        int clientId = sqlite3_column_int(stmt, 0);
-        const char *firstName = (const char *)sqlite3_column_text(stmt, 1);
-        const char *lastName = (const char *)sqlite3_column_text(stmt, 2);
-        const char *productName = (const char *)sqlite3_column_text(stmt, 3);
-        int productId = sqlite3_column_int(stmt, 4);
-        int offerId = sqlite3_column_int(stmt, 5);
-        double price = sqlite3_column_double(stmt, 6);
-        int orderId = sqlite3_column_int(stmt, 7);
-        int amount = sqlite3_column_int(stmt, 8);
-        const char *shopName = (const char *)sqlite3_column_text(stmt, 9);
-
-        if (clientId != currentClientId)
+        // New client found, print client details
+        if (groups->clientId != -1)
         {
-            if (currentClientId != -1)
-            {
-                printf("\n"); // Print a newline before the next client
-            }
-            printf("Client ID: %d, Name: %s %s\n", clientId, firstName, lastName);
-            printf("────────────────────────────────────────\n");
-            currentClientId = clientId;
+            fprintf(groups->out, "\n"); // Print a newline before the next client
         }
+        fprintf(groups->out, "Client ID: %d, Name: %s %s\n", row->clientId, row->firstName.text,
+                row->lastName.text);
+        fprintf(groups->out, "────────────────────────────────────────\n");
+        groups->clientId = row->clientId;
+    }
 
-        if (currentOrderId != orderId)
+    // Print order details
+    fprintf(groups->out, "    Order ID %-3d: %s (ID %-3d) Amount: %d\n", row->orderId, row->productName.text,
+            row->productId, row->amount);
+    return 0;
+}
+
+int PrintOrdersGroupedByClientTo(sqlite3 *db, FILE *out)
+{
+    fprintf(out, "\n=== Orders Grouped by Clients ===\n");
+    ReportGroups groups = {out, -1, -1, 0};
+    int rs = VisitOrderReport(db, ORDER_REPORT_GROUPED_BY_CLIENT, PrintGroupedByClientRow, &groups);
+    return rs == SQLITE_DONE ? SQLITE_OK : rs;
+}
+
+void PrintOrdersGroupedByClient(sqlite3 *db)
+{
+    PrintOrdersGroupedByClientTo(db, stdout);
+}
+
+static int PrintByOrderCountRow(const OrderReportRow *row, void *ctx)
+{
+    ReportGroups *groups = ctx;
+    // Check if we're on a new client
+    if (row->clientId != groups->clientId)
+    {
+        if (groups->clientId != -1)
         {
-            if (currentOrderId != -1)
-            {
-                printf("\n"); // Print a newline before the next order
-            }
-            printf("    Order ID: %d\n", orderId);
-            currentOrderId = orderId;
+            fprintf(groups->out, "\n"); // Add spacing between clients
         }
 
-        printf("        Product '%s' (ID %-3d) - Offer ID: %-3d at Price: %.2f from Shop: %s "
-               "Amount: %d\n",
-               productName, productId, offerId, price, shopName ? shopName : "Unknown", amount);
-    }
-    if (rs != SQLITE_DONE)
-    {
-        fprintf(stderr, "Error executing statement: %s - %s\n", sqlite3_errstr(rs), sqlite3_errmsg(db));
+        groups->clientId = row->clientId;
+
+        // Handle NULL names
+        const char *fName = row->firstName.text ? row->firstName.text : "N/A";
+        const char *lName = row->lastName.text ? row->lastName.text : "N/A";
+
+        fprintf(groups->out, "Client ID %d: %s %s (%d orders)\n",
+                row->clientId, fName, lName, row->orderCount);
+        fprintf(groups->out, "────────────────────────────────────────\n");
     }
-    sqlite3_finalize(stmt);
+
+    // Handle NULL product name
+    const char *pName = row->productName.text ? row->productName.text : "Unknown Product";
+
+    fprintf(groups->out, "  Order ID %-3d: %s (ID: %-3d) Amount: %d\n",
+            row->orderId, pName, row->productId, row->amount);
+
+    groups->rows++;
+    return 0;
 }
 
-void FindCheapestShopPerClient(sqlite3 *db)
+int PrintAllOrdersByClientOrderCountTo(sqlite3 *db, FILE *out)
 {
-    sqlite3_stmt *stmt;
-    const char *sql = "SELECT cl.id AS client_id, cl.first_name, cl.last_name, sh.id AS shop_id, SUM(off.price * o.amount) AS total_cost_for_shop, "
-                      "sh.name AS shop_name, COUNT(o.id) AS orders_count "
-                      "FROM clients AS cl "
-                      "INNER JOIN orders AS o ON o.client_id = cl.id "
-                      "LEFT JOIN products AS prd ON prd.id = o.product_id "
-                      "LEFT JOIN offers AS off ON off.product_id = prd.id "
-                      "LEFT JOIN shops AS sh ON sh.id = off.shop_id "
-                      "GROUP BY sh.id, cl.id "
-                      "ORDER BY cl.id ";
-
-    int currentClientId = -1;
-    double minCost = 0.0;
-    int bestShopId = -1;
-    char bestShopName[128] = "";
-    char currentFirstName[128] = "";
-    char currentLastName[128] = "";
+    fprintf(out, "\n=== Clients by order count ===\n");
 
-    int rs;
-    if ((rs = sqlite3_prepare_v2(db, (const char *)sql, -1, &stmt, NULL)) != SQLITE_OK)
+    ReportGroups groups = {out, -1, -1, 0};
+    int rs = VisitOrderReport(db, ORDER_REPORT_BY_ORDER_COUNT, PrintByOrderCountRow, &groups);
+    if (rs == SQLITE_DONE || groups.rows > 0)
     {
-        fprintf(stderr, "Error preparing statement: %s\n", sqlite3_errmsg(db));
-        return;
+        if (groups.clientId == -1)
+        {
+            fprintf(out, "No orders found in the database.\n");
+        }
+        else
+        {
+            fprintf(out, "\n════════════════════════════════════════\n");
+            fprintf(out, "Total orders displayed: %d\n", groups.rows);
+        }
     }
-    printf("\n=== Cheapest Shop per Client ===\n");
-    while ((rs = sqlite3_step(stmt)) == SQLITE_ROW)
-    {
-        int clientId = sqlite3_column_int(stmt, 0);
-        int shopId = sqlite3_column_int(stmt, 3);
-        double totalCost = sqlite3_column_double(stmt, 4);
-        const unsigned char *shopName = sqlite3_column_text(stmt, 5);
-        const unsigned char *firstName = sqlite3_column_text(stmt, 1);
-        const unsigned char *lastName = sqlite3_column_text(stmt, 2);
+    return rs == SQLITE_DONE ? SQLITE_OK : rs;
+}
 
-        // printf("CHECKING SHOP: %s for client %d\n", shopName, clientId);
+void PrintAllOrdersByClientOrderCount(sqlite3 *db)
+{
+    PrintAllOrdersByClientOrderCountTo(db, stdout);
+}
 
-        if (clientId != currentClientId)
+static int PrintCheapestOfferRow(const OrderReportRow *row, void *ctx)
+{
+    ReportGroups *groups = ctx;
+    // Separators check for earlier rows rather than earlier ids, a range of the report may continue another one
+    if (row->clientId != groups->clientId)
+    {
+        if (groups->rows > 0)
         {
-            // Print previous client's best shop (if any)
-            if (currentClientId != -1)
-            {
-                printf("Best shop for client %s %s (ID %d): Shop ID %d (%.2f €): %s\n",
-                       currentFirstName, currentLastName, currentClientId, bestShopId, minCost, bestShopName);
-            }
-
-            // Reset for new client
-            currentClientId = clientId;
-            minCost = totalCost;
-            bestShopId = shopId;
-            strcpy(currentFirstName, (const char *)firstName);
-            strcpy(currentLastName, (const char *)lastName);
-            strcpy(bestShopName, (const char *)shopName);
+            fprintf(groups->out, "\n"); // Print a newline before the next client
         }
-        else
+        fprintf(groups->out, "Client ID: %d, Name: %s %s\n", row->clientId, row->firstName.text,
+                row->lastName.text);
+        fprintf(groups->out, "────────────────────────────────────────\n");
+        groups->clientId = row->clientId;
+    }
+
+    if (groups->orderId != row->orderId)
+    {
+        if (groups->rows > 0)
         {
-            // Same client - check if this shop is cheaper
-            if (totalCost < minCost)
-            {
-                minCost = totalCost;
-                bestShopId = shopId;
-                strcpy(bestShopName, (const char *)shopName);
-            }
+            fprintf(groups->out, "\n"); // Print a newline before the next order
         }
+        fprintf(groups->out, "    Order ID: %d\n", row->orderId);
+        groups->orderId = row->orderId;
+    }
+
+    fprintf(groups->out, "        Product '%s' (ID %-3d) - Offer ID: %-3d at Price: %.2f from Shop: %s "
+            "Amount: %d\n",
+            row->productName.text, row->productId, row->offerId, row->price,
+            row->shopName.text ? row->shopName.text : "Unknown", row->amount);
+    groups->rows++;
+    return 0;
+}
+
+int PrintCheapestOffersForAllClientOrdersTo(sqlite3 *db, FILE *out)
+{
+    fprintf(out, "\n=== Cheapest Offers for All Orders ===\n");
+    ReportGroups groups = {out, -1, -1, 0};
+    int rs = VisitOrderReport(db, ORDER_REPORT_CHEAPEST_OFFERS, PrintCheapestOfferRow, &groups);
+    return rs == SQLITE_DONE ? SQLITE_OK : rs;
+}
+
+void PrintCheapestOffersForAllClientOrders(sqlite3 *db)
+{
+    PrintCheapestOffersForAllClientOrdersTo(db, stdout);
+}
+
+int PrintCheapestOffersRangeTo(sqlite3 *db, const ClientNameRange *range, int continued, FILE *out, int *rows)
+{
+    ReportGroups groups = {out, -1, -1, continued ? 1 : 0};
+    int rs = VisitOrderReportRange(db, ORDER_REPORT_CHEAPEST_OFFERS, range, PrintCheapestOfferRow, &groups);
+    *rows = groups.rows - (continued ? 1 : 0);
+    return rs;
+}
+
+static void PrintCheapestShopLines(const ClientCostSummary *summaries, size_t count, FILE *out)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        const ClientCostSummary *s = &summaries[i];
+        fprintf(out, "Best shop for client %s %s (ID %d): Shop ID %d (%.2f €): %s\n",
+                s->firstName, s->lastName, s->clientId, s->bestShopId, s->bestCost, s->bestShopName);
     }
+}
 
-    if (currentClientId != -1)
+int FindCheapestShopPerClientTo(sqlite3 *db, FILE *out)
+{
+    const ClientCostSummary *summaries;
+    size_t count;
+    int rs = GetClientCostSummaries(db, &summaries, &count);
+    if (rs != SQLITE_OK)
     {
-        printf("Best shop for client %s %s (ID %d): Shop ID %d (%.2f €): %s\n",
-               currentFirstName, currentLastName, currentClientId, bestShopId, minCost, bestShopName);
+        return rs;
     }
+    fprintf(out, "\n=== Cheapest Shop per Client ===\n");
+    PrintCheapestShopLines(summaries, count, out);
+    return SQLITE_OK;
+}
 
-    if (rs != SQLITE_DONE)
+void FindCheapestShopPerClient(sqlite3 *db)
+{
+    FindCheapestShopPerClientTo(db, stdout);
+}
+
+int FindCheapestShopRangeTo(sqlite3 *db, int firstClientId, int lastClientId, const PriceMatrix *matrix,
+                            ClientCostSet *set, FILE *out)
+{
+    int rs = ComputeClientCostRange(db, firstClientId, lastClientId, matrix, set);
+    if (rs != SQLITE_OK)
     {
-        fprintf(stderr, "Error executing statement: %s - %s\n", sqlite3_errstr(rs), sqlite3_errmsg(db));
+        return rs;
     }
+    size_t count;
+    const ClientCostSummary *summaries = GetClientCostSetSummaries(set, &count);
+    PrintCheapestShopLines(summaries, count, out);
+    return SQLITE_OK;
+}
 
-    sqlite3_finalize(stmt);
+int PrintPotentialSavingsPerClientTo(sqlite3 *db, FILE *out)
+{
+    const ClientCostSummary *summaries;
+    size_t count;
+    int rs = GetClientCostSummaries(db, &summaries, &count);
+    if (rs != SQLITE_OK)
+    {
+        return rs;
+    }
+    fprintf(out, "\n=== Potential savings per client (best price vs wors price) ===\n");
+    for (size_t i = 0; i < count; i++)
+    {
+        const ClientCostSummary *s = &summaries[i];
+        fprintf(out, "Client %s %s (ID %d) could save %.2f € by choosing shop ID %d (%s) instead of shop ID %d (%s)\n%s",
+                s->firstName, s->lastName, s->clientId, s->worstCost - s->bestCost,
+                s->bestShopId, s->bestShopName, s->worstShopId, s->worstShopName, i + 1 < count ? "\n" : "");
+    }
+    return SQLITE_OK;
 }
 
 void PrintPotentialSavingsPerClient(sqlite3 *db)
 {
-    sqlite3_stmt *stmt;
-    const char *sql = "SELECT cl.id AS client_id, cl.first_name, cl.last_name, sh.id AS shop_id, SUM(off.price * o.amount) AS total_cost_for_shop, "
-                      "sh.name AS shop_name, COUNT(o.id) AS orders_count "
-                      "FROM clients AS cl "
-                      "INNER JOIN orders AS o ON o.client_id = cl.id "
-                      "LEFT JOIN products AS prd ON prd.id = o.product_id "
-                      "LEFT JOIN offers AS off ON off.product_id = prd.id "
-                      "LEFT JOIN shops AS sh ON sh.id = off.shop_id "
-                      "GROUP BY sh.id, cl.id "
-                      "ORDER BY cl.id ";
-
-    int currentClientId = -1;
-    double minCost = 0.0;
-    double maxCost = 0.0;
-    int bestShopId = -1;
-    int worstShopId = -1;
-    char bestShopName[128] = "";
-    char worstShopName[128] = "";
-    char currentFirstName[128] = "";
-    char currentLastName[128] = "";
+    PrintPotentialSavingsPerClientTo(db, stdout);
+}
 
+// client_shop_cost and the triggers that keep it exact, created by the first connection that runs the sql
+// analytics engine. Every (order, offer of its product) pair adds price * amount to the pair's client and shop,
+// so duplicate offers of a shop add up like in the matrix engine, but an order counts once per shop that carries
+// its product. The triggers apply the same changes with the opposite sign when a side goes away. Totals are
+// rounded to 4 decimals after every delta so they do not drift away from a fresh SUM and equal baskets stay equal.
+static const char *clientShopCostSchemaSql =
+    "CREATE TABLE IF NOT EXISTS client_shop_cost ("
+    "client_id INTEGER NOT NULL, shop_id INTEGER NOT NULL, total_cost REAL NOT NULL,"
+    " orders_count INTEGER NOT NULL, PRIMARY KEY (client_id, shop_id)) WITHOUT ROWID;"
+    "CREATE TRIGGER IF NOT EXISTS orders_cost_ai AFTER INSERT ON orders BEGIN"
+    "  INSERT INTO client_shop_cost SELECT new.client_id, shop_id, TOTAL(price * new.amount), 1"
+    "   FROM offers WHERE product_id = new.product_id AND shop_id IS NOT NULL AND new.client_id IS NOT NULL"
+    "   GROUP BY shop_id"
+    "   ON CONFLICT DO UPDATE SET total_cost = ROUND(total_cost + excluded.total_cost, 4),"
+    "   orders_count = orders_count + excluded.orders_count;"
+    " END;"
+    "CREATE TRIGGER IF NOT EXISTS orders_cost_ad AFTER DELETE ON orders BEGIN"
+    "  INSERT INTO client_shop_cost SELECT old.client_id, shop_id, -TOTAL(price * old.amount), -1"
+    "   FROM offers WHERE product_id = old.product_id AND shop_id IS NOT NULL AND old.client_id IS NOT NULL"
+    "   GROUP BY shop_id"
+    "   ON CONFLICT DO UPDATE SET total_cost = ROUND(total_cost + excluded.total_cost, 4),"
+    "   orders_count = orders_count + excluded.orders_count;"
+    "  DELETE FROM client_shop_cost WHERE client_id = old.client_id AND orders_count <= 0;"
+    " END;"
+    "CREATE TRIGGER IF NOT EXISTS orders_cost_au AFTER UPDATE OF client_id, product_id, amount ON orders BEGIN"
+    "  INSERT INTO client_shop_cost SELECT old.client_id, shop_id, -TOTAL(price * old.amount), -1"
+    "   FROM offers WHERE product_id = old.product_id AND shop_id IS NOT NULL AND old.client_id IS NOT NULL"
+    "   GROUP BY shop_id"
+    "   ON CONFLICT DO UPDATE SET total_cost = ROUND(total_cost + excluded.total_cost, 4),"
+    "   orders_count = orders_count + excluded.orders_count;"
+    "  INSERT INTO client_shop_cost SELECT new.client_id, shop_id, TOTAL(price * new.amount), 1"
+    "   FROM offers WHERE product_id = new.product_id AND shop_id IS NOT NULL AND new.client_id IS NOT NULL"
+    "   GROUP BY shop_id"
+    "   ON CONFLICT DO UPDATE SET total_cost = ROUND(total_cost + excluded.total_cost, 4),"
+    "   orders_count = orders_count + excluded.orders_count;"
+    "  DELETE FROM client_shop_cost WHERE client_id = old.client_id AND orders_count <= 0;"
+    " END;"
+    // An offer reaches every client that ordered its product, one grouped pass over idx_orders_product.
+    // The orders only count if no other offer of the same shop and product carries them already.
+    "CREATE TRIGGER IF NOT EXISTS offers_cost_ai AFTER INSERT ON offers BEGIN"
+    "  INSERT INTO client_shop_cost SELECT client_id, new.shop_id, TOTAL(new.price * amount),"
+    "   COUNT(*) * NOT EXISTS (SELECT 1 FROM offers WHERE shop_id = new.shop_id AND product_id = new.product_id"
+    "   AND id <> new.id)"
+    "   FROM orders WHERE product_id = new.product_id AND client_id IS NOT NULL AND new.shop_id IS NOT NULL"
+    "   GROUP BY client_id"
+    "   ON CONFLICT DO UPDATE SET total_cost = ROUND(total_cost + excluded.total_cost, 4),"
+    "   orders_count = orders_count + excluded.orders_count;"
+    " END;"
+    "CREATE TRIGGER IF NOT EXISTS offers_cost_ad AFTER DELETE ON offers BEGIN"
+    "  INSERT INTO client_shop_cost SELECT client_id, old.shop_id, -TOTAL(old.price * amount),"
+    "   -COUNT(*) * NOT EXISTS (SELECT 1 FROM offers WHERE shop_id = old.shop_id AND product_id = old.product_id)"
+    "   FROM orders WHERE product_id = old.product_id AND client_id IS NOT NULL AND old.shop_id IS NOT NULL"
+    "   GROUP BY client_id"
+    "   ON CONFLICT DO UPDATE SET total_cost = ROUND(total_cost + excluded.total_cost, 4),"
+    "   orders_count = orders_count + excluded.orders_count;"
+    "  DELETE FROM client_shop_cost WHERE shop_id = old.shop_id AND orders_count <= 0"
+    "   AND client_id IN (SELECT client_id FROM orders WHERE product_id = old.product_id);"
+    " END;"
+    // The updated row is excluded on both sides by its new id, it already carries the new shop and product
+    "CREATE TRIGGER IF NOT EXISTS offers_cost_au AFTER UPDATE OF product_id, shop_id, price ON offers BEGIN"
+    "  INSERT INTO client_shop_cost SELECT client_id, old.shop_id, -TOTAL(old.price * amount),"
+    "   -COUNT(*) * NOT EXISTS (SELECT 1 FROM offers WHERE shop_id = old.shop_id AND product_id = old.product_id"
+    "   AND id <> new.id)"
+    "   FROM orders WHERE product_id = old.product_id AND client_id IS NOT NULL AND old.shop_id IS NOT NULL"
+    "   GROUP BY client_id"
+    "   ON CONFLICT DO UPDATE SET total_cost = ROUND(total_cost + excluded.total_cost, 4),"
+    "   orders_count = orders_count + excluded.orders_count;"
+    "  INSERT INTO client_shop_cost SELECT client_id, new.shop_id, TOTAL(new.price * amount),"
+    "   COUNT(*) * NOT EXISTS (SELECT 1 FROM offers WHERE shop_id = new.shop_id AND product_id = new.product_id"
+    "   AND id <> new.id)"
+    "   FROM orders WHERE product_id = new.product_id AND client_id IS NOT NULL AND new.shop_id IS NOT NULL"
+    "   GROUP BY client_id"
+    "   ON CONFLICT DO UPDATE SET total_cost = ROUND(total_cost + excluded.total_cost, 4),"
+    "   orders_count = orders_count + excluded.orders_count;"
+    "  DELETE FROM client_shop_cost WHERE shop_id = old.shop_id AND orders_count <= 0"
+    "   AND client_id IN (SELECT client_id FROM orders WHERE product_id = old.product_id);"
+    " END;";
+
+int RebuildClientShopCost(sqlite3 *db)
+{
+    char *errMsg = NULL;
     int rs;
-    if ((rs = sqlite3_prepare_v2(db, (const char *)sql, -1, &stmt, NULL)) != SQLITE_OK)
+    if ((rs = sqlite3_exec(db, "BEGIN IMMEDIATE;", NULL, NULL, &errMsg)) == SQLITE_OK &&
+        (rs = sqlite3_exec(db, clientShopCostSchemaSql, NULL, NULL, &errMsg)) == SQLITE_OK)
     {
-        fprintf(stderr, "Error preparing statement: %s\n", sqlite3_errmsg(db));
-        return;
+        rs = sqlite3_exec(db,
+                          "DELETE FROM client_shop_cost;"
+                          "INSERT INTO client_shop_cost SELECT o.client_id, off.shop_id, ROUND(TOTAL(off.price * o.amount), 4),"
+                          " COUNT(DISTINCT o.id) FROM orders AS o JOIN offers AS off ON off.product_id = o.product_id"
+                          " WHERE o.client_id IS NOT NULL AND off.shop_id IS NOT NULL GROUP BY o.client_id, off.shop_id;"
+                          "COMMIT;",
+                          NULL, NULL, &errMsg);
     }
-    printf("\n=== Potential savings per client (best price vs wors price) ===\n");
-    while ((rs = sqlite3_step(stmt)) == SQLITE_ROW)
+    if (rs != SQLITE_OK)
     {
-        int clientId = sqlite3_column_int(stmt, 0);
-        int shopId = sqlite3_column_int(stmt, 3);
-        double totalCost = sqlite3_column_double(stmt, 4);
-        const unsigned char *shopName = sqlite3_column_text(stmt, 5);
-        const unsigned char *firstName = sqlite3_column_text(stmt, 1);
-        const unsigned char *lastName = sqlite3_column_text(stmt, 2);
-
-        if (clientId != currentClientId)
-        {
-            // Print previous client
-            if (currentClientId != -1)
-            {
-                double potentialSavings = maxCost - minCost;
-                printf("Client %s %s (ID %d) could save %.2f € by choosing shop ID %d (%s) instead of shop ID %d (%s)\n\n",
-                       currentFirstName, currentLastName, currentClientId, potentialSavings,
-                       bestShopId, bestShopName, worstShopId, worstShopName);
-            }
-
-            // Reset for new client
-            currentClientId = clientId;
-            minCost = totalCost;
-            maxCost = totalCost;
-            bestShopId = shopId;
-            worstShopId = shopId;
-            strcpy(currentFirstName, (const char *)firstName);
-            strcpy(currentLastName, (const char *)lastName);
-            strcpy(bestShopName, (const char *)shopName);
-            strcpy(worstShopName, (const char *)shopName);
-        }
-        else
-        {
-            // Same client - check if this shop is cheaper
-            if (totalCost < minCost)
-            {
-                minCost = totalCost;
-                bestShopId = shopId;
-                strcpy(bestShopName, (const char *)shopName);
-            }
-            else if (totalCost > maxCost)
-            {
-                maxCost = totalCost;
-                worstShopId = shopId;
-                strcpy(worstShopName, (const char *)shopName);
-            }
-        }
+        fprintf(stderr, "Error rebuilding client_shop_cost: %s\n", errMsg);
+        sqlite3_free(errMsg);
+        sqlite3_exec(db, "ROLLBACK;", NULL, NULL, NULL);
     }
+    return rs;
+}
 
-    // Print the last client's info
-    if (currentClientId != -1)
+int EnableClientShopCost(sqlite3 *db)
+{
+    sqlite3_stmt *stmt;
+    int rs;
+    if ((rs = PrepareCached(db, "SELECT 1 FROM sqlite_schema WHERE type = 'trigger' AND name = 'orders_cost_ai';", &stmt)) !=
+        SQLITE_OK)
     {
-        double potentialSavings = maxCost - minCost;
-        printf("Client %s %s (ID %d) could save %.2f € by choosing shop ID %d (%s) instead of shop ID %d (%s)\n",
-               currentFirstName, currentLastName, currentClientId, potentialSavings,
-               bestShopId, bestShopName, worstShopId, worstShopName);
+        fprintf(stderr, "Error preparing statement: %s\n", sqlite3_errmsg(db));
+        return rs;
+    }
+    rs = sqlite3_step(stmt);
+    ReleaseStatement(stmt);
+    if (rs == SQLITE_ROW)
+    {
+        return SQLITE_OK;
     }
-
     if (rs != SQLITE_DONE)
     {
         fprintf(stderr, "Error executing statement: %s - %s\n", sqlite3_errstr(rs), sqlite3_errmsg(db));
+        return rs;
     }
-
-    sqlite3_finalize(stmt);
-}
\ No newline at end of file
+    if (sqlite3_db_readonly(db, "main") == 1 || !sqlite3_get_autocommit(db))
+    {
+        fprintf(stderr, "client_shop_cost is not maintained in this database, open it once with analytics_engine = sql\n");
+        return SQLITE_READONLY;
+    }
+    return RebuildClientShopCost(db);
+}
@@ -1,8 +1,14 @@
 #ifndef ORDERS_H
 #define ORDERS_H
 
+#include <stdio.h>
 #include <sqlite3.h>
 #include "db.h"
+#include "vector.h"
+#include "row_view.h"
+
+typedef struct ClientCostSet ClientCostSet;
+typedef struct PriceMatrix PriceMatrix;
 
 typedef struct {
     int id;        
@@ -11,6 +17,16 @@ typedef struct {
     int amount;
 } Order;
 
+/**
+ * @brief Fills an order from the current row of a statement selecting id, client_id, product_id and amount, in this order.
+ * @param order Pointer to the Order structure to fill.
+ * @param stmt Statement positioned on a row.
+ */
+void ReadOrderRow(Order *order, sqlite3_stmt *stmt);
+
+DEFINE_VECTOR(OrderVector, Order, VECTOR_NO_FREE)
+DEFINE_VECTOR_ROWS(OrderVector, Order, ReadOrderRow)
+
 /**
  * @brief Creates a new order in the database.
  * @param db Pointer to the SQLite database connection.
@@ -28,6 +44,15 @@ int InsertOrder(sqlite3 *db, Order *order);
  */
 int GetOrderById(sqlite3* db, int orderId, Order *order);
 
+/**
+ * @brief Retrieves all orders of a client, ordered by order ID.
+ * @param db Pointer to the SQLite database connection.
+ * @param clientId The ID of the client.
+ * @param orders Pointer to an initialized vector the orders are appended to.
+ * @returns SQLITE_DONE on success or sqlite3 error code.
+ */
+int GetClientOrders(sqlite3 *db, int clientId, OrderVector *orders);
+
 /**
  * @brief Prompts the user to enter order details and validates the input.
  * @param db Pointer to the SQLite database connection.
@@ -42,36 +67,185 @@ int PromptUserForOrder(sqlite3 *db, Order *order);
  */
 void PrintOrder(Order *order);
 
+typedef enum {
+    ORDER_REPORT_GROUPED_BY_CLIENT, // one row per client and product, in client name order
+    ORDER_REPORT_BY_ORDER_COUNT,    // every order, clients with the most orders first
+    ORDER_REPORT_CHEAPEST_OFFERS    // every order once per cheapest offer of its product, in client name order
+} OrderReport;
+
+// A row of an order report as borrowed by a visitor, the names are valid only during the callback
+typedef struct {
+    int clientId;
+    TextRef firstName;
+    TextRef lastName;
+    int orderId;
+    int productId;
+    int amount;
+    TextRef productName;
+    int orderCount;   // ORDER_REPORT_BY_ORDER_COUNT only
+    int offerId;      // ORDER_REPORT_CHEAPEST_OFFERS only
+    double price;     // ORDER_REPORT_CHEAPEST_OFFERS only
+    TextRef shopName; // ORDER_REPORT_CHEAPEST_OFFERS only
+} OrderReportRow;
+
+// Called once per row, a nonzero return stops the visit
+typedef int (*OrderReportVisitor)(const OrderReportRow *row, void *ctx);
+
+/**
+ * @brief Runs a report query and calls a visitor for each row, without copying the names.
+ * The Print* reports are visitors over these rows, other outputs can reuse the queries the same way.
+ * @param db Pointer to the SQLite database connection.
+ * @param report Report to run.
+ * @param visit Callback receiving each row.
+ * @param ctx Passed to the visitor.
+ * @returns SQLITE_DONE after the last row, SQLITE_ABORT if the visitor stopped, or sqlite3 error code.
+ */
+int VisitOrderReport(sqlite3 *db, OrderReport report, OrderReportVisitor visit, void *ctx);
+
+// Consecutive clients in name order (last name, first name, id), NULL names sort first
+typedef struct {
+    char *lastName;  // name key of the first client, NULL for a NULL name
+    char *firstName;
+    int id;
+    int clientCount; // clients in the range
+} ClientNameRange;
+
+/**
+ * @brief Splits the clients in name order into at most maxChunks ranges of about equal size, in one pass over
+ * idx_clients_name. A range never starts between clients with equal names, their orders are interleaved by
+ * order id in the reports.
+ * @param db Pointer to the SQLite database connection.
+ * @param maxChunks Upper bound on the number of ranges, at least 1.
+ * @param ranges Pointer where the array of ranges is stored, in name order. Free with FreeClientNameRanges.
+ * @param count Pointer where the number of ranges is stored, 1 (an empty range) if there are no clients.
+ * @returns SQLITE_OK or sqlite3 error code, nothing is stored on error.
+ */
+int SplitClientsByName(sqlite3 *db, int maxChunks, ClientNameRange **ranges, int *count);
+
+/**
+ * @brief Frees the ranges returned by SplitClientsByName.
+ * @param ranges Array of ranges, may be NULL.
+ * @param count Number of ranges.
+ */
+void FreeClientNameRanges(ClientNameRange *ranges, int count);
+
+/**
+ * @brief Like VisitOrderReport, for one range of clients in name order only (see SplitClientsByName).
+ * Visiting consecutive ranges one after another visits the rows of the whole report in the same order,
+ * so ranges can run on separate connections and be merged afterwards.
+ * The range seeks into idx_clients_name at its first client, like the pages of a search cursor, so it costs
+ * about its share of the report.
+ * Only ORDER_REPORT_CHEAPEST_OFFERS can be split so far.
+ * @param db Pointer to the SQLite database connection.
+ * @param report Report to run.
+ * @param range Clients to visit the rows of.
+ * @param visit Callback receiving each row.
+ * @param ctx Passed to the visitor.
+ * @returns SQLITE_DONE after the last row, SQLITE_ABORT if the visitor stopped, SQLITE_MISUSE if the report
+ * cannot be split, or sqlite3 error code.
+ */
+int VisitOrderReportRange(sqlite3 *db, OrderReport report, const ClientNameRange *range, OrderReportVisitor visit,
+                          void *ctx);
+
 /**
  * @brief Prints all orders grouped by client to the console.
  * @param db Pointer to the SQLite database connection.
  */
 void PrintOrdersGroupedByClient(sqlite3 *db);
 
+/**
+ * @brief Writes the report of PrintOrdersGroupedByClient to a stream instead of the console.
+ * @param db Pointer to the SQLite database connection.
+ * @param out Stream the report is written to.
+ * @returns SQLITE_OK on success or sqlite3 error code, the report may be cut short on error.
+ */
+int PrintOrdersGroupedByClientTo(sqlite3 *db, FILE *out);
+
 /**
  * @brief Prints all orders sorted by client order count to the console.
  * @param db Pointer to the SQLite database connection.
  */
 void PrintAllOrdersByClientOrderCount(sqlite3 *db);
 
+/**
+ * @brief Writes the report of PrintAllOrdersByClientOrderCount to a stream instead of the console.
+ * @param db Pointer to the SQLite database connection.
+ * @param out Stream the report is written to.
+ * @returns SQLITE_OK on success or sqlite3 error code, the report may be cut short on error.
+ */
+int PrintAllOrdersByClientOrderCountTo(sqlite3 *db, FILE *out);
+
 /**
  * @brief Prints the cheapest offers for all client orders to the console.
  * @param db Pointer to the SQLite database connection.
  */
 void PrintCheapestOffersForAllClientOrders(sqlite3 *db);
 
+/**
+ * @brief Writes the report of PrintCheapestOffersForAllClientOrders to a stream instead of the console.
+ * @param db Pointer to the SQLite database connection.
+ * @param out Stream the report is written to.
+ * @returns SQLITE_OK on success or sqlite3 error code, the report may be cut short on error.
+ */
+int PrintCheapestOffersForAllClientOrdersTo(sqlite3 *db, FILE *out);
+
+/**
+ * @brief Writes the rows of the cheapest offers report for a range of clients in name order, without the title.
+ * Writing consecutive ranges one after another, each continuing if an earlier one printed rows, gives the body
+ * of PrintCheapestOffersForAllClientOrdersTo.
+ * @param db Pointer to the SQLite database connection.
+ * @param range Clients to write the rows of (see SplitClientsByName).
+ * @param continued Nonzero if rows of earlier ranges come before, the first client is separated from them.
+ * @param out Stream the rows are written to.
+ * @param rows Pointer where the number of rows written is stored.
+ * @returns SQLITE_DONE on success or sqlite3 error code.
+ */
+int PrintCheapestOffersRangeTo(sqlite3 *db, const ClientNameRange *range, int continued, FILE *out, int *rows);
+
 /**
  * @brief Prints potential savings per client to the console.
+ * Shares the cached client cost summaries with FindCheapestShopPerClient.
  * @param db Pointer to the SQLite database connection.
  */
 void PrintPotentialSavingsPerClient(sqlite3 *db);
 
+/**
+ * @brief Writes the report of PrintPotentialSavingsPerClient to a stream instead of the console.
+ * @param db Pointer to the SQLite database connection.
+ * @param out Stream the report is written to.
+ * @returns SQLITE_OK on success or sqlite3 error code, the report may be cut short on error.
+ */
+int PrintPotentialSavingsPerClientTo(sqlite3 *db, FILE *out);
+
 /**
  * @brief Finds and prints the cheapest shop per client to the console.
+ * Shares the cached client cost summaries with PrintPotentialSavingsPerClient.
  * @param db Pointer to the SQLite database connection.
  */
 void FindCheapestShopPerClient(sqlite3 *db);
 
+/**
+ * @brief Writes the report of FindCheapestShopPerClient to a stream instead of the console.
+ * @param db Pointer to the SQLite database connection.
+ * @param out Stream the report is written to.
+ * @returns SQLITE_OK on success or sqlite3 error code, the report may be cut short on error.
+ */
+int FindCheapestShopPerClientTo(sqlite3 *db, FILE *out);
+
+/**
+ * @brief Writes the lines of the cheapest shop report for the clients with ids in [firstClientId, lastClientId],
+ * without the title. Consecutive ranges written one after another give the body of FindCheapestShopPerClientTo.
+ * @param db Pointer to the SQLite database connection.
+ * @param firstClientId First client id of the range.
+ * @param lastClientId Last client id of the range, included.
+ * @param matrix Price matrix shared by the ranges (see SharedPriceMatrixCreate), or NULL.
+ * @param set Scratch set for the summaries of the range (see ComputeClientCostRange), may be reused between calls.
+ * @param out Stream the lines are written to.
+ * @returns SQLITE_OK on success or sqlite3 error code.
+ */
+int FindCheapestShopRangeTo(sqlite3 *db, int firstClientId, int lastClientId, const PriceMatrix *matrix,
+                            ClientCostSet *set, FILE *out);
+
 /**
  * @brief Modifies an existing order in the database.
  * @param db Pointer to the SQLite database connection.
@@ -88,4 +262,26 @@ int ModifyOrder(sqlite3 *db, Order *order);
  */
 int DeleteOrder(sqlite3 *db, int orderId);
 
+/**
+ * @brief Recomputes client_shop_cost from orders and offers in one transaction, creating the table and its
+ * triggers first if they do not exist. The triggers keep the table exact, this is for repairing it
+ * (e.g. after bulk loads with triggers off).
+ * @param db Pointer to the SQLite database connection, must not be inside a transaction.
+ * @returns SQLITE_OK on success or sqlite3 error code.
+ */
+int RebuildClientShopCost(sqlite3 *db);
+
+/**
+ * @brief Makes sure client_shop_cost exists and is maintained, for the sql analytics engine.
+ *
+ * The table and its triggers on orders and offers are created and filled on first use only, so databases
+ * that only ever use the matrix engine pay nothing per order write. Once created they stay, every
+ * connection keeps them up to date.
+ *
+ * @param db Pointer to a registered SQLite database connection.
+ * @returns SQLITE_OK if the table is maintained, SQLITE_READONLY if it is not and the connection is read-only
+ * or inside a transaction, or sqlite3 error code.
+ */
+int EnableClientShopCost(sqlite3 *db);
+
 #endif // ORDERS_H
\ No newline at end of file
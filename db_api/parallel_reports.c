@@ -0,0 +1,428 @@
+#include <sqlite3.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+#include "parallel_reports.h"
+#include "orders.h"
+#include "analytics.h"
+#include "work_pool.h"
+#include "stmt_cache.h"
+
+#define REPORT_COUNT 5
+
+// Chunks per reader of a split report, enough for stealing to even out clients with many orders
+#define CHUNKS_PER_READER 8
+
+typedef int (*ReportFn)(sqlite3 *db, FILE *out);
+
+// Reports in menu order, the output keeps this order whichever thread finishes first
+static const ReportFn reports[REPORT_COUNT] = {
+    PrintOrdersGroupedByClientTo,
+    PrintAllOrdersByClientOrderCountTo,
+    PrintCheapestOffersForAllClientOrdersTo,
+    FindCheapestShopPerClientTo,
+    PrintPotentialSavingsPerClientTo,
+};
+
+// Reports handed to a worker at a time: the last two share the per-client cost summaries
+// of the connection, running them on the same reader computes the summaries once
+static const int tasks[][REPORT_COUNT + 1] = {
+    {0, -1},
+    {1, -1},
+    {2, -1},
+    {3, 4, -1},
+};
+#define TASK_COUNT ((int)(sizeof(tasks) / sizeof(tasks[0])))
+
+typedef struct {
+    char *text;
+    size_t length;
+    double seconds;
+} ReportOutput;
+
+typedef struct {
+    ConnectionPool *pool;
+    pthread_mutex_t lock; // guards nextTask
+    int nextTask;
+    ReportOutput outputs[REPORT_COUNT];
+} ReportRun;
+
+typedef struct {
+    ReportRun *run;
+    int reader;
+    int result;
+} ReportWorker;
+
+static double NowSeconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int TakeTask(ReportRun *run)
+{
+    pthread_mutex_lock(&run->lock);
+    int task = run->nextTask < TASK_COUNT ? run->nextTask++ : -1;
+    pthread_mutex_unlock(&run->lock);
+    return task;
+}
+
+static int RunReport(sqlite3 *db, int report, ReportOutput *output)
+{
+    FILE *buffer = open_memstream(&output->text, &output->length);
+    if (buffer == NULL)
+    {
+        fprintf(stderr, "Could not open output buffer for report %d.\n", report + 1);
+        return SQLITE_NOMEM;
+    }
+    double start = NowSeconds();
+    int rs = reports[report](db, buffer);
+    output->seconds = NowSeconds() - start;
+    fclose(buffer);
+    if (rs != SQLITE_OK)
+    {
+        fprintf(stderr, "Report %d failed: %s\n", report + 1, sqlite3_errstr(rs));
+    }
+    return rs;
+}
+
+static void *WorkerMain(void *pWorker)
+{
+    ReportWorker *worker = pWorker;
+    ReportRun *run = worker->run;
+    // The reader stays bound to this thread for the whole run
+    sqlite3 *db = PoolAcquireReader(run->pool, worker->reader);
+    if (db == NULL)
+    {
+        worker->result = SQLITE_MISUSE;
+        return NULL;
+    }
+    int task;
+    while (worker->result == SQLITE_OK && (task = TakeTask(run)) >= 0)
+    {
+        for (const int *report = tasks[task]; *report >= 0 && worker->result == SQLITE_OK; report++)
+        {
+            worker->result = RunReport(db, *report, &run->outputs[*report]);
+        }
+    }
+    PoolRelease(run->pool, db);
+    return NULL;
+}
+
+// Readers cannot create client_shop_cost, the writer does it before their snapshot if the engine needs it
+static int PrepareReaders(ConnectionPool *pool)
+{
+    sqlite3 *db = PoolAcquireWriter(pool);
+    int rs = db != NULL ? PrepareClientCostReaders(db) : SQLITE_MISUSE;
+    PoolRelease(pool, db);
+    return rs;
+}
+
+int RunAllReports(ConnectionPool *pool, FILE *out)
+{
+    ReportRun run = {.pool = pool};
+    pthread_mutex_init(&run.lock, NULL);
+    double start = NowSeconds();
+
+    int rs = PrepareReaders(pool);
+    if (rs == SQLITE_OK)
+    {
+        rs = PoolBeginSnapshot(pool);
+    }
+    if (rs != SQLITE_OK)
+    {
+        pthread_mutex_destroy(&run.lock);
+        return rs;
+    }
+
+    int workerCount = PoolReaderCount(pool) < TASK_COUNT ? PoolReaderCount(pool) : TASK_COUNT;
+    ReportWorker workers[POOL_MAX_READERS];
+    pthread_t threads[POOL_MAX_READERS];
+    int started = 0;
+    for (; started < workerCount; started++)
+    {
+        workers[started] = (ReportWorker){.run = &run, .reader = started, .result = SQLITE_OK};
+        if (pthread_create(&threads[started], NULL, WorkerMain, &workers[started]) != 0)
+        {
+            fprintf(stderr, "Could not start report worker %d.\n", started);
+            break;
+        }
+    }
+    // With at least one worker running the remaining tasks still get done
+    if (started == 0)
+    {
+        rs = SQLITE_ERROR;
+    }
+    for (int i = 0; i < started; i++)
+    {
+        pthread_join(threads[i], NULL);
+        if (workers[i].result != SQLITE_OK && rs == SQLITE_OK)
+        {
+            rs = workers[i].result;
+        }
+    }
+    int endRs = PoolEndSnapshot(pool);
+    rs = rs == SQLITE_OK ? endRs : rs;
+
+    for (int i = 0; i < REPORT_COUNT; i++)
+    {
+        if (run.outputs[i].text != NULL)
+        {
+            fwrite(run.outputs[i].text, 1, run.outputs[i].length, out);
+            free(run.outputs[i].text);
+        }
+    }
+    fflush(out);
+
+    fprintf(stderr, "Ran %d reports on %d readers in %.1f ms (", REPORT_COUNT, started, (NowSeconds() - start) * 1e3);
+    for (int i = 0; i < REPORT_COUNT; i++)
+    {
+        fprintf(stderr, "%s%.1f", i == 0 ? "" : ", ", run.outputs[i].seconds * 1e3);
+    }
+    fprintf(stderr, " ms each)\n");
+
+    pthread_mutex_destroy(&run.lock);
+    return rs;
+}
+
+// Output of one chunk of a split report
+typedef struct {
+    char *text;
+    size_t length;
+    int rows;
+} ChunkOutput;
+
+// Chunk i covers client ids [bounds[i], bounds[i + 1]) or the clients of ranges[i] in name order
+typedef struct {
+    int *bounds;
+    ClientNameRange *ranges;
+    const PriceMatrix *matrix; // shared by the chunks of the cheapest shop report, NULL if not used
+    ChunkOutput *outputs;
+    int chunkCount;
+} SplitReport;
+
+// Divides the keys first..last into chunks of about equal size
+static void InitSplit(SplitReport *split, int first, int last, int readers)
+{
+    split->ranges = NULL;
+    split->matrix = NULL;
+    long keys = (long)last - first + 1;
+    split->chunkCount = (int)(keys < (long)readers * CHUNKS_PER_READER ? keys : (long)readers * CHUNKS_PER_READER);
+    if (split->chunkCount < 1)
+    {
+        split->chunkCount = 1;
+    }
+    split->bounds = malloc(((size_t)split->chunkCount + 1) * sizeof(int));
+    split->outputs = calloc((size_t)split->chunkCount, sizeof(ChunkOutput));
+    if (split->bounds == NULL || split->outputs == NULL)
+    {
+        fprintf(stderr, "Memory allocation failed for report chunks.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i <= split->chunkCount; i++)
+    {
+        split->bounds[i] = (int)(first + keys * i / split->chunkCount);
+    }
+}
+
+// Writes the chunks in key order and frees the split
+static void FinishSplit(SplitReport *split, FILE *out)
+{
+    for (int i = 0; i < split->chunkCount; i++)
+    {
+        if (out != NULL && split->outputs[i].text != NULL)
+        {
+            fwrite(split->outputs[i].text, 1, split->outputs[i].length, out);
+        }
+        free(split->outputs[i].text);
+    }
+    free(split->outputs);
+    free(split->bounds);
+    FreeClientNameRanges(split->ranges, split->chunkCount);
+}
+
+static FILE *OpenChunk(ChunkOutput *output)
+{
+    free(output->text);
+    output->text = NULL;
+    FILE *buffer = open_memstream(&output->text, &output->length);
+    if (buffer == NULL)
+    {
+        fprintf(stderr, "Could not open output buffer for a report chunk.\n");
+    }
+    return buffer;
+}
+
+static int RunCheapestOffersChunk(sqlite3 *db, int chunk, void *ctx)
+{
+    SplitReport *split = ctx;
+    ChunkOutput *output = &split->outputs[chunk];
+    FILE *buffer = OpenChunk(output);
+    if (buffer == NULL)
+    {
+        return SQLITE_NOMEM;
+    }
+    // Every chunk but the first assumes rows before it, see the fix up in PrintCheapestOffersParallel
+    int rs = PrintCheapestOffersRangeTo(db, &split->ranges[chunk], chunk > 0, buffer, &output->rows);
+    fclose(buffer);
+    return rs == SQLITE_DONE ? SQLITE_OK : rs;
+}
+
+static void PrintChunkStats(const char *report, const SplitReport *split, const ChunkStats *stats)
+{
+    fprintf(stderr, "%s: %d chunks on %d readers, %d stolen, %.1f ms\n", report, split->chunkCount, stats->workers,
+            stats->stolen, stats->seconds * 1e3);
+}
+
+int PrintCheapestOffersParallel(ConnectionPool *pool, FILE *out)
+{
+    int rs = PoolBeginSnapshot(pool);
+    if (rs != SQLITE_OK)
+    {
+        return rs;
+    }
+    // The main thread uses the first reader between the parallel parts, no worker holds it then.
+    // The chunk boundaries are found in one pass over the name index, every chunk then seeks to its own.
+    SplitReport split = {0};
+    sqlite3 *db = PoolAcquireReader(pool, 0);
+    rs = db != NULL ? SplitClientsByName(db, PoolReaderCount(pool) * CHUNKS_PER_READER, &split.ranges,
+                                         &split.chunkCount)
+                    : SQLITE_MISUSE;
+    PoolRelease(pool, db);
+    if (rs != SQLITE_OK)
+    {
+        PoolEndSnapshot(pool);
+        return rs;
+    }
+    split.outputs = calloc((size_t)split.chunkCount, sizeof(ChunkOutput));
+    if (split.outputs == NULL)
+    {
+        fprintf(stderr, "Memory allocation failed for report chunks.\n");
+        exit(EXIT_FAILURE);
+    }
+    ChunkStats stats;
+    rs = RunChunks(pool, split.chunkCount, RunCheapestOffersChunk, &split, &stats);
+
+    // The first chunk with rows was written as a continuation unless it is chunk 0, redo it as the start
+    int first = 0;
+    while (rs == SQLITE_OK && first < split.chunkCount && split.outputs[first].rows == 0)
+    {
+        first++;
+    }
+    if (rs == SQLITE_OK && first > 0 && first < split.chunkCount)
+    {
+        db = PoolAcquireReader(pool, 0);
+        FILE *buffer = db != NULL ? OpenChunk(&split.outputs[first]) : NULL;
+        rs = buffer != NULL ? PrintCheapestOffersRangeTo(db, &split.ranges[first], 0, buffer,
+                                                         &split.outputs[first].rows)
+                            : SQLITE_NOMEM;
+        rs = rs == SQLITE_DONE ? SQLITE_OK : rs;
+        if (buffer != NULL)
+        {
+            fclose(buffer);
+        }
+        PoolRelease(pool, db);
+    }
+    int endRs = PoolEndSnapshot(pool);
+    rs = rs == SQLITE_OK ? endRs : rs;
+
+    if (rs == SQLITE_OK)
+    {
+        fprintf(out, "\n=== Cheapest Offers for All Orders ===\n");
+    }
+    FinishSplit(&split, rs == SQLITE_OK ? out : NULL);
+    fflush(out);
+    PrintChunkStats("Cheapest offers", &split, &stats);
+    return rs;
+}
+
+static int RunCheapestShopChunk(sqlite3 *db, int chunk, void *ctx)
+{
+    SplitReport *split = ctx;
+    ChunkOutput *output = &split->outputs[chunk];
+    FILE *buffer = OpenChunk(output);
+    if (buffer == NULL)
+    {
+        return SQLITE_NOMEM;
+    }
+    ClientCostSet *set = ClientCostSetCreate();
+    int rs = FindCheapestShopRangeTo(db, split->bounds[chunk], split->bounds[chunk + 1] - 1, split->matrix, set,
+                                     buffer);
+    ClientCostSetDestroy(set);
+    fclose(buffer);
+    return rs;
+}
+
+// Reads the lowest and highest client id, first > last if there are no clients
+static int ClientIdBounds(sqlite3 *db, int *first, int *last)
+{
+    sqlite3_stmt *stmt;
+    int rs = PrepareCached(db, "SELECT MIN(id), MAX(id) FROM clients;", &stmt);
+    if (rs != SQLITE_OK)
+    {
+        fprintf(stderr, "Error preparing statement: %s\n", sqlite3_errmsg(db));
+        return rs;
+    }
+    if ((rs = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        int empty = sqlite3_column_type(stmt, 0) == SQLITE_NULL;
+        *first = empty ? 1 : sqlite3_column_int(stmt, 0);
+        *last = empty ? 0 : sqlite3_column_int(stmt, 1);
+        rs = SQLITE_OK;
+    }
+    else
+    {
+        fprintf(stderr, "Error executing statement: %s - %s\n", sqlite3_errstr(rs), sqlite3_errmsg(db));
+    }
+    ReleaseStatement(stmt);
+    return rs;
+}
+
+int FindCheapestShopParallel(ConnectionPool *pool, FILE *out)
+{
+    int rs = PrepareReaders(pool);
+    if (rs == SQLITE_OK)
+    {
+        rs = PoolBeginSnapshot(pool);
+    }
+    if (rs != SQLITE_OK)
+    {
+        return rs;
+    }
+    // The offers are loaded into one price matrix on the first reader, the chunks only read it
+    sqlite3 *db = PoolAcquireReader(pool, 0);
+    int first = 1;
+    int last = 0;
+    PriceMatrix *matrix = NULL;
+    rs = db != NULL ? ClientIdBounds(db, &first, &last) : SQLITE_MISUSE;
+    if (rs == SQLITE_OK)
+    {
+        rs = SharedPriceMatrixCreate(db, &matrix);
+    }
+    PoolRelease(pool, db);
+    if (rs != SQLITE_OK)
+    {
+        PoolEndSnapshot(pool);
+        return rs;
+    }
+
+    SplitReport split;
+    InitSplit(&split, first, last, PoolReaderCount(pool));
+    split.matrix = matrix;
+    ChunkStats stats;
+    rs = RunChunks(pool, split.chunkCount, RunCheapestShopChunk, &split, &stats);
+    SharedPriceMatrixDestroy(matrix);
+    int endRs = PoolEndSnapshot(pool);
+    rs = rs == SQLITE_OK ? endRs : rs;
+
+    if (rs == SQLITE_OK)
+    {
+        fprintf(out, "\n=== Cheapest Shop per Client ===\n");
+    }
+    FinishSplit(&split, rs == SQLITE_OK ? out : NULL);
+    fflush(out);
+    PrintChunkStats("Cheapest shop", &split, &stats);
+    return rs;
+}
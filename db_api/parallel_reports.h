@@ -0,0 +1,46 @@
+#ifndef PARALLEL_REPORTS_H
+#define PARALLEL_REPORTS_H
+
+#include <stdio.h>
+#include "pool.h"
+
+/**
+ * @brief Runs all five order reports concurrently, one worker thread per reader of the pool, all in one
+ * consistent snapshot of the database (see PoolBeginSnapshot).
+ *
+ * Every report writes to its own buffer, the buffers are written to the output in menu order
+ * (grouped, by order count, cheapest offers, cheapest shop, savings), so the output is the same
+ * as running the reports one after the other. Timings go to stderr. If the analytics engine computes
+ * with SQL the writer creates client_shop_cost first (see PrepareClientCostReaders).
+ *
+ * @param pool Pointer to the connection pool, no connection of it may be held by another thread.
+ * @param out Stream to write the reports to.
+ * @returns SQLITE_OK, or sqlite3 error code if the snapshot or a worker could not be started or a report failed.
+ * The other reports are still written, the failed one may be missing or cut short.
+ */
+int RunAllReports(ConnectionPool *pool, FILE *out);
+
+/**
+ * @brief Prints the cheapest offers report (see PrintCheapestOffersForAllClientOrders) split into ranges of
+ * clients in name order (see SplitClientsByName), which the readers of the pool run in parallel (see RunChunks)
+ * in one snapshot.
+ * The ranges are merged in client name order, the output is the same as the serial report.
+ * @param pool Pointer to the connection pool, no connection of it may be held by another thread.
+ * @param out Stream to write the report to.
+ * @returns SQLITE_OK or sqlite3 error code, nothing is written on error.
+ */
+int PrintCheapestOffersParallel(ConnectionPool *pool, FILE *out);
+
+/**
+ * @brief Prints the cheapest shop report (see FindCheapestShopPerClient) split into client id ranges,
+ * which the readers of the pool compute in parallel (see RunChunks) in one snapshot. With the matrix engine
+ * the offers are loaded once into a price matrix all readers share (see SharedPriceMatrixCreate), with SQL
+ * the writer creates client_shop_cost first (see PrepareClientCostReaders).
+ * The ranges are merged in client id order, the output is the same as the serial report.
+ * @param pool Pointer to the connection pool, no connection of it may be held by another thread.
+ * @param out Stream to write the report to.
+ * @returns SQLITE_OK or sqlite3 error code, nothing is written on error.
+ */
+int FindCheapestShopParallel(ConnectionPool *pool, FILE *out);
+
+#endif // PARALLEL_REPORTS_H
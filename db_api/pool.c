@@ -0,0 +1,247 @@
+#include <sqlite3.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include "pool.h"
+#include "db.h"
+
+typedef struct {
+    sqlite3 *db;
+    pthread_t owner; // only meaningful while held
+    int held;
+} PooledConnection;
+
+struct ConnectionPool {
+    pthread_mutex_t lock; // guards the owner and held fields, not the connections
+    PooledConnection writer;
+    PooledConnection readers[POOL_MAX_READERS];
+    int readerCount;
+};
+
+// Switches the database to WAL mode, the mode is stored in the file so it is done once through the writer
+static int EnableWal(sqlite3 *db)
+{
+    sqlite3_stmt *stmt;
+    int rs = sqlite3_prepare_v2(db, "PRAGMA journal_mode=WAL;", -1, &stmt, NULL);
+    if (rs != SQLITE_OK)
+    {
+        fprintf(stderr, "Error preparing journal mode: %s\n", sqlite3_errmsg(db));
+        return rs;
+    }
+    rs = sqlite3_step(stmt);
+    if (rs == SQLITE_ROW)
+    {
+        const char *mode = (const char *)sqlite3_column_text(stmt, 0);
+        rs = mode != NULL && strcmp(mode, "wal") == 0 ? SQLITE_OK : SQLITE_ERROR;
+        if (rs != SQLITE_OK)
+        {
+            fprintf(stderr, "Database refused WAL mode, it stayed in '%s' mode.\n", mode != NULL ? mode : "?");
+        }
+    }
+    else
+    {
+        fprintf(stderr, "Error setting journal mode: %s\n", sqlite3_errmsg(db));
+    }
+    sqlite3_finalize(stmt);
+    return rs;
+}
+
+int PoolOpen(const char *path, int readers, ConnectionPool **pPool)
+{
+    *pPool = NULL;
+    if (readers < 1 || readers > POOL_MAX_READERS)
+    {
+        fprintf(stderr, "Connection pool needs 1 to %d readers, got %d.\n", POOL_MAX_READERS, readers);
+        return SQLITE_MISUSE;
+    }
+    ConnectionPool *pool = calloc(1, sizeof(ConnectionPool));
+    if (pool == NULL)
+    {
+        fprintf(stderr, "Memory allocation failed for connection pool.\n");
+        exit(EXIT_FAILURE);
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+
+    // Every connection is used by one thread at a time, SQLite's own mutexes would only add overhead
+    db_open_v2(&pool->writer.db, path, SQLITE_OPEN_READWRITE | SQLITE_OPEN_NOMUTEX);
+    int rs = EnableWal(pool->writer.db);
+    if (rs != SQLITE_OK)
+    {
+        PoolClose(pool);
+        return rs;
+    }
+    for (int i = 0; i < readers; i++)
+    {
+        db_open_v2(&pool->readers[i].db, path, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX);
+        pool->readerCount++;
+    }
+    *pPool = pool;
+    return SQLITE_OK;
+}
+
+void PoolClose(ConnectionPool *pool)
+{
+    if (pool == NULL)
+    {
+        return;
+    }
+    for (int i = 0; i < pool->readerCount; i++)
+    {
+        db_close(pool->readers[i].db);
+    }
+    if (pool->writer.db != NULL)
+    {
+        db_close(pool->writer.db);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    free(pool);
+}
+
+int PoolReaderCount(const ConnectionPool *pool)
+{
+    return pool->readerCount;
+}
+
+static sqlite3 *Acquire(ConnectionPool *pool, PooledConnection *conn)
+{
+    pthread_t self = pthread_self();
+    pthread_mutex_lock(&pool->lock);
+    sqlite3 *db = NULL;
+    if (!conn->held || pthread_equal(conn->owner, self))
+    {
+        conn->owner = self;
+        conn->held = 1;
+        db = conn->db;
+    }
+    pthread_mutex_unlock(&pool->lock);
+    if (db == NULL)
+    {
+        fprintf(stderr, "Pooled connection is bound to another thread.\n");
+    }
+    return db;
+}
+
+sqlite3 *PoolAcquireReader(ConnectionPool *pool, int index)
+{
+    if (index < 0 || index >= pool->readerCount)
+    {
+        fprintf(stderr, "No reader %d in the connection pool.\n", index);
+        return NULL;
+    }
+    return Acquire(pool, &pool->readers[index]);
+}
+
+sqlite3 *PoolAcquireWriter(ConnectionPool *pool)
+{
+    return Acquire(pool, &pool->writer);
+}
+
+void PoolRelease(ConnectionPool *pool, sqlite3 *db)
+{
+    PooledConnection *conn = pool->writer.db == db ? &pool->writer : NULL;
+    for (int i = 0; conn == NULL && i < pool->readerCount; i++)
+    {
+        if (pool->readers[i].db == db)
+        {
+            conn = &pool->readers[i];
+        }
+    }
+    if (conn == NULL)
+    {
+        return; // Not from this pool
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    if (conn->held && pthread_equal(conn->owner, pthread_self()))
+    {
+        conn->held = 0;
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+// Starts a read transaction, BEGIN alone is deferred so a read is needed to pin the snapshot
+static int BeginRead(sqlite3 *db)
+{
+    int rs = sqlite3_exec(db, "BEGIN; SELECT count(*) FROM sqlite_schema;", NULL, NULL, NULL);
+    if (rs != SQLITE_OK)
+    {
+        fprintf(stderr, "Error starting read transaction: %s\n", sqlite3_errmsg(db));
+        if (sqlite3_get_autocommit(db) == 0)
+        {
+            sqlite3_exec(db, "ROLLBACK;", NULL, NULL, NULL);
+        }
+    }
+    return rs;
+}
+
+int PoolBeginSnapshot(ConnectionPool *pool)
+{
+    sqlite3 *writer = PoolAcquireWriter(pool);
+    if (writer == NULL)
+    {
+        return SQLITE_MISUSE;
+    }
+    // Holding the write lock keeps every commit out until all readers have started
+    int rs = sqlite3_exec(writer, "BEGIN IMMEDIATE;", NULL, NULL, NULL);
+    if (rs != SQLITE_OK)
+    {
+        fprintf(stderr, "Error locking database for a snapshot: %s\n", sqlite3_errmsg(writer));
+        PoolRelease(pool, writer);
+        return rs;
+    }
+
+    int started = 0;
+    for (; started < pool->readerCount; started++)
+    {
+        sqlite3 *reader = PoolAcquireReader(pool, started);
+        rs = reader != NULL ? BeginRead(reader) : SQLITE_MISUSE;
+        PoolRelease(pool, reader);
+        if (rs != SQLITE_OK)
+        {
+            break;
+        }
+    }
+    sqlite3_exec(writer, "ROLLBACK;", NULL, NULL, NULL);
+    PoolRelease(pool, writer);
+
+    if (rs != SQLITE_OK)
+    {
+        // Readers that already started must not keep the old snapshot around
+        for (int i = 0; i < started; i++)
+        {
+            sqlite3 *reader = PoolAcquireReader(pool, i);
+            if (reader != NULL)
+            {
+                sqlite3_exec(reader, "ROLLBACK;", NULL, NULL, NULL);
+                PoolRelease(pool, reader);
+            }
+        }
+    }
+    return rs;
+}
+
+int PoolEndSnapshot(ConnectionPool *pool)
+{
+    int result = SQLITE_OK;
+    for (int i = 0; i < pool->readerCount; i++)
+    {
+        sqlite3 *reader = PoolAcquireReader(pool, i);
+        if (reader == NULL)
+        {
+            result = result == SQLITE_OK ? SQLITE_MISUSE : result;
+            continue;
+        }
+        if (sqlite3_get_autocommit(reader) == 0)
+        {
+            int rs = sqlite3_exec(reader, "COMMIT;", NULL, NULL, NULL);
+            if (rs != SQLITE_OK)
+            {
+                fprintf(stderr, "Error ending read transaction: %s\n", sqlite3_errmsg(reader));
+                result = result == SQLITE_OK ? rs : result;
+            }
+        }
+        PoolRelease(pool, reader);
+    }
+    return result;
+}
@@ -0,0 +1,82 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <sqlite3.h>
+
+typedef struct ConnectionPool ConnectionPool;
+
+// Upper bound on reader connections per pool
+#define POOL_MAX_READERS 16
+
+/**
+ * @brief Opens one read/write and a number of read-only connections to the same database in WAL mode,
+ * so the readers never block the writer or each other.
+ *
+ * Connections are opened with SQLITE_OPEN_NOMUTEX and each is bound to at most one thread at a time:
+ * a thread acquires a connection before using it and releases it to hand it over (see PoolAcquireReader).
+ * The database is switched to WAL mode permanently, the journal mode of the config is not used.
+ * Exits the program if a connection cannot be opened, like db_open.
+ *
+ * @param path Path to the database file, NULL for the configured path.
+ * @param readers Number of read-only connections, 1 to POOL_MAX_READERS.
+ * @param pPool Pointer where the pool is stored, close it with PoolClose.
+ * @returns SQLITE_OK, SQLITE_MISUSE for an invalid reader count, or sqlite3 error code if WAL mode could not be set.
+ */
+int PoolOpen(const char *path, int readers, ConnectionPool **pPool);
+
+/**
+ * @brief Closes all connections of the pool. No connection may be acquired by another thread.
+ * @param pool Pointer to the pool, may be NULL.
+ */
+void PoolClose(ConnectionPool *pool);
+
+/**
+ * @brief Tells how many read-only connections the pool has.
+ * @param pool Pointer to the pool.
+ * @returns The number of readers.
+ */
+int PoolReaderCount(const ConnectionPool *pool);
+
+/**
+ * @brief Binds a read-only connection to the calling thread until it is released.
+ * @param pool Pointer to the pool.
+ * @param index Index of the reader, 0 to PoolReaderCount - 1.
+ * @returns The connection, or NULL if the index is invalid or another thread holds the connection.
+ */
+sqlite3 *PoolAcquireReader(ConnectionPool *pool, int index);
+
+/**
+ * @brief Binds the read/write connection to the calling thread until it is released.
+ * @param pool Pointer to the pool.
+ * @returns The connection, or NULL if another thread holds it.
+ */
+sqlite3 *PoolAcquireWriter(ConnectionPool *pool);
+
+/**
+ * @brief Unbinds a connection from the calling thread, another thread may acquire it afterwards.
+ * @param pool Pointer to the pool.
+ * @param db Connection returned by PoolAcquireReader or PoolAcquireWriter.
+ */
+void PoolRelease(ConnectionPool *pool, sqlite3 *db);
+
+/**
+ * @brief Starts a read transaction on every reader, all at the same snapshot of the database.
+ *
+ * The writer holds the write lock (BEGIN IMMEDIATE) while the readers start, so no commit, from this process
+ * or another one, can land between them. The readers keep seeing that snapshot until PoolEndSnapshot, whichever
+ * thread uses them meanwhile. Must be called while no connection of the pool is held by another thread.
+ *
+ * @param pool Pointer to the pool.
+ * @returns SQLITE_OK or sqlite3 error code (e.g. SQLITE_BUSY if another writer did not finish within busy_timeout).
+ */
+int PoolBeginSnapshot(ConnectionPool *pool);
+
+/**
+ * @brief Ends the read transactions started by PoolBeginSnapshot. Must be called while no connection
+ * of the pool is held by another thread.
+ * @param pool Pointer to the pool.
+ * @returns SQLITE_OK or sqlite3 error code of the first reader that failed.
+ */
+int PoolEndSnapshot(ConnectionPool *pool);
+
+#endif // POOL_H
@@ -0,0 +1,271 @@
+#include <sqlite3.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "price_matrix.h"
+#include "stmt_cache.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_KERNELS 1
+#endif
+
+static void AccumulateScalar(const double *row, double amount, double *cost, double *priced, int stride)
+{
+    for (int s = 0; s < stride; s++)
+    {
+        if (!isnan(row[s]))
+        {
+            cost[s] += row[s] * amount;
+            priced[s] += 1.0;
+        }
+    }
+}
+
+#ifdef HAVE_X86_KERNELS
+// The ordered compare is all ones for carried prices, masking the product keeps NaN out of the sums
+
+__attribute__((target("sse2"))) static void AccumulateSse2(const double *row, double amount, double *cost,
+                                                           double *priced, int stride)
+{
+    __m128d amounts = _mm_set1_pd(amount);
+    __m128d ones = _mm_set1_pd(1.0);
+    for (int s = 0; s < stride; s += 2)
+    {
+        __m128d prices = _mm_loadu_pd(row + s);
+        __m128d carried = _mm_cmpord_pd(prices, prices);
+        __m128d add = _mm_and_pd(carried, _mm_mul_pd(prices, amounts));
+        _mm_storeu_pd(cost + s, _mm_add_pd(_mm_loadu_pd(cost + s), add));
+        _mm_storeu_pd(priced + s, _mm_add_pd(_mm_loadu_pd(priced + s), _mm_and_pd(carried, ones)));
+    }
+}
+
+__attribute__((target("avx2"))) static void AccumulateAvx2(const double *row, double amount, double *cost,
+                                                           double *priced, int stride)
+{
+    __m256d amounts = _mm256_set1_pd(amount);
+    __m256d ones = _mm256_set1_pd(1.0);
+    for (int s = 0; s < stride; s += 4)
+    {
+        __m256d prices = _mm256_loadu_pd(row + s);
+        __m256d carried = _mm256_cmp_pd(prices, prices, _CMP_ORD_Q);
+        __m256d add = _mm256_and_pd(carried, _mm256_mul_pd(prices, amounts));
+        _mm256_storeu_pd(cost + s, _mm256_add_pd(_mm256_loadu_pd(cost + s), add));
+        _mm256_storeu_pd(priced + s, _mm256_add_pd(_mm256_loadu_pd(priced + s), _mm256_and_pd(carried, ones)));
+    }
+}
+#endif
+
+static void SelectKernel(PriceMatrix *matrix)
+{
+    matrix->accumulate = AccumulateScalar;
+    matrix->kernelName = "scalar";
+#ifdef HAVE_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        matrix->accumulate = AccumulateAvx2;
+        matrix->kernelName = "avx2";
+    }
+    else if (__builtin_cpu_supports("sse2"))
+    {
+        matrix->accumulate = AccumulateSse2;
+        matrix->kernelName = "sse2";
+    }
+#endif
+}
+
+static void *Grow(void *p, size_t *allocated, size_t needed, size_t elementSize)
+{
+    if (needed <= *allocated)
+    {
+        return p;
+    }
+    size_t size = *allocated ? *allocated : 1024;
+    while (size < needed)
+    {
+        size *= 2;
+    }
+    void *grown = realloc(p, size * elementSize);
+    if (grown == NULL)
+    {
+        fprintf(stderr, "Memory allocation failed for price matrix.\n");
+        exit(EXIT_FAILURE);
+    }
+    *allocated = size;
+    return grown;
+}
+
+static int FindColumn(const PriceMatrix *matrix, int shopId)
+{
+    int lo = 0;
+    int hi = matrix->shopCount;
+    while (lo < hi)
+    {
+        int mid = lo + (hi - lo) / 2;
+        if (matrix->shopIds[mid] < shopId)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    return lo < matrix->shopCount && matrix->shopIds[lo] == shopId ? lo : -1;
+}
+
+static int LoadShopColumns(sqlite3 *db, PriceMatrix *matrix)
+{
+    sqlite3_stmt *stmt;
+    int rs;
+    if ((rs = PrepareCached(db, "SELECT id FROM shops ORDER BY id;", &stmt)) != SQLITE_OK)
+    {
+        fprintf(stderr, "Error preparing statement: %s\n", sqlite3_errmsg(db));
+        return rs;
+    }
+    size_t allocated = 0;
+    while ((rs = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        matrix->shopIds = Grow(matrix->shopIds, &allocated, (size_t)matrix->shopCount + 1, sizeof(int));
+        matrix->shopIds[matrix->shopCount++] = sqlite3_column_int(stmt, 0);
+    }
+    ReleaseStatement(stmt);
+    if (rs != SQLITE_DONE)
+    {
+        fprintf(stderr, "Error executing statement: %s - %s\n", sqlite3_errstr(rs), sqlite3_errmsg(db));
+        return rs;
+    }
+    matrix->stride = (matrix->shopCount + PRICE_MATRIX_LANES - 1) / PRICE_MATRIX_LANES * PRICE_MATRIX_LANES;
+    return SQLITE_OK;
+}
+
+int PriceMatrixBuild(sqlite3 *db, size_t maxBytes, PriceMatrix *matrix)
+{
+    memset(matrix, 0, sizeof(PriceMatrix));
+    SelectKernel(matrix);
+
+    int rs;
+    if ((rs = LoadShopColumns(db, matrix)) != SQLITE_OK)
+    {
+        return rs;
+    }
+    size_t rowBytes = (size_t)matrix->stride * sizeof(double);
+
+    // idx_offers_product_price delivers the offers grouped by product without a sort
+    sqlite3_stmt *stmt;
+    if ((rs = PrepareCached(db,
+                            "SELECT product_id, shop_id, price FROM offers "
+                            "WHERE product_id IS NOT NULL AND shop_id IS NOT NULL ORDER BY product_id;",
+                            &stmt)) != SQLITE_OK)
+    {
+        fprintf(stderr, "Error preparing statement: %s\n", sqlite3_errmsg(db));
+        return rs;
+    }
+
+    size_t rowsAllocated = 0;
+    size_t idsAllocated = 0;
+    double *row = NULL;
+    while ((rs = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        int column = FindColumn(matrix, sqlite3_column_int(stmt, 1));
+        if (column < 0)
+        {
+            continue; // Offer of a deleted shop
+        }
+        int productId = sqlite3_column_int(stmt, 0);
+        if (matrix->productCount == 0 || matrix->productIds[matrix->productCount - 1] != productId)
+        {
+            if ((size_t)(matrix->productCount + 1) * rowBytes > maxBytes)
+            {
+                rs = SQLITE_TOOBIG;
+                break;
+            }
+            matrix->productIds = Grow(matrix->productIds, &idsAllocated, (size_t)matrix->productCount + 1, sizeof(int));
+            matrix->prices = Grow(matrix->prices, &rowsAllocated, ((size_t)matrix->productCount + 1) * matrix->stride,
+                                  sizeof(double));
+            matrix->productIds[matrix->productCount] = productId;
+            row = matrix->prices + (size_t)matrix->productCount * matrix->stride;
+            for (int s = 0; s < matrix->stride; s++)
+            {
+                row[s] = NAN;
+            }
+            matrix->productCount++;
+        }
+        // A NULL price is carried at 0 like in client_shop_cost, duplicate offers of a shop add up like the
+        // (order, offer) pairs summed there, so an order costs amount times the sum of the shop's offers
+        double price = sqlite3_column_double(stmt, 2);
+        row[column] = isnan(row[column]) ? price : row[column] + price;
+    }
+    ReleaseStatement(stmt);
+    if (rs != SQLITE_DONE)
+    {
+        if (rs != SQLITE_TOOBIG)
+        {
+            fprintf(stderr, "Error executing statement: %s - %s\n", sqlite3_errstr(rs), sqlite3_errmsg(db));
+        }
+        return rs;
+    }
+    return SQLITE_OK;
+}
+
+int PriceMatrixBytes(sqlite3 *db, size_t *bytes)
+{
+    *bytes = 0;
+    sqlite3_stmt *stmt;
+    int rs;
+    // Same rows and columns as PriceMatrixBuild, counted on idx_offers_product_price and the shops table
+    if ((rs = PrepareCached(db,
+                            "SELECT (SELECT COUNT(*) FROM shops), (SELECT COUNT(DISTINCT product_id) FROM offers "
+                            "WHERE product_id IS NOT NULL AND shop_id IN (SELECT id FROM shops));",
+                            &stmt)) != SQLITE_OK)
+    {
+        fprintf(stderr, "Error preparing statement: %s\n", sqlite3_errmsg(db));
+        return rs;
+    }
+    if ((rs = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        size_t shopCount = (size_t)sqlite3_column_int64(stmt, 0);
+        size_t stride = (shopCount + PRICE_MATRIX_LANES - 1) / PRICE_MATRIX_LANES * PRICE_MATRIX_LANES;
+        *bytes = (size_t)sqlite3_column_int64(stmt, 1) * stride * sizeof(double);
+        rs = SQLITE_OK;
+    }
+    else
+    {
+        fprintf(stderr, "Error executing statement: %s - %s\n", sqlite3_errstr(rs), sqlite3_errmsg(db));
+    }
+    ReleaseStatement(stmt);
+    return rs;
+}
+
+void PriceMatrixFree(PriceMatrix *matrix)
+{
+    free(matrix->shopIds);
+    free(matrix->productIds);
+    free(matrix->prices);
+    memset(matrix, 0, sizeof(PriceMatrix));
+}
+
+const double *PriceMatrixRow(const PriceMatrix *matrix, int productId)
+{
+    int lo = 0;
+    int hi = matrix->productCount;
+    while (lo < hi)
+    {
+        int mid = lo + (hi - lo) / 2;
+        if (matrix->productIds[mid] < productId)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    if (lo < matrix->productCount && matrix->productIds[lo] == productId)
+    {
+        return matrix->prices + (size_t)lo * matrix->stride;
+    }
+    return NULL;
+}
@@ -0,0 +1,63 @@
+#ifndef PRICE_MATRIX_H
+#define PRICE_MATRIX_H
+
+#include <sqlite3.h>
+#include <stddef.h>
+
+// Shops per SIMD step of the widest kernel, rows are padded to a multiple of it
+#define PRICE_MATRIX_LANES 4
+
+/**
+ * @brief Adds amount * price of every shop carrying a product to the shop's basket cost.
+ * Shops without the product (NaN price) are left unchanged, priced counts how many items each shop priced.
+ */
+typedef void (*BasketKernel)(const double *row, double amount, double *cost, double *priced, int stride);
+
+// Dense price table, one row per product with offers, one column per shop
+typedef struct PriceMatrix {
+    int shopCount;
+    int stride;        // doubles per row, shopCount rounded up to PRICE_MATRIX_LANES
+    int *shopIds;      // column -> shop id, ascending
+    int productCount;
+    int *productIds;   // row -> product id, ascending
+    double *prices;    // productCount * stride, sum of the shop's offer prices, NaN where it has no offer
+    BasketKernel accumulate; // widest kernel the CPU supports
+    const char *kernelName;  // "avx2", "sse2" or "scalar"
+} PriceMatrix;
+
+/**
+ * @brief Loads all offers of existing shops into a dense matrix.
+ *
+ * Rows are stored product-major so one product's prices for all shops are contiguous, the kernel
+ * adds an order to every shop's basket with a few vector instructions.
+ *
+ * @param db Pointer to the SQLite database connection.
+ * @param maxBytes Upper bound on the size of the price table.
+ * @param matrix Pointer to the matrix to fill, freed with PriceMatrixFree also on failure.
+ * @returns SQLITE_OK on success, SQLITE_TOOBIG if the table would exceed maxBytes or sqlite3 error code.
+ */
+int PriceMatrixBuild(sqlite3 *db, size_t maxBytes, PriceMatrix *matrix);
+
+/**
+ * @brief Tells how big the price table of PriceMatrixBuild would be without loading the offers.
+ * @param db Pointer to the SQLite database connection.
+ * @param bytes Pointer where the size of the price table is stored.
+ * @returns SQLITE_OK on success or sqlite3 error code.
+ */
+int PriceMatrixBytes(sqlite3 *db, size_t *bytes);
+
+/**
+ * @brief Frees the arrays of a matrix and zeroes it.
+ * @param matrix Pointer to the matrix.
+ */
+void PriceMatrixFree(PriceMatrix *matrix);
+
+/**
+ * @brief Finds the price row of a product.
+ * @param matrix Pointer to the matrix.
+ * @param productId The ID of the product.
+ * @returns Pointer to stride prices, or NULL if no shop offers the product.
+ */
+const double *PriceMatrixRow(const PriceMatrix *matrix, int productId);
+
+#endif // PRICE_MATRIX_H
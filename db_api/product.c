@@ -5,82 +5,184 @@
 #include <string.h>
 #include "product.h"
 #include "db.h"
+#include "stmt_cache.h"
+#include "connection.h"
+#include "catalog.h"
+#include "entity_cache.h"
 #include "../main.h"
 
-void InitProductWrapper(GenericWrapper *wrapper)
+void FreeProduct(Product *product)
 {
-    wrapper->data = NULL;
-    wrapper->freeData = FreeProduct;
-    wrapper->getElementAt = GetProductAt;
-    wrapper->size = 0;
-    wrapper->used = 0;
-    wrapper->limit = 0;
+    if (product == NULL)
+    {
+        return; // Nothing to free
+    }
+    ShortStringFree(&product->name); // Free the name string if it did not fit inline
 }
 
-void FreeProduct(void *pProduct)
+void ReadProductRow(Product *product, sqlite3_stmt *stmt)
 {
-    Product *product = (Product *)pProduct;
-    if (product == NULL)
+    product->id = sqlite3_column_int(stmt, 0);
+    ShortStringSetRef(&product->name, ColumnTextRef(stmt, 1));
+}
+
+void RetainProductRow(const ProductRow *row, ProductVector *products)
+{
+    Product *product = ProductVectorPush(products);
+    product->id = row->id;
+    ShortStringSetRef(&product->name, row->name);
+}
+
+// Search statements, all bind ?1 = exact id, ?2 = search term, ?3 = row limit.
+// The FTS subqueries keep the limit + 1 best matches by bm25 over the whole match set (the extra row covers
+// the exact id also matching the term), the top-N sort is cheaper than joining every match to products.
+// Substring search over the trigram index, same matches as LIKE '%term%' but needs at least 3 characters
+static const char *trigramSearchSql =
+    "SELECT id, name, -1e300 AS score FROM products WHERE id = ?1"
+    " UNION ALL"
+    " SELECT p.id, p.name, f.score FROM"
+    " (SELECT rowid, bm25(products_fts) AS score FROM products_fts WHERE products_fts MATCH ?2"
+    " ORDER BY score LIMIT ?3 + 1) AS f"
+    " JOIN products AS p ON p.id = f.rowid WHERE p.id <> ?1"
+    " ORDER BY 3 LIMIT ?3;";
+// Shorter terms match the start of a word through the prefix index
+static const char *prefixSearchSql =
+    "SELECT id, name, -1e300 AS score FROM products WHERE id = ?1"
+    " UNION ALL"
+    " SELECT p.id, p.name, f.score FROM"
+    " (SELECT rowid, bm25(products_prefix) AS score FROM products_prefix WHERE products_prefix MATCH ?2"
+    " ORDER BY score LIMIT ?3 + 1) AS f"
+    " JOIN products AS p ON p.id = f.rowid WHERE p.id <> ?1"
+    " ORDER BY 3 LIMIT ?3;";
+// Empty terms and databases without the FTS5 tables
+static const char *likeSearchSql =
+    "SELECT id, name FROM products WHERE id = ?1 OR name LIKE '%' || ?2 || '%' LIMIT ?3;";
+
+static size_t Utf8Length(const char *s)
+{
+    size_t len = 0;
+    for (; *s != '\0'; s++)
     {
-        return; // Nothing to free
+        len += ((unsigned char)*s & 0xC0) != 0x80;
     }
-    FreeMemory((void **)&product->name); // Free the name string
+    return len;
 }
 
-void *GetProductAt(void *pWrapper, size_t index)
+/**
+ * @brief Prepares and binds the best available search statement for the product name.
+ *
+ * The term is passed to FTS5 as one quoted phrase, so operators in user input are not interpreted.
+ * Falls back to LIKE if the full-text tables do not exist (SQLite built without FTS5).
+ *
+ * @returns SQLITE_OK or sqlite3 error code of preparing the LIKE statement.
+ */
+static int PrepareProductSearch(sqlite3 *db, const Product *search, int limit, sqlite3_stmt **pStmt)
 {
-    GenericWrapper *wrapper = (GenericWrapper *)pWrapper;
-    if (index >= wrapper->used)
+    const char *term = ShortStringGet(&search->name) != NULL ? ShortStringGet(&search->name) : "";
+    size_t length = Utf8Length(term);
+    const char *sql = length >= 3 ? trigramSearchSql : length > 0 ? prefixSearchSql : likeSearchSql;
+
+    int rs = PrepareCached(db, sql, pStmt);
+    if (rs != SQLITE_OK && sql != likeSearchSql)
+    {
+        sql = likeSearchSql;
+        rs = PrepareCached(db, sql, pStmt);
+    }
+    if (rs != SQLITE_OK)
+    {
+        return rs;
+    }
+
+    sqlite3_bind_int(*pStmt, 1, search->id);
+    sqlite3_bind_int(*pStmt, 3, limit);
+    if (sql == likeSearchSql)
+    {
+        sqlite3_bind_text(*pStmt, 2, term, -1, SQLITE_STATIC);
+        return SQLITE_OK;
+    }
+
+    // "te""rm" for the trigram phrase, "te""rm"* for a word prefix
+    size_t quotes = 0;
+    for (const char *p = term; *p != '\0'; p++)
+    {
+        quotes += *p == '"';
+    }
+    size_t termLen = strlen(term);
+    char *query = malloc(termLen + quotes + 4);
+    if (query == NULL)
+    {
+        fprintf(stderr, "Memory allocation failed.\n");
+        ReleaseStatement(*pStmt);
+        exit(EXIT_FAILURE);
+    }
+    char *q = query;
+    *q++ = '"';
+    for (const char *p = term; *p != '\0'; p++)
+    {
+        if (*p == '"')
+        {
+            *q++ = '"';
+        }
+        *q++ = *p;
+    }
+    *q++ = '"';
+    if (sql == prefixSearchSql)
     {
-        return NULL; // Index out of bounds
+        *q++ = '*';
     }
-    Product *pProduct = (Product *)wrapper->data + index;
-    return (void *)pProduct;
+    *q = '\0';
+    sqlite3_bind_text(*pStmt, 2, query, -1, free);
+    return SQLITE_OK;
+}
+
+static Catalog *GetCatalog(sqlite3 *db)
+{
+    DbConnection *conn = GetConnection(db);
+    return conn != NULL ? conn->catalog : NULL;
 }
 
 int GetProduct(sqlite3 *db, Product *product)
 {
+    Catalog *catalog = GetCatalog(db);
+    if (catalog != NULL)
+    {
+        CatalogProduct *matches;
+        size_t count;
+        int rs = CatalogSearchProducts(catalog, product->id, ShortStringGet(&product->name), 1, &matches, &count);
+        if (rs == SQLITE_DONE && count > 0)
+        {
+            FreeProduct(product);
+            product->id = matches[0].id;
+            ShortStringSet(&product->name, matches[0].name);
+            rs = SQLITE_ROW;
+        }
+        free(matches);
+        return rs;
+    }
 
     sqlite3_stmt *stmt;
 
-    const char *sql = "SELECT id, name FROM products WHERE id = ?1 OR name LIKE '%' || ?2 || '%';";
     int rs;
-    if ((rs = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL)) != SQLITE_OK)
+    if ((rs = PrepareProductSearch(db, product, 1, &stmt)) != SQLITE_OK)
     {
         // Error preparing statement
         fprintf(stderr, "Error preparing statement: %s\n", sqlite3_errmsg(db));
         return rs;
     }
-    sqlite3_bind_int(stmt, 1, product->id);
-    sqlite3_bind_text(stmt, 2, product->name, -1, SQLITE_STATIC);
 
     if ((rs = sqlite3_step(stmt)) == SQLITE_ROW)
     {
         // Successfully retrieved a row
         product->id = sqlite3_column_int(stmt, 0);
-        const unsigned char *name = sqlite3_column_text(stmt, 1);
-        if (name)
-        {
-            // strncpy(product->name, (const char *)name, sizeof(product->name) - 1);
-            product->name = strdup((const char *)name);
-            product->name[sizeof(product->name) - 1] = '\0'; // Ensure null termination
-        }
-        else
-        {
-            product->name[0] = '\0'; // Handle NULL case
-        }
-        sqlite3_finalize(stmt);
-    }
-    else if (rs == SQLITE_DONE)
-    {
-        // No rows found
-        sqlite3_finalize(stmt);
+        FreeProduct(product);
+        ShortStringSetRef(&product->name, ColumnTextRef(stmt, 1));
     }
-    else
+    else if (rs != SQLITE_DONE)
     {
         fprintf(stderr, "Error executing statement: %s - %s\n", sqlite3_errstr(rs), sqlite3_errmsg(db));
     }
 
+    ReleaseStatement(stmt);
     return rs;
 }
 
@@ -92,147 +194,151 @@ int GetProductById(sqlite3 *db, int productId, Product *product)
         return SQLITE_MISUSE; // Return an error code for misuse
     }
 
-    product->id = productId; // Set the ID to search for
-    product->name[0] = '\0'; // Initialize name to an empty string
-
     int rs;
-    const char *sql = "SELECT id, name FROM products WHERE id = ?1;";
-    sqlite3_stmt *stmt;
-    // Prepare the SQL statement to select a product by ID
-    if ((rs = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL)) != SQLITE_OK)
+    const char *names[2];
+    Catalog *catalog = GetCatalog(db);
+    DbConnection *conn = GetConnection(db);
+    EntityCache *cache = conn != NULL ? conn->entityCache : NULL;
+    if (catalog != NULL)
     {
-        // Error preparing statement
-        fprintf(stderr, "Error preparing statement: %s\n", sqlite3_errmsg(db));
-        return rs;
+        CatalogProduct found;
+        if ((rs = CatalogGetProduct(catalog, productId, &found)) == SQLITE_ROW)
+        {
+            FreeProduct(product);
+            product->id = productId;
+            ShortStringSet(&product->name, found.name);
+        }
     }
-    sqlite3_bind_int(stmt, 1, productId);
-    if ((rs = sqlite3_step(stmt)) & (SQLITE_ROW | SQLITE_DONE))
+    else if (cache != NULL && (rs = EntityCacheGet(cache, ENTITY_PRODUCT, productId, names)) != SQLITE_NOTFOUND)
     {
-        int id = sqlite3_column_int(stmt, 0);
-        if (id == productId)
+        if (rs == SQLITE_ROW)
         {
-            // Successfully retrieved a row
-            product->id = id;
-            const unsigned char *name = sqlite3_column_text(stmt, 1);
-            if (name)
-            {
-                // strncpy(product->name, (const char *)name, sizeof(product->name) - 1);
-                product->name = strdup((const char *)name);
-            }
-            else
-            {
-                product->name[0] = '\0'; // Handle NULL case
-            }
+            FreeProduct(product);
+            product->id = productId;
+            ShortStringSet(&product->name, names[0]);
         }
-        else
+    }
+    else
+    {
+        const char *sql = "SELECT name FROM products WHERE id = ?1;";
+        sqlite3_stmt *stmt;
+        // Prepare the SQL statement to select a product by ID
+        if ((rs = PrepareCached(db, sql, &stmt)) != SQLITE_OK)
+        {
+            // Error preparing statement
+            fprintf(stderr, "Error preparing statement: %s\n", sqlite3_errmsg(db));
+            return rs;
+        }
+        sqlite3_bind_int(stmt, 1, productId);
+        const unsigned char *name = NULL;
+        if ((rs = sqlite3_step(stmt)) == SQLITE_ROW)
+        {
+            name = sqlite3_column_text(stmt, 0);
+            FreeProduct(product);
+            product->id = productId;
+            ShortStringSet(&product->name, (const char *)name);
+        }
+        else if (rs != SQLITE_DONE)
+        {
+            fprintf(stderr, "Error executing statement: %s - %s\n", sqlite3_errstr(rs), sqlite3_errmsg(db));
+        }
+        // Missing ids are cached too, operators retype the same wrong id
+        if (cache != NULL && (rs == SQLITE_ROW || rs == SQLITE_DONE))
         {
-            fprintf(stderr, "Product with ID %d not found.\n", productId);
+            EntityCachePut(cache, ENTITY_PRODUCT, productId, rs == SQLITE_ROW, name, NULL);
         }
-        sqlite3_finalize(stmt);
+        ReleaseStatement(stmt);
     }
 
+    if (rs == SQLITE_DONE)
+    {
+        fprintf(stderr, "Product with ID %d not found.\n", productId);
+    }
     return rs;
 }
 
-int GetMatchedProducts(sqlite3 *db, Product *searchProduct, GenericWrapper *productWrapper)
+/**
+ * @brief Visits the matches of the catalog mirror, best matches first.
+ */
+static int VisitMatchedProductsCataloged(Catalog *catalog, const Product *searchProduct, ProductRowVisitor visit,
+                                         void *ctx)
 {
-    sqlite3_stmt *stmt;
+    CatalogProduct *matches;
+    size_t count;
+    int rs = CatalogSearchProducts(catalog, searchProduct->id, ShortStringGet(&searchProduct->name), PRODUCT_SEARCH_LIMIT, &matches,
+                                   &count);
+    if (rs != SQLITE_DONE)
+    {
+        return rs;
+    }
 
-    const char *sql = "SELECT id, name FROM products WHERE id = ?1 OR name LIKE '%' || ?2 || '%';";
-    // For readability, define indices for the columns, not sure if there is a better way to do this
-    const int idIdx = 0;
-    const int nameIdx = 1;
+    for (size_t i = 0; i < count && rs == SQLITE_DONE; i++)
+    {
+        ProductRow row = {matches[i].id, MakeTextRef(matches[i].name)};
+        if (visit(&row, ctx) != 0)
+        {
+            rs = SQLITE_ABORT;
+        }
+    }
+    free(matches);
+    return rs;
+}
+
+int VisitMatchedProducts(sqlite3 *db, const Product *searchProduct, ProductRowVisitor visit, void *ctx)
+{
+    Catalog *catalog = GetCatalog(db);
+    if (catalog != NULL)
+    {
+        return VisitMatchedProductsCataloged(catalog, searchProduct, visit, ctx);
+    }
+
+    sqlite3_stmt *stmt;
 
     int rs;
-    if ((rs = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL)) != SQLITE_OK)
+    if ((rs = PrepareProductSearch(db, searchProduct, PRODUCT_SEARCH_LIMIT, &stmt)) != SQLITE_OK)
     {
         // Error preparing statement
         fprintf(stderr, "Error preparing statement: %s\n", sqlite3_errmsg(db));
         PrintProduct(searchProduct);
         return rs;
     }
-    sqlite3_bind_int(stmt, 1, searchProduct->id);
-    sqlite3_bind_text(stmt, 2, searchProduct->name, -1, SQLITE_STATIC);
-
-    int count = 0;
-    int allocated = 4; // Initial allocation size
-    Product *products = malloc(allocated * sizeof(Product));
-    if (!products)
-    {
-        fprintf(stderr, "Memory allocation failed.\n");
-        sqlite3_finalize(stmt);
-        exit(EXIT_FAILURE);
-    }
-    Product *tempProduct = NULL;
 
+    // Columns are id, name (and the score, not needed)
     while ((rs = sqlite3_step(stmt)) == SQLITE_ROW)
     {
-        if (count >= allocated)
+        ProductRow row = {sqlite3_column_int(stmt, 0), ColumnTextRef(stmt, 1)};
+        if (visit(&row, ctx) != 0)
         {
-            // Resize the array if needed
-            allocated *= 2;
-            tempProduct = realloc(products, allocated * sizeof(Product));
-            if (!tempProduct)
-            {
-                fprintf(stderr, "Memory reallocation failed.\n");
-                // Free all the products in array before exiting
-                for (int i = 0; i < count; i++)
-                {
-                    FreeProduct((void **)&products[i]);
-                }
-                FreeMemory((void **)&products);
-                sqlite3_finalize(stmt);
-                exit(EXIT_FAILURE);
-            }
-
-            products = tempProduct;
+            rs = SQLITE_ABORT;
+            break;
         }
-
-        // Successfully retrieved a row
-        (products + count)->id = sqlite3_column_int(stmt, idIdx);
-        const unsigned char *name = sqlite3_column_text(stmt, nameIdx);
-        if (name)
-        {
-            // strncpy((products + count)->name, (const char *)name, sizeof((products + count)->name) - 1);
-            (products + count)->name = strdup((const char *)name);
-            // null termination?
-        }
-        else
-        {
-            // Handle NULL case
-            (products + count)->name = NULL;
-        }
-
-        count++;
     }
-
-    productWrapper->data = products;
-    productWrapper->used = count;
-    productWrapper->limit = allocated;
-    productWrapper->size = sizeof(Product);
-
-    if (rs == SQLITE_DONE)
-    {
-        // No rows found
-        sqlite3_finalize(stmt);
-    }
-    else
+    if (rs != SQLITE_DONE && rs != SQLITE_ABORT)
     {
         fprintf(stderr, "Error executing statement: %s - %s\n", sqlite3_errstr(rs), sqlite3_errmsg(db));
     }
 
+    ReleaseStatement(stmt);
     return rs;
 }
 
+static int RetainProductVisitor(const ProductRow *row, void *ctx)
+{
+    RetainProductRow(row, ctx);
+    return 0;
+}
+
+int GetMatchedProducts(sqlite3 *db, Product *searchProduct, ProductVector *products)
+{
+    return VisitMatchedProducts(db, searchProduct, RetainProductVisitor, products);
+}
+
 int PromptUserForProduct(sqlite3 *db, Product **outProduct)
 {
-    GenericWrapper *productWrapper = malloc(sizeof(GenericWrapper));
-    if(productWrapper == NULL)
-    {
-        fprintf(stderr, "Memory allocation failed for product wrapper.\n");
-        exit(EXIT_FAILURE);
-    }
-    InitProductWrapper(productWrapper);
+    ProductVector products;
+    // Only the selected row is copied out, the results are released with the arena
+    DbConnection *conn = GetConnection(db);
+    ProductVectorInitArena(&products, conn != NULL ? conn->searchArena : NULL);
     // First get the product name from the user
     char product_name[128];
     printf("\nSearch for products by name: ");
@@ -250,22 +356,21 @@ int PromptUserForProduct(sqlite3 *db, Product **outProduct)
 
     Product product = {
         .id = 0,     // Assuming 0 means no specific ID
-        .name = NULL // Initialize name to an empty string
+        .name = {.kind = SHORT_STRING_NULL}
     };
-    // strncpy(product.name, product_name, sizeof(product.name) - 1);
-    product.name = strdup(product_name);
+    ShortStringSet(&product.name, product_name);
 
     int rs;
-    // Get matched products in generic wrapper
-    // do not forhet to free the wrapper after use
-    if ((rs = GetMatchedProducts(db, &product, productWrapper)) & (SQLITE_ROW | SQLITE_DONE))
+    // Get matched products in the vector
+    // do not forget to free the vector after use
+    if ((rs = GetMatchedProducts(db, &product, &products)) & (SQLITE_ROW | SQLITE_DONE))
     {
-        for (size_t i = 0; i < productWrapper->used; i++)
+        for (size_t i = 0; i < products.count; i++)
         {
-            Product *pProduct = (Product *)productWrapper->getElementAt(productWrapper, i);
-            PrintProduct(pProduct);
+            PrintProduct(ProductVectorAt(&products, i));
         }
-        printf("Found %zu products matching '%s':\n", productWrapper->used, product.name);
+        printf("Found %zu products matching '%s'%s:\n", products.count, ShortStringGet(&product.name),
+               products.count >= PRODUCT_SEARCH_LIMIT ? " (best matches only, refine the search for more)" : "");
         printf("\nType ID of the product you want to select or 0 to cancel: ");
         int productId;
         // Read the product ID from user input
@@ -276,15 +381,14 @@ int PromptUserForProduct(sqlite3 *db, Product **outProduct)
         {
             printf("Product selection cancelled.\n");
             FreeProduct(&product); // Free the product name
-            FreeWrapper(productWrapper); // Free the wrapper after use
-            FreeMemory((void **)&productWrapper);
+            ProductVectorFree(&products); // Free the vector after use
             return 0; // User cancelled the selection
         }
 
         // Check if picked ID is in fetched products and set it to outProduct
-        for (size_t i = 0; i < productWrapper->used; i++)
+        for (size_t i = 0; i < products.count; i++)
         {
-            Product *pProduct = (Product *)productWrapper->getElementAt(productWrapper, i);
+            Product *pProduct = ProductVectorAt(&products, i);
             if (pProduct->id == productId)
             {
                 // Set the output product to the found one
@@ -296,15 +400,13 @@ int PromptUserForProduct(sqlite3 *db, Product **outProduct)
                 }
                 // Copy the found product data
                 newPProduct->id = pProduct->id;
-                newPProduct->name = strdup(pProduct->name);
+                ShortStringCopy(&newPProduct->name, &pProduct->name);
 
                 *outProduct = newPProduct; // Set the output product to the selected one
                 printf("Selected product: ");
                 PrintProduct(newPProduct);
-                FreeWrapper(productWrapper); // Free the wrapper after use
-                FreeMemory((void **)&productWrapper); // Free the product name
+                ProductVectorFree(&products); // Free the vector after use
                 FreeProduct(&product);
-                // FreeMemory((void **)&productWrapper);
                 return 1; // Successfully selected a product
             }
         }
@@ -340,7 +442,7 @@ int PromptUserForProduct(sqlite3 *db, Product **outProduct)
                     exit(EXIT_FAILURE);
                 }
                 newPProduct->id = product.id;
-                newPProduct->name = strdup(product.name);
+                ShortStringCopy(&newPProduct->name, &product.name);
 
                 *outProduct = newPProduct;
                 printf("Found product: ");
@@ -359,21 +461,20 @@ int PromptUserForProduct(sqlite3 *db, Product **outProduct)
     }
     else
     {
-        Product *firstMatchedProduct = (Product *)productWrapper->getElementAt(productWrapper, 0);
-        printf("%s - searched for product '%s'\n", sqlite3_errstr(rs), firstMatchedProduct->name);
+        printf("%s - searched for product '%s'\n", sqlite3_errstr(rs), ShortStringGet(&product.name));
     }
 
-    FreeWrapper(productWrapper); // Free the wrapper after use
-    FreeMemory((void **)&productWrapper);
+    ProductVectorFree(&products); // Free the vector after use
+    FreeProduct(&product);
     return rs;
 }
 
-void PrintProduct(Product *product)
+void PrintProduct(const Product *product)
 {
     if (product == NULL)
     {
         printf("No product data available.\n");
         return;
     }
-    printf("Product ID: %d, Name: %s\n", product->id, product->name);
+    printf("Product ID: %d, Name: %s\n", product->id, ShortStringGet(&product->name));
 }
\ No newline at end of file
@@ -3,14 +3,55 @@
 
 #include <sqlite3.h>
 #include "db.h"
+#include "vector.h"
+#include "row_view.h"
+#include "short_string.h"
+
+// Maximum number of products a name search returns, best matches first
+#define PRODUCT_SEARCH_LIMIT 50
 
 typedef struct {
     int id;          // Unique identifier for the product
-    char *name;  // Name of the product
+    ShortString name; // Name of the product, read with ShortStringGet
 } Product;
 
 /**
- * @brief Retrieves a product from the database.
+ * @brief Frees memory allocated for a Product structure.
+ * @param product Pointer to the Product structure to be freed.
+ */
+void FreeProduct(Product *product);
+
+/**
+ * @brief Fills a product from the current row of a statement selecting id and name, in this order.
+ * @param product Pointer to the Product structure to fill.
+ * @param stmt Statement positioned on a row.
+ */
+void ReadProductRow(Product *product, sqlite3_stmt *stmt);
+
+DEFINE_VECTOR(ProductVector, Product, FreeProduct)
+DEFINE_VECTOR_ROWS(ProductVector, Product, ReadProductRow)
+
+// A product row as borrowed by a visitor, the name is valid only during the callback
+typedef struct {
+    int id;
+    TextRef name;
+} ProductRow;
+
+// Called once per row, a nonzero return stops the visit
+typedef int (*ProductRowVisitor)(const ProductRow *row, void *ctx);
+
+/**
+ * @brief Copies a visited product row into a vector, for callers that keep rows past the callback.
+ * @param row Row passed to the visitor.
+ * @param products Pointer to an initialized vector.
+ */
+void RetainProductRow(const ProductRow *row, ProductVector *products);
+
+/**
+ * @brief Retrieves a product from the database, the product with the given ID or else the best name match.
+ *
+ * Names are matched like in GetMatchedProducts, so a name of 1 or 2 characters only matches the start of a word.
+ *
  * @param db Pointer to the SQLite database connection.
  * @param product Pointer to a Product structure that contains values to search for
  * and retrieved data will be stored in the same structure.
@@ -27,21 +68,47 @@ int GetProduct(sqlite3 *db, Product *product);
 
 /**
  * @brief Convenience function to retrieve a product by only its ID
+ *
+ * Answered from the catalog mirror if it is enabled, else from the connection's entity cache
+ * (see entity_cache.h), which also remembers ids that do not exist.
+ *
  * @param db Pointer to the SQLite database connection.
  * @param productId The ID of the product to retrieve.
- * @param product Pointer to a Product structure that will be filled with the retrieved data.
+ * @param product Pointer to a Product structure that will be filled with the retrieved data,
+ * its name must be NULL or heap allocated and is replaced (freed) if the product is found.
+ * @returns SQLITE_ROW if the product is found, SQLITE_DONE if not, or sqlite3 error code.
  */
 int GetProductById(sqlite3 *db, int productId, Product *product);
 
 /**
  * @brief Retrieves products that match the search criteria from the database.
+ *
+ * The product with the searched ID comes first, then up to PRODUCT_SEARCH_LIMIT products whose name
+ * contains the searched name, the best PRODUCT_SEARCH_LIMIT of all matches by bm25.
+ * Names of 1 or 2 characters are too short for the trigram index and match the start of a word instead
+ * ("ju" finds "Tere juust", "er" does not find "Tere"), the same as the catalog mirror does.
+ * Uses the FTS5 indexes from migration 3, or LIKE '%name%' if they are not available, then short names
+ * match anywhere in the name.
+ * With the catalog mirror enabled the names are searched in memory instead (see CatalogSearchProducts).
+ * The products are allocated from the vector's arena if it has one (see ProductVectorInitArena).
+ *
  * @param db Pointer to the SQLite database connection.
  * @param searchProduct Pointer to a Product structure containing search criteria.
- * @param productWrapper Pointer to a GenericWrapper structure where matched products will be stored.
+ * @param products Pointer to an initialized vector the matched products are appended to.
  * 
  * @returns sqlite3 result code or -1 on error.
  */
-int GetMatchedProducts(sqlite3 *db, Product *searchProduct, GenericWrapper *productWrapper);
+int GetMatchedProducts(sqlite3 *db, Product *searchProduct, ProductVector *products);
+
+/**
+ * @brief Calls a visitor for each product GetMatchedProducts would return, in the same order, without copying the names.
+ * @param db Pointer to the SQLite database connection.
+ * @param searchProduct Pointer to a Product structure containing search criteria.
+ * @param visit Callback receiving each row, copy with RetainProductRow what must outlive the call.
+ * @param ctx Passed to the visitor.
+ * @returns SQLITE_DONE after the last row, SQLITE_ABORT if the visitor stopped, or sqlite3 error code.
+ */
+int VisitMatchedProducts(sqlite3 *db, const Product *searchProduct, ProductRowVisitor visit, void *ctx);
 
 /**
  * @brief Prompts the user for product details and retrieves matching products from the database for user to select.
@@ -52,30 +119,10 @@ int GetMatchedProducts(sqlite3 *db, Product *searchProduct, GenericWrapper *prod
  */
 int PromptUserForProduct(sqlite3 *db, Product **outProduct);
 
-/**
- * @brief Frees memory allocated for a Product structure.
- * @param pProduct Pointer to the Product structure to be freed.
- */
-void FreeProduct(void *pProduct);
-
-/**
- * @brief Gets a product at the specified index from a wrapper.
- * @param pWrapper Pointer to the wrapper containing products.
- * @param index The index of the product to retrieve.
- * @returns Pointer to the Product at the specified index, or NULL if index is out of bounds.
- */
-void *GetProductAt(void *pWrapper, size_t index);
-
-/**
- * @brief Initializes a GenericWrapper for handling Product structures.
- * @param wrapper Pointer to the GenericWrapper to initialize.
- */
-void InitProductWrapper(GenericWrapper *wrapper);
-
 /**
  * @brief Prints the details of a single product to the console.
  * @param product Pointer to the Product structure to print.
  */
-void PrintProduct(Product *product);
+void PrintProduct(const Product *product);
 
 #endif // PRODUCT_H
\ No newline at end of file
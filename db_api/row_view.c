@@ -0,0 +1,19 @@
+#include <string.h>
+#include "row_view.h"
+
+TextRef ColumnTextRef(sqlite3_stmt *stmt, int column)
+{
+    // sqlite3_column_bytes must come after sqlite3_column_text to measure the UTF-8 form
+    TextRef ref;
+    ref.text = (const char *)sqlite3_column_text(stmt, column);
+    ref.length = ref.text != NULL ? sqlite3_column_bytes(stmt, column) : 0;
+    return ref;
+}
+
+TextRef MakeTextRef(const char *s)
+{
+    TextRef ref;
+    ref.text = s;
+    ref.length = s != NULL ? (int)strlen(s) : 0;
+    return ref;
+}
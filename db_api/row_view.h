@@ -0,0 +1,29 @@
+#ifndef ROW_VIEW_H
+#define ROW_VIEW_H
+
+#include <sqlite3.h>
+
+// Borrowed text of a column or of an in-memory name, nothing is copied.
+// Valid until the statement is stepped again (or the index/catalog owning it changes),
+// text is NULL for SQL NULL. text[length] is always '\0', so it can be printed with %s.
+typedef struct {
+    const char *text;
+    int length;
+} TextRef;
+
+/**
+ * @brief Borrows the text of a column of the current row, without copying it.
+ * @param stmt Statement positioned on a row.
+ * @param column Index of the column.
+ * @returns View of the text, valid until the next sqlite3_step, reset or finalize of the statement.
+ */
+TextRef ColumnTextRef(sqlite3_stmt *stmt, int column);
+
+/**
+ * @brief Borrows a NUL terminated string.
+ * @param s String, may be NULL.
+ * @returns View of the string.
+ */
+TextRef MakeTextRef(const char *s);
+
+#endif // ROW_VIEW_H
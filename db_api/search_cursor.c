@@ -0,0 +1,268 @@
+#include <sqlite3.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "search_cursor.h"
+#include "stmt_cache.h"
+
+// Statements bind ?1 = exact id, ?2/?3 = search terms, ?7 = row limit,
+// the next page ones ?4/?5 = names and ?6 = id of the last row returned.
+// The row value comparison seeks into the name index, but is NULL if a name of the key is NULL.
+// NULL names sort first, so the NULL aware comparison, which SQLite can only evaluate while
+// scanning the index from the start, is needed for the first few rows at most.
+static const char *clientFirstPageSql =
+    "SELECT id, first_name, last_name FROM clients"
+    " WHERE (id = ?1 OR first_name LIKE '%' || ?2 || '%' OR last_name LIKE '%' || ?3 || '%')"
+    " ORDER BY last_name, first_name, id LIMIT ?7;";
+static const char *clientNextPageSql =
+    "SELECT id, first_name, last_name FROM clients"
+    " WHERE (last_name, first_name, id) > (?4, ?5, ?6)"
+    " AND (id = ?1 OR first_name LIKE '%' || ?2 || '%' OR last_name LIKE '%' || ?3 || '%')"
+    " ORDER BY last_name, first_name, id LIMIT ?7;";
+static const char *clientNextPageNullSql =
+    "SELECT id, first_name, last_name FROM clients"
+    " WHERE (last_name > ?4 OR (?4 IS NULL AND last_name IS NOT NULL) OR (last_name IS ?4 AND"
+    " (first_name > ?5 OR (?5 IS NULL AND first_name IS NOT NULL) OR (first_name IS ?5 AND id > ?6))))"
+    " AND (id = ?1 OR first_name LIKE '%' || ?2 || '%' OR last_name LIKE '%' || ?3 || '%')"
+    " ORDER BY last_name, first_name, id LIMIT ?7;";
+static const char *productFirstPageSql =
+    "SELECT id, name FROM products WHERE (id = ?1 OR name LIKE '%' || ?2 || '%')"
+    " ORDER BY name, id LIMIT ?7;";
+static const char *productNextPageSql =
+    "SELECT id, name FROM products WHERE (name, id) > (?4, ?6) AND (id = ?1 OR name LIKE '%' || ?2 || '%')"
+    " ORDER BY name, id LIMIT ?7;";
+static const char *productNextPageNullSql =
+    "SELECT id, name FROM products"
+    " WHERE (name > ?4 OR (?4 IS NULL AND name IS NOT NULL) OR (name IS ?4 AND id > ?6))"
+    " AND (id = ?1 OR name LIKE '%' || ?2 || '%')"
+    " ORDER BY name, id LIMIT ?7;";
+
+struct SearchCursor {
+    sqlite3 *db;
+    int clients; // 1 for a client search, 0 for products
+    int pageSize;
+
+    int id;
+    char *terms[2]; // first and last name, or product name and NULL
+
+    // Sort key of the last row returned
+    char *keys[2];
+    int nullKey; // a name of the key is NULL
+    int keyId;
+    int started;
+    int finished;
+};
+
+static char *CopyText(const char *text)
+{
+    if (text == NULL)
+    {
+        return NULL;
+    }
+    char *copy = strdup(text);
+    if (copy == NULL)
+    {
+        fprintf(stderr, "Memory allocation failed for search cursor.\n");
+        exit(EXIT_FAILURE);
+    }
+    return copy;
+}
+
+static int OpenCursor(sqlite3 *db, int clients, int id, const char *first, const char *second, int pageSize,
+                      SearchCursor **pCursor)
+{
+    *pCursor = NULL;
+    if (pageSize < 1)
+    {
+        fprintf(stderr, "Invalid page size %d.\n", pageSize);
+        return SQLITE_MISUSE;
+    }
+    SearchCursor *cursor = calloc(1, sizeof(SearchCursor));
+    if (cursor == NULL)
+    {
+        fprintf(stderr, "Memory allocation failed for search cursor.\n");
+        exit(EXIT_FAILURE);
+    }
+    cursor->db = db;
+    cursor->clients = clients;
+    cursor->pageSize = pageSize;
+    cursor->id = id;
+    cursor->terms[0] = CopyText(first);
+    cursor->terms[1] = CopyText(second);
+    *pCursor = cursor;
+    return SQLITE_OK;
+}
+
+int OpenClientCursor(sqlite3 *db, const Client *search, int pageSize, SearchCursor **pCursor)
+{
+    return OpenCursor(db, 1, search->id, ShortStringGet(&search->first_name), ShortStringGet(&search->last_name),
+                      pageSize, pCursor);
+}
+
+int OpenProductCursor(sqlite3 *db, const Product *search, int pageSize, SearchCursor **pCursor)
+{
+    return OpenCursor(db, 0, search->id, ShortStringGet(&search->name), NULL, pageSize, pCursor);
+}
+
+// Remembers where the next page starts, the wrapper holds the names of the last row
+static void SetKey(SearchCursor *cursor, int id, const char *first, const char *second)
+{
+    free(cursor->keys[0]);
+    free(cursor->keys[1]);
+    cursor->keys[0] = CopyText(first);
+    cursor->keys[1] = CopyText(second);
+    cursor->nullKey = first == NULL || (cursor->clients && second == NULL);
+    cursor->keyId = id;
+    cursor->started = 1;
+}
+
+/**
+ * @brief Prepares the statement of the next page, or of the first one.
+ * @returns SQLITE_OK or sqlite3 error code of the prepare.
+ */
+static int PreparePage(SearchCursor *cursor, sqlite3_stmt **pStmt)
+{
+    const char *sql;
+    if (!cursor->started)
+    {
+        sql = cursor->clients ? clientFirstPageSql : productFirstPageSql;
+    }
+    else if (cursor->nullKey)
+    {
+        sql = cursor->clients ? clientNextPageNullSql : productNextPageNullSql;
+    }
+    else
+    {
+        sql = cursor->clients ? clientNextPageSql : productNextPageSql;
+    }
+
+    int rs;
+    if ((rs = PrepareCached(cursor->db, sql, pStmt)) != SQLITE_OK)
+    {
+        fprintf(stderr, "Error preparing statement: %s\n", sqlite3_errmsg(cursor->db));
+        return rs;
+    }
+    sqlite3_stmt *stmt = *pStmt;
+    sqlite3_bind_int(stmt, 1, cursor->id);
+    sqlite3_bind_text(stmt, 2, cursor->terms[0], -1, SQLITE_STATIC);
+    if (cursor->clients)
+    {
+        sqlite3_bind_text(stmt, 3, cursor->terms[1], -1, SQLITE_STATIC);
+    }
+    if (cursor->started)
+    {
+        sqlite3_bind_text(stmt, 4, cursor->keys[0], -1, SQLITE_STATIC);
+        if (cursor->clients)
+        {
+            sqlite3_bind_text(stmt, 5, cursor->keys[1], -1, SQLITE_STATIC);
+        }
+        sqlite3_bind_int(stmt, 6, cursor->keyId);
+    }
+    // One row more than the page tells whether another page follows
+    sqlite3_bind_int64(stmt, 7, (sqlite3_int64)cursor->pageSize + 1);
+    return SQLITE_OK;
+}
+
+/**
+ * @brief Checks the result of reading a page and whether another page follows.
+ * @returns SQLITE_ROW if the page has rows, SQLITE_DONE if not, or the sqlite3 error code.
+ */
+static int FinishPage(SearchCursor *cursor, int rs, size_t count)
+{
+    cursor->finished = count <= (size_t)cursor->pageSize;
+    if (rs != SQLITE_DONE)
+    {
+        fprintf(stderr, "Error executing statement: %s - %s\n", sqlite3_errstr(rs), sqlite3_errmsg(cursor->db));
+        cursor->finished = 1;
+        return rs;
+    }
+    return count > 0 ? SQLITE_ROW : SQLITE_DONE;
+}
+
+int CursorNextClientPage(SearchCursor *cursor, ClientVector *clients)
+{
+    ClientVectorFree(clients);
+    if (!cursor->clients)
+    {
+        fprintf(stderr, "Cursor does not page through clients.\n");
+        return SQLITE_MISUSE;
+    }
+    if (cursor->finished)
+    {
+        return SQLITE_DONE;
+    }
+
+    sqlite3_stmt *stmt;
+    int rs;
+    if ((rs = PreparePage(cursor, &stmt)) != SQLITE_OK)
+    {
+        return rs;
+    }
+    ClientVectorReserve(clients, (size_t)cursor->pageSize < 16 ? (size_t)cursor->pageSize + 1 : 16);
+    rs = ClientVectorAppendRows(clients, stmt);
+    ReleaseStatement(stmt);
+
+    if ((rs = FinishPage(cursor, rs, clients->count)) == SQLITE_ROW)
+    {
+        if (!cursor->finished)
+        {
+            ClientVectorPop(clients);
+        }
+        const Client *last = ClientVectorAt(clients, clients->count - 1);
+        SetKey(cursor, last->id, ShortStringGet(&last->last_name), ShortStringGet(&last->first_name));
+    }
+    return rs;
+}
+
+int CursorNextProductPage(SearchCursor *cursor, ProductVector *products)
+{
+    ProductVectorFree(products);
+    if (cursor->clients)
+    {
+        fprintf(stderr, "Cursor does not page through products.\n");
+        return SQLITE_MISUSE;
+    }
+    if (cursor->finished)
+    {
+        return SQLITE_DONE;
+    }
+
+    sqlite3_stmt *stmt;
+    int rs;
+    if ((rs = PreparePage(cursor, &stmt)) != SQLITE_OK)
+    {
+        return rs;
+    }
+    ProductVectorReserve(products, (size_t)cursor->pageSize < 16 ? (size_t)cursor->pageSize + 1 : 16);
+    rs = ProductVectorAppendRows(products, stmt);
+    ReleaseStatement(stmt);
+
+    if ((rs = FinishPage(cursor, rs, products->count)) == SQLITE_ROW)
+    {
+        if (!cursor->finished)
+        {
+            ProductVectorPop(products);
+        }
+        const Product *last = ProductVectorAt(products, products->count - 1);
+        SetKey(cursor, last->id, ShortStringGet(&last->name), NULL);
+    }
+    return rs;
+}
+
+int CursorFinished(const SearchCursor *cursor)
+{
+    return cursor->finished;
+}
+
+void CloseCursor(SearchCursor *cursor)
+{
+    if (cursor == NULL)
+    {
+        return;
+    }
+    free(cursor->terms[0]);
+    free(cursor->terms[1]);
+    free(cursor->keys[0]);
+    free(cursor->keys[1]);
+    free(cursor);
+}
@@ -0,0 +1,71 @@
+#ifndef SEARCH_CURSOR_H
+#define SEARCH_CURSOR_H
+
+#include <sqlite3.h>
+#include "clients.h"
+#include "product.h"
+
+typedef struct SearchCursor SearchCursor;
+
+// Rows per page shown by the interactive client search
+#define CLIENT_PAGE_SIZE 20
+
+/**
+ * @brief Starts paging through the clients that GetMatchedClients would match without an index:
+ * the client with the searched id and clients whose first name contains first_name or whose last
+ * name contains last_name (LIKE, case-insensitive for ASCII).
+ *
+ * Pages are ordered by (last_name, first_name, id), NULL names first. Each page is one query
+ * that resumes after the last row of the previous page (keyset pagination over idx_clients_name),
+ * so a page costs the same no matter how deep it is, and no statement stays open between pages.
+ *
+ * @param db Pointer to the SQLite database connection.
+ * @param search Pointer to a Client structure containing search criteria, copied.
+ * @param pageSize Maximum number of rows per page.
+ * @param pCursor Pointer where the cursor is stored, close it with CloseCursor.
+ * @returns SQLITE_OK on success, SQLITE_MISUSE for a page size below 1.
+ */
+int OpenClientCursor(sqlite3 *db, const Client *search, int pageSize, SearchCursor **pCursor);
+
+/**
+ * @brief Starts paging through the products with the searched id or whose name contains the searched
+ * name (LIKE), ordered by (name, id) over idx_products_name. Unlike GetMatchedProducts the matches are
+ * not ranked and not limited to PRODUCT_SEARCH_LIMIT.
+ * @param db Pointer to the SQLite database connection.
+ * @param search Pointer to a Product structure containing search criteria, copied.
+ * @param pageSize Maximum number of rows per page.
+ * @param pCursor Pointer where the cursor is stored, close it with CloseCursor.
+ * @returns SQLITE_OK on success, SQLITE_MISUSE for a page size below 1.
+ */
+int OpenProductCursor(sqlite3 *db, const Product *search, int pageSize, SearchCursor **pCursor);
+
+/**
+ * @brief Fetches the next page of a client cursor. The previous page in the vector is freed first.
+ * @param cursor Pointer to a cursor opened with OpenClientCursor.
+ * @param clients Pointer to an initialized vector, may use an arena (see ClientVectorInitArena).
+ * @returns SQLITE_ROW if the vector holds a page, SQLITE_DONE if there are no more rows, or sqlite3 error code.
+ */
+int CursorNextClientPage(SearchCursor *cursor, ClientVector *clients);
+
+/**
+ * @brief Fetches the next page of a product cursor. The previous page in the vector is freed first.
+ * @param cursor Pointer to a cursor opened with OpenProductCursor.
+ * @param products Pointer to an initialized vector, may use an arena (see ProductVectorInitArena).
+ * @returns SQLITE_ROW if the vector holds a page, SQLITE_DONE if there are no more rows, or sqlite3 error code.
+ */
+int CursorNextProductPage(SearchCursor *cursor, ProductVector *products);
+
+/**
+ * @brief Tells whether the last page has been fetched.
+ * @param cursor Pointer to the cursor.
+ * @returns 1 if the next page would be empty (SQLITE_DONE), 0 otherwise.
+ */
+int CursorFinished(const SearchCursor *cursor);
+
+/**
+ * @brief Frees a cursor.
+ * @param cursor Pointer to the cursor, may be NULL.
+ */
+void CloseCursor(SearchCursor *cursor);
+
+#endif // SEARCH_CURSOR_H
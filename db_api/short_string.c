@@ -0,0 +1,43 @@
+#include <string.h>
+#include "short_string.h"
+
+void ShortStringSetRef(ShortString *s, TextRef ref)
+{
+    if (ref.text == NULL)
+    {
+        s->kind = SHORT_STRING_NULL;
+        return;
+    }
+    if (ref.length <= SHORT_STRING_INLINE)
+    {
+        memcpy(s->text, ref.text, (size_t)ref.length);
+        s->text[ref.length] = '\0';
+        s->kind = SHORT_STRING_INLINED;
+        return;
+    }
+    s->interned = Intern(ref.text, (size_t)ref.length);
+    s->kind = SHORT_STRING_INTERNED;
+}
+
+void ShortStringSet(ShortString *s, const char *value)
+{
+    ShortStringSetRef(s, MakeTextRef(value));
+}
+
+void ShortStringCopy(ShortString *dst, const ShortString *src)
+{
+    *dst = *src;
+    if (src->kind == SHORT_STRING_INTERNED)
+    {
+        InternRetain(src->interned);
+    }
+}
+
+void ShortStringFree(ShortString *s)
+{
+    if (s->kind == SHORT_STRING_INTERNED)
+    {
+        InternRelease(s->interned);
+    }
+    s->kind = SHORT_STRING_NULL;
+}
@@ -0,0 +1,92 @@
+#ifndef SHORT_STRING_H
+#define SHORT_STRING_H
+
+#include <stddef.h>
+#include <string.h>
+#include "row_view.h"
+#include "intern.h"
+
+// Longest value stored inside the struct, longer values are interned (see intern.h).
+// 30 keeps a ShortString at 32 bytes and holds every client name and most product names;
+// can be overridden at build time, e.g. CFLAGS += -DSHORT_STRING_INLINE=46
+#ifndef SHORT_STRING_INLINE
+#define SHORT_STRING_INLINE 30
+#endif
+
+enum {
+    SHORT_STRING_NULL = 0, // zero initialized strings are NULL
+    SHORT_STRING_INLINED,
+    SHORT_STRING_INTERNED,
+};
+
+/**
+ * String with small-string storage, NUL terminated either way. Arrays of structs holding them are contiguous,
+ * reading a short value needs no pointer chase and setting one no allocation. A long value is a reference
+ * to the process-wide interned copy, shared by every result holding the same name.
+ * Use ShortStringGet to read it, ShortStringSet* to fill it and ShortStringFree to release it.
+ */
+typedef union {
+    struct {
+        char text[SHORT_STRING_INLINE + 1];
+        unsigned char kind; // last byte, not overlapped by interned
+    };
+    const char *interned;
+} ShortString;
+
+_Static_assert(SHORT_STRING_INLINE + 1 >= sizeof(const char *),
+               "SHORT_STRING_INLINE too small, the interned pointer would overlap the kind byte");
+
+/**
+ * @brief Reads a string.
+ * @param s Pointer to the string.
+ * @returns The value, NULL for NULL. Valid until the string is set or freed, and for inline values until it is moved.
+ */
+static inline const char *ShortStringGet(const ShortString *s)
+{
+    return s->kind == SHORT_STRING_INLINED ? s->text : s->kind == SHORT_STRING_INTERNED ? s->interned : NULL;
+}
+
+/**
+ * @brief Compares two strings. A value has one representation (inline if it fits, else interned),
+ * so long values compare by pointer and short ones within the struct.
+ * @returns 1 if both are NULL or hold equal values, 0 otherwise.
+ */
+static inline int ShortStringEquals(const ShortString *a, const ShortString *b)
+{
+    if (a->kind != b->kind)
+    {
+        return 0;
+    }
+    return a->kind == SHORT_STRING_NULL || (a->kind == SHORT_STRING_INTERNED ? a->interned == b->interned
+                                                                              : strcmp(a->text, b->text) == 0);
+}
+
+/**
+ * @brief Stores a copy of borrowed text, inline if it fits, else interned. The previous value is not released.
+ * Exits the program if memory cannot be allocated.
+ * @param s Pointer to the string.
+ * @param ref Text to copy, NULL text stores NULL.
+ */
+void ShortStringSetRef(ShortString *s, TextRef ref);
+
+/**
+ * @brief Stores a copy of a NUL terminated string, see ShortStringSetRef.
+ * @param s Pointer to the string.
+ * @param value String to copy, may be NULL.
+ */
+void ShortStringSet(ShortString *s, const char *value);
+
+/**
+ * @brief Copies a string, an interned value only takes another reference. The previous value of dst is not released.
+ * @param dst Pointer to the string to fill.
+ * @param src Pointer to the string to copy.
+ */
+void ShortStringCopy(ShortString *dst, const ShortString *src);
+
+/**
+ * @brief Releases an interned value and sets the string to NULL.
+ * @param s Pointer to the string.
+ */
+void ShortStringFree(ShortString *s);
+
+#endif // SHORT_STRING_H
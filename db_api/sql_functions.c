@@ -0,0 +1,202 @@
+#include <sqlite3.h>
+#include <stdio.h>
+#include <string.h>
+#include "sql_functions.h"
+
+// Flags shared by all functions: same result for the same input, no side effects
+#define FUNCTION_FLAGS (SQLITE_UTF8 | SQLITE_DETERMINISTIC | SQLITE_INNOCUOUS)
+
+typedef struct {
+    int seen;
+    double value;
+    sqlite3_int64 intKey;  // the best row's key when it is an integer (shop ids, rowids)
+    sqlite3_value *key;    // copy of the best row's key otherwise
+} ArgState;
+
+typedef struct {
+    double cost;
+    sqlite3_int64 items;
+    sqlite3_int64 missing;
+} BasketState;
+
+/**
+ * @brief Orders keys like SQLite does for values of different types: NULL, numbers, text, blobs.
+ * Text is compared bytewise (BINARY collation).
+ */
+static int CompareKeys(sqlite3_value *a, sqlite3_value *b)
+{
+    static const int rank[] = {[SQLITE_NULL] = 0, [SQLITE_INTEGER] = 1, [SQLITE_FLOAT] = 1, [SQLITE_TEXT] = 2,
+                               [SQLITE_BLOB] = 3};
+    int typeA = sqlite3_value_type(a);
+    int typeB = sqlite3_value_type(b);
+    if (rank[typeA] != rank[typeB])
+    {
+        return rank[typeA] - rank[typeB];
+    }
+    if (rank[typeA] == 0)
+    {
+        return 0;
+    }
+    if (rank[typeA] == 1)
+    {
+        if (typeA == SQLITE_INTEGER && typeB == SQLITE_INTEGER)
+        {
+            sqlite3_int64 x = sqlite3_value_int64(a);
+            sqlite3_int64 y = sqlite3_value_int64(b);
+            return (x > y) - (x < y);
+        }
+        double x = sqlite3_value_double(a);
+        double y = sqlite3_value_double(b);
+        return (x > y) - (x < y);
+    }
+
+    const void *bytesA = typeA == SQLITE_TEXT ? (const void *)sqlite3_value_text(a) : sqlite3_value_blob(a);
+    const void *bytesB = typeB == SQLITE_TEXT ? (const void *)sqlite3_value_text(b) : sqlite3_value_blob(b);
+    int lenA = sqlite3_value_bytes(a);
+    int lenB = sqlite3_value_bytes(b);
+    int cmp = lenA && lenB ? memcmp(bytesA, bytesB, (size_t)(lenA < lenB ? lenA : lenB)) : 0;
+    return cmp != 0 ? cmp : lenA - lenB;
+}
+
+/**
+ * @brief Compares a row's key with the best key kept so far.
+ */
+static int CompareKey(sqlite3_value *key, const ArgState *state)
+{
+    if (state->key != NULL)
+    {
+        return CompareKeys(key, state->key);
+    }
+    int type = sqlite3_value_type(key);
+    if (type == SQLITE_INTEGER)
+    {
+        sqlite3_int64 x = sqlite3_value_int64(key);
+        return (x > state->intKey) - (x < state->intKey);
+    }
+    if (type == SQLITE_FLOAT)
+    {
+        double x = sqlite3_value_double(key);
+        double y = (double)state->intKey;
+        return (x > y) - (x < y);
+    }
+    // NULL sorts before the integer kept, text and blobs after it
+    return type == SQLITE_NULL ? -1 : 1;
+}
+
+/**
+ * @brief Keeps the key of the row that beats the current one, direction is passed as user data
+ * (1 for argmin, -1 for argmax). Ties go to the lowest key, so the result does not depend on the
+ * order rows arrive in (GROUP BY may sort them).
+ */
+static void ArgStep(sqlite3_context *ctx, int argc, sqlite3_value **argv)
+{
+    (void)argc;
+    if (sqlite3_value_type(argv[0]) == SQLITE_NULL)
+    {
+        return;
+    }
+    ArgState *state = sqlite3_aggregate_context(ctx, sizeof(ArgState));
+    if (state == NULL)
+    {
+        sqlite3_result_error_nomem(ctx);
+        return;
+    }
+
+    int direction = *(const int *)sqlite3_user_data(ctx);
+    double value = sqlite3_value_double(argv[0]);
+    if (state->seen && value != state->value && (direction > 0) != (value < state->value))
+    {
+        return;
+    }
+    if (state->seen && value == state->value && CompareKey(argv[1], state) >= 0)
+    {
+        return;
+    }
+
+    // Integer keys are the common case, they need no copy of the value
+    sqlite3_value *key = NULL;
+    if (sqlite3_value_type(argv[1]) == SQLITE_INTEGER)
+    {
+        state->intKey = sqlite3_value_int64(argv[1]);
+    }
+    else if ((key = sqlite3_value_dup(argv[1])) == NULL)
+    {
+        sqlite3_result_error_nomem(ctx);
+        return;
+    }
+    sqlite3_value_free(state->key);
+    state->key = key;
+    state->value = value;
+    state->seen = 1;
+}
+
+static void ArgFinal(sqlite3_context *ctx)
+{
+    ArgState *state = sqlite3_aggregate_context(ctx, 0);
+    if (state == NULL || !state->seen)
+    {
+        sqlite3_result_null(ctx);
+        return;
+    }
+    if (state->key == NULL)
+    {
+        sqlite3_result_int64(ctx, state->intKey);
+        return;
+    }
+    sqlite3_result_value(ctx, state->key);
+    sqlite3_value_free(state->key);
+    state->key = NULL;
+}
+
+static void BasketStep(sqlite3_context *ctx, int argc, sqlite3_value **argv)
+{
+    (void)argc;
+    BasketState *state = sqlite3_aggregate_context(ctx, sizeof(BasketState));
+    if (state == NULL)
+    {
+        sqlite3_result_error_nomem(ctx);
+        return;
+    }
+    state->items++;
+    if (sqlite3_value_type(argv[0]) == SQLITE_NULL)
+    {
+        state->missing++;
+        return;
+    }
+    state->cost += sqlite3_value_double(argv[0]) * sqlite3_value_double(argv[1]);
+}
+
+static void BasketFinal(sqlite3_context *ctx)
+{
+    BasketState *state = sqlite3_aggregate_context(ctx, 0);
+    BasketState empty = {0};
+    if (state == NULL)
+    {
+        state = &empty;
+    }
+    char *json = sqlite3_mprintf("{\"cost\":%!.15g,\"items\":%lld,\"missing\":%lld}", state->cost, state->items,
+                                 state->missing);
+    if (json == NULL)
+    {
+        sqlite3_result_error_nomem(ctx);
+        return;
+    }
+    sqlite3_result_text(ctx, json, -1, sqlite3_free);
+}
+
+int RegisterSqlFunctions(sqlite3 *db)
+{
+    static const int minimum = 1;
+    static const int maximum = -1;
+    int rs;
+    if ((rs = sqlite3_create_function(db, "argmin", 2, FUNCTION_FLAGS, (void *)&minimum, NULL, ArgStep, ArgFinal)) !=
+            SQLITE_OK ||
+        (rs = sqlite3_create_function(db, "argmax", 2, FUNCTION_FLAGS, (void *)&maximum, NULL, ArgStep, ArgFinal)) !=
+            SQLITE_OK ||
+        (rs = sqlite3_create_function(db, "basket_cost", 2, FUNCTION_FLAGS, NULL, NULL, BasketStep, BasketFinal)) !=
+            SQLITE_OK)
+    {
+        fprintf(stderr, "Error registering SQL functions: %s\n", sqlite3_errmsg(db));
+    }
+    return rs;
+}
@@ -0,0 +1,24 @@
+#ifndef SQL_FUNCTIONS_H
+#define SQL_FUNCTIONS_H
+
+#include <sqlite3.h>
+
+/**
+ * @brief Registers the application's SQL functions on a connection.
+ *
+ * Aggregates:
+ *
+ *  - argmin(value, key): key of the row with the lowest value, the lowest key on ties, NULL values are skipped
+ *
+ *  - argmax(value, key): key of the row with the highest value, the lowest key on ties
+ *
+ *  - basket_cost(price, amount): cost of a basket given one row per ordered item, as JSON text
+ *    {"cost": sum of price * amount, "items": rows, "missing": rows with a NULL price (item not carried)},
+ *    e.g. SELECT json_extract(basket_cost(off.price, o.amount), '$.missing') ... GROUP BY o.client_id
+ *
+ * @param db Pointer to the SQLite database connection.
+ * @returns SQLITE_OK on success or sqlite3 error code.
+ */
+int RegisterSqlFunctions(sqlite3 *db);
+
+#endif // SQL_FUNCTIONS_H
@@ -0,0 +1,207 @@
+#include <sqlite3.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "stmt_cache.h"
+#include "connection.h"
+
+#define STMT_CACHE_INITIAL_CAPACITY 32 // must be a power of two
+
+typedef struct {
+    const char *sql; // points to sqlite3_sql(stmt), lives as long as the statement
+    uint32_t hash;
+    sqlite3_stmt *stmt;
+    int inUse;
+} StmtCacheEntry;
+
+struct StmtCache {
+    sqlite3 *db;
+    StmtCacheEntry *entries; // open addressing table, NULL stmt marks an empty slot
+    size_t capacity;
+    size_t used;
+
+    unsigned long hits;
+    unsigned long misses;
+};
+
+// FNV-1a, query texts are short so this is plenty
+static uint32_t HashSql(const char *sql)
+{
+    uint32_t hash = 2166136261u;
+    for (const unsigned char *p = (const unsigned char *)sql; *p != '\0'; p++)
+    {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static StmtCacheEntry *FindEntry(StmtCache *cache, const char *sql, uint32_t hash)
+{
+    size_t mask = cache->capacity - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask)
+    {
+        StmtCacheEntry *entry = &cache->entries[i];
+        if (entry->stmt == NULL)
+        {
+            return entry; // First empty slot, caller checks stmt to see if it was found
+        }
+        if (entry->hash == hash && strcmp(entry->sql, sql) == 0)
+        {
+            return entry;
+        }
+    }
+}
+
+static int GrowCache(StmtCache *cache)
+{
+    StmtCacheEntry *old = cache->entries;
+    size_t oldCapacity = cache->capacity;
+
+    StmtCacheEntry *entries = calloc(oldCapacity * 2, sizeof(StmtCacheEntry));
+    if (entries == NULL)
+    {
+        return 0;
+    }
+    cache->entries = entries;
+    cache->capacity = oldCapacity * 2;
+
+    for (size_t i = 0; i < oldCapacity; i++)
+    {
+        if (old[i].stmt != NULL)
+        {
+            *FindEntry(cache, old[i].sql, old[i].hash) = old[i];
+        }
+    }
+    free(old);
+    return 1;
+}
+
+StmtCache *StmtCacheCreate(sqlite3 *db)
+{
+    StmtCache *cache = calloc(1, sizeof(StmtCache));
+    if (cache == NULL)
+    {
+        fprintf(stderr, "Memory allocation failed for statement cache.\n");
+        return NULL;
+    }
+    cache->entries = calloc(STMT_CACHE_INITIAL_CAPACITY, sizeof(StmtCacheEntry));
+    if (cache->entries == NULL)
+    {
+        fprintf(stderr, "Memory allocation failed for statement cache.\n");
+        free(cache);
+        return NULL;
+    }
+    cache->db = db;
+    cache->capacity = STMT_CACHE_INITIAL_CAPACITY;
+    return cache;
+}
+
+void StmtCacheDestroy(StmtCache *cache)
+{
+    if (cache == NULL)
+    {
+        return;
+    }
+    for (size_t i = 0; i < cache->capacity; i++)
+    {
+        if (cache->entries[i].stmt != NULL)
+        {
+            sqlite3_finalize(cache->entries[i].stmt);
+        }
+    }
+    free(cache->entries);
+    free(cache);
+}
+
+int PrepareCached(sqlite3 *db, const char *sql, sqlite3_stmt **pStmt)
+{
+    DbConnection *conn = GetConnection(db);
+    if (conn == NULL || conn->stmtCache == NULL)
+    {
+        // Connection was not opened through db_init, behave like a plain prepare
+        return sqlite3_prepare_v2(db, sql, -1, pStmt, NULL);
+    }
+
+    StmtCache *cache = conn->stmtCache;
+    uint32_t hash = HashSql(sql);
+    StmtCacheEntry *entry = FindEntry(cache, sql, hash);
+    if (entry->stmt != NULL)
+    {
+        if (entry->inUse)
+        {
+            // Same query is already being stepped by the caller, hand out a private statement
+            cache->misses++;
+            return sqlite3_prepare_v2(db, sql, -1, pStmt, NULL);
+        }
+        // Statement was reset on release, bindings still need clearing for the next caller
+        sqlite3_clear_bindings(entry->stmt);
+        entry->inUse = 1;
+        cache->hits++;
+        *pStmt = entry->stmt;
+        return SQLITE_OK;
+    }
+
+    cache->misses++;
+    int rs = sqlite3_prepare_v2(db, sql, -1, pStmt, NULL);
+    if (rs != SQLITE_OK || *pStmt == NULL)
+    {
+        return rs;
+    }
+
+    // Keep the load factor below 3/4, if growing fails the statement is simply not cached
+    if ((cache->used + 1) * 4 > cache->capacity * 3)
+    {
+        if (!GrowCache(cache))
+        {
+            return rs;
+        }
+        entry = FindEntry(cache, sql, hash);
+    }
+
+    entry->sql = sqlite3_sql(*pStmt);
+    entry->hash = hash;
+    entry->stmt = *pStmt;
+    entry->inUse = 1;
+    cache->used++;
+    return rs;
+}
+
+void ReleaseStatement(sqlite3_stmt *stmt)
+{
+    if (stmt == NULL)
+    {
+        return;
+    }
+
+    DbConnection *conn = GetConnection(sqlite3_db_handle(stmt));
+    if (conn != NULL && conn->stmtCache != NULL)
+    {
+        const char *sql = sqlite3_sql(stmt);
+        StmtCacheEntry *entry = FindEntry(conn->stmtCache, sql, HashSql(sql));
+        if (entry->stmt == stmt)
+        {
+            // Reset right away so a partially stepped SELECT does not keep the read transaction open
+            sqlite3_reset(stmt);
+            sqlite3_clear_bindings(stmt);
+            entry->inUse = 0;
+            return;
+        }
+    }
+
+    sqlite3_finalize(stmt);
+}
+
+void GetStmtCacheStats(sqlite3 *db, StmtCacheStats *stats)
+{
+    memset(stats, 0, sizeof(StmtCacheStats));
+    DbConnection *conn = GetConnection(db);
+    if (conn == NULL || conn->stmtCache == NULL)
+    {
+        return;
+    }
+    stats->hits = conn->stmtCache->hits;
+    stats->misses = conn->stmtCache->misses;
+    stats->entries = conn->stmtCache->used;
+}
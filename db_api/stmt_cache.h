@@ -0,0 +1,59 @@
+#ifndef STMT_CACHE_H
+#define STMT_CACHE_H
+
+#include <sqlite3.h>
+#include <stddef.h>
+
+typedef struct StmtCache StmtCache;
+
+typedef struct {
+    unsigned long hits;   // statements handed out without preparing
+    unsigned long misses; // statements that had to be prepared
+    size_t entries;       // statements currently held by the cache
+} StmtCacheStats;
+
+/**
+ * @brief Creates an empty prepared statement cache for a connection.
+ * @param db Pointer to the SQLite database connection the statements belong to.
+ * @returns Pointer to the new cache, or NULL on allocation failure.
+ */
+StmtCache *StmtCacheCreate(sqlite3 *db);
+
+/**
+ * @brief Finalizes every cached statement and frees the cache.
+ * @param cache Pointer to the cache, may be NULL.
+ */
+void StmtCacheDestroy(StmtCache *cache);
+
+/**
+ * @brief Drop-in replacement for sqlite3_prepare_v2 that reuses statements of a connection.
+ *
+ * The statement is looked up by its query text. A cached statement is handed out
+ * reset with all bindings cleared. If the same query is already in use (e.g. nested use),
+ * an uncached statement is prepared instead.
+ *
+ * @param db Pointer to the SQLite database connection.
+ * @param sql Query text, used as the cache key.
+ * @param pStmt Pointer where the statement will be stored.
+ * @returns sqlite3 result code of the prepare, SQLITE_OK on cache hit.
+ */
+int PrepareCached(sqlite3 *db, const char *sql, sqlite3_stmt **pStmt);
+
+/**
+ * @brief Gives a statement obtained from PrepareCached back to the cache.
+ *
+ * Cached statements are reset and their bindings cleared so they do not hold
+ * read locks, statements that are not cached are finalized.
+ *
+ * @param stmt The statement to release, may be NULL.
+ */
+void ReleaseStatement(sqlite3_stmt *stmt);
+
+/**
+ * @brief Retrieves the hit and miss counters of the statement cache of a connection.
+ * @param db Pointer to the SQLite database connection.
+ * @param stats Pointer to a StmtCacheStats structure that will be filled.
+ */
+void GetStmtCacheStats(sqlite3 *db, StmtCacheStats *stats);
+
+#endif // STMT_CACHE_H
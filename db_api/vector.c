@@ -0,0 +1,23 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include "vector.h"
+
+void *VectorResize(Arena *arena, void *items, size_t oldBytes, size_t newBytes)
+{
+    if (arena != NULL)
+    {
+        return ArenaRealloc(arena, items, oldBytes, newBytes);
+    }
+    if (newBytes == 0)
+    {
+        free(items);
+        return NULL;
+    }
+    void *resized = realloc(items, newBytes);
+    if (resized == NULL)
+    {
+        fprintf(stderr, "Memory reallocation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    return resized;
+}
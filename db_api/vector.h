@@ -0,0 +1,138 @@
+#ifndef VECTOR_H
+#define VECTOR_H
+
+#include <sqlite3.h>
+#include <stddef.h>
+#include "arena.h"
+
+/**
+ * @brief Resizes an item array, from the arena or with realloc. Exits the program if memory cannot be allocated.
+ * @param arena Arena the array comes from, NULL for malloc.
+ * @param items Current array, may be NULL.
+ * @param oldBytes Current size of the array.
+ * @param newBytes New size of the array, 0 frees a malloc array and returns NULL.
+ * @returns Pointer to the resized array.
+ */
+void *VectorResize(Arena *arena, void *items, size_t oldBytes, size_t newBytes);
+
+// FreeElement for item types without owned memory
+#define VECTOR_NO_FREE(item) ((void)(item))
+
+/**
+ * Defines the vector type Name holding Type items in one contiguous array, and its functions:
+ *
+ *  - Name##Init(v), Name##InitArena(v, arena): empty vector, the item array from malloc or an arena
+ *  - Name##At(v, i): pointer to item i, not bounds checked
+ *  - Name##Reserve(v, capacity), Name##Shrink(v): grow to at least capacity items, give back unused capacity
+ *  - Name##Push(v): appends an uninitialized item and returns it, growing by growthStep items (0 doubles)
+ *  - Name##Pop(v): removes and frees the last item
+ *  - Name##Clear(v): frees the items but keeps the capacity
+ *  - Name##Free(v): frees the items and the array, the array by resetting the arena if there is one
+ *
+ * FreeElement(Type *) releases what an item owns. Everything is inline, loops over items need no calls.
+ */
+#define DEFINE_VECTOR(Name, Type, FreeElement)                                                                       \
+    typedef struct                                                                                                   \
+    {                                                                                                                \
+        Type *items;                                                                                                 \
+        size_t count;                                                                                                \
+        size_t capacity;                                                                                             \
+        size_t growthStep; /* items added when the vector is full, 0 doubles the capacity */                         \
+        Arena *arena;      /* the item array is allocated from it, NULL for malloc */                      \
+    } Name;                                                                                                          \
+                                                                                                                     \
+    static inline void Name##InitArena(Name *v, Arena *arena)                                                        \
+    {                                                                                                                \
+        v->items = NULL;                                                                                             \
+        v->count = 0;                                                                                                \
+        v->capacity = 0;                                                                                             \
+        v->growthStep = 0;                                                                                           \
+        v->arena = arena;                                                                                            \
+    }                                                                                                                \
+                                                                                                                     \
+    static inline void Name##Init(Name *v)                                                                           \
+    {                                                                                                                \
+        Name##InitArena(v, NULL);                                                                                    \
+    }                                                                                                                \
+                                                                                                                     \
+    static inline Type *Name##At(const Name *v, size_t i)                                                           \
+    {                                                                                                                \
+        return &v->items[i];                                                                                         \
+    }                                                                                                                \
+                                                                                                                     \
+    static inline void Name##Reserve(Name *v, size_t capacity)                                                       \
+    {                                                                                                                \
+        if (capacity > v->capacity)                                                                                  \
+        {                                                                                                            \
+            v->items = VectorResize(v->arena, v->items, v->capacity * sizeof(Type), capacity * sizeof(Type));        \
+            v->capacity = capacity;                                                                                  \
+        }                                                                                                            \
+    }                                                                                                                \
+                                                                                                                     \
+    static inline void Name##Shrink(Name *v)                                                                         \
+    {                                                                                                                \
+        if (v->count < v->capacity)                                                                                  \
+        {                                                                                                            \
+            v->items = VectorResize(v->arena, v->items, v->capacity * sizeof(Type), v->count * sizeof(Type));        \
+            v->capacity = v->count;                                                                                  \
+        }                                                                                                            \
+    }                                                                                                                \
+                                                                                                                     \
+    static inline Type *Name##Push(Name *v)                                                                          \
+    {                                                                                                                \
+        if (v->count == v->capacity)                                                                                 \
+        {                                                                                                            \
+            size_t step = v->growthStep ? v->growthStep : v->capacity ? v->capacity : 4;                            \
+            Name##Reserve(v, v->capacity + step);                                                                    \
+        }                                                                                                            \
+        return &v->items[v->count++];                                                                                \
+    }                                                                                                                \
+                                                                                                                     \
+    static inline void Name##Pop(Name *v)                                                                            \
+    {                                                                                                                \
+        v->count--;                                                                                                  \
+        FreeElement(&v->items[v->count]);                                                                            \
+    }                                                                                                                \
+                                                                                                                     \
+    static inline void Name##Clear(Name *v)                                                                          \
+    {                                                                                                                \
+        for (size_t i = 0; i < v->count; i++)                                                                        \
+        {                                                                                                            \
+            FreeElement(&v->items[i]);                                                                               \
+        }                                                                                                            \
+        v->count = 0;                                                                                                \
+    }                                                                                                                \
+                                                                                                                     \
+    static inline void Name##Free(Name *v)                                                                           \
+    {                                                                                                                \
+        Name##Clear(v);                                                                                              \
+        if (v->arena != NULL)                                                                                        \
+        {                                                                                                            \
+            ArenaReset(v->arena);                                                                                    \
+        }                                                                                                            \
+        else                                                                                                         \
+        {                                                                                                            \
+            VectorResize(NULL, v->items, v->capacity * sizeof(Type), 0);                                             \
+        }                                                                                                            \
+        v->items = NULL;                                                                                             \
+        v->count = 0;                                                                                                \
+        v->capacity = 0;                                                                                             \
+    }
+
+/**
+ * Defines Name##AppendRows(v, stmt), which steps the statement to the end and appends one item per row.
+ * ReadRow(Type *item, sqlite3_stmt *stmt) fills an item from the current row.
+ * Returns SQLITE_DONE or the sqlite3 error code of the failing step.
+ */
+#define DEFINE_VECTOR_ROWS(Name, Type, ReadRow)                                                                      \
+    static inline int Name##AppendRows(Name *v, sqlite3_stmt *stmt)                                                  \
+    {                                                                                                                \
+        int rs;                                                                                                      \
+        while ((rs = sqlite3_step(stmt)) == SQLITE_ROW)                                                              \
+        {                                                                                                            \
+            ReadRow(Name##Push(v), stmt);                                                                            \
+        }                                                                                                            \
+        return rs;                                                                                                   \
+    }
+
+#endif // VECTOR_H
@@ -0,0 +1,159 @@
+#include <sqlite3.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+#include "work_pool.h"
+
+// Chunks [next, end) not taken yet, the owner takes from next, thieves from end
+typedef struct {
+    pthread_mutex_t lock;
+    int next;
+    int end;
+} ChunkQueue;
+
+typedef struct {
+    ConnectionPool *pool;
+    ChunkTask task;
+    void *ctx;
+    ChunkQueue queues[POOL_MAX_READERS];
+    int workerCount;
+} ChunkRun;
+
+typedef struct {
+    ChunkRun *run;
+    int index;
+    int result;
+    int stolen;
+} ChunkWorker;
+
+static double NowSeconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int TakeOwn(ChunkQueue *queue)
+{
+    pthread_mutex_lock(&queue->lock);
+    int chunk = queue->next < queue->end ? queue->next++ : -1;
+    pthread_mutex_unlock(&queue->lock);
+    return chunk;
+}
+
+static int Steal(ChunkRun *run, int self)
+{
+    // Chunks left can only shrink, so retry until every queue is seen empty
+    for (;;)
+    {
+        int victim = -1;
+        int most = 0;
+        for (int i = 0; i < run->workerCount; i++)
+        {
+            if (i == self)
+            {
+                continue;
+            }
+            pthread_mutex_lock(&run->queues[i].lock);
+            int left = run->queues[i].end - run->queues[i].next;
+            pthread_mutex_unlock(&run->queues[i].lock);
+            if (left > most)
+            {
+                most = left;
+                victim = i;
+            }
+        }
+        if (victim < 0)
+        {
+            return -1;
+        }
+
+        ChunkQueue *queue = &run->queues[victim];
+        pthread_mutex_lock(&queue->lock);
+        int chunk = queue->next < queue->end ? --queue->end : -1;
+        pthread_mutex_unlock(&queue->lock);
+        if (chunk >= 0)
+        {
+            return chunk;
+        }
+    }
+}
+
+static void *WorkerMain(void *pWorker)
+{
+    ChunkWorker *worker = pWorker;
+    ChunkRun *run = worker->run;
+    // The reader stays bound to this thread for the whole run
+    sqlite3 *db = PoolAcquireReader(run->pool, worker->index);
+    if (db == NULL)
+    {
+        worker->result = SQLITE_MISUSE;
+        return NULL;
+    }
+    while (worker->result == SQLITE_OK)
+    {
+        int chunk = TakeOwn(&run->queues[worker->index]);
+        if (chunk < 0 && (chunk = Steal(run, worker->index)) >= 0)
+        {
+            worker->stolen++;
+        }
+        if (chunk < 0)
+        {
+            break;
+        }
+        worker->result = run->task(db, chunk, run->ctx);
+    }
+    PoolRelease(run->pool, db);
+    return NULL;
+}
+
+int RunChunks(ConnectionPool *pool, int chunkCount, ChunkTask task, void *ctx, ChunkStats *stats)
+{
+    double start = NowSeconds();
+    ChunkRun run = {.pool = pool, .task = task, .ctx = ctx};
+    run.workerCount = PoolReaderCount(pool) < chunkCount ? PoolReaderCount(pool) : chunkCount;
+    for (int i = 0; i < run.workerCount; i++)
+    {
+        pthread_mutex_init(&run.queues[i].lock, NULL);
+        run.queues[i].next = (int)((long)chunkCount * i / run.workerCount);
+        run.queues[i].end = (int)((long)chunkCount * (i + 1) / run.workerCount);
+    }
+
+    ChunkWorker workers[POOL_MAX_READERS];
+    pthread_t threads[POOL_MAX_READERS];
+    int started = 0;
+    for (; started < run.workerCount; started++)
+    {
+        workers[started] = (ChunkWorker){.run = &run, .index = started, .result = SQLITE_OK};
+        if (pthread_create(&threads[started], NULL, WorkerMain, &workers[started]) != 0)
+        {
+            fprintf(stderr, "Could not start worker %d.\n", started);
+            break;
+        }
+    }
+    // Chunks of workers that did not start are stolen by the others
+    int rs = started > 0 || chunkCount <= 0 ? SQLITE_OK : SQLITE_ERROR;
+    int stolen = 0;
+    for (int i = 0; i < started; i++)
+    {
+        pthread_join(threads[i], NULL);
+        stolen += workers[i].stolen;
+        if (workers[i].result != SQLITE_OK && rs == SQLITE_OK)
+        {
+            rs = workers[i].result;
+        }
+    }
+    for (int i = 0; i < run.workerCount; i++)
+    {
+        pthread_mutex_destroy(&run.queues[i].lock);
+    }
+
+    if (stats != NULL)
+    {
+        stats->workers = started;
+        stats->stolen = stolen;
+        stats->seconds = NowSeconds() - start;
+    }
+    return rs;
+}
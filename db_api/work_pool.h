@@ -0,0 +1,35 @@
+#ifndef WORK_POOL_H
+#define WORK_POOL_H
+
+#include <sqlite3.h>
+#include "pool.h"
+
+// Runs one chunk of a partitioned job on the reader bound to the calling thread, returns SQLITE_OK or an error code
+typedef int (*ChunkTask)(sqlite3 *db, int chunk, void *ctx);
+
+typedef struct {
+    int workers;    // threads started, one per reader
+    int stolen;     // chunks a worker took from another worker's queue
+    double seconds; // wall time of the run
+} ChunkStats;
+
+/**
+ * @brief Runs chunks 0 to chunkCount - 1 of a job on one worker thread per reader of the pool.
+ *
+ * Every worker starts with a contiguous share of the chunks and takes them from the front. A worker that
+ * runs out steals from the back of the worker with the most chunks left, so uneven chunks even out without
+ * a shared counter on every chunk. Chunks may finish in any order: results belong in per-chunk slots of ctx
+ * and are merged by the caller afterwards.
+ *
+ * Connections are not put in a snapshot here, see PoolBeginSnapshot.
+ *
+ * @param pool Pointer to the connection pool, no reader of it may be held by another thread.
+ * @param chunkCount Number of chunks.
+ * @param task Callback running one chunk, called concurrently from the workers.
+ * @param ctx Passed to the callback.
+ * @param stats Pointer where the statistics of the run are stored, may be NULL.
+ * @returns SQLITE_OK, the first error returned by a chunk, or SQLITE_ERROR if no worker could be started.
+ */
+int RunChunks(ConnectionPool *pool, int chunkCount, ChunkTask task, void *ctx, ChunkStats *stats);
+
+#endif // WORK_POOL_H
@@ -8,13 +8,104 @@
 #include "db_api/orders.h"
 #include "main.h"
 #include "menu.h"
+#include "batch.h"
+#include "db_api/pool.h"
+#include "db_api/parallel_reports.h"
 
-int main(void)
+int main(int argc, char **argv)
 {
+    // Non-interactive modes:
+    //   hw3 --batch <file|->           runs commands without prompting
+    //   hw3 --import <file.csv> [chunk] bulk loads orders from CSV
+    //   hw3 --all-reports [readers]     runs all reports concurrently in one snapshot
+    //   hw3 --parallel-report <cheapest-offers|cheapest-shop> [readers]
+    //                                   splits one report by client over the readers
+    FILE *batchInput = NULL;
+    const char *importPath = NULL;
+    int importChunk = 0;
+    int allReports = 0;
+    const char *parallelReport = NULL;
+    int reportReaders = 4;
+    if (argc > 1)
+    {
+        if (strcmp(argv[1], "--batch") == 0 && argc == 3)
+        {
+            batchInput = strcmp(argv[2], "-") == 0 ? stdin : fopen(argv[2], "r");
+            if (batchInput == NULL)
+            {
+                fprintf(stderr, "Could not open batch file '%s'\n", argv[2]);
+                return EXIT_FAILURE;
+            }
+        }
+        else if (strcmp(argv[1], "--import") == 0 && (argc == 3 || argc == 4))
+        {
+            importPath = argv[2];
+            importChunk = argc == 4 ? atoi(argv[3]) : 0;
+        }
+        else if (strcmp(argv[1], "--all-reports") == 0 && (argc == 2 || argc == 3))
+        {
+            allReports = 1;
+            reportReaders = argc == 3 ? atoi(argv[2]) : reportReaders;
+        }
+        else if (strcmp(argv[1], "--parallel-report") == 0 && (argc == 3 || argc == 4) &&
+                 (strcmp(argv[2], "cheapest-offers") == 0 || strcmp(argv[2], "cheapest-shop") == 0))
+        {
+            parallelReport = argv[2];
+            reportReaders = argc == 4 ? atoi(argv[3]) : reportReaders;
+        }
+        else
+        {
+            fprintf(stderr, "Usage: %s [--batch <file|->] [--import <file.csv> [chunk]] [--all-reports [readers]]\n"
+                            "       [--parallel-report <cheapest-offers|cheapest-shop> [readers]]\n",
+                    argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (allReports || parallelReport != NULL)
+    {
+        ConnectionPool *pool;
+        int rs = PoolOpen(NULL, reportReaders, &pool);
+        if (rs == SQLITE_OK)
+        {
+            if (allReports)
+            {
+                rs = RunAllReports(pool, stdout);
+            }
+            else if (strcmp(parallelReport, "cheapest-offers") == 0)
+            {
+                rs = PrintCheapestOffersParallel(pool, stdout);
+            }
+            else
+            {
+                rs = FindCheapestShopParallel(pool, stdout);
+            }
+            PoolClose(pool);
+        }
+        return rs == SQLITE_OK ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
 
     sqlite3 *db = NULL;
     db_init(&db);
 
+    if (batchInput != NULL)
+    {
+        int failures = RunBatch(db, batchInput);
+        if (batchInput != stdin)
+        {
+            fclose(batchInput);
+        }
+        db_close(db);
+        return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if (importPath != NULL)
+    {
+        int rs = RunImport(db, importPath, importChunk);
+        db_close(db);
+        return rs == SQLITE_OK ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
     int option;
     // Get menu selection and check if it's not 0
     while ((option = GetMenuSelection()) != 0)
@@ -60,7 +151,7 @@ int main(void)
         }
     }
 
-    sqlite3_close(db); // Close the database connection
+    db_close(db); // Finalize cached statements and close the database connection
 
     return 0;
 }
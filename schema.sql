@@ -1,3 +1,6 @@
+-- Schema after all migrations in db_api/migrations.c (PRAGMA user_version = 6), dumped with .schema.
+-- The migrations are authoritative; regenerate this file whenever a migration is added.
+-- client_shop_cost and its triggers are not part of it, the sql analytics engine creates them (EnableClientShopCost).
 CREATE TABLE shops (id INTEGER PRIMARY KEY, name TEXT);
 CREATE TABLE products (id INTEGER PRIMARY KEY, name TEXT);
 CREATE TABLE offers (id INTEGER PRIMARY KEY, shop_id INTEGER, product_id INTEGER, price REAL, FOREIGN KEY(shop_id) REFERENCES shops(id), FOREIGN KEY(product_id) REFERENCES products(id));
@@ -11,4 +14,19 @@ CREATE TABLE IF NOT EXISTS "orders" (
 	CONSTRAINT "fk_orders_products" FOREIGN KEY("product_id") REFERENCES products("id"),
 	PRIMARY KEY("id" AUTOINCREMENT)
 );
-CREATE TABLE sqlite_sequence(name,seq);
+CREATE INDEX idx_offers_product_price ON offers(product_id, price, shop_id);
+CREATE INDEX idx_orders_product ON orders(product_id);
+CREATE VIRTUAL TABLE products_fts USING fts5(name, content='products', content_rowid='id', tokenize='trigram')
+/* products_fts(name) */;
+CREATE VIRTUAL TABLE products_prefix USING fts5(name, content='products', content_rowid='id', prefix='1 2')
+/* products_prefix(name) */;
+CREATE TRIGGER products_fts_ai AFTER INSERT ON products BEGIN  INSERT INTO products_fts(rowid, name) VALUES (new.id, new.name);  INSERT INTO products_prefix(rowid, name) VALUES (new.id, new.name); END;
+CREATE TRIGGER products_fts_ad AFTER DELETE ON products BEGIN  INSERT INTO products_fts(products_fts, rowid, name) VALUES ('delete', old.id, old.name);  INSERT INTO products_prefix(products_prefix, rowid, name) VALUES ('delete', old.id, old.name); END;
+CREATE TRIGGER products_fts_au AFTER UPDATE OF id, name ON products BEGIN  INSERT INTO products_fts(products_fts, rowid, name) VALUES ('delete', old.id, old.name);  INSERT INTO products_prefix(products_prefix, rowid, name) VALUES ('delete', old.id, old.name);  INSERT INTO products_fts(rowid, name) VALUES (new.id, new.name);  INSERT INTO products_prefix(rowid, name) VALUES (new.id, new.name); END;
+CREATE TABLE product_best_offer (product_id INTEGER NOT NULL, offer_id INTEGER NOT NULL, shop_id INTEGER, price REAL NOT NULL, PRIMARY KEY (product_id, offer_id)) WITHOUT ROWID;
+CREATE TRIGGER offers_best_ai AFTER INSERT ON offers BEGIN  DELETE FROM product_best_offer WHERE product_id = new.product_id;  INSERT INTO product_best_offer SELECT product_id, id, shop_id, price FROM offers   WHERE product_id = new.product_id   AND price = (SELECT MIN(price) FROM offers WHERE product_id = new.product_id); END;
+CREATE TRIGGER offers_best_ad AFTER DELETE ON offers BEGIN  DELETE FROM product_best_offer WHERE product_id = old.product_id;  INSERT INTO product_best_offer SELECT product_id, id, shop_id, price FROM offers   WHERE product_id = old.product_id   AND price = (SELECT MIN(price) FROM offers WHERE product_id = old.product_id); END;
+CREATE TRIGGER offers_best_au AFTER UPDATE OF id, product_id, shop_id, price ON offers BEGIN  DELETE FROM product_best_offer WHERE product_id IN (old.product_id, new.product_id);  INSERT INTO product_best_offer SELECT product_id, id, shop_id, price FROM offers   WHERE product_id IN (old.product_id, new.product_id)   AND price = (SELECT MIN(price) FROM offers AS m WHERE m.product_id = offers.product_id); END;
+CREATE INDEX idx_orders_client_product ON orders(client_id, product_id);
+CREATE INDEX idx_clients_name ON clients(last_name, first_name);
+CREATE INDEX idx_products_name ON products(name);
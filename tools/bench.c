@@ -0,0 +1,873 @@
+// Benchmark runner for the reports and the hot db_api calls.
+//
+// Reports run with stdout redirected to /dev/null, rows are counted through the SQLite
+// row trace. Results (p50/p95/p99 wall time, rows per second, peak RSS) are written as JSON,
+// one benchmark per line, so a stored run can be used as a baseline for --compare.
+//
+// Usage: bench [--db path] [--reps N] [--iterations N] [--out file]
+//              [--compare baseline.json] [--threshold percent]
+
+#include <sqlite3.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <pthread.h>
+#include "../db_api/db.h"
+#include "../db_api/orders.h"
+#include "../db_api/product.h"
+#include "../db_api/clients.h"
+#include "../db_api/stmt_cache.h"
+#include "../db_api/config.h"
+#include "../db_api/offers.h"
+#include "../db_api/analytics.h"
+#include "../db_api/catalog.h"
+#include "../db_api/entity_cache.h"
+#include "../db_api/arena.h"
+#include "../db_api/search_cursor.h"
+#include "../db_api/order_writer.h"
+#include "../db_api/intern.h"
+
+#define MAX_BENCHMARKS 32
+#define NAME_LEN 64
+
+typedef struct {
+    char name[NAME_LEN];
+    int iterations;
+    double p50;
+    double p95;
+    double p99;
+    long rows;
+    double rowsPerSec;
+} BenchResult;
+
+typedef struct {
+    const char *dbPath;
+    int reps;
+    int iterations;
+    const char *outPath;
+    const char *comparePath;
+    double threshold; // allowed slowdown in percent before a benchmark counts as regressed
+} BenchOptions;
+
+typedef void (*ReportFn)(sqlite3 *db);
+
+static long rowCounter = 0;
+
+static int CountRows(unsigned type, void *ctx, void *p, void *x)
+{
+    (void)ctx;
+    (void)p;
+    (void)x;
+    if (type == SQLITE_TRACE_ROW)
+    {
+        rowCounter++;
+    }
+    return 0;
+}
+
+static double NowMs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1e6;
+}
+
+/**
+ * @brief Highest resident set size of the whole process so far, not of a single benchmark.
+ */
+static long PeakRssKb(void)
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+static int CompareDoubles(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of sorted samples
+static double Percentile(const double *sorted, int count, double pct)
+{
+    int rank = (int)(pct / 100.0 * count + 0.999999);
+    if (rank < 1)
+    {
+        rank = 1;
+    }
+    if (rank > count)
+    {
+        rank = count;
+    }
+    return sorted[rank - 1];
+}
+
+static void Summarize(BenchResult *result, const char *name, double *samples, int count, long rows)
+{
+    qsort(samples, (size_t)count, sizeof(double), CompareDoubles);
+    double total = 0.0;
+    for (int i = 0; i < count; i++)
+    {
+        total += samples[i];
+    }
+    snprintf(result->name, sizeof(result->name), "%s", name);
+    result->iterations = count;
+    result->p50 = Percentile(samples, count, 50);
+    result->p95 = Percentile(samples, count, 95);
+    result->p99 = Percentile(samples, count, 99);
+    result->rows = rows;
+    result->rowsPerSec = total > 0.0 ? rows / (total / 1000.0) : 0.0;
+    fprintf(stderr, "%-40s p50 %10.3f ms  p95 %10.3f ms  rows %ld\n", name, result->p50, result->p95, rows);
+}
+
+static void BenchReport(sqlite3 *db, const char *name, ReportFn report, int reps, BenchResult *result)
+{
+    double *samples = malloc((size_t)reps * sizeof(double));
+    if (samples == NULL)
+    {
+        fprintf(stderr, "Memory allocation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    long rowsBefore = rowCounter;
+    for (int i = 0; i < reps; i++)
+    {
+        double start = NowMs();
+        report(db);
+        fflush(stdout);
+        samples[i] = NowMs() - start;
+    }
+    Summarize(result, name, samples, reps, rowCounter - rowsBefore);
+    free(samples);
+}
+
+// Recomputes the summaries behind the cheapest shop and savings reports on every rep. The price matrix is
+// kept while offers do not change, so only the first matrix rep includes building it
+static void BenchCostSummaries(sqlite3 *db, const char *engine, int reps, BenchResult *result)
+{
+    double *samples = malloc((size_t)reps * sizeof(double));
+    if (samples == NULL)
+    {
+        fprintf(stderr, "Memory allocation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    char name[NAME_LEN];
+    snprintf(name, sizeof(name), "ClientCostSummaries/%s", engine);
+    long rowsBefore = rowCounter;
+    for (int i = 0; i < reps; i++)
+    {
+        const ClientCostSummary *summaries;
+        size_t count;
+        double start = NowMs();
+        SetAnalyticsEngine(db, engine);
+        GetClientCostSummaries(db, &summaries, &count);
+        samples[i] = NowMs() - start;
+    }
+    Summarize(result, name, samples, reps, rowCounter - rowsBefore);
+    free(samples);
+    SetAnalyticsEngine(db, "auto");
+}
+
+static int QueryInt(sqlite3 *db, const char *sql)
+{
+    sqlite3_stmt *stmt;
+    int value = 0;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) == SQLITE_OK && sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        value = sqlite3_column_int(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    return value;
+}
+
+// Existing order id at or after a random point of the id range
+static int RandomOrderId(sqlite3 *db, int minId, int maxId)
+{
+    sqlite3_stmt *stmt;
+    int id = minId;
+    int target = minId + rand() % (maxId - minId + 1);
+    if (sqlite3_prepare_v2(db, "SELECT id FROM orders WHERE id >= ?1 ORDER BY id LIMIT 1;", -1, &stmt, NULL) == SQLITE_OK)
+    {
+        sqlite3_bind_int(stmt, 1, target);
+        if (sqlite3_step(stmt) == SQLITE_ROW)
+        {
+            id = sqlite3_column_int(stmt, 0);
+        }
+    }
+    sqlite3_finalize(stmt);
+    return id;
+}
+
+/**
+ * @brief Order write and lookup microbenchmarks. Every write is its own autocommit transaction
+ * like in the interactive program, inserted orders are deleted again and modified orders get
+ * their original amount back, so the database content is unchanged afterwards.
+ */
+static int BenchOrderCalls(sqlite3 *db, int iterations, BenchResult *results)
+{
+    int minId = QueryInt(db, "SELECT MIN(id) FROM orders;");
+    int maxId = QueryInt(db, "SELECT MAX(id) FROM orders;");
+    int clientId = QueryInt(db, "SELECT MIN(id) FROM clients WHERE id > 0;");
+    int productId = QueryInt(db, "SELECT MIN(id) FROM products WHERE id > 0;");
+    if (maxId <= 0 || clientId <= 0 || productId <= 0)
+    {
+        fprintf(stderr, "Database has no orders, clients or products to benchmark against.\n");
+        return 0;
+    }
+
+    double *samples = malloc((size_t)iterations * sizeof(double));
+    int *ids = malloc((size_t)iterations * sizeof(int));
+    if (samples == NULL || ids == NULL)
+    {
+        fprintf(stderr, "Memory allocation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    int count = 0;
+
+    for (int i = 0; i < iterations; i++)
+    {
+        ids[i] = RandomOrderId(db, minId, maxId);
+    }
+
+    long rowsBefore = rowCounter;
+    for (int i = 0; i < iterations; i++)
+    {
+        Order order = {0};
+        double start = NowMs();
+        GetOrderById(db, ids[i], &order);
+        samples[i] = NowMs() - start;
+    }
+    Summarize(&results[count++], "GetOrderById", samples, iterations, rowCounter - rowsBefore);
+
+    // One vector reused across clients, cleared between them
+    int maxClient = QueryInt(db, "SELECT MAX(id) FROM clients;");
+    OrderVector orders;
+    OrderVectorInit(&orders);
+    long amounts = 0;
+    rowsBefore = rowCounter;
+    for (int i = 0; i < iterations; i++)
+    {
+        double start = NowMs();
+        OrderVectorClear(&orders);
+        GetClientOrders(db, 1 + rand() % maxClient, &orders);
+        for (size_t j = 0; j < orders.count; j++)
+        {
+            amounts += orders.items[j].amount;
+        }
+        samples[i] = NowMs() - start;
+    }
+    OrderVectorFree(&orders);
+    Summarize(&results[count++], "GetClientOrders", samples, iterations, rowCounter - rowsBefore);
+    if (amounts < 0)
+    {
+        fprintf(stderr, "Negative order amounts.\n");
+    }
+
+    // Cheapest offer of the ordered products, a point lookup whatever the number of offers
+    int *productIds = malloc((size_t)iterations * sizeof(int));
+    if (productIds == NULL)
+    {
+        fprintf(stderr, "Memory allocation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < iterations; i++)
+    {
+        Order order = {0};
+        GetOrderById(db, ids[i], &order);
+        productIds[i] = order.product_id;
+    }
+    rowsBefore = rowCounter;
+    for (int i = 0; i < iterations; i++)
+    {
+        Offer offer = {0};
+        double start = NowMs();
+        GetCheapestOffer(db, productIds[i], &offer);
+        samples[i] = NowMs() - start;
+    }
+    Summarize(&results[count++], "GetCheapestOffer", samples, iterations, rowCounter - rowsBefore);
+    free(productIds);
+
+    long rows = 0;
+    for (int i = 0; i < iterations; i++)
+    {
+        Order order = {0};
+        GetOrderById(db, ids[i], &order);
+        int originalAmount = order.amount;
+        order.amount = originalAmount + 1;
+
+        rowsBefore = rowCounter;
+        double start = NowMs();
+        ModifyOrder(db, &order);
+        samples[i] = NowMs() - start;
+        rows += rowCounter - rowsBefore;
+
+        order.amount = originalAmount;
+        ModifyOrder(db, &order);
+    }
+    Summarize(&results[count++], "ModifyOrder", samples, iterations, rows);
+
+    rowsBefore = rowCounter;
+    for (int i = 0; i < iterations; i++)
+    {
+        Order order = {.id = 0, .client_id = clientId, .product_id = productId, .amount = 1};
+        double start = NowMs();
+        InsertOrder(db, &order);
+        samples[i] = NowMs() - start;
+        ids[i] = order.id;
+    }
+    Summarize(&results[count++], "InsertOrder", samples, iterations, rowCounter - rowsBefore);
+
+    rowsBefore = rowCounter;
+    for (int i = 0; i < iterations; i++)
+    {
+        double start = NowMs();
+        DeleteOrder(db, ids[i]);
+        samples[i] = NowMs() - start;
+    }
+    Summarize(&results[count++], "DeleteOrder", samples, iterations, rowCounter - rowsBefore);
+
+    free(samples);
+    free(ids);
+    return count;
+}
+
+// Order entry from several threads at once, through the group-commit writer
+#define GROUP_COMMIT_PRODUCERS 8
+
+typedef struct {
+    OrderWriter *writer;
+    OrderWriteKind kind;
+    Order order; // template, the id comes from ids for deletes
+    int *ids;
+    double *samples;
+    int count;
+} Producer;
+
+static void *ProduceWrites(void *pProducer)
+{
+    Producer *producer = pProducer;
+    for (int i = 0; i < producer->count; i++)
+    {
+        Order order = producer->order;
+        order.id = producer->kind == ORDER_WRITE_DELETE ? producer->ids[i] : 0;
+        double start = NowMs();
+        OrderWrite *write = SubmitOrderWrite(producer->writer, producer->kind, &order);
+        if (write != NULL && WaitOrderWrite(write, &order) == SQLITE_DONE && producer->kind == ORDER_WRITE_INSERT)
+        {
+            producer->ids[i] = order.id;
+        }
+        producer->samples[i] = NowMs() - start;
+    }
+    return NULL;
+}
+
+// Runs the same write on all producers, the samples are the time from submit to commit
+static void RunProducers(OrderWriter *writer, OrderWriteKind kind, const Order *order, int *ids, double *samples,
+                         int iterations)
+{
+    Producer producers[GROUP_COMMIT_PRODUCERS];
+    pthread_t threads[GROUP_COMMIT_PRODUCERS];
+    int started = 0;
+    for (int i = 0; i < GROUP_COMMIT_PRODUCERS; i++)
+    {
+        int first = (int)((long)iterations * i / GROUP_COMMIT_PRODUCERS);
+        int end = (int)((long)iterations * (i + 1) / GROUP_COMMIT_PRODUCERS);
+        producers[i] = (Producer){writer, kind, *order, ids + first, samples + first, end - first};
+        if (pthread_create(&threads[i], NULL, ProduceWrites, &producers[i]) != 0)
+        {
+            ProduceWrites(&producers[i]); // Runs on this thread instead
+            continue;
+        }
+        threads[started++] = threads[i];
+    }
+    for (int i = 0; i < started; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+}
+
+static int BenchGroupCommit(sqlite3 *db, const char *dbPath, int iterations, BenchResult *results)
+{
+    int clientId = QueryInt(db, "SELECT MIN(id) FROM clients WHERE id > 0;");
+    int productId = QueryInt(db, "SELECT MIN(id) FROM products WHERE id > 0;");
+    if (clientId <= 0 || productId <= 0)
+    {
+        fprintf(stderr, "Database has no clients or products to benchmark against.\n");
+        return 0;
+    }
+    OrderWriter *writer;
+    if (OrderWriterOpen(dbPath, 0, -1.0, &writer) != SQLITE_OK)
+    {
+        return 0;
+    }
+
+    double *samples = malloc((size_t)iterations * sizeof(double));
+    int *ids = calloc((size_t)iterations, sizeof(int));
+    if (samples == NULL || ids == NULL)
+    {
+        fprintf(stderr, "Memory allocation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    int count = 0;
+
+    Order order = {.id = 0, .client_id = clientId, .product_id = productId, .amount = 1};
+    double start = NowMs();
+    RunProducers(writer, ORDER_WRITE_INSERT, &order, ids, samples, iterations);
+    Summarize(&results[count++], "GroupCommitInsert", samples, iterations, iterations);
+    RunProducers(writer, ORDER_WRITE_DELETE, &order, ids, samples, iterations);
+    Summarize(&results[count++], "GroupCommitDelete", samples, iterations, iterations);
+    double elapsed = NowMs() - start;
+
+    OrderWriterStats stats;
+    GetOrderWriterStats(writer, &stats);
+    fprintf(stderr, "Group commit: %ld writes from %d threads in %ld transactions (largest %d), %.0f writes/s, "
+            "%.1f ms committing\n", stats.writes, GROUP_COMMIT_PRODUCERS, stats.batches, stats.largestBatch,
+            stats.writes / (elapsed / 1e3), stats.commitSeconds * 1e3);
+    OrderWriterClose(writer);
+
+    free(samples);
+    free(ids);
+    return count;
+}
+
+// Operators look up the same few hundred ids all day, one in ten of them mistyped (missing)
+#define HOT_IDS 300
+
+static int BenchEntityLookups(sqlite3 *db, int iterations, BenchResult *results)
+{
+    int maxProduct = QueryInt(db, "SELECT MAX(id) FROM products;");
+    int maxClient = QueryInt(db, "SELECT MAX(id) FROM clients;");
+    int productIds[HOT_IDS];
+    int clientIds[HOT_IDS];
+    for (int i = 0; i < HOT_IDS; i++)
+    {
+        productIds[i] = i % 10 == 0 ? maxProduct + 1 + i : 1 + rand() % (maxProduct > 0 ? maxProduct : 1);
+        clientIds[i] = i % 10 == 0 ? maxClient + 1 + i : 1 + rand() % (maxClient > 0 ? maxClient : 1);
+    }
+
+    double *samples = malloc((size_t)iterations * sizeof(double));
+    if (samples == NULL)
+    {
+        fprintf(stderr, "Memory allocation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    int count = 0;
+
+    long rowsBefore = rowCounter;
+    for (int i = 0; i < iterations; i++)
+    {
+        Product product = {0};
+        double start = NowMs();
+        GetProductById(db, productIds[rand() % HOT_IDS], &product);
+        samples[i] = NowMs() - start;
+        FreeProduct(&product);
+    }
+    Summarize(&results[count++], "GetProductById", samples, iterations, rowCounter - rowsBefore);
+
+    rowsBefore = rowCounter;
+    for (int i = 0; i < iterations; i++)
+    {
+        Client client = {0};
+        double start = NowMs();
+        GetClientById(db, clientIds[rand() % HOT_IDS], &client);
+        samples[i] = NowMs() - start;
+        FreeClient(&client);
+    }
+    Summarize(&results[count++], "GetClientById", samples, iterations, rowCounter - rowsBefore);
+
+    free(samples);
+    return count;
+}
+
+// Searches with the rows allocated one by one, or from an arena that is reset after each search
+static int BenchSearches(sqlite3 *db, int iterations, Arena *arena, BenchResult *results)
+{
+    static const char *productTerms[] = {"piim", "juust", "Alma", "kohv", "croissant"};
+    static const char *clientTerms[] = {"Tamm", "Mari", "Rand", "Kask", "Karl"};
+    const int termCount = 5;
+
+    double *samples = malloc((size_t)iterations * sizeof(double));
+    if (samples == NULL)
+    {
+        fprintf(stderr, "Memory allocation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    int count = 0;
+
+    long rowsBefore = rowCounter;
+    for (int i = 0; i < iterations; i++)
+    {
+        Product search = {.id = 0};
+        ShortStringSet(&search.name, productTerms[i % termCount]);
+        ProductVector products;
+        ProductVectorInitArena(&products, arena);
+        double start = NowMs();
+        GetMatchedProducts(db, &search, &products);
+        ProductVectorFree(&products);
+        samples[i] = NowMs() - start;
+    }
+    Summarize(&results[count++], arena != NULL ? "GetMatchedProducts/arena" : "GetMatchedProducts", samples, iterations,
+              rowCounter - rowsBefore);
+
+    rowsBefore = rowCounter;
+    for (int i = 0; i < iterations; i++)
+    {
+        Client search = {.id = 0};
+        ShortStringSet(&search.first_name, clientTerms[i % termCount]);
+        ShortStringSet(&search.last_name, clientTerms[i % termCount]);
+        ClientVector clients;
+        ClientVectorInitArena(&clients, arena);
+        double start = NowMs();
+        GetMatchedClients(db, &search, &clients);
+        ClientVectorFree(&clients);
+        samples[i] = NowMs() - start;
+    }
+    Summarize(&results[count++], arena != NULL ? "GetMatchedClients/arena" : "GetMatchedClients", samples, iterations,
+              rowCounter - rowsBefore);
+
+    free(samples);
+    return count;
+}
+
+static int CountClientRow(const ClientRow *row, void *ctx)
+{
+    *(long *)ctx += row->first_name.length + row->last_name.length;
+    return 0;
+}
+
+static int CountProductRow(const ProductRow *row, void *ctx)
+{
+    *(long *)ctx += row->name.length;
+    return 0;
+}
+
+// The same searches through the row visitors, nothing is copied out of the rows
+static int BenchVisitors(sqlite3 *db, int iterations, BenchResult *results)
+{
+    static const char *productTerms[] = {"piim", "juust", "Alma", "kohv", "croissant"};
+    static const char *clientTerms[] = {"Tamm", "Mari", "Rand", "Kask", "Karl"};
+    const int termCount = 5;
+
+    double *samples = malloc((size_t)iterations * sizeof(double));
+    if (samples == NULL)
+    {
+        fprintf(stderr, "Memory allocation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    int count = 0;
+    long bytes = 0;
+
+    long rowsBefore = rowCounter;
+    for (int i = 0; i < iterations; i++)
+    {
+        Product search = {.id = 0};
+        ShortStringSet(&search.name, productTerms[i % termCount]);
+        double start = NowMs();
+        VisitMatchedProducts(db, &search, CountProductRow, &bytes);
+        samples[i] = NowMs() - start;
+    }
+    Summarize(&results[count++], "VisitMatchedProducts", samples, iterations, rowCounter - rowsBefore);
+
+    rowsBefore = rowCounter;
+    for (int i = 0; i < iterations; i++)
+    {
+        Client search = {.id = 0};
+        ShortStringSet(&search.first_name, clientTerms[i % termCount]);
+        ShortStringSet(&search.last_name, clientTerms[i % termCount]);
+        double start = NowMs();
+        VisitMatchedClients(db, &search, CountClientRow, &bytes);
+        samples[i] = NowMs() - start;
+    }
+    Summarize(&results[count++], "VisitMatchedClients", samples, iterations, rowCounter - rowsBefore);
+
+    free(samples);
+    return bytes < 0 ? 0 : count; // keeps the visited lengths in use
+}
+
+// First page of broad searches, where GetMatchedClients materializes most of the table
+static int BenchCursors(sqlite3 *db, int iterations, Arena *arena, BenchResult *results)
+{
+    double *samples = malloc((size_t)iterations * sizeof(double));
+    if (samples == NULL)
+    {
+        fprintf(stderr, "Memory allocation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    int count = 0;
+
+    long rowsBefore = rowCounter;
+    for (int i = 0; i < iterations; i++)
+    {
+        Client search = {.id = 0};
+        ShortStringSet(&search.first_name, "a");
+        ShortStringSet(&search.last_name, "a");
+        ClientVector clients;
+        ClientVectorInitArena(&clients, arena);
+        SearchCursor *cursor;
+        double start = NowMs();
+        if (OpenClientCursor(db, &search, CLIENT_PAGE_SIZE, &cursor) == SQLITE_OK)
+        {
+            CursorNextClientPage(cursor, &clients);
+            CloseCursor(cursor);
+        }
+        ClientVectorFree(&clients);
+        samples[i] = NowMs() - start;
+    }
+    Summarize(&results[count++], "ClientCursor/first page", samples, iterations, rowCounter - rowsBefore);
+
+    rowsBefore = rowCounter;
+    for (int i = 0; i < iterations; i++)
+    {
+        Product search = {.id = 0};
+        ShortStringSet(&search.name, "a");
+        ProductVector products;
+        ProductVectorInitArena(&products, arena);
+        SearchCursor *cursor;
+        double start = NowMs();
+        if (OpenProductCursor(db, &search, CLIENT_PAGE_SIZE, &cursor) == SQLITE_OK)
+        {
+            CursorNextProductPage(cursor, &products);
+            CloseCursor(cursor);
+        }
+        ProductVectorFree(&products);
+        samples[i] = NowMs() - start;
+    }
+    Summarize(&results[count++], "ProductCursor/first page", samples, iterations, rowCounter - rowsBefore);
+
+    free(samples);
+    return count;
+}
+
+static void WriteJson(FILE *out, const char *dbPath, const char *profile, const BenchResult *results, int count, const StmtCacheStats *cacheStats,
+                      const EntityCacheStats *entityStats, const InternStats *internStats, long peakRssKb)
+{
+    fprintf(out, "{\n");
+    fprintf(out, "  \"database\": \"%s\",\n", dbPath);
+    fprintf(out, "  \"profile\": \"%s\",\n", profile);
+    fprintf(out, "  \"sqlite_version\": \"%s\",\n", sqlite3_libversion());
+    fprintf(out, "  \"stmt_cache\": {\"hits\": %lu, \"misses\": %lu},\n", cacheStats->hits, cacheStats->misses);
+    fprintf(out, "  \"entity_cache\": {\"hits\": %lu, \"negative_hits\": %lu, \"misses\": %lu, \"evictions\": %lu, "
+                 "\"invalidations\": %lu},\n",
+            entityStats->hits, entityStats->negativeHits, entityStats->misses, entityStats->evictions,
+            entityStats->invalidations);
+    fprintf(out, "  \"interned_names\": {\"strings\": %zu, \"bytes\": %zu, \"hits\": %lu, \"inserts\": %lu},\n",
+            internStats->strings, internStats->bytes, internStats->hits, internStats->inserts);
+    fprintf(out, "  \"process_peak_rss_kb\": %ld,\n", peakRssKb);
+    fprintf(out, "  \"benchmarks\": [\n");
+    for (int i = 0; i < count; i++)
+    {
+        const BenchResult *r = &results[i];
+        fprintf(out, "    {\"name\": \"%s\", \"iterations\": %d, \"p50_ms\": %.4f, \"p95_ms\": %.4f, \"p99_ms\": %.4f, "
+                     "\"rows\": %ld, \"rows_per_sec\": %.1f}%s\n",
+                r->name, r->iterations, r->p50, r->p95, r->p99, r->rows, r->rowsPerSec,
+                i + 1 < count ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+}
+
+/**
+ * @brief Reads the benchmark lines of a file written by WriteJson.
+ * @returns Number of benchmarks read, -1 if the file could not be opened.
+ */
+static int ReadBaseline(const char *path, BenchResult *results, int max)
+{
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+    {
+        return -1;
+    }
+    int count = 0;
+    char line[1024];
+    while (count < max && fgets(line, sizeof(line), file) != NULL)
+    {
+        BenchResult *r = &results[count];
+        if (sscanf(line, " {\"name\": \"%63[^\"]\", \"iterations\": %d, \"p50_ms\": %lf, \"p95_ms\": %lf, \"p99_ms\": %lf, "
+                         "\"rows\": %ld, \"rows_per_sec\": %lf",
+                   r->name, &r->iterations, &r->p50, &r->p95, &r->p99, &r->rows, &r->rowsPerSec) == 7)
+        {
+            count++;
+        }
+    }
+    fclose(file);
+    return count;
+}
+
+/**
+ * @brief Compares p50 and p95 against the baseline.
+ * @returns Number of regressed benchmarks.
+ */
+static int CompareWithBaseline(const BenchResult *results, int count, const BenchResult *baseline, int baselineCount, double threshold)
+{
+    int regressions = 0;
+    double limit = 1.0 + threshold / 100.0;
+    fprintf(stderr, "\n%-40s %12s %12s %9s\n", "benchmark", "baseline p50", "current p50", "change");
+    for (int i = 0; i < count; i++)
+    {
+        const BenchResult *base = NULL;
+        for (int j = 0; j < baselineCount; j++)
+        {
+            if (strcmp(baseline[j].name, results[i].name) == 0)
+            {
+                base = &baseline[j];
+                break;
+            }
+        }
+        if (base == NULL)
+        {
+            fprintf(stderr, "%-40s %12s %12.3f %9s\n", results[i].name, "-", results[i].p50, "new");
+            continue;
+        }
+
+        double change = base->p50 > 0.0 ? (results[i].p50 / base->p50 - 1.0) * 100.0 : 0.0;
+        int regressed = (base->p50 > 0.0 && results[i].p50 > base->p50 * limit) ||
+                        (base->p95 > 0.0 && results[i].p95 > base->p95 * limit);
+        fprintf(stderr, "%-40s %12.3f %12.3f %+8.1f%%%s\n", results[i].name, base->p50, results[i].p50, change,
+                regressed ? "  REGRESSION" : "");
+        regressions += regressed;
+    }
+    return regressions;
+}
+
+static void PrintUsage(const char *program)
+{
+    fprintf(stderr,
+            "Usage: %s [--db path] [--reps N] [--iterations N] [--out file]\n"
+            "          [--compare baseline.json] [--threshold percent]\n",
+            program);
+}
+
+static int ParseOptions(int argc, char **argv, BenchOptions *opt)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (value == NULL)
+        {
+            fprintf(stderr, "Missing value for %s\n", arg);
+            return 0;
+        }
+        i++;
+        if (strcmp(arg, "--db") == 0)
+            opt->dbPath = value;
+        else if (strcmp(arg, "--reps") == 0)
+            opt->reps = atoi(value);
+        else if (strcmp(arg, "--iterations") == 0)
+            opt->iterations = atoi(value);
+        else if (strcmp(arg, "--out") == 0)
+            opt->outPath = value;
+        else if (strcmp(arg, "--compare") == 0)
+            opt->comparePath = value;
+        else if (strcmp(arg, "--threshold") == 0)
+            opt->threshold = atof(value);
+        else
+        {
+            fprintf(stderr, "Unknown option %s\n", arg);
+            return 0;
+        }
+    }
+    return opt->reps > 0 && opt->iterations > 0 && opt->threshold >= 0.0;
+}
+
+int main(int argc, char **argv)
+{
+    BenchOptions opt = {
+        .dbPath = DB_PATH,
+        .reps = 5,
+        .iterations = 200,
+        .outPath = NULL,
+        .comparePath = NULL,
+        .threshold = 10.0};
+
+    if (!ParseOptions(argc, argv, &opt))
+    {
+        PrintUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // JSON goes to the real stdout (or --out), everything the reports print goes to the sink
+    FILE *json = opt.outPath ? fopen(opt.outPath, "w") : fdopen(dup(STDOUT_FILENO), "w");
+    if (json == NULL)
+    {
+        fprintf(stderr, "Could not open output for results.\n");
+        return EXIT_FAILURE;
+    }
+    if (freopen("/dev/null", "w", stdout) == NULL)
+    {
+        fprintf(stderr, "Could not redirect stdout.\n");
+        return EXIT_FAILURE;
+    }
+
+    srand(1);
+    sqlite3 *db = NULL;
+    db_open(&db, opt.dbPath);
+    // db_open already exited if the config is invalid, this only picks up the profile name for the results
+    DbConfig config;
+    LoadDbConfig(&config);
+    sqlite3_trace_v2(db, SQLITE_TRACE_ROW, CountRows, NULL);
+    CatalogStats catalogStats;
+    if (GetCatalogStats(db, &catalogStats) == SQLITE_OK)
+    {
+        fprintf(stderr, "Catalog mirror: %zu products, %zu offers, %zu bytes\n", catalogStats.products,
+                catalogStats.offers, catalogStats.bytes);
+    }
+
+    BenchResult results[MAX_BENCHMARKS];
+    int count = 0;
+
+    BenchReport(db, "PrintOrdersGroupedByClient", PrintOrdersGroupedByClient, opt.reps, &results[count++]);
+    BenchReport(db, "PrintAllOrdersByClientOrderCount", PrintAllOrdersByClientOrderCount, opt.reps, &results[count++]);
+    BenchReport(db, "PrintCheapestOffersForAllClientOrders", PrintCheapestOffersForAllClientOrders, opt.reps, &results[count++]);
+    BenchReport(db, "FindCheapestShopPerClient", FindCheapestShopPerClient, opt.reps, &results[count++]);
+    BenchReport(db, "PrintPotentialSavingsPerClient", PrintPotentialSavingsPerClient, opt.reps, &results[count++]);
+    BenchCostSummaries(db, "sql", opt.reps, &results[count++]);
+    BenchCostSummaries(db, "matrix", opt.reps, &results[count++]);
+    count += BenchOrderCalls(db, opt.iterations, &results[count]);
+    count += BenchSearches(db, opt.iterations, NULL, &results[count]);
+    count += BenchVisitors(db, opt.iterations, &results[count]);
+    Arena *arena = ArenaCreate(0);
+    if (arena != NULL)
+    {
+        count += BenchSearches(db, opt.iterations, arena, &results[count]);
+        count += BenchCursors(db, opt.iterations, arena, &results[count]);
+        ArenaDestroy(arena);
+    }
+    count += BenchEntityLookups(db, opt.iterations, &results[count]);
+    count += BenchGroupCommit(db, opt.dbPath, opt.iterations, &results[count]);
+
+    StmtCacheStats cacheStats;
+    GetStmtCacheStats(db, &cacheStats);
+    EntityCacheStats entityStats;
+    GetEntityCacheStats(db, &entityStats);
+    // Taken before closing, the cached names still hold their references
+    InternStats internStats;
+    GetInternStats(&internStats);
+    db_close(db);
+
+    WriteJson(json, opt.dbPath, config.profile, results, count, &cacheStats, &entityStats, &internStats, PeakRssKb());
+    fclose(json);
+
+    if (opt.comparePath != NULL)
+    {
+        BenchResult baseline[MAX_BENCHMARKS];
+        int baselineCount = ReadBaseline(opt.comparePath, baseline, MAX_BENCHMARKS);
+        if (baselineCount < 0)
+        {
+            fprintf(stderr, "Could not read baseline %s\n", opt.comparePath);
+            return EXIT_FAILURE;
+        }
+        int regressions = CompareWithBaseline(results, count, baseline, baselineCount, opt.threshold);
+        if (regressions > 0)
+        {
+            fprintf(stderr, "%d benchmark(s) regressed by more than %.1f%%\n", regressions, opt.threshold);
+            return 2;
+        }
+        fprintf(stderr, "No regressions against %s\n", opt.comparePath);
+    }
+
+    return 0;
+}
@@ -0,0 +1,600 @@
+// Synthetic dataset generator for scale testing.
+//
+// Fills a fresh database with the shop2.db schema using a fixed seed, so every run with
+// the same arguments produces the same data. Everything is written in one transaction
+// through reused multi-row INSERT statements. Product popularity follows a Zipf distribution
+// and the number of orders per client is heavy tailed (Pareto weights).
+//
+// Usage: gen_data --db <path> [--force] [--seed N] [--shops N] [--products N]
+//                 [--offers-per-product N] [--clients N] [--orders N]
+//                 [--zipf S] [--pareto-alpha A]
+
+#include <sqlite3.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef struct {
+    const char *dbPath;
+    int force;
+    uint64_t seed;
+    int shops;
+    int products;
+    int offersPerProduct;
+    int clients;
+    long orders;
+    double zipfExponent;
+    double paretoAlpha;
+} GenOptions;
+
+static const char *schemaSql =
+    "CREATE TABLE shops (id INTEGER PRIMARY KEY, name TEXT);"
+    "CREATE TABLE products (id INTEGER PRIMARY KEY, name TEXT);"
+    "CREATE TABLE offers (id INTEGER PRIMARY KEY, shop_id INTEGER, product_id INTEGER, price REAL, "
+    "FOREIGN KEY(shop_id) REFERENCES shops(id), FOREIGN KEY(product_id) REFERENCES products(id));"
+    "CREATE TABLE clients (id INTEGER PRIMARY KEY, first_name TEXT, last_name TEXT);"
+    "CREATE TABLE IF NOT EXISTS \"orders\" ("
+    "\"id\" INTEGER NOT NULL UNIQUE,"
+    "\"client_id\" INTEGER,"
+    "\"product_id\" INTEGER,"
+    "\"amount\" INTEGER,"
+    "CONSTRAINT \"fk_orders_clients\" FOREIGN KEY(\"client_id\") REFERENCES clients(\"id\"),"
+    "CONSTRAINT \"fk_orders_products\" FOREIGN KEY(\"product_id\") REFERENCES products(\"id\"),"
+    "PRIMARY KEY(\"id\" AUTOINCREMENT));";
+
+static const char *shopChains[] = {"COOP", "Rimi", "Prisma", "Selver", "Maxima", "Lidl", "Grossi", "Konsum"};
+static const char *districts[] = {"Kesklinn", "Lasnamäe", "Mustamäe", "Kristiine", "Haabersti", "Nõmme", "Pirita", "Kalamaja", "Tartu", "Pärnu"};
+static const char *brands[] = {"Alma", "Farmi", "Tere", "Saaremaa", "Rimi Basic", "Eesti Pagar", "Kalev", "Premia", "Valio", "Nopri", "Rakvere", "Salvest"};
+static const char *goods[] = {"piim", "keefir", "jogurt", "juust", "või", "leib", "sai", "vorst", "sink", "mahl", "šokolaad", "kohv", "tee", "kommid", "müsli", "jäätis", "pelmeenid", "kartulikrõpsud"};
+static const char *sizes[] = {"0.5L", "1L", "1.5L", "200g", "300g", "400g", "500g", "1kg", "60g", "6x0.33L"};
+static const char *firstNames[] = {"Mari", "Karl", "Mart", "Sirje", "Risto", "Martin", "Kadri", "Jaan", "Liis", "Tiit", "Anu", "Peeter", "Kristi", "Andres", "Triin", "Toomas", "Kati", "Rein", "Maarja", "Indrek"};
+static const char *lastNames[] = {"Tamm", "Rand", "Kuusk", "Jõemets", "Narva", "Saar", "Sepp", "Mägi", "Kask", "Kukk", "Ilves", "Pärn", "Koppel", "Lepik", "Oja", "Kallas", "Vaher", "Lill", "Raud", "Teder"};
+
+#define COUNT_OF(a) (sizeof(a) / sizeof((a)[0]))
+
+// splitmix64, small and good enough for synthetic data
+static uint64_t rngState;
+
+static uint64_t NextRandom(void)
+{
+    uint64_t z = (rngState += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// Uniform double in (0, 1)
+static double NextUnit(void)
+{
+    return ((double)(NextRandom() >> 11) + 0.5) / 9007199254740992.0;
+}
+
+static int NextInt(int bound)
+{
+    return (int)(NextRandom() % (uint64_t)bound);
+}
+
+// Walker/Vose alias table, weighted picks cost one random index and one coin flip
+typedef struct {
+    double *prob;
+    int *alias;
+    int n;
+} AliasTable;
+
+static void BuildAliasTable(AliasTable *table, const double *weights, int n)
+{
+    table->prob = malloc((size_t)n * sizeof(double));
+    table->alias = malloc((size_t)n * sizeof(int));
+    int *small = malloc((size_t)n * sizeof(int));
+    int *large = malloc((size_t)n * sizeof(int));
+    if (table->prob == NULL || table->alias == NULL || small == NULL || large == NULL)
+    {
+        fprintf(stderr, "Memory allocation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    table->n = n;
+
+    double total = 0.0;
+    for (int i = 0; i < n; i++)
+    {
+        total += weights[i];
+    }
+
+    // Scale weights so the average is 1, then pair every underfull slot with an overfull one
+    int smallCount = 0;
+    int largeCount = 0;
+    for (int i = 0; i < n; i++)
+    {
+        table->prob[i] = weights[i] * n / total;
+        table->alias[i] = i;
+        if (table->prob[i] < 1.0)
+        {
+            small[smallCount++] = i;
+        }
+        else
+        {
+            large[largeCount++] = i;
+        }
+    }
+    while (smallCount > 0 && largeCount > 0)
+    {
+        int s = small[--smallCount];
+        int l = large[--largeCount];
+        table->alias[s] = l;
+        table->prob[l] -= 1.0 - table->prob[s];
+        if (table->prob[l] < 1.0)
+        {
+            small[smallCount++] = l;
+        }
+        else
+        {
+            large[largeCount++] = l;
+        }
+    }
+    // Leftovers are only off by rounding errors
+    while (largeCount > 0)
+    {
+        table->prob[large[--largeCount]] = 1.0;
+    }
+    while (smallCount > 0)
+    {
+        table->prob[small[--smallCount]] = 1.0;
+    }
+
+    free(small);
+    free(large);
+}
+
+static int SampleAlias(const AliasTable *table)
+{
+    int i = NextInt(table->n);
+    return NextUnit() < table->prob[i] ? i : table->alias[i];
+}
+
+static void FreeAliasTable(AliasTable *table)
+{
+    free(table->prob);
+    free(table->alias);
+}
+
+static void ShuffleIds(int *ids, int n)
+{
+    for (int i = n - 1; i > 0; i--)
+    {
+        int j = NextInt(i + 1);
+        int tmp = ids[i];
+        ids[i] = ids[j];
+        ids[j] = tmp;
+    }
+}
+
+static void Exec(sqlite3 *db, const char *sql)
+{
+    char *errMsg = NULL;
+    if (sqlite3_exec(db, sql, NULL, NULL, &errMsg) != SQLITE_OK)
+    {
+        fprintf(stderr, "Error executing '%s': %s\n", sql, errMsg);
+        sqlite3_free(errMsg);
+        sqlite3_close(db);
+        exit(EXIT_FAILURE);
+    }
+}
+
+static sqlite3_stmt *Prepare(sqlite3 *db, const char *sql)
+{
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "Error preparing statement: %s\n", sqlite3_errmsg(db));
+        sqlite3_close(db);
+        exit(EXIT_FAILURE);
+    }
+    return stmt;
+}
+
+// Steps an insert and resets it for the next row
+static void StepInsert(sqlite3 *db, sqlite3_stmt *stmt)
+{
+    int rs = sqlite3_step(stmt);
+    if (rs != SQLITE_DONE)
+    {
+        fprintf(stderr, "Error executing statement: %s - %s\n", sqlite3_errstr(rs), sqlite3_errmsg(db));
+        sqlite3_close(db);
+        exit(EXIT_FAILURE);
+    }
+    sqlite3_reset(stmt);
+}
+
+// Rows bound into one INSERT statement, multi-row VALUES amortizes the per-statement overhead
+#define ROWS_PER_INSERT 128
+
+// Reused multi-row INSERT, rows are bound one after another and the statement is stepped once full
+typedef struct {
+    sqlite3 *db;
+    const char *prefix;    // "INSERT INTO table (columns) VALUES "
+    int columns;
+    sqlite3_stmt *full;    // ROWS_PER_INSERT rows per statement
+    sqlite3_stmt *tail;    // whatever is left at the end
+    sqlite3_stmt *current;
+    long rowsLeft;
+    int rowsInStmt;
+    int bound;
+} BatchInsert;
+
+static sqlite3_stmt *PrepareMultiRow(sqlite3 *db, const char *prefix, int columns, int rows)
+{
+    size_t len = strlen(prefix) + (size_t)rows * (size_t)(columns * 2 + 3) + 2;
+    char *sql = malloc(len);
+    if (sql == NULL)
+    {
+        fprintf(stderr, "Memory allocation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    char *p = sql + sprintf(sql, "%s", prefix);
+    for (int r = 0; r < rows; r++)
+    {
+        *p++ = r == 0 ? '(' : ',';
+        if (r > 0)
+        {
+            *p++ = '(';
+        }
+        for (int c = 0; c < columns; c++)
+        {
+            *p++ = '?';
+            *p++ = c + 1 < columns ? ',' : ')';
+        }
+    }
+    *p++ = ';';
+    *p = '\0';
+    sqlite3_stmt *stmt = Prepare(db, sql);
+    free(sql);
+    return stmt;
+}
+
+static void BatchInsertBegin(BatchInsert *batch, sqlite3 *db, const char *prefix, int columns, long totalRows)
+{
+    memset(batch, 0, sizeof(BatchInsert));
+    batch->db = db;
+    batch->prefix = prefix;
+    batch->columns = columns;
+    batch->rowsLeft = totalRows;
+    if (totalRows >= ROWS_PER_INSERT)
+    {
+        batch->full = PrepareMultiRow(db, prefix, columns, ROWS_PER_INSERT);
+    }
+}
+
+/**
+ * @brief Gets the statement the next row is bound to.
+ * @param param Set to the parameter index of the first column of the row.
+ */
+static sqlite3_stmt *NextBatchRow(BatchInsert *batch, int *param)
+{
+    if (batch->current == NULL)
+    {
+        if (batch->rowsLeft >= ROWS_PER_INSERT)
+        {
+            batch->current = batch->full;
+            batch->rowsInStmt = ROWS_PER_INSERT;
+        }
+        else
+        {
+            batch->tail = PrepareMultiRow(batch->db, batch->prefix, batch->columns, (int)batch->rowsLeft);
+            batch->current = batch->tail;
+            batch->rowsInStmt = (int)batch->rowsLeft;
+        }
+        batch->bound = 0;
+    }
+    *param = batch->bound * batch->columns + 1;
+    return batch->current;
+}
+
+static void FinishBatchRow(BatchInsert *batch)
+{
+    batch->bound++;
+    batch->rowsLeft--;
+    if (batch->bound == batch->rowsInStmt)
+    {
+        StepInsert(batch->db, batch->current);
+        batch->current = NULL;
+    }
+}
+
+static void BatchInsertEnd(BatchInsert *batch)
+{
+    sqlite3_finalize(batch->full);
+    sqlite3_finalize(batch->tail);
+}
+
+static double Elapsed(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec) + (double)(now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void GenerateShops(sqlite3 *db, const GenOptions *opt)
+{
+    BatchInsert batch;
+    BatchInsertBegin(&batch, db, "INSERT INTO shops (id, name) VALUES ", 2, opt->shops);
+    char name[128];
+    for (int id = 1; id <= opt->shops; id++)
+    {
+        snprintf(name, sizeof(name), "%s %s %d", shopChains[NextInt(COUNT_OF(shopChains))],
+                 districts[NextInt(COUNT_OF(districts))], id);
+        int p;
+        sqlite3_stmt *stmt = NextBatchRow(&batch, &p);
+        sqlite3_bind_int(stmt, p, id);
+        sqlite3_bind_text(stmt, p + 1, name, -1, SQLITE_TRANSIENT);
+        FinishBatchRow(&batch);
+    }
+    BatchInsertEnd(&batch);
+}
+
+static void GenerateProductsAndOffers(sqlite3 *db, const GenOptions *opt)
+{
+    int offersPerProduct = opt->offersPerProduct < opt->shops ? opt->offersPerProduct : opt->shops;
+    BatchInsert productBatch;
+    BatchInsert offerBatch;
+    BatchInsertBegin(&productBatch, db, "INSERT INTO products (id, name) VALUES ", 2, opt->products);
+    BatchInsertBegin(&offerBatch, db, "INSERT INTO offers (id, shop_id, product_id, price) VALUES ", 4,
+                     (long)opt->products * offersPerProduct);
+
+    // Every shop has its own price level, offers vary around product base price * shop level
+    double *shopLevel = malloc((size_t)opt->shops * sizeof(double));
+    int *shopIds = malloc((size_t)opt->shops * sizeof(int));
+    if (shopLevel == NULL || shopIds == NULL)
+    {
+        fprintf(stderr, "Memory allocation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < opt->shops; i++)
+    {
+        shopLevel[i] = 0.85 + 0.4 * NextUnit();
+        shopIds[i] = i + 1;
+    }
+
+    int offerId = 1;
+    char name[160];
+    for (int id = 1; id <= opt->products; id++)
+    {
+        snprintf(name, sizeof(name), "%s %s %s #%d", brands[NextInt(COUNT_OF(brands))],
+                 goods[NextInt(COUNT_OF(goods))], sizes[NextInt(COUNT_OF(sizes))], id);
+        int p;
+        sqlite3_stmt *productStmt = NextBatchRow(&productBatch, &p);
+        sqlite3_bind_int(productStmt, p, id);
+        sqlite3_bind_text(productStmt, p + 1, name, -1, SQLITE_TRANSIENT);
+        FinishBatchRow(&productBatch);
+
+        // Log-normal-ish base price between a few cents and tens of euros
+        double basePrice = exp(log(0.3) + NextUnit() * (log(40.0) - log(0.3)));
+
+        // Partial Fisher-Yates picks distinct shops for the offers of this product
+        for (int k = 0; k < offersPerProduct; k++)
+        {
+            int j = k + NextInt(opt->shops - k);
+            int tmp = shopIds[k];
+            shopIds[k] = shopIds[j];
+            shopIds[j] = tmp;
+
+            int shopId = shopIds[k];
+            double price = basePrice * shopLevel[shopId - 1] * (0.95 + 0.1 * NextUnit());
+            price = round(price * 100.0) / 100.0;
+            if (price < 0.01)
+            {
+                price = 0.01;
+            }
+
+            sqlite3_stmt *offerStmt = NextBatchRow(&offerBatch, &p);
+            sqlite3_bind_int(offerStmt, p, offerId++);
+            sqlite3_bind_int(offerStmt, p + 1, shopId);
+            sqlite3_bind_int(offerStmt, p + 2, id);
+            sqlite3_bind_double(offerStmt, p + 3, price);
+            FinishBatchRow(&offerBatch);
+        }
+    }
+
+    free(shopLevel);
+    free(shopIds);
+    BatchInsertEnd(&productBatch);
+    BatchInsertEnd(&offerBatch);
+}
+
+static void GenerateClients(sqlite3 *db, const GenOptions *opt)
+{
+    BatchInsert batch;
+    BatchInsertBegin(&batch, db, "INSERT INTO clients (id, first_name, last_name) VALUES ", 3, opt->clients);
+    for (int id = 1; id <= opt->clients; id++)
+    {
+        int p;
+        sqlite3_stmt *stmt = NextBatchRow(&batch, &p);
+        sqlite3_bind_int(stmt, p, id);
+        sqlite3_bind_text(stmt, p + 1, firstNames[NextInt(COUNT_OF(firstNames))], -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, p + 2, lastNames[NextInt(COUNT_OF(lastNames))], -1, SQLITE_STATIC);
+        FinishBatchRow(&batch);
+    }
+    BatchInsertEnd(&batch);
+}
+
+static void GenerateOrders(sqlite3 *db, const GenOptions *opt)
+{
+    // Zipf popularity by rank, ranks are shuffled over product ids so popular products are spread out
+    double *weights = malloc((size_t)(opt->products > opt->clients ? opt->products : opt->clients) * sizeof(double));
+    int *productByRank = malloc((size_t)opt->products * sizeof(int));
+    if (weights == NULL || productByRank == NULL)
+    {
+        fprintf(stderr, "Memory allocation failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < opt->products; i++)
+    {
+        weights[i] = 1.0 / pow((double)(i + 1), opt->zipfExponent);
+        productByRank[i] = i + 1;
+    }
+    ShuffleIds(productByRank, opt->products);
+    AliasTable productTable;
+    BuildAliasTable(&productTable, weights, opt->products);
+
+    // Pareto weights give most clients a handful of orders and a few clients a very large number
+    for (int i = 0; i < opt->clients; i++)
+    {
+        weights[i] = pow(NextUnit(), -1.0 / opt->paretoAlpha);
+    }
+    AliasTable clientTable;
+    BuildAliasTable(&clientTable, weights, opt->clients);
+    free(weights);
+
+    BatchInsert batch;
+    BatchInsertBegin(&batch, db, "INSERT INTO orders (id, client_id, product_id, amount) VALUES ", 4, opt->orders);
+    for (long id = 1; id <= opt->orders; id++)
+    {
+        int clientId = SampleAlias(&clientTable) + 1;
+        int productId = productByRank[SampleAlias(&productTable)];
+        // Mostly single items, sometimes a few more
+        int amount = 1 + (NextUnit() < 0.3 ? NextInt(5) : 0);
+
+        int p;
+        sqlite3_stmt *stmt = NextBatchRow(&batch, &p);
+        sqlite3_bind_int64(stmt, p, id);
+        sqlite3_bind_int(stmt, p + 1, clientId);
+        sqlite3_bind_int(stmt, p + 2, productId);
+        sqlite3_bind_int(stmt, p + 3, amount);
+        FinishBatchRow(&batch);
+    }
+    BatchInsertEnd(&batch);
+
+    FreeAliasTable(&productTable);
+    FreeAliasTable(&clientTable);
+    free(productByRank);
+}
+
+static void PrintUsage(const char *program)
+{
+    fprintf(stderr,
+            "Usage: %s --db <path> [--force] [--seed N] [--shops N] [--products N]\n"
+            "          [--offers-per-product N] [--clients N] [--orders N]\n"
+            "          [--zipf S] [--pareto-alpha A]\n",
+            program);
+}
+
+static int ParseOptions(int argc, char **argv, GenOptions *opt)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(arg, "--force") == 0)
+        {
+            opt->force = 1;
+            continue;
+        }
+        if (value == NULL)
+        {
+            fprintf(stderr, "Missing value for %s\n", arg);
+            return 0;
+        }
+        i++;
+        if (strcmp(arg, "--db") == 0)
+            opt->dbPath = value;
+        else if (strcmp(arg, "--seed") == 0)
+            opt->seed = strtoull(value, NULL, 10);
+        else if (strcmp(arg, "--shops") == 0)
+            opt->shops = atoi(value);
+        else if (strcmp(arg, "--products") == 0)
+            opt->products = atoi(value);
+        else if (strcmp(arg, "--offers-per-product") == 0)
+            opt->offersPerProduct = atoi(value);
+        else if (strcmp(arg, "--clients") == 0)
+            opt->clients = atoi(value);
+        else if (strcmp(arg, "--orders") == 0)
+            opt->orders = atol(value);
+        else if (strcmp(arg, "--zipf") == 0)
+            opt->zipfExponent = atof(value);
+        else if (strcmp(arg, "--pareto-alpha") == 0)
+            opt->paretoAlpha = atof(value);
+        else
+        {
+            fprintf(stderr, "Unknown option %s\n", arg);
+            return 0;
+        }
+    }
+
+    if (opt->dbPath == NULL || opt->shops <= 0 || opt->products <= 0 || opt->offersPerProduct <= 0 ||
+        opt->clients <= 0 || opt->orders < 0 || opt->zipfExponent <= 0.0 || opt->paretoAlpha <= 0.0)
+    {
+        return 0;
+    }
+    return 1;
+}
+
+int main(int argc, char **argv)
+{
+    GenOptions opt = {
+        .dbPath = NULL,
+        .force = 0,
+        .seed = 42,
+        .shops = 50,
+        .products = 100000,
+        .offersPerProduct = 10,
+        .clients = 100000,
+        .orders = 1000000,
+        .zipfExponent = 1.0,
+        .paretoAlpha = 1.5};
+
+    if (!ParseOptions(argc, argv, &opt))
+    {
+        PrintUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (access(opt.dbPath, F_OK) == 0)
+    {
+        if (!opt.force)
+        {
+            fprintf(stderr, "%s already exists, use --force to replace it.\n", opt.dbPath);
+            return EXIT_FAILURE;
+        }
+        unlink(opt.dbPath);
+    }
+
+    rngState = opt.seed;
+
+    sqlite3 *db = NULL;
+    if (sqlite3_open_v2(opt.dbPath, &db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "Error opening database: %s\n", sqlite3_errmsg(db));
+        sqlite3_close(db);
+        return EXIT_FAILURE;
+    }
+
+    // The file is brand new, if the load fails it is simply regenerated, so skip journaling
+    Exec(db, "PRAGMA journal_mode = OFF; PRAGMA synchronous = OFF; PRAGMA cache_size = -262144;");
+    Exec(db, schemaSql);
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    // Everything goes through one transaction, indexes are left to the migrations in db_init
+    Exec(db, "BEGIN;");
+    GenerateShops(db, &opt);
+    GenerateProductsAndOffers(db, &opt);
+    fprintf(stderr, "catalog done in %.2fs\n", Elapsed(&start));
+    GenerateClients(db, &opt);
+    GenerateOrders(db, &opt);
+    Exec(db, "COMMIT;");
+
+    double seconds = Elapsed(&start);
+    int offersPerProduct = opt.offersPerProduct < opt.shops ? opt.offersPerProduct : opt.shops;
+    long rows = opt.shops + (long)opt.products * (1 + offersPerProduct) + opt.clients + opt.orders;
+    printf("Generated %s (seed %llu): %d shops, %d products, %ld offers, %d clients, %ld orders\n",
+           opt.dbPath, (unsigned long long)opt.seed, opt.shops, opt.products, (long)opt.products * offersPerProduct,
+           opt.clients, opt.orders);
+    printf("Loaded %ld rows in %.2fs (%.0f rows/s)\n", rows, seconds, seconds > 0 ? rows / seconds : 0.0);
+
+    sqlite3_close(db);
+    return 0;
+}
@@ -0,0 +1,710 @@
+// Consistency checks for the layers that answer from memory or write from another thread.
+//
+// Every check runs on a scratch copy of the database. It changes rows in autocommit mode, inside
+// an open transaction, after a rollback and from a second connection, and after each step compares
+// what the layer returns with plain SQL:
+//
+//  - catalog:      CatalogGetProduct and CatalogGetCheapestOffer against products and product_best_offer
+//  - entity-cache: GetProductById and GetClientById against products and clients
+//  - cursors:      every page of the client and product cursors against one ORDER BY query
+//  - order-writer: concurrent SubmitOrderWrite calls, a rolled back batch and a batch behind another
+//                  writer against the rows they left in orders
+//  - analytics:    the client cost summaries of the sql engine (client_shop_cost kept by its triggers)
+//                  against the matrix engine, which recomputes them from the offers, duplicate offers included
+//
+// Prints one line per step. The exit status is the number of mismatches, capped at 100.
+//
+// Usage: verify [--db path] [--scratch path] [--check catalog|entity-cache|cursors|order-writer|analytics|all]
+
+#include <sqlite3.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "../db_api/db.h"
+#include "../db_api/orders.h"
+#include "../db_api/product.h"
+#include "../db_api/clients.h"
+#include "../db_api/offers.h"
+#include "../db_api/catalog.h"
+#include "../db_api/connection.h"
+#include "../db_api/entity_cache.h"
+#include "../db_api/arena.h"
+#include "../db_api/search_cursor.h"
+#include "../db_api/order_writer.h"
+#include "../db_api/analytics.h"
+
+// Mismatches printed per step, the rest are only counted
+#define MAX_REPORTED 5
+
+#define WRITER_THREADS 4
+#define WRITES_PER_THREAD 50
+
+typedef struct {
+    const char *dbPath;
+    const char *scratchPath;
+    const char *check;
+} VerifyOptions;
+
+static FILE *out;
+static int mismatches = 0;
+
+static void Mismatch(const char *label, int *bad, const char *format, int a, int b)
+{
+    if ((*bad)++ < MAX_REPORTED)
+    {
+        fprintf(out, "  %s: ", label);
+        fprintf(out, format, a, b);
+        fputc('\n', out);
+    }
+}
+
+static void EndStep(const char *check, const char *label, long checked, int bad)
+{
+    fprintf(out, "%-13s %-12s checked %8ld  mismatches %d\n", check, label, checked, bad);
+    mismatches += bad;
+}
+
+static int SameText(const char *a, const unsigned char *b)
+{
+    return (a == NULL && b == NULL) || (a != NULL && b != NULL && strcmp(a, (const char *)b) == 0);
+}
+
+static void Exec(sqlite3 *db, const char *sql)
+{
+    char *errMsg = NULL;
+    if (sqlite3_exec(db, sql, NULL, NULL, &errMsg) != SQLITE_OK)
+    {
+        fprintf(stderr, "Error executing \"%.60s...\": %s\n", sql, errMsg);
+        sqlite3_free(errMsg);
+        exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * @brief Runs a change in a second connection, committed behind the back of the checked one.
+ */
+static void ExecOther(const char *path, const char *sql)
+{
+    sqlite3 *other;
+    if (sqlite3_open(path, &other) != SQLITE_OK)
+    {
+        fprintf(stderr, "Error opening second connection: %s\n", sqlite3_errmsg(other));
+        exit(EXIT_FAILURE);
+    }
+    sqlite3_busy_timeout(other, 5000);
+    Exec(other, sql);
+    sqlite3_close(other);
+}
+
+static sqlite3_stmt *Prepare(sqlite3 *db, const char *sql)
+{
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "Error preparing statement: %s\n", sqlite3_errmsg(db));
+        exit(EXIT_FAILURE);
+    }
+    return stmt;
+}
+
+static int QueryInt(sqlite3 *db, const char *sql)
+{
+    sqlite3_stmt *stmt = Prepare(db, sql);
+    int value = sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int(stmt, 0) : 0;
+    sqlite3_finalize(stmt);
+    return value;
+}
+
+/**
+ * @brief Copies the database into the scratch file with the backup API, replacing what was there.
+ */
+static void MakeScratchCopy(const VerifyOptions *opt)
+{
+    const char *suffixes[] = {"", "-wal", "-shm", "-journal"};
+    for (size_t i = 0; i < sizeof(suffixes) / sizeof(suffixes[0]); i++)
+    {
+        char path[1024];
+        snprintf(path, sizeof(path), "%s%s", opt->scratchPath, suffixes[i]);
+        unlink(path);
+    }
+
+    sqlite3 *source;
+    sqlite3 *scratch;
+    if (sqlite3_open_v2(opt->dbPath, &source, SQLITE_OPEN_READONLY, NULL) != SQLITE_OK ||
+        sqlite3_open(opt->scratchPath, &scratch) != SQLITE_OK)
+    {
+        fprintf(stderr, "Could not open %s or %s\n", opt->dbPath, opt->scratchPath);
+        exit(EXIT_FAILURE);
+    }
+    sqlite3_backup *backup = sqlite3_backup_init(scratch, "main", source, "main");
+    int rs = backup != NULL ? sqlite3_backup_step(backup, -1) : sqlite3_errcode(scratch);
+    sqlite3_backup_finish(backup);
+    sqlite3_close(source);
+    sqlite3_close(scratch);
+    if (rs != SQLITE_DONE)
+    {
+        fprintf(stderr, "Could not copy %s: %s\n", opt->dbPath, sqlite3_errstr(rs));
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void CompareCatalog(sqlite3 *db, const char *label)
+{
+    Catalog *catalog = GetConnection(db)->catalog;
+    sqlite3_stmt *ids = Prepare(db, "SELECT id FROM products UNION SELECT product_id FROM offers;");
+    sqlite3_stmt *best = Prepare(db, "SELECT offer_id, shop_id, price FROM product_best_offer WHERE product_id = ?1"
+                                     " ORDER BY shop_id, offer_id LIMIT 1;");
+    sqlite3_stmt *name = Prepare(db, "SELECT name FROM products WHERE id = ?1;");
+    long checked = 0;
+    int bad = 0;
+    while (sqlite3_step(ids) == SQLITE_ROW)
+    {
+        int productId = sqlite3_column_int(ids, 0);
+
+        Offer offer = {0};
+        int rsMirror = CatalogGetCheapestOffer(catalog, productId, &offer);
+        sqlite3_bind_int(best, 1, productId);
+        int rsSql = sqlite3_step(best);
+        if (rsMirror != rsSql ||
+            (rsSql == SQLITE_ROW && (offer.id != sqlite3_column_int(best, 0) || offer.shop_id != sqlite3_column_int(best, 1) ||
+                                     offer.price != sqlite3_column_double(best, 2))))
+        {
+            Mismatch(label, &bad, "cheapest offer of product %d differs (mirror offer %d)", productId, offer.id);
+        }
+        sqlite3_reset(best);
+
+        CatalogProduct product;
+        rsMirror = CatalogGetProduct(catalog, productId, &product);
+        sqlite3_bind_int(name, 1, productId);
+        rsSql = sqlite3_step(name);
+        if (rsMirror != rsSql || (rsSql == SQLITE_ROW && !SameText(product.name, sqlite3_column_text(name, 0))))
+        {
+            Mismatch(label, &bad, "product %d differs (result %d)", productId, rsMirror);
+        }
+        sqlite3_reset(name);
+        checked++;
+    }
+    sqlite3_finalize(ids);
+    sqlite3_finalize(best);
+    sqlite3_finalize(name);
+    EndStep("catalog", label, checked, bad);
+}
+
+static void VerifyCatalog(const char *path)
+{
+    sqlite3 *db;
+    db_open(&db, path);
+    if (EnableCatalog(db) != SQLITE_OK)
+    {
+        fprintf(stderr, "Could not load the catalog mirror\n");
+        exit(EXIT_FAILURE);
+    }
+    CompareCatalog(db, "initial");
+    Exec(db, "UPDATE offers SET price = price * 0.5 WHERE id % 7 = 0;"
+             "DELETE FROM offers WHERE id % 11 = 0;"
+             "INSERT INTO offers (shop_id, product_id, price) SELECT shop_id, product_id, price - 0.01 FROM offers WHERE id % 13 = 0;"
+             "UPDATE products SET name = name || ' X' WHERE id % 5 = 0;"
+             "INSERT INTO products (name) VALUES ('Brand new Õun');");
+    CompareCatalog(db, "autocommit");
+    Exec(db, "BEGIN; UPDATE offers SET price = 0.001 WHERE id % 3 = 0; DELETE FROM products WHERE id % 4 = 0;");
+    CompareCatalog(db, "in-tx");
+    Exec(db, "ROLLBACK;");
+    CompareCatalog(db, "rolled back");
+    Exec(db, "BEGIN; UPDATE offers SET product_id = product_id + 1 WHERE id % 17 = 0;"
+             "UPDATE offers SET price = NULL WHERE id % 19 = 0;");
+    CompareCatalog(db, "in-tx 2");
+    Exec(db, "COMMIT;");
+    CompareCatalog(db, "committed");
+    // More changed rows than the mirror re-reads one by one, it reloads everything
+    Exec(db, "UPDATE offers SET price = price + 1;");
+    CompareCatalog(db, "bulk");
+    ExecOther(path, "UPDATE offers SET price = price - 2 WHERE id % 23 = 0; UPDATE products SET name = 'Other' WHERE id = 3;");
+    CompareCatalog(db, "other conn");
+    db_close(db);
+}
+
+static void CompareEntityCache(sqlite3 *db, const char *label, int maxId)
+{
+    sqlite3_stmt *productName = Prepare(db, "SELECT name FROM products WHERE id = ?1;");
+    sqlite3_stmt *clientName = Prepare(db, "SELECT first_name, last_name FROM clients WHERE id = ?1;");
+    long checked = 0;
+    int bad = 0;
+    // The second round is answered from the cache
+    for (int round = 0; round < 2; round++)
+    {
+        for (int id = 1; id <= maxId; id++)
+        {
+            Product product = {.id = 0};
+            int rsCache = GetProductById(db, id, &product);
+            sqlite3_bind_int(productName, 1, id);
+            int rsSql = sqlite3_step(productName);
+            if (rsCache != rsSql ||
+                (rsSql == SQLITE_ROW && !SameText(ShortStringGet(&product.name), sqlite3_column_text(productName, 0))))
+            {
+                Mismatch(label, &bad, "product %d differs (result %d)", id, rsCache);
+            }
+            sqlite3_reset(productName);
+            FreeProduct(&product);
+
+            Client client = {.id = 0};
+            rsCache = GetClientById(db, id, &client);
+            sqlite3_bind_int(clientName, 1, id);
+            rsSql = sqlite3_step(clientName);
+            if (rsCache != rsSql ||
+                (rsSql == SQLITE_ROW && (!SameText(ShortStringGet(&client.first_name), sqlite3_column_text(clientName, 0)) ||
+                                         !SameText(ShortStringGet(&client.last_name), sqlite3_column_text(clientName, 1)))))
+            {
+                Mismatch(label, &bad, "client %d differs (result %d)", id, rsCache);
+            }
+            sqlite3_reset(clientName);
+            FreeClient(&client);
+            checked += 2;
+        }
+    }
+    sqlite3_finalize(productName);
+    sqlite3_finalize(clientName);
+    EndStep("entity-cache", label, checked, bad);
+}
+
+static void VerifyEntityCache(const char *path)
+{
+    sqlite3 *db;
+    db_open(&db, path);
+    if (GetConnection(db)->catalog != NULL)
+    {
+        fprintf(out, "entity-cache skipped, the catalog mirror answers GetProductById (catalog_mirror = on)\n");
+        db_close(db);
+        return;
+    }
+    // A few ids past the end check the cached "no such id" answers
+    int maxId = QueryInt(db, "SELECT max((SELECT max(id) FROM products), (SELECT max(id) FROM clients)) + 10;");
+    CompareEntityCache(db, "initial", maxId);
+    Exec(db, "UPDATE products SET name = name || ' X' WHERE id % 5 = 0;"
+             "UPDATE clients SET last_name = NULL WHERE id % 7 = 0;"
+             "DELETE FROM products WHERE id % 9 = 0 AND id NOT IN (SELECT product_id FROM orders)"
+             " AND id NOT IN (SELECT product_id FROM offers);");
+    CompareEntityCache(db, "autocommit", maxId);
+    Exec(db, "BEGIN; UPDATE products SET name = 'TX' WHERE id % 3 = 0;"
+             "INSERT INTO clients (first_name, last_name) VALUES ('A', 'B');");
+    CompareEntityCache(db, "in-tx", maxId);
+    Exec(db, "ROLLBACK;");
+    CompareEntityCache(db, "rolled back", maxId);
+    ExecOther(path, "UPDATE products SET name = 'Other' WHERE id = 2; UPDATE clients SET first_name = 'Other' WHERE id = 3;");
+    CompareEntityCache(db, "other conn", maxId);
+    db_close(db);
+}
+
+/**
+ * @brief Pages through one cursor and compares the ids with a single query in the documented order.
+ */
+static void CompareCursor(sqlite3 *db, int clients, const char *term, int id, int pageSize, Arena *arena, long *checked,
+                          int *bad)
+{
+    sqlite3_stmt *expected = Prepare(
+        db, clients ? "SELECT id FROM clients WHERE id = ?1 OR first_name LIKE '%' || ?2 || '%' OR last_name LIKE '%' || ?2 || '%'"
+                      " ORDER BY last_name, first_name, id;"
+                    : "SELECT id FROM products WHERE id = ?1 OR name LIKE '%' || ?2 || '%' ORDER BY name, id;");
+    sqlite3_bind_int(expected, 1, id);
+    sqlite3_bind_text(expected, 2, term, -1, SQLITE_STATIC);
+
+    Client clientSearch = {.id = id};
+    ShortStringSet(&clientSearch.first_name, term);
+    ShortStringSet(&clientSearch.last_name, term);
+    Product productSearch = {.id = id};
+    ShortStringSet(&productSearch.name, term);
+    SearchCursor *cursor;
+    int rs = clients ? OpenClientCursor(db, &clientSearch, pageSize, &cursor) : OpenProductCursor(db, &productSearch, pageSize, &cursor);
+    FreeClient(&clientSearch);
+    FreeProduct(&productSearch);
+    if (rs != SQLITE_OK)
+    {
+        Mismatch("cursor", bad, "could not open cursor (%d, page size %d)", rs, pageSize);
+        sqlite3_finalize(expected);
+        return;
+    }
+
+    ClientVector clientPage;
+    ProductVector productPage;
+    ClientVectorInitArena(&clientPage, arena);
+    ProductVectorInitArena(&productPage, arena);
+    while ((rs = clients ? CursorNextClientPage(cursor, &clientPage) : CursorNextProductPage(cursor, &productPage)) == SQLITE_ROW)
+    {
+        size_t count = clients ? clientPage.count : productPage.count;
+        if (count == 0 || count > (size_t)pageSize)
+        {
+            Mismatch(term, bad, "page of %d rows with page size %d", (int)count, pageSize);
+        }
+        for (size_t i = 0; i < count; i++)
+        {
+            int got = clients ? ClientVectorAt(&clientPage, i)->id : ProductVectorAt(&productPage, i)->id;
+            int want = sqlite3_step(expected) == SQLITE_ROW ? sqlite3_column_int(expected, 0) : -1;
+            if (got != want)
+            {
+                Mismatch(term, bad, "cursor returned id %d where the query has %d", got, want);
+            }
+            (*checked)++;
+        }
+    }
+    if (rs != SQLITE_DONE || !CursorFinished(cursor) || sqlite3_step(expected) != SQLITE_DONE)
+    {
+        Mismatch(term, bad, "cursor ended early or with %d (page size %d)", rs, pageSize);
+    }
+    ClientVectorFree(&clientPage);
+    ProductVectorFree(&productPage);
+    CloseCursor(cursor);
+    sqlite3_finalize(expected);
+}
+
+static void VerifyCursors(const char *path)
+{
+    sqlite3 *db;
+    db_open(&db, path);
+    // NULL and empty names sort first and repeated names need the id as tie breaker
+    Exec(db, "INSERT INTO clients (first_name, last_name) VALUES (NULL, 'Tamm'), ('Mari', NULL), (NULL, NULL),"
+             " ('Mari', 'Tamm'), ('Mari', 'Tamm'), ('', '');"
+             "INSERT INTO products (name) VALUES (NULL), (''), ('piim'), ('piim');");
+    Arena *arena = ArenaCreate(0);
+    const char *terms[] = {"a", "Ma", "Tamm", "zzz", "", "piim", "e"};
+    int pageSizes[] = {1, 7, 20, 1000000};
+    for (int clients = 0; clients < 2; clients++)
+    {
+        long checked = 0;
+        int bad = 0;
+        for (size_t t = 0; t < sizeof(terms) / sizeof(terms[0]); t++)
+        {
+            for (size_t s = 0; s < sizeof(pageSizes) / sizeof(pageSizes[0]); s++)
+            {
+                // Every other page size reads into an arena backed vector
+                CompareCursor(db, clients, terms[t], 3, pageSizes[s], s % 2 ? arena : NULL, &checked, &bad);
+            }
+        }
+        EndStep("cursors", clients ? "clients" : "products", checked, bad);
+    }
+    ArenaDestroy(arena);
+    db_close(db);
+}
+
+typedef struct {
+    OrderWriter *writer;
+    int thread;
+    int ids[WRITES_PER_THREAD];
+    int failed;
+} WriterThread;
+
+static void *SubmitInserts(void *arg)
+{
+    WriterThread *t = arg;
+    for (int i = 0; i < WRITES_PER_THREAD; i++)
+    {
+        Order order = {.id = 0, .client_id = 1 + t->thread, .product_id = 1, .amount = 1 + i};
+        OrderWrite *write = SubmitOrderWrite(t->writer, ORDER_WRITE_INSERT, &order);
+        t->ids[i] = WaitOrderWrite(write, &order) == SQLITE_DONE ? order.id : -1;
+        t->failed += t->ids[i] < 0;
+    }
+    return NULL;
+}
+
+static void VerifyOrderWriter(const char *path)
+{
+    sqlite3 *db;
+    db_open(&db, path);
+    int ordersBefore = QueryInt(db, "SELECT count(*) FROM orders;");
+
+    OrderWriter *writer;
+    if (OrderWriterOpen(path, 16, 1.0, &writer) != SQLITE_OK)
+    {
+        fprintf(stderr, "Could not start the order writer\n");
+        exit(EXIT_FAILURE);
+    }
+    WriterThread threads[WRITER_THREADS];
+    pthread_t handles[WRITER_THREADS];
+    for (int i = 0; i < WRITER_THREADS; i++)
+    {
+        threads[i] = (WriterThread){.writer = writer, .thread = i};
+        pthread_create(&handles[i], NULL, SubmitInserts, &threads[i]);
+    }
+    for (int i = 0; i < WRITER_THREADS; i++)
+    {
+        pthread_join(handles[i], NULL);
+    }
+
+    // An invalid write fails on its own without failing the valid write batched with it
+    Order invalid = {.id = 0, .client_id = 0, .product_id = 1, .amount = 1};
+    Order valid = {.id = 0, .client_id = 1, .product_id = 1, .amount = 7};
+    OrderWrite *invalidWrite = SubmitOrderWrite(writer, ORDER_WRITE_INSERT, &invalid);
+    OrderWrite *validWrite = SubmitOrderWrite(writer, ORDER_WRITE_INSERT, &valid);
+    int invalidRs = WaitOrderWrite(invalidWrite, NULL);
+    int validRs = WaitOrderWrite(validWrite, &valid);
+
+    // RAISE(ROLLBACK) ends the whole transaction like SQLITE_FULL would: the writes batched with the failing one
+    // must not report success, wherever the batches are cut a write is reported committed only if its row is there
+    Exec(db, "CREATE TRIGGER verify_rollback BEFORE INSERT ON orders WHEN NEW.amount = 1002 "
+             "BEGIN SELECT RAISE(ROLLBACK, 'verify rollback'); END;");
+    OrderWrite *lostWrites[3];
+    int lostRs[3];
+    for (int i = 0; i < 3; i++)
+    {
+        Order lost = {.id = 0, .client_id = 1, .product_id = 1, .amount = 1001 + i};
+        lostWrites[i] = SubmitOrderWrite(writer, ORDER_WRITE_INSERT, &lost);
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        lostRs[i] = WaitOrderWrite(lostWrites[i], NULL);
+    }
+    Exec(db, "DROP TRIGGER verify_rollback;");
+
+    // Another connection holding the write lock for a while delays the batch instead of failing it
+    Exec(db, "BEGIN IMMEDIATE;");
+    Order waiting = {.id = 0, .client_id = 1, .product_id = 1, .amount = 1004};
+    OrderWrite *waitingWrite = SubmitOrderWrite(writer, ORDER_WRITE_INSERT, &waiting);
+    usleep(200 * 1000);
+    Exec(db, "COMMIT;");
+    int waitingRs = WaitOrderWrite(waitingWrite, NULL);
+
+    // Writes still queued when the writer closes are applied before it stops
+    Order modified = {.id = valid.id, .client_id = 1, .product_id = 1, .amount = 9};
+    Order deleted = {.id = threads[0].ids[0]};
+    OrderWrite *modifyWrite = SubmitOrderWrite(writer, ORDER_WRITE_MODIFY, &modified);
+    OrderWrite *deleteWrite = SubmitOrderWrite(writer, ORDER_WRITE_DELETE, &deleted);
+    OrderWriterStats stats;
+    GetOrderWriterStats(writer, &stats);
+    OrderWriterClose(writer);
+    int modifyRs = WaitOrderWrite(modifyWrite, NULL);
+    int deleteRs = WaitOrderWrite(deleteWrite, NULL);
+
+    int bad = 0;
+    long checked = 0;
+    sqlite3_stmt *amount = Prepare(db, "SELECT amount FROM orders WHERE id = ?1;");
+    for (int t = 0; t < WRITER_THREADS; t++)
+    {
+        for (int i = 0; i < WRITES_PER_THREAD; i++)
+        {
+            int id = threads[t].ids[i];
+            sqlite3_bind_int(amount, 1, id);
+            int rs = sqlite3_step(amount);
+            int deletedRow = t == 0 && i == 0;
+            if (id < 0 || (deletedRow ? rs != SQLITE_DONE : rs != SQLITE_ROW || sqlite3_column_int(amount, 0) != 1 + i))
+            {
+                Mismatch("writes", &bad, "insert %d of thread %d is not in orders as reported", i, t);
+            }
+            sqlite3_reset(amount);
+            checked++;
+        }
+    }
+    sqlite3_bind_int(amount, 1, valid.id);
+    if (sqlite3_step(amount) != SQLITE_ROW || sqlite3_column_int(amount, 0) != 9)
+    {
+        Mismatch("writes", &bad, "modified order %d does not have amount %d", valid.id, 9);
+    }
+    sqlite3_finalize(amount);
+    if (invalidRs == SQLITE_DONE || validRs != SQLITE_DONE || modifyRs != SQLITE_DONE || deleteRs != SQLITE_DONE)
+    {
+        Mismatch("writes", &bad, "unexpected results: invalid insert %d, valid insert %d", invalidRs, validRs);
+    }
+    sqlite3_stmt *lostRows = Prepare(db, "SELECT count(*) FROM orders WHERE amount = ?1;");
+    int committed = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        sqlite3_bind_int(lostRows, 1, 1001 + i);
+        int rows = sqlite3_step(lostRows) == SQLITE_ROW ? sqlite3_column_int(lostRows, 0) : -1;
+        sqlite3_reset(lostRows);
+        if (rows != (lostRs[i] == SQLITE_DONE) || (i == 1 && lostRs[i] == SQLITE_DONE))
+        {
+            Mismatch("writes", &bad, "insert %d around a rollback reported %d, rows do not match", i, lostRs[i]);
+        }
+        committed += lostRs[i] == SQLITE_DONE;
+    }
+    sqlite3_finalize(lostRows);
+    if (waitingRs != SQLITE_DONE)
+    {
+        Mismatch("writes", &bad, "insert of amount %d behind another writer failed with %d", waiting.amount, waitingRs);
+    }
+    int added = QueryInt(db, "SELECT count(*) FROM orders;") - ordersBefore;
+    int expected = WRITER_THREADS * WRITES_PER_THREAD + committed + 1;
+    if (added != expected)
+    {
+        Mismatch("writes", &bad, "orders grew by %d rows instead of %d", added, expected);
+    }
+    checked += 8;
+    db_close(db);
+    fprintf(out, "order-writer %ld writes in %ld batches, largest %d\n", stats.writes, stats.batches, stats.largestBatch);
+    EndStep("order-writer", "concurrent", checked, bad);
+}
+
+/**
+ * @brief Loads the summaries of one engine into a copy, the engine's own array is replaced by the next call.
+ */
+static ClientCostSummary *EngineSummaries(sqlite3 *db, const char *engine, size_t *count)
+{
+    const ClientCostSummary *summaries;
+    if (SetAnalyticsEngine(db, engine) != SQLITE_OK || GetClientCostSummaries(db, &summaries, count) != SQLITE_OK)
+    {
+        fprintf(stderr, "The %s engine could not compute the client cost summaries\n", engine);
+        exit(EXIT_FAILURE);
+    }
+    ClientCostSummary *copy = malloc((*count ? *count : 1) * sizeof(ClientCostSummary));
+    if (copy == NULL)
+    {
+        fprintf(stderr, "Memory allocation failed for summaries.\n");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(copy, summaries, *count * sizeof(ClientCostSummary));
+    return copy;
+}
+
+static void CompareEngines(sqlite3 *db, const char *label)
+{
+    size_t sqlCount;
+    size_t matrixCount;
+    ClientCostSummary *sql = EngineSummaries(db, "sql", &sqlCount);
+    ClientCostSummary *matrix = EngineSummaries(db, "matrix", &matrixCount);
+    int bad = 0;
+    if (sqlCount != matrixCount)
+    {
+        Mismatch(label, &bad, "sql has %d clients, matrix %d", (int)sqlCount, (int)matrixCount);
+    }
+    for (size_t i = 0; i < sqlCount && i < matrixCount; i++)
+    {
+        const ClientCostSummary *a = &sql[i];
+        const ClientCostSummary *b = &matrix[i];
+        // Both engines round the totals to 4 decimals
+        int fields[][2] = {
+            {a->clientId, b->clientId},
+            {a->bestShopId, b->bestShopId},
+            {(int)llround(a->bestCost * 1e4), (int)llround(b->bestCost * 1e4)},
+            {a->worstShopId, b->worstShopId},
+            {(int)llround(a->worstCost * 1e4), (int)llround(b->worstCost * 1e4)},
+            {a->shopsPriced, b->shopsPriced},
+            {a->shopsIncomplete, b->shopsIncomplete},
+            {a->ordersCount, b->ordersCount},
+            {a->ordersPriced, b->ordersPriced}};
+        for (size_t f = 0; f < sizeof(fields) / sizeof(fields[0]); f++)
+        {
+            if (fields[f][0] != fields[f][1])
+            {
+                Mismatch(label, &bad, "client %d differs in summary field %d", a->clientId, (int)f);
+                break;
+            }
+        }
+    }
+    free(sql);
+    free(matrix);
+    EndStep("analytics", label, (long)sqlCount, bad);
+}
+
+static void VerifyAnalytics(const char *path)
+{
+    sqlite3 *db;
+    db_open(&db, path);
+    CompareEngines(db, "initial");
+    // A second and third offer of the same shop and product add up in both engines
+    Exec(db, "INSERT INTO offers (shop_id, product_id, price) SELECT shop_id, product_id, price * 3 FROM offers"
+             " WHERE id % 3 = 0;"
+             "INSERT INTO offers (shop_id, product_id, price) SELECT shop_id, product_id, 0.5 FROM offers"
+             " WHERE id % 7 = 0;");
+    CompareEngines(db, "duplicates");
+    Exec(db, "UPDATE offers SET price = price + 1 WHERE id % 5 = 0;"
+             "UPDATE offers SET product_id = product_id + 1 WHERE id % 11 = 0;"
+             "UPDATE offers SET shop_id = (SELECT min(id) FROM shops) WHERE id % 13 = 0;"
+             "DELETE FROM offers WHERE id % 17 = 0;");
+    CompareEngines(db, "offer edits");
+    Exec(db, "DELETE FROM orders WHERE id % 13 = 0;"
+             "UPDATE orders SET amount = amount + 1 WHERE id % 7 = 0;"
+             "UPDATE orders SET product_id = product_id + 1 WHERE id % 19 = 0;"
+             "INSERT INTO orders (client_id, product_id, amount) SELECT client_id, product_id, 2 FROM orders"
+             " WHERE id % 5 = 0;");
+    CompareEngines(db, "order edits");
+    ExecOther(path, "INSERT INTO offers (shop_id, product_id, price) SELECT shop_id, product_id, 1 FROM offers"
+                    " WHERE id % 4 = 0; DELETE FROM offers WHERE id % 23 = 0;");
+    CompareEngines(db, "other conn");
+    db_close(db);
+}
+
+static void PrintUsage(const char *program)
+{
+    fprintf(stderr, "Usage: %s [--db path] [--scratch path] [--check catalog|entity-cache|cursors|order-writer|analytics|all]\n",
+            program);
+}
+
+static int ParseOptions(int argc, char **argv, VerifyOptions *opt)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (value == NULL)
+        {
+            fprintf(stderr, "Missing value for %s\n", arg);
+            return 0;
+        }
+        i++;
+        if (strcmp(arg, "--db") == 0)
+            opt->dbPath = value;
+        else if (strcmp(arg, "--scratch") == 0)
+            opt->scratchPath = value;
+        else if (strcmp(arg, "--check") == 0)
+            opt->check = value;
+        else
+        {
+            fprintf(stderr, "Unknown option %s\n", arg);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int main(int argc, char **argv)
+{
+    VerifyOptions opt = {
+        .dbPath = DB_PATH,
+        .scratchPath = "build/verify.db",
+        .check = "all"};
+
+    if (!ParseOptions(argc, argv, &opt))
+    {
+        PrintUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // Results go to the real stdout, what db_open and the migrations print goes to the sink
+    out = fdopen(dup(STDOUT_FILENO), "w");
+    if (out == NULL || freopen("/dev/null", "w", stdout) == NULL)
+    {
+        fprintf(stderr, "Could not redirect stdout.\n");
+        return EXIT_FAILURE;
+    }
+
+    const struct {
+        const char *name;
+        void (*run)(const char *path);
+    } checks[] = {
+        {"catalog", VerifyCatalog},
+        {"entity-cache", VerifyEntityCache},
+        {"cursors", VerifyCursors},
+        {"order-writer", VerifyOrderWriter},
+        {"analytics", VerifyAnalytics}};
+    int ran = 0;
+    for (size_t i = 0; i < sizeof(checks) / sizeof(checks[0]); i++)
+    {
+        if (strcmp(opt.check, "all") == 0 || strcmp(opt.check, checks[i].name) == 0)
+        {
+            // Each check changes rows, so each starts from a fresh copy
+            MakeScratchCopy(&opt);
+            checks[i].run(opt.scratchPath);
+            fflush(out);
+            ran++;
+        }
+    }
+    if (ran == 0)
+    {
+        PrintUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    fprintf(out, "%d mismatch(es)\n", mismatches);
+    fclose(out);
+    return mismatches < 100 ? mismatches : 100;
+}